@@ -34,6 +34,9 @@
 #define RES_X 192
 #define RES_Y 147
 #define NFRAMES 128
+#define MAX_FRAMES 1024
+#define KEY_INTERVAL 32
+#define MAX_SIZE_FIRMWARE ( 128 * 1024 - 8 )
 #define BITS_PER_PIXEL 8
 #define CNT_AFTER_REPETITION 1
 
@@ -56,26 +59,64 @@ const unsigned char tml[ 4 * 4 ] =
 };
 
 // some memory for loading + dithering
-unsigned char rawData[ RES_X * RES_Y * NFRAMES ];
-unsigned char bitData[ RES_X * RES_Y * NFRAMES ];
+unsigned char rawData[ RES_X * RES_Y * MAX_FRAMES ];
+unsigned char bitData[ RES_X * RES_Y * MAX_FRAMES ];
 
 // ... plus generating the output (hopefully large enough)
 unsigned char output[ 512 * 1024 ];
 unsigned char flags[ 512 * 1024 ];
 unsigned char bitflags[ 512 * 1024 / 8 ];
 
+//
+// delta-compressed container (see Firmware/animation_delta.h): per block a top mask (one bit per non-zero mask byte),
+// the non-zero mask bytes (one bit per non-zero frame byte), and the non-zero bytes of the frame/XOR-delta
+//
+#define FRAME_BYTES ( RES_X * RES_Y / 8 )
+#define MASK_BYTES ( FRAME_BYTES / 8 )
+#define TOPMASK_BYTES ( ( MASK_BYTES + 7 ) / 8 )
+
+unsigned char container[ MAX_FRAMES * ( FRAME_BYTES + MASK_BYTES + TOPMASK_BYTES ) * 2 ];
+
+int encodeBlock( unsigned char *dst, const unsigned char *a, const unsigned char *b )
+{
+	unsigned char d[ FRAME_BYTES ], mask[ MASK_BYTES ];
+	unsigned char *top = dst;
+
+	for ( int i = 0; i < FRAME_BYTES; i++ )
+		d[ i ] = a[ i ] ^ ( b ? b[ i ] : 0 );
+
+	memset( mask, 0, MASK_BYTES );
+	memset( top, 0, TOPMASK_BYTES );
+	for ( int i = 0; i < FRAME_BYTES; i++ )
+		if ( d[ i ] ) mask[ i / 8 ] |= 1 << ( i & 7 );
+	for ( int i = 0; i < MASK_BYTES; i++ )
+		if ( mask[ i ] ) top[ i / 8 ] |= 1 << ( i & 7 );
+
+	unsigned char *o = dst + TOPMASK_BYTES;
+	for ( int i = 0; i < MASK_BYTES; i++ )
+		if ( mask[ i ] ) *(o++) = mask[ i ];
+	for ( int i = 0; i < FRAME_BYTES; i++ )
+		if ( d[ i ] ) *(o++) = d[ i ];
+
+	return (int)( o - dst );
+}
+
 int main( int argc, char **argv )
 {
 	char path[ 2048 ] = { 0 };
 	int flipY = 0;
 	int ditherType = 0;
+	int legacyRLE = 0;
+	int nFrames = 0;
 	float gamma = 1.5f, scale = 395.0f / 255.0f;
 
 	if ( argc < 5 )
 	{
-		printf( "usage: skanim f{l|o} gamma scale path output.zap\n" );
-		printf( "       converts a sequence of 128 raw-images (resolution 192x147, 8-bit gray scale) with filename 0000.raw 0001.raw etc.\n\n" );
+		printf( "usage: skanim f{l|o}r gamma scale path output.zap\n" );
+		printf( "       converts a sequence of up to %d raw-images (resolution 192x147, 8-bit gray scale) with filename 0000.raw 0001.raw etc.\n", MAX_FRAMES );
+		printf( "       into a delta-compressed animation (keyframe every %d frames)\n\n", KEY_INTERVAL );
 		printf( "       f       flip images vertically (not shown in preview!)\n" );
+		printf( "       r       old per-pixel RLE format (exactly 128 images, for firmware before the delta format)\n" );
 		printf( "       o       standard ordered dither matrix\n" );
 		printf( "       l       line-like dither matrix\n" );
 		printf( "       gamma   gamma-correction value (typically between 0.5 and 2.5)\n" );
@@ -87,6 +128,7 @@ int main( int argc, char **argv )
 	// options
 	if ( strstr( argv[ 1 ], "f" ) != 0 ) flipY = 1;
 	if ( strstr( argv[ 1 ], "l" ) != 0 ) ditherType = 1;
+	if ( strstr( argv[ 1 ], "r" ) != 0 ) legacyRLE = 1;
 
 	// gamma + scale
 	gamma = atof( argv[ 2 ] );
@@ -100,22 +142,31 @@ int main( int argc, char **argv )
 		path[ strlen( path ) + 1 ] = 0;
 	}
 
-	for ( int i = 0; i < NFRAMES; i++ )
+	for ( int i = 0; i < MAX_FRAMES; i++ )
 	{
 		char fn[ 4096 ];
 		sprintf( fn, "%s%04d.raw", path, i );
 
 		FILE *f = fopen( fn, "rb" );
+		if ( f == NULL ) break;
 		fread( &rawData[ i * RES_X * RES_Y ], 1, RES_X * RES_Y, f );
 		fclose( f );
+		nFrames ++;
 	}
 
-	memset( bitData, 0, RES_X * RES_Y * NFRAMES );
+	if ( nFrames == 0 || ( legacyRLE && nFrames < NFRAMES ) )
+	{
+		printf( "error: found %d images, need %d\n", nFrames, legacyRLE ? NFRAMES : 1 );
+		exit( 1 );
+	}
+	if ( legacyRLE ) nFrames = NFRAMES;
+
+	memset( bitData, 0, RES_X * RES_Y * MAX_FRAMES );
 
 	//
 	// Gamma-correction + dithering
 	//
-	for ( int f = 0; f < NFRAMES; f++ )
+	for ( int f = 0; f < nFrames; f++ )
 	{
 		for ( int y = 0; y < RES_Y; y++ )
 		{
@@ -163,6 +214,44 @@ int main( int argc, char **argv )
 		fclose( g );
 	}
 
+	if ( !legacyRLE )
+	{
+		//
+		// delta compression: XOR-delta to the previous frame (frame 0 to the last one), and keyframes
+		//
+		int nKeys = ( nFrames + KEY_INTERVAL - 1 ) / KEY_INTERVAL;
+		unsigned int *hdr = (unsigned int *)container;
+		unsigned int *deltaOfs = hdr + 2;
+		unsigned int *keyOfs = deltaOfs + nFrames;
+
+		hdr[ 0 ] = 0x44414b53; // "SKAD"
+		hdr[ 1 ] = nFrames | ( KEY_INTERVAL << 16 );
+
+		int size = ( 2 + nFrames + nKeys ) * 4;
+		for ( int f = 0; f < nFrames; f++ )
+		{
+			deltaOfs[ f ] = size;
+			size += encodeBlock( &container[ size ], &bitData[ f * FRAME_BYTES ], &bitData[ ( ( f + nFrames - 1 ) % nFrames ) * FRAME_BYTES ] );
+		}
+		for ( int k = 0; k < nKeys; k++ )
+		{
+			keyOfs[ k ] = size;
+			size += encodeBlock( &container[ size ], &bitData[ k * KEY_INTERVAL * FRAME_BYTES ], NULL );
+		}
+
+		printf( "%d frames, %d bytes (%.1f bytes/frame)\n", nFrames, size, (float)size / nFrames );
+		if ( size > MAX_SIZE_FIRMWARE )
+			printf( "warning: animation is larger than %d bytes and will not be shown by the firmware\n", MAX_SIZE_FIRMWARE );
+
+		FILE *f;
+		if ( argc > 5 )
+			f = fopen( argv[ 5 ], "wb" ); else
+			f = fopen( "animation.zap", "wb" );
+		fwrite( container, 1, size, f );
+		fclose( f );
+		return 0;
+	}
+
 	//
 	//
 	// RLE compression for "per-pixel" incremental reconstruction
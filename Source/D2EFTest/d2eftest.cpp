@@ -0,0 +1,116 @@
+/*
+  _________.__    .___      __   .__        __        ________  ________________________ 
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \______ \ \_____  \_   _____/\_   _____/
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /     |    |  \ /  ____/|    __)_  |    __)  
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <      |    `   \/       \|        \ |     \   
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \    /_______  /\_______ \_______  / \___  /   
+        \/         \/    \/     \/       \/     \/            \/         \/       \/      \/    
+
+
+ Sidekick64 - D2EF converter test
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// converts disk images with the original D2EF code (createD2EF) and the streaming converter (createD2EFStream)
+// for all build/mode/autostart combinations and compares the resulting CRTs byte by byte
+//
+// build:  g++ -O2 -fpermissive -w -o d2eftest d2eftest.cpp ../Firmware/D2EF/disk2easyflash.cpp ../Firmware/D2EF/bundle.cpp
+//             ../Firmware/D2EF/d64.cpp ../Firmware/D2EF/diskimage.cpp ../Firmware/D2EF/binaries.cpp ../Firmware/D2EF/d2efstream.cpp
+// usage:  d2eftest <image.d64> ...
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern int createD2EF( unsigned char *diskimage, int imageSize, unsigned char *cart, int build, int mode, int autostart );
+extern int createD2EFStream( unsigned char *diskimage, int imageSize, unsigned char *cart, int build, int mode, int autostart );
+
+#define CART_SIZE ( 1024 * 1025 + 64 * 1024 )
+
+static unsigned char diskimage[ 1024 * 1024 ];
+static unsigned char cartRef[ CART_SIZE ], cartNew[ CART_SIZE ];
+
+static double now()
+{
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main( int argc, char **argv )
+{
+	static const char *modeName[] = { "lo", "nm", "hi" };
+	static const char *buildName[] = { "", "xbank", "crt" };
+	int errors = 0, tests = 0;
+	double tRef = 0.0, tNew = 0.0;
+
+	if ( argc < 2 )
+	{
+		printf( "usage: %s <image.d64> ...\n", argv[ 0 ] );
+		return -1;
+	}
+
+	for ( int a = 1; a < argc; a++ )
+	{
+		FILE *f = fopen( argv[ a ], "rb" );
+		if ( f == NULL )
+		{
+			printf( "cannot open '%s'\n", argv[ a ] );
+			errors ++;
+			continue;
+		}
+		int imageSize = fread( diskimage, 1, sizeof( diskimage ), f );
+		fclose( f );
+
+		for ( int build = 1; build <= 2; build++ )
+			for ( int mode = 0; mode <= 2; mode++ )
+				for ( int autostart = 0; autostart <= 1; autostart++ )
+				{
+					memset( cartRef, 0x55, CART_SIZE );
+					memset( cartNew, 0xaa, CART_SIZE );
+
+					double t0 = now();
+					int sizeRef = createD2EF( diskimage, imageSize, cartRef, build, mode, autostart );
+					double t1 = now();
+					int sizeNew = createD2EFStream( diskimage, imageSize, cartNew, build, mode, autostart );
+					double t2 = now();
+					tRef += t1 - t0;
+					tNew += t2 - t1;
+					tests ++;
+
+					int diff = -1;
+					for ( int i = 0; i < sizeRef && i < sizeNew && diff < 0; i++ )
+						if ( cartRef[ i ] != cartNew[ i ] )
+							diff = i;
+
+					if ( sizeRef != sizeNew || diff >= 0 )
+					{
+						printf( "%s (%s, %s%s): size %d vs %d, first difference at %d\n", argv[ a ], buildName[ build ], modeName[ mode ], autostart ? ", autostart" : "",
+							sizeRef, sizeNew, diff );
+						errors ++;
+					}
+				}
+	}
+
+	printf( "%d conversions, %d mismatches\n", tests, errors );
+	printf( "createD2EF:       %8.3f ms per conversion\n", tRef * 1e3 / ( tests ? tests : 1 ) );
+	printf( "createD2EFStream: %8.3f ms per conversion\n", tNew * 1e3 / ( tests ? tests : 1 ) );
+
+	return errors ? 1 : 0;
+}
@@ -744,15 +744,14 @@ void handleC64( int k, u32 *launchKernel, char *FILENAME, char *filenameKernal )
 					u32 imgsize = 0;
 
 					// mount file system
-					FATFS m_FileSystem;
-					if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+					if ( fsMount( DRIVE ) != FR_OK )
 						logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: %s", DRIVE );
 
 					if ( !readD64File( logger, "", path, d64buf, &imgsize ) )
 						return;
 
 					// unmount file system
-					if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
+					if ( fsUnmount( DRIVE ) != FR_OK )
 						logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
 
 					if ( d64ParseExtract( d64buf, imgsize, D64_GET_FILE + fileIndex, prgDataLaunch, (s32*)&prgSizeLaunch ) == 0 )
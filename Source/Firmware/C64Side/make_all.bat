@@ -1,5 +1,6 @@
 64tass --nostart cart.a --output=launch.cbm80
 64tass --nostart cart_ultimax.a --output=launch_ultimax.cbm80
+64tass --nostart snapshot.a --output=snapshot.bin
 
 ..\bin\cc65 -t c64 -T -O --static-locals rpimenu.c
 ..\bin\ca65 -t c64 rpimenu_sub.s
@@ -0,0 +1,566 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ d2efstream.cpp
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - D64/D71/D81 to EasyFlash conversion writing directly into the CRT buffer (same output as createD2EF)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+
+#include "binaries.h"
+#include "cart.h"
+
+// The converter walks the directory and the sector chains of the disk image once and writes the EasyFlash
+// banks directly into the CRT buffer. All bookkeeping lives in static arrays, there are no heap allocations.
+
+#define D2EF_MAX_ENTRIES	296					// directory entries of a D81 (37 sectors)
+#define D2EF_MAX_FILE		( 1024 * 1024 )		// same limit as the temporary buffer in parse_d64
+#define D2EF_FLASH_SIZE		( MAX_BANKS * 0x4000 )
+#define D2EF_CHUNK			0x2000
+#define D2EF_CHUNK_OUT		( sizeof( BankHeader ) + D2EF_CHUNK )
+
+#define D2EF_D64	1
+#define D2EF_D71	2
+#define D2EF_D81	3
+
+typedef struct
+{
+	char type;						// 'd' = DEL, 'p' = PRG (stored), 'o' = other (listed as PRG)
+	char name[ 17 ];
+	unsigned char track, sector;	// start of the data
+	uint32_t length;
+} D2EFENTRY;
+
+static D2EFENTRY d2efEntries[ D2EF_MAX_ENTRIES + 1 ];	// + "$"
+static const unsigned char *d2efDirRaw[ D2EF_MAX_ENTRIES ];
+static unsigned char d2efListing[ 53 + D2EF_MAX_ENTRIES * 30 ];
+
+static const unsigned char *d2efImage;
+static int d2efImageSize, d2efType, d2efTracks;
+
+static unsigned char *d2efOut;			// first bank (CHIP packet) of the flash contents in the CRT buffer
+static uint32_t d2efChunks;				// number of 8k chunks initialized in the CRT buffer
+static int d2efOverflow;
+
+//
+// disk geometry, as in diskimage.cpp
+//
+static int d2efSectorsPerTrack( int track )
+{
+	if ( d2efType == D2EF_D81 )
+		return 40;
+	if ( d2efType == D2EF_D71 && track > 35 )
+		track -= 35;
+	if ( track < 18 ) return 21;
+	if ( track < 25 ) return 19;
+	if ( track < 31 ) return 18;
+	return 17;
+}
+
+static const unsigned char *d2efSector( int track, int sector )
+{
+	int block;
+
+	if ( d2efType == D2EF_D81 )
+		block = ( track - 1 ) * 40; else
+	{
+		block = 0;
+		if ( d2efType == D2EF_D71 && track > 35 )
+		{
+			block = 683;
+			track -= 35;
+		}
+		if ( track < 18 ) block += ( track - 1 ) * 21; else
+		if ( track < 25 ) block += ( track - 18 ) * 19 + 17 * 21; else
+		if ( track < 31 ) block += ( track - 25 ) * 18 + 17 * 21 + 7 * 19; else
+			block += ( track - 31 ) * 17 + 17 * 21 + 7 * 19 + 6 * 18;
+	}
+	block += sector;
+
+	if ( track < 1 || block < 0 || ( block + 1 ) * 256 > d2efImageSize )
+		return NULL;
+	return d2efImage + block * 256;
+}
+
+// link of a sector, validated like next_ts_in_chain (track 0 = end of chain)
+static void d2efNext( const unsigned char *p, unsigned char *track, unsigned char *sector )
+{
+	*track = p[ 0 ];
+	*sector = p[ 1 ];
+	if ( p[ 0 ] > d2efTracks || p[ 1 ] > d2efSectorsPerTrack( p[ 0 ] ) )
+		*track = *sector = 0;
+}
+
+static void d2efNameFromRaw( char *name, const unsigned char *raw )
+{
+	int i;
+	for ( i = 0; i < 16 && raw[ i ] != 0xa0; i++ )
+		name[ i ] = raw[ i ];
+	name[ i ] = 0;
+}
+
+// same as match_pattern in diskimage.cpp
+static int d2efMatch( const unsigned char *pattern, const unsigned char *name )
+{
+	for ( int i = 0; i < 16; i++ )
+	{
+		if ( pattern[ i ] == '*' )
+			return 1;
+		if ( name[ i ] == 0xa0 )
+			return pattern[ i ] == 0xa0;
+		if ( pattern[ i ] != '?' && pattern[ i ] != name[ i ] )
+			return 0;
+	}
+	return 1;
+}
+
+//
+// flash memory in the CRT buffer: flash address 'a' is in 8k chunk a >> 13, each chunk is preceded by a CHIP header
+//
+static void d2efFlashReserve( uint32_t end )
+{
+	while ( d2efChunks * D2EF_CHUNK < end )
+		memset( d2efOut + d2efChunks ++ * D2EF_CHUNK_OUT + sizeof( BankHeader ), 0xff, D2EF_CHUNK );
+}
+
+static void d2efFlashWrite( uint32_t a, const void *src, uint32_t size )
+{
+	const unsigned char *s = (const unsigned char *)src;
+
+	if ( a + size > D2EF_FLASH_SIZE )
+	{
+		d2efOverflow = 1;
+		return;
+	}
+	d2efFlashReserve( a + size );
+
+	while ( size )
+	{
+		uint32_t n = D2EF_CHUNK - ( a & ( D2EF_CHUNK - 1 ) );
+		if ( n > size ) n = size;
+		memcpy( d2efOut + ( a >> 13 ) * D2EF_CHUNK_OUT + sizeof( BankHeader ) + ( a & ( D2EF_CHUNK - 1 ) ), s, n );
+		a += n; s += n; size -= n;
+	}
+}
+
+// walks the sector chain of a file like di_read does and returns its length,
+// if 'store' is set, the data without the load address goes to flash address 'a'
+static uint32_t d2efFile( D2EFENTRY *e, int store, uint32_t a, unsigned char *loadAddr )
+{
+	uint32_t length = 0;
+	unsigned char track = e->track, sector = e->sector;
+
+	loadAddr[ 0 ] = loadAddr[ 1 ] = 0xff;
+
+	const unsigned char *p;
+	while ( ( p = d2efSector( track, sector ) ) != NULL )
+	{
+		int n = p[ 0 ] ? 254 : p[ 1 ] - 1;
+		if ( n < 0 ) n = 0;
+		if ( (uint32_t)n > D2EF_MAX_FILE - length ) n = D2EF_MAX_FILE - length;
+
+		const unsigned char *d = p + 2;
+		for ( ; n > 0 && length < 2; n--, length++ )
+			loadAddr[ length ] = *d++;
+		if ( store && n > 0 )
+			d2efFlashWrite( a + length - 2, d, n );
+		length += n;
+
+		if ( p[ 0 ] == 0 || length >= D2EF_MAX_FILE )
+			break;
+		d2efNext( p, &track, &sector );
+		if ( track == 0 )
+			break;
+	}
+
+	return length;
+}
+
+// BASIC listing of the directory, stored as file "$"
+static uint32_t d2efCreateListing( int nEntries, const char *title, const unsigned char *id )
+{
+	static const char txt_blocks_free[] = "BLOCKS FREE.";
+	const int blocksfree = 2;
+	unsigned char *l = d2efListing;
+	int i;
+
+	*l++ = 0x01; *l++ = 0x04;		// load address
+
+	*l++ = 0x01; *l++ = 0x01;		// next ptr
+	*l++ = 0x00; *l++ = 0x00;		// size
+	*l++ = 0x12;					// REVERSE
+	*l++ = 0x22;
+	for ( i = 0; title[ i ]; i++ ) *l++ = title[ i ];
+	for ( ; i < 16; i++ ) *l++ = 0x20;
+	*l++ = 0x22; *l++ = 0x20;
+	for ( i = 0; i < 5; i++ ) *l++ = id[ i ];
+	*l++ = 0x00;
+
+	for ( int k = 0; k < nEntries; k++ )
+	{
+		const D2EFENTRY *e = &d2efEntries[ k ];
+		const char *type = e->type == 'd' ? "DEL" : "PRG";
+		int size = ( e->length + 253 ) / 254;
+
+		*l++ = 0x01; *l++ = 0x01;
+		*l++ = size; *l++ = size >> 8;
+		for ( i = size < 10 ? 3 : ( size < 100 ? 2 : 1 ); i > 0; i-- ) *l++ = 0x20;
+		*l++ = 0x22;
+		for ( i = 0; e->name[ i ]; i++ ) *l++ = e->name[ i ];
+		*l++ = 0x22;
+		for ( ; i < 17; i++ ) *l++ = 0x20;
+		for ( i = 0; i < 3; i++ ) *l++ = type[ i ];
+		*l++ = 0x00;
+	}
+
+	*l++ = 0x01; *l++ = 0x01;
+	*l++ = blocksfree; *l++ = blocksfree >> 8;
+	for ( i = 0; txt_blocks_free[ i ]; i++ ) *l++ = txt_blocks_free[ i ];
+	*l++ = 0x00;
+
+	*l++ = 0x00; *l++ = 0x00;		// end of file
+
+	return l - d2efListing;
+}
+
+static void d2efSetBankHeader( BankHeader *h )
+{
+	static const char chip_signature[] = CHIP_SIGNATURE;
+
+	memcpy( h->signature, chip_signature, 4 );
+	h->packetLen[ 0 ] = 0x00;
+	h->packetLen[ 1 ] = 0x00;
+	h->packetLen[ 2 ] = 0x20;
+	h->packetLen[ 3 ] = 0x10;
+	h->chipType[ 0 ] = 0x00;
+	h->chipType[ 1 ] = 0x00;
+	h->bank[ 0 ] = h->bank[ 1 ] = 0x00;
+	h->loadAddr[ 0 ] = 0xa0;
+	h->loadAddr[ 1 ] = 0x00;
+	h->romLen[ 0 ] = 0x20;
+	h->romLen[ 1 ] = 0x00;
+}
+
+// build: 1 = xbank, 2 = crt, 3 = listing only; mode: 0 = lo, 1 = nm, 2 = hi (see disk2easyflash.cpp)
+// returns the size of the CRT written to 'cart', or 0 if the image is invalid or does not fit into the flash
+int createD2EFStream( unsigned char *diskimage, int imageSize, unsigned char *cart, int build, int mode, int autostart )
+{
+	static const char cart_signature[] = CART_SIGNATURE;
+	unsigned char dirTrack, dirSector, bamTrack, bamSector;
+	unsigned char *out = cart;
+
+	d2efImage = diskimage;
+	d2efImageSize = imageSize;
+	switch ( imageSize )
+	{
+	case 174848:
+	case 175531:
+		d2efType = D2EF_D64; d2efTracks = 35;
+		bamTrack = dirTrack = 18; bamSector = dirSector = 0;
+		break;
+	case 349696:
+		d2efType = D2EF_D71; d2efTracks = 70;
+		bamTrack = dirTrack = 18; bamSector = dirSector = 0;
+		break;
+	case 819200:
+		d2efType = D2EF_D81; d2efTracks = 80;
+		bamTrack = 40; bamSector = 1;
+		dirTrack = 40; dirSector = 0;
+		break;
+	default:
+		return 0;
+	}
+
+	if ( build == 3 )
+		return 0;
+
+	//
+	// directory: the raw entries for name lookups (chain starting behind the BAM, as find_file_entry),
+	// and the listed entries (chain starting at the header, as reading "$")
+	//
+	const unsigned char *p;
+	unsigned char t, s;
+	int nDirRaw = 0, nEntries = 0;
+
+	if ( ( p = d2efSector( bamTrack, bamSector ) ) == NULL )
+		return 0;
+	d2efNext( p, &t, &s );
+	for ( int i = 0; t && i < D2EF_MAX_ENTRIES / 8 && ( p = d2efSector( t, s ) ) != NULL; i++ )
+	{
+		for ( int o = 0; o < 256; o += 32 )
+			d2efDirRaw[ nDirRaw ++ ] = p + o;
+		d2efNext( p, &t, &s );
+	}
+
+	const unsigned char *header = d2efSector( dirTrack, dirSector );
+	if ( header == NULL )
+		return 0;
+	const unsigned char *title = header + ( d2efType == D2EF_D81 ? 4 : 144 );
+
+	// the header block is skipped, then only complete 254 byte blocks are parsed
+	if ( d2efType == D2EF_D81 )
+	{
+		t = header[ 0 ]; s = header[ 1 ];
+		if ( t ) d2efNext( header, &t, &s );
+	} else
+	{
+		t = 18; s = 1;
+	}
+
+	for ( int i = 0; t && i < D2EF_MAX_ENTRIES / 8 && ( p = d2efSector( t, s ) ) != NULL; i++ )
+	{
+		if ( p[ 0 ] == 0 && p[ 1 ] != 255 )
+			break;
+
+		for ( int o = 0; o < 256; o += 32 )
+		{
+			unsigned char type = p[ o + 2 ];
+			if ( type == 0 )
+				continue;
+
+			D2EFENTRY *e = &d2efEntries[ nEntries ];
+			d2efNameFromRaw( e->name, p + o + 5 );
+			e->length = 0;
+
+			if ( ( type & 7 ) == 0 )
+			{
+				e->type = 'd';
+				nEntries ++;
+				continue;
+			}
+
+			// data comes from the first closed file of this type with a matching name
+			const unsigned char *f = NULL;
+			for ( int k = 0; k < nDirRaw && f == NULL; k++ )
+				if ( ( d2efDirRaw[ k ][ 2 ] & ~0x40 ) == ( ( type & 7 ) | 0x80 ) && d2efMatch( p + o + 5, d2efDirRaw[ k ] + 5 ) )
+					f = d2efDirRaw[ k ];
+
+			if ( f == NULL || f[ 3 ] == 0 || f[ 3 ] > d2efTracks )
+				continue;
+
+			e->type = ( type & 7 ) == 2 ? 'p' : 'o';
+			e->track = f[ 3 ];
+			e->sector = f[ 4 ];
+			nEntries ++;
+		}
+
+		if ( p[ 0 ] == 0 )
+			break;
+		d2efNext( p, &t, &s );
+	}
+
+	//
+	// CRT header and boot bank
+	//
+	CartHeader cartHeader;
+	memcpy( cartHeader.signature, cart_signature, 16 );
+	cartHeader.headerLen[ 0 ] = cartHeader.headerLen[ 1 ] = cartHeader.headerLen[ 2 ] = 0x00;
+	cartHeader.headerLen[ 3 ] = 0x40;
+	cartHeader.version[ 0 ] = 0x01;
+	cartHeader.version[ 1 ] = 0x00;
+	if ( build == 1 )
+	{
+		cartHeader.type[ 0 ] = CART_TYPE_EASYFLASH_XBANK >> 8;
+		cartHeader.type[ 1 ] = CART_TYPE_EASYFLASH_XBANK & 0xff;
+		cartHeader.exromLine = ( mode == 2 ) ? 1 : 0;
+		cartHeader.gameLine = ( mode == 2 ) ? 0 : ( ( mode == 0 ) ? 1 : 0 );
+	} else
+	{
+		cartHeader.type[ 0 ] = CART_TYPE_EASYFLASH >> 8;
+		cartHeader.type[ 1 ] = CART_TYPE_EASYFLASH & 0xff;
+		cartHeader.exromLine = 1;
+		cartHeader.gameLine = 0;
+	}
+	memset( cartHeader.reserved, 0, 6 );
+	memset( cartHeader.name, 0, 32 );
+	strcpy( cartHeader.name, "D2EF" );
+	memcpy( out, &cartHeader, sizeof( CartHeader ) );
+	out += sizeof( CartHeader );
+
+	if ( build == 2 )
+	{
+		d2efSetBankHeader( (BankHeader *)out );
+		out += sizeof( BankHeader );
+
+		memset( out, 0xff, 0x2000 );
+		memcpy( out + 0x1800, sprites, sprites_size );
+		memcpy( out + 0x1e00, startup, startup_size );
+		out[ 0x2000 - startup_size + 0 ] = 1;					// BANK
+		switch ( mode )											// MODE
+		{
+		case 1: out[ 0x2000 - startup_size + 1 ] = 7; break;
+		case 0: out[ 0x2000 - startup_size + 1 ] = 6; break;
+		case 2: out[ 0x2000 - startup_size + 1 ] = 5; break;
+		}
+		out += 0x2000;
+	}
+
+	//
+	// flash contents (as bundle() in bundle.cpp)
+	//
+	uint32_t bank_size, bank_offset, bank_shift, api_length, launcher_length = 0;
+	uint8_t *api, *launcher = NULL;
+	uint16_t first_bank = ( build == 1 ) ? 0 : 1;
+
+	switch ( mode )
+	{
+	default:
+	case 1:
+		bank_size = 0x4000; bank_offset = 0x8000; bank_shift = 14;
+		api = autostart ? kapi_nm_auto : kapi_nm;
+		api_length = autostart ? kapi_nm_size_auto : kapi_nm_size;
+		break;
+	case 0:
+		bank_size = 0x2000; bank_offset = 0x8000; bank_shift = 13;
+		api = autostart ? kapi_lo_auto : kapi_lo;
+		api_length = autostart ? kapi_lo_size_auto : kapi_lo_size;
+		break;
+	case 2:
+		bank_size = 0x2000; bank_offset = 0xa000; bank_shift = 13;
+		api = autostart ? kapi_hi_auto : kapi_hi;
+		api_length = autostart ? kapi_hi_size_auto : kapi_hi_size;
+		launcher = launcher_hi;
+		launcher_length = autostart ? launcher_hi_size_auto : launcher_hi_size;
+		break;
+	}
+
+	d2efOut = out;
+	d2efChunks = 0;
+	d2efOverflow = 0;
+
+	uint32_t pos = 0;
+	d2efFlashWrite( pos, api, api_length );
+	pos += api_length;
+
+	// the visible line with the disk name
+	char titleName[ 17 ], name[ 17 ];
+	int i, j, len;
+	d2efNameFromRaw( titleName, title );
+	strcpy( name, titleName );
+	for ( len = strlen( name ); len > 0 && name[ len - 1 ] == 0x20; len-- );
+	name[ len ] = 0;
+
+	unsigned char line[ 40 ];
+	memset( line, 0x20, 40 );
+	i = ( 31 - len ) / 2;
+	line[ i + 0 ] = line[ i + 1 ] = line[ i + 2 ] = line[ i + 3 ] = '*';
+	for ( j = 0; j < len; j++ )
+	{
+		unsigned char c = name[ j ];
+		if ( c >= 'a' && c <= 'z' ) c += 'A' - 'a';
+		line[ i + 5 + j ] = ( c >= 0x41 && c <= 0x5a ) ? c - 0x40 : c;
+	}
+	line[ i + 5 + len + 1 ] = line[ i + 5 + len + 2 ] = line[ i + 5 + len + 3 ] = line[ i + 5 + len + 4 ] = '*';
+	d2efFlashWrite( pos, line, 40 );
+	pos += 40;
+
+	// directory: all PRGs and the listing, followed by the end marker
+	uint32_t dir_pos = pos;
+	int nPRG = 1;
+	for ( int k = 0; k < nEntries; k++ )
+		if ( d2efEntries[ k ].type == 'p' ) nPRG ++;
+	pos += nPRG * 24;
+	unsigned char endMarker = 0;
+	d2efFlashWrite( pos ++, &endMarker, 1 );
+
+	if ( launcher != NULL )
+	{
+		d2efFlashWrite( bank_size - launcher_length, launcher, launcher_length );
+		pos = bank_size;
+	}
+
+	// files (the listing needs all lengths, so it is created last)
+	for ( int k = 0; k <= nEntries; k++ )
+	{
+		D2EFENTRY *e = &d2efEntries[ k ];
+		unsigned char loadAddr[ 2 ];
+		uint32_t length;
+
+		if ( k == nEntries )
+		{
+			length = d2efCreateListing( nEntries, titleName, title + 18 );
+			loadAddr[ 0 ] = d2efListing[ 0 ];
+			loadAddr[ 1 ] = d2efListing[ 1 ];
+			d2efFlashWrite( pos, d2efListing + 2, length - 2 );
+			strcpy( e->name, "$" );
+		} else
+		{
+			if ( e->type == 'd' )
+				continue;
+			length = e->length = d2efFile( e, e->type == 'p', pos, loadAddr );
+			if ( e->type != 'p' )
+				continue;
+		}
+
+		uint32_t bank = pos >> bank_shift;
+		uint32_t offset = ( pos & ( bank_size - 1 ) ) + bank_offset;
+		uint32_t size = length > 2 ? length - 2 : 0;
+
+		unsigned char entry[ 24 ];
+		if ( strlen( e->name ) == 16 )
+			memcpy( entry, e->name, 16 ); else
+		{
+			memset( entry, 0xff, 16 );
+			strcpy( (char *)entry, e->name );
+		}
+		entry[ 16 ] = bank & 0xff;
+		entry[ 17 ] = bank >> 8;
+		entry[ 18 ] = offset & 0xff;
+		entry[ 19 ] = offset >> 8;
+		entry[ 20 ] = loadAddr[ 0 ];
+		entry[ 21 ] = loadAddr[ 1 ];
+		entry[ 22 ] = size & 0xff;
+		entry[ 23 ] = size >> 8;
+		d2efFlashWrite( dir_pos, entry, 24 );
+		dir_pos += 24;
+
+		pos += size;
+	}
+
+	if ( d2efOverflow )
+		return 0;
+
+	// CHIP headers of all used 8k chunks
+	d2efFlashReserve( pos );
+	uint32_t nChunks = ( pos + 0x1fff ) >> 13;
+	for ( uint32_t c = 0; c < nChunks; c++ )
+	{
+		BankHeader *h = (BankHeader *)( out + c * D2EF_CHUNK_OUT );
+		d2efSetBankHeader( h );
+		if ( bank_size == 0x4000 )
+		{
+			h->bank[ 0 ] = ( ( first_bank << 1 ) + c ) >> 9;
+			h->bank[ 1 ] = ( ( first_bank << 1 ) + c ) >> 1;
+			h->loadAddr[ 0 ] = ( 0x8000 >> 8 ) + ( c & 1 ? 0x20 : 0x00 );
+		} else
+		{
+			h->bank[ 0 ] = ( first_bank + c ) >> 8;
+			h->bank[ 1 ] = ( first_bank + c );
+			h->loadAddr[ 0 ] = ( 0x8000 | ( bank_offset & 0x2000 ) ) >> 8;
+		}
+	}
+
+	return (int)( out + nChunks * D2EF_CHUNK_OUT - cart );
+}
@@ -0,0 +1,247 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ hvscindex.cpp
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - binary index for the HVSC song length database and STIL (built once, used by the firmware and HVSCIndexTool)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "hvscindex.h"
+#include <string.h>
+
+uint64_t hvscIndexHash( const char *path, int length )
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for ( int i = 0; length < 0 ? path[ i ] != 0 : i < length; i++ )
+	{
+		uint8_t c = path[ i ];
+		if ( c == '\\' ) c = '/';
+		if ( c >= 'a' && c <= 'z' ) c -= 'a' - 'A';
+		h ^= c;
+		h *= 0x100000001b3ULL;
+	}
+	// 0 marks empty buckets
+	return h ? h : 1;
+}
+
+static HVSCINDEXENTRY *hvscIndexBucket( HVSCINDEXENTRY *table, uint32_t nBuckets, uint64_t hash, int insert )
+{
+	uint32_t lo = (uint32_t)hash, hi = (uint32_t)( hash >> 32 );
+	uint32_t b = ( lo ^ hi ) & ( nBuckets - 1 );
+
+	while ( table[ b ].hashLo | table[ b ].hashHi )
+	{
+		if ( table[ b ].hashLo == lo && table[ b ].hashHi == hi )
+			return &table[ b ];
+		b = ( b + 1 ) & ( nBuckets - 1 );
+	}
+
+	if ( !insert )
+		return NULL;
+
+	table[ b ].hashLo = lo;
+	table[ b ].hashHi = hi;
+	return &table[ b ];
+}
+
+// returns the length of the line starting at 'p' (without line break), *next is set to the beginning of the next line
+static uint32_t hvscIndexLine( const char *p, const char *end, const char **next )
+{
+	const char *e = p;
+	while ( e < end && *e != '\n' && *e != '\r' ) e++;
+	uint32_t l = (uint32_t)( e - p );
+	if ( e < end && *e == '\r' ) e++;
+	if ( e < end && *e == '\n' ) e++;
+	*next = e;
+	// strip trailing spaces
+	while ( l > 0 && ( p[ l - 1 ] == ' ' || p[ l - 1 ] == '\t' ) ) l--;
+	return l;
+}
+
+static uint32_t hvscIndexParseNumber( const char **p, const char *end )
+{
+	uint32_t v = 0;
+	while ( *p < end && **p >= '0' && **p <= '9' )
+		v = v * 10 + *(*p)++ - '0';
+	return v;
+}
+
+uint32_t hvscIndexBuild( const char *songlengths, uint32_t songlengthsSize, const char *stil, uint32_t stilSize, uint8_t **index )
+{
+	const char *p, *end, *next;
+
+	// upper bounds for the number of entries and song lengths
+	uint32_t maxEntries = 0, maxLengths = 0;
+	for ( uint32_t i = 0; i < songlengthsSize; i++ )
+	{
+		if ( songlengths[ i ] == ';' ) maxEntries ++;
+		if ( songlengths[ i ] == ':' ) maxLengths ++;
+	}
+	for ( uint32_t i = 0; i < stilSize; i++ )
+		if ( stil[ i ] == '/' && ( i == 0 || stil[ i - 1 ] == '\n' ) ) maxEntries ++;
+
+	uint32_t nBuckets = 16;
+	while ( nBuckets < maxEntries * 2 ) nBuckets <<= 1;
+
+	HVSCINDEXENTRY *table = new HVSCINDEXENTRY[ nBuckets ];
+	uint16_t *lengths = new uint16_t[ maxLengths + 1 ];
+	memset( table, 0, nBuckets * sizeof( HVSCINDEXENTRY ) );
+
+	uint32_t nEntries = 0, nLengths = 0;
+
+	//
+	// Songlengths.md5: "; /path" followed by "md5=m:ss m:ss.mmm(G) ..."
+	//
+	p = songlengths; end = songlengths + songlengthsSize;
+	const char *curPath = NULL;
+	uint32_t curPathLength = 0;
+	while ( p < end )
+	{
+		uint32_t l = hvscIndexLine( p, end, &next );
+
+		if ( l > 0 && p[ 0 ] == ';' )
+		{
+			curPath = p + 1;
+			curPathLength = l - 1;
+			while ( curPathLength > 0 && *curPath == ' ' ) { curPath ++; curPathLength --; }
+			if ( curPathLength == 0 || *curPath != '/' )
+				curPath = NULL;
+		} else
+		if ( curPath != NULL )
+		{
+			const char *t = (const char *)memchr( p, '=', l );
+			if ( t != NULL )
+			{
+				HVSCINDEXENTRY *e = hvscIndexBucket( table, nBuckets, hvscIndexHash( curPath, curPathLength ), 1 );
+				if ( e->nSongs == 0 && e->stilLength == 0 ) nEntries ++;
+
+				e->lengthsOffset = nLengths;
+				e->nSongs = 0;
+
+				const char *le = p + l;
+				t ++;
+				while ( t < le && nLengths < maxLengths )
+				{
+					while ( t < le && ( *t < '0' || *t > '9' ) ) t++;
+					if ( t >= le ) break;
+
+					uint32_t m = hvscIndexParseNumber( &t, le ), s = 0;
+					if ( t < le && *t == ':' ) { t ++; s = hvscIndexParseNumber( &t, le ); }
+					if ( t < le && *t == '.' ) { t ++; hvscIndexParseNumber( &t, le ); }
+					// skip attributes like "(G)"
+					if ( t < le && *t == '(' ) while ( t < le && *t != ')' ) t++;
+
+					uint32_t sec = m * 60 + s;
+					lengths[ nLengths ++ ] = sec > 0xffff ? 0xffff : sec;
+					e->nSongs ++;
+				}
+			}
+			curPath = NULL;
+		}
+		p = next;
+	}
+
+	//
+	// STIL.txt: entries start with "/path" in the first column, the text ends at the next path or comment line
+	//
+	p = stil; end = stil + stilSize;
+	HVSCINDEXENTRY *curEntry = NULL;
+	while ( p < end )
+	{
+		uint32_t l = hvscIndexLine( p, end, &next );
+
+		if ( l > 0 && ( p[ 0 ] == '/' || p[ 0 ] == '#' ) )
+		{
+			curEntry = NULL;
+			if ( p[ 0 ] == '/' )
+			{
+				curEntry = hvscIndexBucket( table, nBuckets, hvscIndexHash( p, l ), 1 );
+				if ( curEntry->nSongs == 0 && curEntry->stilLength == 0 ) nEntries ++;
+				curEntry->stilOffset = (uint32_t)( next - stil );
+				curEntry->stilLength = 0;
+			}
+		} else
+		if ( curEntry != NULL && l > 0 )
+			curEntry->stilLength = (uint32_t)( p + l - stil ) - curEntry->stilOffset;
+
+		p = next;
+	}
+
+	//
+	// assemble the index blob
+	//
+	uint32_t size = sizeof( HVSCINDEXHEADER ) + nBuckets * sizeof( HVSCINDEXENTRY ) + nLengths * sizeof( uint16_t );
+	uint8_t *blob = new uint8_t[ size ];
+
+	HVSCINDEXHEADER *h = (HVSCINDEXHEADER *)blob;
+	h->magic = HVSCINDEX_MAGIC;
+	h->version = HVSCINDEX_VERSION;
+	h->nBuckets = nBuckets;
+	h->nEntries = nEntries;
+	h->nLengths = nLengths;
+	h->songlengthsSize = songlengthsSize;
+	h->stilSize = stilSize;
+	memcpy( blob + sizeof( HVSCINDEXHEADER ), table, nBuckets * sizeof( HVSCINDEXENTRY ) );
+	memcpy( blob + sizeof( HVSCINDEXHEADER ) + nBuckets * sizeof( HVSCINDEXENTRY ), lengths, nLengths * sizeof( uint16_t ) );
+
+	delete [] table;
+	delete [] lengths;
+
+	*index = blob;
+	return size;
+}
+
+int hvscIndexValid( const uint8_t *index, uint32_t size )
+{
+	const HVSCINDEXHEADER *h = (const HVSCINDEXHEADER *)index;
+
+	if ( index == NULL || size < sizeof( HVSCINDEXHEADER ) ||
+		 h->magic != HVSCINDEX_MAGIC || h->version != HVSCINDEX_VERSION ||
+		 h->nBuckets == 0 || ( h->nBuckets & ( h->nBuckets - 1 ) ) )
+		return 0;
+
+	return size == sizeof( HVSCINDEXHEADER ) + h->nBuckets * sizeof( HVSCINDEXENTRY ) + h->nLengths * sizeof( uint16_t );
+}
+
+const HVSCINDEXENTRY *hvscIndexFind( const uint8_t *index, const char *path )
+{
+	if ( index == NULL )
+		return NULL;
+
+	const HVSCINDEXHEADER *h = (const HVSCINDEXHEADER *)index;
+	HVSCINDEXENTRY *table = (HVSCINDEXENTRY *)( index + sizeof( HVSCINDEXHEADER ) );
+
+	// we do not know where the HVSC root is: try all suffixes starting at a path separator, longest first
+	for ( const char *s = path; *s; s++ )
+	{
+		if ( *s != '/' && *s != '\\' )
+			continue;
+
+		const HVSCINDEXENTRY *e = hvscIndexBucket( table, h->nBuckets, hvscIndexHash( s ), 0 );
+		if ( e != NULL )
+			return e;
+	}
+
+	return NULL;
+}
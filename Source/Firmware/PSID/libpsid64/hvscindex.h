@@ -0,0 +1,89 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ hvscindex.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - binary index for the HVSC song length database and STIL (built once, used by the firmware and HVSCIndexTool)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _hvscindex_h
+#define _hvscindex_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// the index is stored as one blob:
+//   HVSCINDEXHEADER
+//   HVSCINDEXENTRY[ nBuckets ]		open addressing hash table, keyed by a 64-bit hash of the HVSC path ("/MUSICIANS/H/Hubbard_Rob/Commando.sid")
+//   uint16_t[ nLengths ]			song lengths in seconds, referenced by the entries
+#define HVSCINDEX_FILENAME		"HVSC.IDX"
+#define HVSCINDEX_MAGIC			0x58444948		// "HIDX"
+#define HVSCINDEX_VERSION		1
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nBuckets;				// power of two
+	uint32_t nEntries;
+	uint32_t nLengths;
+	uint32_t songlengthsSize;		// sizes of the files the index was built from (to detect updates of the collection)
+	uint32_t stilSize;
+} __attribute__((packed)) HVSCINDEXHEADER;
+
+typedef struct
+{
+	uint32_t hashLo, hashHi;		// 0 = empty bucket
+	uint32_t stilOffset;			// STIL entry text (without the path line) as byte range of STIL.txt
+	uint32_t stilLength;
+	uint32_t lengthsOffset;			// first song length in the lengths array
+	uint16_t nSongs;				// 0 = no song length information
+	uint16_t reserved;
+} __attribute__((packed)) HVSCINDEXENTRY;
+
+// case-insensitive hash of a path, '\' and '/' are treated equally
+extern uint64_t hvscIndexHash( const char *path, int length = -1 );
+
+// builds the index from the contents of Songlengths.md5 and STIL.txt (either may be NULL),
+// returns the size of the index and a buffer allocated with new[] in *index, or 0 on failure
+extern uint32_t hvscIndexBuild( const char *songlengths, uint32_t songlengthsSize, const char *stil, uint32_t stilSize, uint8_t **index );
+
+// returns 1 if the blob is a valid index
+extern int hvscIndexValid( const uint8_t *index, uint32_t size );
+
+// looks up a .sid file, 'path' can be any path ending in the HVSC path, e.g. "SD:SID\C64Music\MUSICIANS\H\Hubbard_Rob\Commando.sid"
+extern const HVSCINDEXENTRY *hvscIndexFind( const uint8_t *index, const char *path );
+
+// length of song 'song' (0-based) in seconds, 0 if unknown
+static inline uint16_t hvscIndexSongLength( const uint8_t *index, const HVSCINDEXENTRY *e, int song )
+{
+	const HVSCINDEXHEADER *h = (const HVSCINDEXHEADER *)index;
+	const uint16_t *lengths = (const uint16_t *)( index + sizeof( HVSCINDEXHEADER ) + h->nBuckets * sizeof( HVSCINDEXENTRY ) );
+
+	if ( e == NULL || song < 0 || song >= e->nSongs )
+		return 0;
+	return lengths[ e->lengthsOffset + song ];
+}
+
+#endif
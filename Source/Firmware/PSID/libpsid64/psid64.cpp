@@ -69,7 +69,7 @@
 //////////////////////////////////////////////////////////////////////////////
 //                     L O C A L   D E F I N I T I O N S
 //////////////////////////////////////////////////////////////////////////////
-static char* emptyString = "";
+//static char* emptyString = "";
 
 #if defined(HAVE_IOS_OPENMODE)
     typedef std::ios::openmode openmode;
@@ -234,6 +234,11 @@ Psid64::Psid64() :
     //m_sidId(new SidId),
     m_screen(new Screen),
     //m_stilText(),
+    m_stilTextLength(0),
+    m_stilEntry(NULL),
+    m_stilEntryLength(0),
+    m_songlengthSeconds(NULL),
+    m_nSonglengthSeconds(0),
     m_songlengthsData(),
     m_songlengthsSize(0),
     m_driverPage(0),
@@ -433,8 +438,8 @@ Psid64::convert()
     {
 	block_t stil_text_block;
 	stil_text_block.load = m_stilPage << 8;
-	stil_text_block.size = 0;
-	stil_text_block.data = (uint_least8_t*)emptyString;//(uint_least8_t*) m_stilText.c_str();
+	stil_text_block.size = m_stilTextLength;
+	stil_text_block.data = m_stilText;
 	//stil_text_block.description = "STIL text";
 	//blocks.push_back(stil_text_block);
 	blocks[ nBlocks++ ] = stil_text_block;
@@ -852,82 +857,40 @@ Psid64::convertBASIC()
 bool
 Psid64::formatStilText()
 {
-/*    m_stilText.clear();
+    // The STIL entry is provided by the caller (see setStilEntry), the
+    // Sidekick64 firmware retrieves it using the HVSC index.
+    m_stilTextLength = 0;
 
-    if (m_hvscRoot.empty())
+    if (m_stilEntry == NULL || m_stilEntryLength <= 0)
     {
 	return true;
     }
 
-    // strip hvsc path from the file name
-    string hvscFileName = m_fileName;
-    size_t index = hvscFileName.find(m_hvscRoot);
-    if (index != string::npos)
-    {
-	hvscFileName.erase(0, index + m_hvscRoot.length());
-    }
-
-    // convert backslashes to slashes (for DOS and Windows filenames)
-    replace(hvscFileName.begin(), hvscFileName.end(), '\\', '/');
-
-    string str;
-    if (!m_stil->hasCriticalError() && m_useGlobalComment)
-    {
-	char* globalComment = m_stil->getGlobalComment(hvscFileName.c_str());
-	if (globalComment != NULL)
-	{
-	    str += globalComment;
-	}
-    }
-    if (!m_stil->hasCriticalError())
-    {
-	char* stilEntry = m_stil->getEntry(hvscFileName.c_str(), 0);
-	if (stilEntry != NULL)
-	{
-	    str += stilEntry;
-	}
-    }
-    if (!m_stil->hasCriticalError())
-    {
-	char* bugEntry = m_stil->getBug(hvscFileName.c_str(), 0);
-	if (bugEntry != NULL)
-	{
-	    str += bugEntry;
-	}
-    }
-    if (m_stil->hasCriticalError())
-    {
-	m_statusString = m_stil->getErrorStr();
-	return false;
-    }
-
-    // convert the stil text and remove all double whitespace characters
-    unsigned int n = str.length();
-    m_stilText.reserve(n);
-
     // start the scroll text with some space characters (to separate end
     // from beginning and to make sure the color effect has reached the end
     // of the line before the first character is visible)
     for (unsigned int i = 0; i < (STIL_EOT_SPACES-1); ++i)
     {
-	m_stilText += Screen::iso2scr(' ');
+	m_stilText[m_stilTextLength++] = Screen::iso2scr(' ');
     }
 
+    // convert the stil text and remove all double whitespace characters
     bool space = true;
     bool realText = false;
-    for (unsigned int i = 0; i < n; ++i)
+    for (int i = 0; i < m_stilEntryLength && m_stilTextLength < STIL_MAX_TEXT - 2; ++i)
     {
-	if (isspace(str[i]))
+	char c = m_stilEntry[i];
+	if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
 	{
 	    space = true;
 	}
 	else
 	{
 	    if (space) {
-	       m_stilText += Screen::iso2scr(' ');
+	       m_stilText[m_stilTextLength++] = Screen::iso2scr(' ');
 	       space = false;
 	    }
-	    m_stilText += Screen::iso2scr(str[i]);
+	    m_stilText[m_stilTextLength++] = Screen::iso2scr(c);
 	    realText = true;
 	}
     }
@@ -936,14 +899,14 @@ Psid64::formatStilText()
     if (realText)
     {
 	// end-of-text marker
-	m_stilText += 0xff;
+	m_stilText[m_stilTextLength++] = 0xff;
     }
     else
     {
 	// no STIL text at all
-	m_stilText.clear();
+	m_stilTextLength = 0;
     }
-*/
+
     return true;
 }
 
@@ -957,10 +920,13 @@ Psid64::getSongLengths()
 	// retrieve song length database information
 	m_tune.selectSong(i + 1);
 
+	//int_least32_t length = m_database.length (m_tune);
 	int_least32_t length = 0;
+	if (m_songlengthSeconds != NULL && i < m_nSonglengthSeconds)
+	{
+	    length = m_songlengthSeconds[i];
+	}
 
-	#if 0
-	int_least32_t length = m_database.length (m_tune);
 	if (length > 0)
 	{
 	    // maximum representable length is 99:59
@@ -996,7 +962,6 @@ Psid64::getSongLengths()
 	    have_songlengths = true;
 	}
 	else
-	#endif
 	{
 	    // no song length data for this song
 	    m_songlengthsData[i] = 0x00;
@@ -1125,12 +1090,12 @@ Psid64::findFreeSpace()
     uint_least8_t driver;
 
     // calculate size of the STIL text in pages
-    uint_least8_t stilSize = 0;//(m_stilText.length() + 255) >> 8;
+    uint_least8_t stilSize = (m_stilTextLength + 255) >> 8;
     uint_least8_t songlengthsSize = (m_songlengthsSize + 255) >> 8;
 
 	hasCustomCharset = true;
 restartBuild:
-    stilSize = 0;//(m_stilText.length() + 255) >> 8;
+    stilSize = (m_stilTextLength + 255) >> 8;
     songlengthsSize = (m_songlengthsSize + 255) >> 8;
     startp = m_tuneInfo.relocStartPage;
     maxp = m_tuneInfo.relocPages;
@@ -54,6 +54,12 @@
 //                      G L O B A L   F U N C T I O N S
 //////////////////////////////////////////////////////////////////////////////
 
+SidId::SidId() : m_compiled(false)
+{
+    // do nothing
+}
+
+
 void SidId::Pattern::clear()
 {
     m_values.clear();
@@ -119,6 +125,12 @@ bool SidId::Pattern::match(const std::vector<uint_least8_t>& buffer) const
 }
 
 
+const std::vector<uint_least16_t>& SidId::Pattern::values() const
+{
+    return m_values;
+}
+
+
 SidId::Player::Player(const std::string& name) : m_name(name)
 {
     // do nothing
@@ -151,6 +163,12 @@ const std::string& SidId::Player::name() const
     }
 
 
+const std::vector<SidId::Pattern>& SidId::Player::patterns() const
+{
+    return m_patterns;
+}
+
+
 std::string SidId::trim(const std::string& str, const std::string& whitespace)
 {
     const size_t begin_pos = str.find_first_not_of(whitespace);
@@ -166,6 +184,7 @@ std::string SidId::trim(const std::string& str, const std::string& whitespace)
 bool SidId::readConfigFile(const std::string& filename)
 {
     m_players.clear();
+    m_compiled = false;
     std::ifstream f;
     f.open(filename.c_str());
     if (!f)
@@ -224,7 +243,245 @@ bool SidId::readConfigFile(const std::string& filename)
 }
 
 
+void SidId::compile()
+{
+    m_segments.clear();
+    m_patterns.clear();
+    m_nodes.clear();
+    m_nodes.push_back(Node());
+    m_nodes[0].fail = 0;
+    m_nodes[0].dict = 0;
+
+    // split all patterns into segments
+    for (size_t p = 0; p < m_players.size(); ++p)
+    {
+        const std::vector<Pattern>& patterns = m_players[p].patterns();
+        for (size_t k = 0; k < patterns.size(); ++k)
+        {
+            const std::vector<uint_least16_t>& v = patterns[k].values();
+            CompiledPattern cp;
+            cp.player = p;
+            cp.firstSegment = m_segments.size();
+            cp.numSegments = 0;
+            cp.matchable = true;
+
+            size_t start = 0;
+            for (size_t i = 0; i < v.size(); ++i)
+            {
+                if ((v[i] != MATCH_WILDCARD_MULTIPLE) && (v[i] != MATCH_END))
+                {
+                    continue;
+                }
+
+                Segment seg;
+                seg.values = &v[start];
+                seg.length = i - start;
+                seg.anchorOffset = 0;
+                seg.anchorLength = 0;
+                seg.pattern = m_patterns.size();
+
+                // Pattern::match never finds a part that starts with a
+                // wildcard, or an empty part which is not the last one
+                if ((seg.length > 0) ? (v[start] == MATCH_WILDCARD_ONE)
+                                     : (v[i] != MATCH_END))
+                {
+                    cp.matchable = false;
+                }
+
+                // the longest run of literal bytes is the anchor
+                size_t run = 0;
+                for (size_t j = 0; j < seg.length; ++j)
+                {
+                    run = (seg.values[j] == MATCH_WILDCARD_ONE) ? 0 : run + 1;
+                    if ((run > seg.anchorLength)
+                        && (seg.anchorLength < MAX_ANCHOR_LENGTH))
+                    {
+                        seg.anchorLength = run;
+                        seg.anchorOffset = j + 1 - run;
+                    }
+                }
+
+                m_segments.push_back(seg);
+                ++cp.numSegments;
+                start = i + 1;
+                if (v[i] == MATCH_END)
+                {
+                    break;
+                }
+            }
+            m_patterns.push_back(cp);
+        }
+    }
+
+    // build the trie of the anchors
+    for (size_t s = 0; s < m_segments.size(); ++s)
+    {
+        const Segment& seg = m_segments[s];
+        if ((seg.anchorLength == 0) || !m_patterns[seg.pattern].matchable)
+        {
+            continue;
+        }
+
+        uint_least32_t node = 0;
+        for (size_t j = 0; j < seg.anchorLength; ++j)
+        {
+            uint_least8_t c = (uint_least8_t) seg.values[seg.anchorOffset + j];
+            uint_least32_t child = 0;
+            for (size_t e = 0; e < m_nodes[node].next.size(); ++e)
+            {
+                if (m_nodes[node].next[e].first == c)
+                {
+                    child = m_nodes[node].next[e].second;
+                    break;
+                }
+            }
+            if (child == 0)
+            {
+                child = (uint_least32_t) m_nodes.size();
+                m_nodes.push_back(Node());
+                m_nodes[node].next.push_back(std::make_pair(c, child));
+            }
+            node = child;
+        }
+        m_nodes[node].segments.push_back((uint_least32_t) s);
+    }
+
+    // failure and dictionary links and the transition table, in
+    // breadth-first order (the fail node is always complete before)
+    m_delta.assign(m_nodes.size() * 256, 0);
+    std::vector<uint_least32_t> queue;
+    for (size_t e = 0; e < m_nodes[0].next.size(); ++e)
+    {
+        uint_least32_t child = m_nodes[0].next[e].second;
+        m_delta[m_nodes[0].next[e].first] = child;
+        m_nodes[child].fail = 0;
+        m_nodes[child].dict = 0;
+        queue.push_back(child);
+    }
+    for (size_t q = 0; q < queue.size(); ++q)
+    {
+        uint_least32_t node = queue[q];
+        uint_least32_t* delta = &m_delta[node * 256];
+        const uint_least32_t* failDelta = &m_delta[m_nodes[node].fail * 256];
+        for (unsigned int c = 0; c < 256; ++c)
+        {
+            delta[c] = failDelta[c];
+        }
+        for (size_t e = 0; e < m_nodes[node].next.size(); ++e)
+        {
+            uint_least32_t child = m_nodes[node].next[e].second;
+            uint_least32_t fail = failDelta[m_nodes[node].next[e].first];
+            delta[m_nodes[node].next[e].first] = child;
+            m_nodes[child].fail = fail;
+            m_nodes[child].dict = m_nodes[fail].segments.empty()
+                                  ? m_nodes[fail].dict : fail;
+            queue.push_back(child);
+        }
+    }
+
+    m_compiled = true;
+}
+
+
+bool SidId::verify(const Segment& segment,
+                   const std::vector<uint_least8_t>& buffer,
+                   size_t start) const
+{
+    if (start + segment.length > buffer.size())
+    {
+        return false;
+    }
+    for (size_t j = 0; j < segment.length; ++j)
+    {
+        uint_least16_t v = segment.values[j];
+        if ((v != MATCH_WILDCARD_ONE) && (v != buffer[start + j]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
 std::string SidId::identify(const std::vector<uint_least8_t>& buffer)
+{
+    if (!m_compiled)
+    {
+        compile();
+    }
+
+    // Each pattern waits for its segments in order: a segment is taken at
+    // its first occurrence behind the previous one, just like
+    // Pattern::match does it. An occurrence is reported when the end of its
+    // anchor is reached, for a fixed segment these come in order of their
+    // start positions.
+    std::vector<size_t> progress(m_patterns.size(), 0);
+    std::vector<size_t> nextPos(m_patterns.size(), 0);
+    size_t best = m_players.size();
+
+    for (size_t k = 0; k < m_patterns.size(); ++k)
+    {
+        const CompiledPattern& cp = m_patterns[k];
+        if (cp.matchable && (m_segments[cp.firstSegment].length == 0)
+            && (cp.player < best))
+        {
+            // pattern without any bytes
+            best = cp.player;
+        }
+    }
+
+    uint_least32_t node = 0;
+    for (size_t i = 0; (i < buffer.size()) && (best > 0); ++i)
+    {
+        node = m_delta[node * 256 + buffer[i]];
+
+        uint_least32_t d = m_nodes[node].segments.empty()
+                           ? m_nodes[node].dict : node;
+        for (; d != 0; d = m_nodes[d].dict)
+        {
+            const std::vector<uint_least32_t>& out = m_nodes[d].segments;
+            for (size_t o = 0; o < out.size(); ++o)
+            {
+                const Segment& seg = m_segments[out[o]];
+                const CompiledPattern& cp = m_patterns[seg.pattern];
+                size_t& pr = progress[seg.pattern];
+
+                if ((cp.player >= best)
+                    || (cp.firstSegment + pr != out[o])
+                    || (i + 1 < seg.anchorOffset + seg.anchorLength))
+                {
+                    continue;
+                }
+
+                size_t start = i + 1 - seg.anchorOffset - seg.anchorLength;
+                if ((start < nextPos[seg.pattern])
+                    || !verify(seg, buffer, start))
+                {
+                    continue;
+                }
+
+                nextPos[seg.pattern] = start + seg.length;
+                ++pr;
+
+                // an empty last part matches right away
+                if ((pr == cp.numSegments - 1)
+                    && (m_segments[cp.firstSegment + pr].length == 0))
+                {
+                    ++pr;
+                }
+                if (pr == cp.numSegments)
+                {
+                    best = cp.player;
+                }
+            }
+        }
+    }
+
+    return (best < m_players.size()) ? m_players[best].name() : "";
+}
+
+
+std::string SidId::identifySlow(const std::vector<uint_least8_t>& buffer)
 {
     for (std::vector<Player>::const_iterator iter = m_players.begin();
          iter != m_players.end(); ++iter)
@@ -27,6 +27,7 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "../sidplay/sidint.h"
@@ -50,6 +51,7 @@ class SidId
         void clear();
         void pushValue(uint_least16_t value);
         bool match(const std::vector<uint_least8_t>& buffer) const;
+        const std::vector<uint_least16_t>& values() const;
     };
 
     class Player
@@ -61,9 +63,51 @@ class SidId
         void addPattern(const Pattern& pattern);
         const std::string& name() const;
         bool match(const std::vector<uint_least8_t>& buffer) const;
+        const std::vector<Pattern>& patterns() const;
     };
 
+    // A part of a pattern between two AND tokens. It is found through its
+    // longest run of literal bytes (the anchor) and then verified in full.
+    struct Segment
+    {
+        const uint_least16_t* values;
+        size_t length;
+        size_t anchorOffset;
+        size_t anchorLength;
+        size_t pattern;
+    };
+
+    struct CompiledPattern
+    {
+        size_t player;
+        size_t firstSegment;
+        size_t numSegments;
+        bool matchable;
+    };
+
+    // Aho-Corasick automaton over the anchors of all segments
+    struct Node
+    {
+        std::vector<std::pair<uint_least8_t, uint_least32_t> > next;
+        uint_least32_t fail;
+        uint_least32_t dict;      // next node on the fail chain with outputs
+        std::vector<uint_least32_t> segments;
+    };
+
+    // anchors are limited in length to keep the transition table small
+    static const size_t MAX_ANCHOR_LENGTH = 8;
+
     std::vector<Player> m_players;
+    std::vector<Segment> m_segments;
+    std::vector<CompiledPattern> m_patterns;
+    std::vector<Node> m_nodes;
+    std::vector<uint_least32_t> m_delta;    // 256 transitions per node
+    bool m_compiled;
+
+    void compile();
+    bool verify(const Segment& segment,
+                const std::vector<uint_least8_t>& buffer,
+                size_t start) const;
 
     static const uint_least16_t MATCH_WILDCARD_ONE = 0x100;
     static const uint_least16_t MATCH_WILDCARD_MULTIPLE = 0x101;
@@ -72,8 +116,14 @@ class SidId
     static std::string trim(const std::string& str,
                             const std::string& whitespace = " \t\n\r");
 public:
+    SidId();
     bool readConfigFile(const std::string& filename);
+
+    // identify the player in a single pass over the buffer
     std::string identify(const std::vector<uint_least8_t>& buffer);
+
+    // reference implementation: matches every pattern separately
+    std::string identifySlow(const std::vector<uint_least8_t>& buffer);
 };
 
 #endif // SIDID_H
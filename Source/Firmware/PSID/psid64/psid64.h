@@ -211,6 +211,26 @@ public:
         return m_useGlobalComment;
     }
 
+    /**
+     * Set the song lengths (in seconds, 0 = unknown) of the subtunes, e.g.
+     * taken from the HVSC index. The data is used by the next conversion.
+     */
+    inline void setSongLengths(const uint_least16_t* seconds, int n)
+    {
+	m_songlengthSeconds = seconds;
+	m_nSonglengthSeconds = n;
+    }
+
+    /**
+     * Set the raw STIL entry text (not zero terminated) of the tune. The
+     * text is converted into the scroll text by the next conversion.
+     */
+    inline void setStilEntry(const char* text, int length)
+    {
+	m_stilEntry = text;
+	m_stilEntryLength = length;
+    }
+
     /**
      * Set the verbose flag. When set, PSID64 will be more verbose about the
      * generation of the C64 executable.
@@ -289,6 +309,7 @@ private:
     static const unsigned int NUM_SCREEN_PAGES = 4; // size of screen in pages
     static const unsigned int NUM_CHAR_PAGES = 4; // size of charset in pages
     static const unsigned int STIL_EOT_SPACES = 10; // number of spaces before EOT
+    static const unsigned int STIL_MAX_TEXT = 0x1000; // maximum size of the scroll text
     static const unsigned int BAR_X = 15;
     static const unsigned int BAR_WIDTH = 19;
     static const unsigned int BAR_SPRITE_SCREEN_OFFSET = 0x300;
@@ -328,6 +349,12 @@ private:
     // conversion data
     Screen *m_screen;
     //std::string m_stilText;
+    uint_least8_t m_stilText[STIL_MAX_TEXT];
+    unsigned int m_stilTextLength;
+    const char* m_stilEntry;
+    int m_stilEntryLength;
+    const uint_least16_t* m_songlengthSeconds;
+    int m_nSonglengthSeconds;
     uint_least8_t m_songlengthsData[4 * SIDTUNE_MAX_SONGS];
     size_t m_songlengthsSize;
     uint_least8_t m_driverPage; // startpage of driver, 0 means no driver
@@ -185,7 +185,7 @@ unsigned char	*CYmMusic::depackFile(ymu32 checkOriginalSize)
 
 
 
-static ymint	fileSizeGet(FILE *h)
+static inline ymint	fileSizeGet(FILE *h)
  {
  ymint size;
  ymint old;
@@ -1,5 +1,6 @@
 /* 
-This TED sound emulation is taken from YapeSDL (https://github.com/calmopyrin/yapesdl), only one minor change has been made (always retrieving a single sample value).
+This TED sound emulation is taken from YapeSDL (https://github.com/calmopyrin/yapesdl), only one minor change has been made (always retrieving a single sample value),
+and TEDrenderBlock has been added which renders blocks of samples with the same results.
 The following lists the license that applies to Yape:
 
 README.SDL
@@ -130,6 +131,68 @@ short TEDcalcNextSample()
 	}
 }
 
+// renders nSamples samples, bit-exact to calling TEDcalcNextSample() nSamples times:
+// the output only changes when an oscillator reloads, so we step from reload to reload and fill the samples in between
+void TEDrenderBlock( int *dst, unsigned int nSamples )
+{
+	if ( DAStatus )
+	{
+		for ( unsigned int i = 0; i < nSamples; i++ )
+			dst[ i ] = cachedDigiSample;
+		return;
+	}
+
+	int count0 = oscCount[ 0 ], count1 = oscCount[ 1 ];
+	int out = cachedSoundSample[ 0 ] + cachedSoundSample[ 1 ];
+
+	while ( nSamples )
+	{
+		// samples up to and including the next reload of either oscillator
+		unsigned int run = nSamples;
+		if ( oscStep > 0 )
+		{
+			int k0 = ( OSCRELOADVAL - count0 + oscStep - 1 ) / oscStep;
+			int k1 = ( OSCRELOADVAL - count1 + oscStep - 1 ) / oscStep;
+			int k = k0 < k1 ? k0 : k1;
+			if ( k < 1 ) k = 1;
+			if ( (unsigned int)k < run ) run = k;
+		}
+		nSamples -= run;
+
+		for ( unsigned int i = 1; i < run; i++ )
+			*( dst ++ ) = out;
+		count0 += ( run - 1 ) * oscStep;
+		count1 += ( run - 1 ) * oscStep;
+
+		// last sample of the run, exactly as in TEDcalcNextSample()
+		if ( ( count0 += oscStep ) >= OSCRELOADVAL )
+		{
+			if ( OscReload[ 0 ] != ( 0x3FF << PRECISION ) )
+			{
+				FlipFlop ^= 0x10;
+				cachedSoundSample[ 0 ] = volumeTable[ Volume | ( FlipFlop & channelStatus[ 0 ] ) ];
+			}
+			count0 = OscReload[ 0 ] + ( count0 - OSCRELOADVAL );
+		}
+		if ( ( count1 += oscStep ) >= OSCRELOADVAL )
+		{
+			if ( OscReload[ 1 ] != ( 0x3FF << PRECISION ) )
+			{
+				FlipFlop ^= 0x20;
+				if ( ++NoiseCounter == 256 )
+					NoiseCounter = 0;
+				cachedSoundSample[ 1 ] = volumeTable[ Volume | ( FlipFlop & channelStatus[ 1 ] ) | ( noise[ NoiseCounter ] & SndNoiseStatus ) ];
+			}
+			count1 = OscReload[ 1 ] + ( count1 - OSCRELOADVAL );
+		}
+		out = cachedSoundSample[ 0 ] + cachedSoundSample[ 1 ];
+		*( dst ++ ) = out;
+	}
+
+	oscCount[ 0 ] = count0;
+	oscCount[ 1 ] = count1;
+}
+
 inline void setFreq( unsigned int channel, int freq )
 {
 	if ( freq == 0x3FE ) {
@@ -0,0 +1,194 @@
+/*
+  _________.__    .___      __   .__        __            _____                       
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __       /     \   ____   ____  __ __ 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /      /  \ /  \_/ __ \ /    \|  |  \
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <      /    Y    \  ___/|   |  \  |  /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \____|__  /\___  >___|  /____/ 
+        \/         \/    \/     \/       \/     \/             \/     \/     \/       
+ 
+ animation_delta.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - delta-compressed background animation (keyframes + XOR deltas, seekable, playable in both directions)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _animation_delta_h
+#define _animation_delta_h
+
+#include <circle/types.h>
+#include <circle/util.h>
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+//
+// container written by AnimationTool (SKAnimation.cpp):
+//
+//   SKANIMHEADER
+//   u32 deltaOffset[ nFrames ]		delta[ f ] = frame[ f ] ^ frame[ f - 1 ], delta[ 0 ] = frame[ 0 ] ^ frame[ nFrames - 1 ]
+//   u32 keyOffset[ nKeys ]			key[ k ] = frame[ k * keyInterval ] ^ 0, nKeys = ( nFrames + keyInterval - 1 ) / keyInterval
+//   blocks
+//
+// every block encodes the set bytes of an XOR mask of a 192x147 1-bit frame:
+//   u8 topMask[ 56 ]		one bit per mask byte which is not zero
+//   u8 mask[ ... ]			the non-zero mask bytes, one bit per frame byte which is not zero
+//   u8 data[ ... ]			the non-zero frame bytes
+//
+#define SKANIM_MAGIC			0x44414b53		// "SKAD"
+#define SKANIM_RES_X			192
+#define SKANIM_RES_Y			147
+#define SKANIM_FRAME_BYTES		( SKANIM_RES_X / 8 * SKANIM_RES_Y )
+#define SKANIM_MASK_BYTES		( SKANIM_FRAME_BYTES / 8 )
+#define SKANIM_TOPMASK_BYTES	( ( SKANIM_MASK_BYTES + 7 ) / 8 )
+
+typedef struct
+{
+	u32 magic;
+	u16 nFrames;
+	u16 keyInterval;
+} __attribute__((packed)) SKANIMHEADER;
+
+// for each mask byte: index of the data byte for every set bit, 0xff (-> 0 with vtbl) otherwise
+static u8 skAnimExpand[ 256 ][ 8 ];
+
+static void skAnimInit()
+{
+	for ( u32 m = 0; m < 256; m++ )
+	{
+		u32 k = 0;
+		for ( u32 b = 0; b < 8; b++ )
+			skAnimExpand[ m ][ b ] = ( m & ( 1 << b ) ) ? k ++ : 0xff;
+	}
+}
+
+// returns 1 if the block at 'ofs' lies completely within the first 'size' bytes and only touches mask bytes of the frame
+static int skAnimBlockValid( const u8 *data, u32 size, u32 ofs )
+{
+	if ( ofs > size || size - ofs < SKANIM_TOPMASK_BYTES )
+		return 0;
+
+	const u8 *top = data + ofs;
+	if ( top[ SKANIM_TOPMASK_BYTES - 1 ] >> ( SKANIM_MASK_BYTES - ( SKANIM_TOPMASK_BYTES - 1 ) * 8 ) )
+		return 0;
+
+	u32 nMask = 0;
+	for ( u32 t = 0; t < SKANIM_TOPMASK_BYTES; t++ )
+		nMask += __builtin_popcount( top[ t ] );
+
+	u32 avail = size - ofs - SKANIM_TOPMASK_BYTES;
+	if ( nMask > avail )
+		return 0;
+
+	const u8 *mask = top + SKANIM_TOPMASK_BYTES;
+	u32 nData = 0;
+	for ( u32 i = 0; i < nMask; i++ )
+		nData += __builtin_popcount( mask[ i ] );
+
+	return nData <= avail - nMask;
+}
+
+// returns 1 if 'data' is a delta-compressed animation which fits into 'maxSize' bytes and all of its blocks are within 'size'
+// (the buffer needs 7 bytes beyond 'maxSize' for the NEON path of skAnimApply)
+static int skAnimValid( const u8 *data, u32 size, u32 maxSize )
+{
+	const SKANIMHEADER *h = (const SKANIMHEADER *)data;
+	if ( size < sizeof( SKANIMHEADER ) || size > maxSize || h->magic != SKANIM_MAGIC || h->nFrames == 0 || h->keyInterval == 0 )
+		return 0;
+	u32 nKeys = ( h->nFrames + h->keyInterval - 1 ) / h->keyInterval;
+	if ( sizeof( SKANIMHEADER ) + ( h->nFrames + nKeys ) * 4 > size )
+		return 0;
+
+	const u32 *ofs = (const u32 *)( data + sizeof( SKANIMHEADER ) );
+	for ( u32 i = 0; i < (u32)h->nFrames + nKeys; i++ )
+		if ( !skAnimBlockValid( data, size, ofs[ i ] ) )
+			return 0;
+
+	return 1;
+}
+
+// XORs one block onto the frame, 8 frame bytes (one mask byte) at a time
+// (NEON: the data bytes are expanded with a table lookup, this reads up to 7 bytes beyond the block)
+static void skAnimApply( u8 *frame, const u8 *block )
+{
+	const u8 *top = block;
+	const u8 *mask = block + SKANIM_TOPMASK_BYTES;
+
+	u32 nMask = 0;
+	for ( u32 t = 0; t < SKANIM_TOPMASK_BYTES; t++ )
+		nMask += __builtin_popcount( top[ t ] );
+	const u8 *data = mask + nMask;
+
+	for ( u32 t = 0; t < SKANIM_TOPMASK_BYTES; t++ )
+	{
+		u32 bits = top[ t ];
+		while ( bits )
+		{
+			u8 *dst = frame + ( t * 8 + __builtin_ctz( bits ) ) * 8;
+			u32 m = *mask++;
+			bits &= bits - 1;
+
+		#ifdef __ARM_NEON
+			uint8x8_t v = vtbl1_u8( vld1_u8( data ), vld1_u8( skAnimExpand[ m ] ) );
+			vst1_u8( dst, veor_u8( vld1_u8( dst ), v ) );
+		#else
+			for ( u32 b = 0; b < 8; b++ )
+				if ( m & ( 1 << b ) )
+					dst[ b ] ^= data[ skAnimExpand[ m ][ b ] ];
+		#endif
+			data += __builtin_popcount( m );
+		}
+	}
+}
+
+static const u8 *skAnimDelta( const u8 *anim, u32 frame )
+{
+	const u32 *ofs = (const u32 *)( anim + sizeof( SKANIMHEADER ) );
+	return anim + ofs[ frame ];
+}
+
+// reconstructs any frame: closest keyframe before it plus the deltas in between
+static void skAnimSeek( const u8 *anim, u8 *frame, u32 target )
+{
+	const SKANIMHEADER *h = (const SKANIMHEADER *)anim;
+	const u32 *keyOfs = (const u32 *)( anim + sizeof( SKANIMHEADER ) ) + h->nFrames;
+
+	u32 k = target / h->keyInterval;
+	memset( frame, 0, SKANIM_FRAME_BYTES );
+	skAnimApply( frame, anim + keyOfs[ k ] );
+	for ( u32 f = k * h->keyInterval + 1; f <= target; f++ )
+		skAnimApply( frame, skAnimDelta( anim, f ) );
+}
+
+// steps from frame 'cur' to the next frame in direction 'dir' (+1/-1), wraps around at the ends
+static u32 skAnimStep( const u8 *anim, u8 *frame, u32 cur, int dir )
+{
+	const SKANIMHEADER *h = (const SKANIMHEADER *)anim;
+
+	if ( dir > 0 )
+	{
+		cur = ( cur + 1 == h->nFrames ) ? 0 : cur + 1;
+		skAnimApply( frame, skAnimDelta( anim, cur ) );
+	} else
+	{
+		skAnimApply( frame, skAnimDelta( anim, cur ) );
+		cur = ( cur == 0 ) ? h->nFrames - 1 : cur - 1;
+	}
+	return cur;
+}
+
+#endif
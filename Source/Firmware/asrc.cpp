@@ -0,0 +1,152 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ asrc.cpp
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - asynchronous sample rate conversion between C64 clock and audio output clock
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <circle/util.h>
+#include "asrc.h"
+#include "helpers.h"
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+// Blackman windowed sinc, one row per phase plus one for the interpolation of the last phase
+static float asrcTable[ ASRC_PHASES + 1 ][ ASRC_TAPS ] AAA;
+static u32 asrcTableReady = 0;
+
+static void asrcCreateTable()
+{
+	for ( u32 p = 0; p <= ASRC_PHASES; p++ )
+	{
+		float sum = 0.0f;
+		for ( u32 k = 0; k < ASRC_TAPS; k++ )
+		{
+			// tap k is at distance x from the output position which lies between taps ASRC_TAPS/2-1 and ASRC_TAPS/2
+			float x = (float)k - (float)( ASRC_TAPS / 2 - 1 ) - (float)p / (float)ASRC_PHASES;
+			float s = ( fabsf( x ) < 1e-6f ) ? 1.0f : sinf( M_PI * x ) / ( M_PI * x );
+			float w = 0.42f + 0.5f * cosf( M_PI * x / ( ASRC_TAPS / 2 ) ) + 0.08f * cosf( 2.0f * M_PI * x / ( ASRC_TAPS / 2 ) );
+			asrcTable[ p ][ k ] = s * w;
+			sum += s * w;
+		}
+		for ( u32 k = 0; k < ASRC_TAPS; k++ )
+			asrcTable[ p ][ k ] /= sum;
+	}
+	asrcTableReady = 1;
+}
+
+void asrcInit( ASRC *a, u32 target, u32 rate )
+{
+	if ( !asrcTableReady )
+		asrcCreateTable();
+
+	memset( a, 0, sizeof( ASRC ) );
+	a->step = 1ull << 32;
+	a->target = target;
+	a->fill = (float)target;
+	a->rate = (float)rate;
+}
+
+void asrcResync( ASRC *a )
+{
+	a->fill = (float)a->target;
+}
+
+static __attribute__( ( always_inline ) ) inline s32 asrcRound( float v )
+{
+	return (s32)( v + ( v < 0.0f ? -0.5f : 0.5f ) );
+}
+
+u32 asrcProcess( ASRC *a, const s32 *left, const s32 *right, u32 n, u32 fill, s32 *outLeft, s32 *outRight )
+{
+	//
+	// PI controller: more samples in the output ring than wanted -> advance faster through the input (larger step)
+	//
+	float dt = (float)n / a->rate;
+	a->fill += ( (float)fill - a->fill ) * min( 1.0f, dt / ASRC_FILL_SMOOTH );
+
+	float e = a->fill - (float)a->target;
+	a->integral += e * dt;
+
+	// anti-windup: the integral term alone must stay within the allowed deviation
+	const float iMax = ASRC_MAX_DEVIATION / ASRC_KI;
+	a->integral = max( -iMax, min( iMax, a->integral ) );
+
+	float ratio = ASRC_KP * e + ASRC_KI * a->integral;
+	ratio = max( -ASRC_MAX_DEVIATION, min( ASRC_MAX_DEVIATION, ratio ) );
+	a->step = (u64)( ( 1.0 + (double)ratio ) * 4294967296.0 );
+
+	//
+	// polyphase resampler
+	//
+	u32 nOut = 0;
+	for ( u32 i = 0; i < n; i++ )
+	{
+		u32 h = a->histPos;
+		a->hist[ 0 ][ h ] = a->hist[ 0 ][ h + ASRC_TAPS ] = (float)left[ i ];
+		a->hist[ 1 ][ h ] = a->hist[ 1 ][ h + ASRC_TAPS ] = (float)right[ i ];
+		h = a->histPos = ( h + 1 ) & ( ASRC_TAPS - 1 );
+
+		// history from the oldest to the newest sample
+		const float *hl = &a->hist[ 0 ][ h ];
+		const float *hr = &a->hist[ 1 ][ h ];
+
+		while ( a->frac < ( 1ull << 32 ) )
+		{
+			u32 f = (u32)a->frac;
+			u32 p = f >> ( 32 - ASRC_PHASE_BITS );
+			float t = (float)( f << ASRC_PHASE_BITS ) * ( 1.0f / 4294967296.0f );
+			const float *c0 = asrcTable[ p ], *c1 = asrcTable[ p + 1 ];
+
+		#ifdef __ARM_NEON
+			float32x4_t ca = vld1q_f32( &c0[ 0 ] ), cb = vld1q_f32( &c0[ 4 ] );
+			ca = vmlaq_n_f32( ca, vsubq_f32( vld1q_f32( &c1[ 0 ] ), ca ), t );
+			cb = vmlaq_n_f32( cb, vsubq_f32( vld1q_f32( &c1[ 4 ] ), cb ), t );
+
+			float l = vaddvq_f32( vmlaq_f32( vmulq_f32( ca, vld1q_f32( &hl[ 0 ] ) ), cb, vld1q_f32( &hl[ 4 ] ) ) );
+			float r = vaddvq_f32( vmlaq_f32( vmulq_f32( ca, vld1q_f32( &hr[ 0 ] ) ), cb, vld1q_f32( &hr[ 4 ] ) ) );
+		#else
+			float l = 0.0f, r = 0.0f;
+			for ( u32 k = 0; k < ASRC_TAPS; k++ )
+			{
+				float c = c0[ k ] + ( c1[ k ] - c0[ k ] ) * t;
+				l += c * hl[ k ];
+				r += c * hr[ k ];
+			}
+		#endif
+
+			outLeft[ nOut ] = asrcRound( l );
+			outRight[ nOut ] = asrcRound( r );
+			nOut ++;
+			a->frac += a->step;
+		}
+		a->frac -= 1ull << 32;
+	}
+
+	return nOut;
+}
@@ -0,0 +1,74 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ asrc.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - asynchronous sample rate conversion between C64 clock and audio output clock
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _asrc_h_
+#define _asrc_h_
+
+#include <circle/types.h>
+#include "lowlevel_arm64.h"
+
+//
+// the emulated chips are clocked by the C64 (or C16/+4) bus, the PWM and HDMI sinks by the Pi's clocks:
+// a PI controller on the fill level of the output ring steers the ratio of a polyphase resampler,
+// such that the rings can be kept short without running empty (or over) as the clocks drift apart
+//
+#define ASRC_TAPS			8		// taps per phase
+#define ASRC_PHASE_BITS		6
+#define ASRC_PHASES			( 1 << ASRC_PHASE_BITS )	// the fractional position is interpolated between two phases
+
+#define ASRC_MAX_DEVIATION	0.01f	// maximum ratio deviation from 1 (10000 ppm)
+#define ASRC_FILL_SMOOTH	0.05f	// time constant of the fill level low-pass in seconds (hides the chunk-wise consumption of HDMI)
+#define ASRC_KP				( 1.0f / 48000.0f )		// ratio per stereo sample of fill error: ~1s time constant
+#define ASRC_KI				( 0.25f / 48000.0f )	// critically damped with the above
+
+// maximum number of output samples for n input samples
+#define ASRC_MAX_OUTPUT( n )	( (n) + (n) / 64 + 2 )
+
+typedef struct
+{
+	float hist[ 2 ][ ASRC_TAPS * 2 ] AAA;	// input history of both channels, stored twice for wrap-free access
+	u32 histPos;
+	u64 frac;		// position of the next output sample after the second to last input sample, 32.32 fixed point
+	u64 step;		// input samples per output sample, 32.32 fixed point
+	u32 target;		// fill level (stereo samples) of the output ring the controller aims at
+	float fill;		// low-pass filtered fill level
+	float integral;	// integral of the fill error, converges to the clock drift
+	float rate;		// input sample rate
+} ASRC;
+
+extern void asrcInit( ASRC *a, u32 target, u32 rate );
+
+// restarts the controller from the current clock drift estimate, e.g. after the output ring has been reset
+extern void asrcResync( ASRC *a );
+
+// resamples n input samples, 'fill' is the current fill level of the output ring,
+// returns the number of output samples (at most ASRC_MAX_OUTPUT( n ))
+extern u32 asrcProcess( ASRC *a, const s32 *left, const s32 *right, u32 n, u32 fill, s32 *outLeft, s32 *outRight );
+
+#endif
@@ -0,0 +1,189 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ audiograph.cpp
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - audio graph: chip sources, block mixer and output sinks
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <circle/util.h>
+#include <circle/soundbasedevice.h>
+#include <vc4/vchiq/vchiqdevice.h>
+#include "audiograph.h"
+#include "sound.h"
+#include "hdmidma.h"
+#include "helpers.h"
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+AUDIO_GRAPH audioGraph AAA;
+
+void audioGraphInit( u32 sinks )
+{
+	memset( &audioGraph, 0, sizeof( AUDIO_GRAPH ) );
+	audioGraph.sinks = sinks;
+	asrcInit( &audioGraph.asrcPWM, PWM_DMA_TARGET, AUDIO_SAMPLERATE );
+	asrcInit( &audioGraph.asrcHDMI, HDMI_DMA_TARGET, AUDIO_SAMPLERATE );
+}
+
+u32 audioGraphAddSource( s32 gainLeft, s32 gainRight, AUDIO_RENDER_FUNC render, void *param )
+{
+	if ( audioGraph.nSources >= AUDIO_MAX_SOURCES )
+		return AUDIO_NO_SOURCE;
+
+	AUDIO_SOURCE *s = &audioGraph.src[ audioGraph.nSources ];
+	s->gainLeft = gainLeft;
+	s->gainRight = gainRight;
+	s->render = render;
+	s->param = param;
+
+	return audioGraph.nSources ++;
+}
+
+void audioGraphSetGain( u32 src, s32 gainLeft, s32 gainRight )
+{
+	if ( src >= audioGraph.nSources )
+		return;
+
+	audioGraph.src[ src ].gainLeft = gainLeft;
+	audioGraph.src[ src ].gainRight = gainRight;
+}
+
+void audioGraphVolPan( s32 volume, s32 panning, s32 scale, s32 *gainLeft, s32 *gainRight )
+{
+	*gainLeft  = volume * ( 14 - panning ) * scale / 210;
+	*gainRight = volume * ( panning ) * scale / 210;
+}
+
+void audioGraphNormalizeGains()
+{
+	s32 maxGain = 0;
+	for ( u32 i = 0; i < audioGraph.nSources; i++ )
+		maxGain = max( maxGain, max( audioGraph.src[ i ].gainLeft, audioGraph.src[ i ].gainRight ) );
+
+	if ( maxGain == 0 ) return;
+
+	for ( u32 i = 0; i < audioGraph.nSources; i++ )
+	{
+		audioGraph.src[ i ].gainLeft  = audioGraph.src[ i ].gainLeft  * 256 / maxGain;
+		audioGraph.src[ i ].gainRight = audioGraph.src[ i ].gainRight * 256 / maxGain;
+	}
+}
+
+void audioGraphMix()
+{
+	AUDIO_GRAPH *g = &audioGraph;
+
+	// pull sources render the remainder of their block now
+	for ( u32 i = 0; i < g->nSources; i++ )
+		if ( g->src[ i ].render )
+		{
+			AUDIO_SOURCE *s = &g->src[ i ];
+			if ( s->rendered < AUDIO_BLOCK_SIZE )
+				s->render( s->param, &s->block[ s->rendered ], AUDIO_BLOCK_SIZE - s->rendered );
+			s->rendered = 0;
+		}
+
+#ifdef __ARM_NEON
+	const int32x4_t clipMin = vdupq_n_s32( -AUDIO_CLIP );
+	const int32x4_t clipMax = vdupq_n_s32( AUDIO_CLIP );
+
+	for ( u32 j = 0; j < AUDIO_BLOCK_SIZE; j += 4 )
+	{
+		int32x4_t l = vdupq_n_s32( 0 );
+		int32x4_t r = vdupq_n_s32( 0 );
+
+		for ( u32 i = 0; i < g->nSources; i++ )
+		{
+			int32x4_t v = vld1q_s32( &g->src[ i ].block[ j ] );
+			l = vmlaq_n_s32( l, v, g->src[ i ].gainLeft );
+			r = vmlaq_n_s32( r, v, g->src[ i ].gainRight );
+		}
+
+		l = vmaxq_s32( clipMin, vminq_s32( clipMax, vshrq_n_s32( l, 8 ) ) );
+		r = vmaxq_s32( clipMin, vminq_s32( clipMax, vshrq_n_s32( r, 8 ) ) );
+
+		vst1q_s32( &g->mixLeft[ j ], l );
+		vst1q_s32( &g->mixRight[ j ], r );
+	}
+#else
+	for ( u32 j = 0; j < AUDIO_BLOCK_SIZE; j++ )
+	{
+		s32 l = 0, r = 0;
+
+		for ( u32 i = 0; i < g->nSources; i++ )
+		{
+			l += g->src[ i ].block[ j ] * g->src[ i ].gainLeft;
+			r += g->src[ i ].block[ j ] * g->src[ i ].gainRight;
+		}
+
+		g->mixLeft[ j ]  = max( -AUDIO_CLIP, min( AUDIO_CLIP, l >> 8 ) );
+		g->mixRight[ j ] = max( -AUDIO_CLIP, min( AUDIO_CLIP, r >> 8 ) );
+	}
+#endif
+}
+
+void audioGraphOutput()
+{
+	AUDIO_GRAPH *g = &audioGraph;
+
+	if ( g->sinks & AUDIO_SINK_PWM )
+	{
+		u32 fill = pwmDMAFill();
+		if ( fill < AUDIO_BLOCK_SIZE || fill > PWM_DMA_FRAMES - 2 * AUDIO_BLOCK_SIZE )
+		{
+			// underrun (or overrun), restart at the target distance
+			pwmDMAResync();
+			asrcResync( &g->asrcPWM );
+			fill = PWM_DMA_TARGET;
+		}
+
+		u32 n = asrcProcess( &g->asrcPWM, g->mixLeft, g->mixRight, AUDIO_BLOCK_SIZE, fill, g->outLeft, g->outRight );
+		pwmDMAOutput( g->outLeft, g->outRight, n );
+	}
+
+	if ( g->sinks & AUDIO_SINK_HDMI )
+	{
+		// (re)start with silence up to the target fill level
+		if ( hdmiDMAFill() < AUDIO_BLOCK_SIZE )
+		{
+			while ( hdmiDMAFill() < HDMI_DMA_TARGET )
+				hdmiDMAPutSample( 0, 0 );
+			asrcResync( &g->asrcHDMI );
+		}
+
+		u32 n = asrcProcess( &g->asrcHDMI, g->mixLeft, g->mixRight, AUDIO_BLOCK_SIZE, hdmiDMALevel(), g->outLeft, g->outRight );
+		for ( u32 j = 0; j < n; j++ )
+			hdmiDMAPutSample( max( -AUDIO_CLIP, min( AUDIO_CLIP, g->outLeft[ j ] ) ) << 8, max( -AUDIO_CLIP, min( AUDIO_CLIP, g->outRight[ j ] ) ) << 8 );
+	}
+
+	if ( g->sinks & AUDIO_SINK_VCHIQ )
+		for ( u32 j = 0; j < AUDIO_BLOCK_SIZE; j++ )
+		{
+			putSample( (short)g->mixLeft[ j ] );
+			putSample( (short)g->mixRight[ j ] );
+		}
+}
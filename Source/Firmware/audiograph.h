@@ -0,0 +1,130 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ audiograph.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - audio graph: chip sources, block mixer and output sinks
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _audiograph_h_
+#define _audiograph_h_
+
+#include <circle/types.h>
+#include "lowlevel_arm64.h"
+#include "asrc.h"
+
+//
+// the audio graph replaces the hand-written mixers of the SID kernels:
+// chip sources (reSID, FM_OPL, TED sound, digiblaster, tsf MIDI, ...) deliver their output into
+// fixed-size blocks, one mixer applies per-source gains for both channels, and the result is written to the sinks
+//
+#define AUDIO_MAX_SOURCES	8
+#define AUDIO_NO_SOURCE		0xffffffff	// returned by audioGraphAddSource if all sources are in use
+#define AUDIO_BLOCK_SIZE	32		// samples per block, must be a multiple of 4
+
+#define AUDIO_CLIP			32767
+#define AUDIO_SAMPLERATE	48000	// nominal, the actual rate follows the C64 clock
+
+// output sinks
+#define AUDIO_SINK_PWM		1		// DMA ring of the PWM FIFO, requantized with noise shaping, see sound.cpp
+#define AUDIO_SINK_HDMI		2		// ring buffer of the DMA driven HDMI device, see hdmidma.h
+									// (both are resampled to the clock of the output device, see asrc.h)
+#define AUDIO_SINK_VCHIQ	4		// PCMBuffer, fed to the VCHIQ sound device
+
+// sources either render a whole block when the mixer asks for it ("pull", e.g. tsf MIDI),
+// or are fed sample by sample using audioGraphPut ("push", emulated chips which are clocked by the bus)
+typedef void (*AUDIO_RENDER_FUNC)( void *param, s32 *dst, u32 nSamples );
+
+typedef struct
+{
+	s32 block[ AUDIO_BLOCK_SIZE ] AAA;
+	s32 gainLeft, gainRight;		// 8.8 fixed point
+	AUDIO_RENDER_FUNC render;
+	void *param;
+	u32 rendered;					// pull sources: number of samples of the current block already rendered
+} AUDIO_SOURCE;
+
+typedef struct
+{
+	AUDIO_SOURCE src[ AUDIO_MAX_SOURCES ] AAA;
+	s32 mixLeft[ AUDIO_BLOCK_SIZE ] AAA;
+	s32 mixRight[ AUDIO_BLOCK_SIZE ] AAA;
+	s32 outLeft[ ASRC_MAX_OUTPUT( AUDIO_BLOCK_SIZE ) ] AAA;
+	s32 outRight[ ASRC_MAX_OUTPUT( AUDIO_BLOCK_SIZE ) ] AAA;
+	ASRC asrcPWM, asrcHDMI;
+	u32 nSources;
+	u32 pos;
+	u32 sinks;
+} AUDIO_GRAPH;
+
+extern AUDIO_GRAPH audioGraph;
+
+extern void audioGraphInit( u32 sinks );
+extern u32  audioGraphAddSource( s32 gainLeft, s32 gainRight, AUDIO_RENDER_FUNC render = NULL, void *param = NULL );
+extern void audioGraphSetGain( u32 src, s32 gainLeft, s32 gainRight );
+
+// computes the gains from the volume (0..15) and panning (0..14) settings as used in the config files
+extern void audioGraphVolPan( s32 volume, s32 panning, s32 scale, s32 *gainLeft, s32 *gainRight );
+
+// scales the gains of all sources such that the loudest one is 1.0 (256)
+extern void audioGraphNormalizeGains();
+
+extern void audioGraphMix();
+extern void audioGraphOutput();
+
+static __attribute__( ( always_inline ) ) inline void audioGraphPut( u32 src, s32 v )
+{
+	audioGraph.src[ src ].block[ audioGraph.pos ] = v;
+}
+
+static __attribute__( ( always_inline ) ) inline void audioGraphMute()
+{
+	for ( u32 i = 0; i < audioGraph.nSources; i++ )
+		audioGraph.src[ i ].gainLeft = audioGraph.src[ i ].gainRight = 0;
+}
+
+// renders a pull source up to (excluding) the current sample, such that events (e.g. MIDI messages) take effect at their exact sample position
+static __attribute__( ( always_inline ) ) inline void audioGraphRenderUpTo( u32 src )
+{
+	AUDIO_SOURCE *s = &audioGraph.src[ src ];
+	if ( s->render && audioGraph.pos > s->rendered )
+	{
+		s->render( s->param, &s->block[ s->rendered ], audioGraph.pos - s->rendered );
+		s->rendered = audioGraph.pos;
+	}
+}
+
+// advances to the next sample, returns 1 if this completed a block (which then has been mixed and output)
+static __attribute__( ( always_inline ) ) inline u32 audioGraphAdvance()
+{
+	if ( ++ audioGraph.pos < AUDIO_BLOCK_SIZE )
+		return 0;
+
+	audioGraphMix();
+	audioGraphOutput();
+	audioGraph.pos = 0;
+	return 1;
+}
+
+#endif
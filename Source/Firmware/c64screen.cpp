@@ -37,8 +37,11 @@
 #include "dirscan.h"
 #include "config.h"
 #include "crt.h"
+#include "crtprofile.h"
 #include "kernel_menu.h"
 #include "PSID/psid64/psid64.h"
+#include "psidcache.h"
+#include "hvscdb.h"
 
 const int VK_F1 = 133;
 const int VK_F2 = 137;
@@ -66,6 +69,7 @@ const int VK_UP    = 145;
 const int VK_DOWN  = 17;
 const int VK_HOME  = 19;
 const int VK_S	   = 83;
+const int VK_P	   = 80;
 
 const int VIRTK_SEARCH_DOWN = 256;
 const int VIRTK_SEARCH_UP   = 257;
@@ -95,7 +99,7 @@ u8 c64screenUppercase = 0;
 
 const char *errorMsg = NULL;
 
-#define NUM_ERRORMESSAGES 9
+#define NUM_ERRORMESSAGES 10
 const char errorMessages[NUM_ERRORMESSAGES][52] = {
 //   1234567890123456789012345678901234567890
 	"                NO ERROR                ",
@@ -107,6 +111,7 @@ const char errorMessages[NUM_ERRORMESSAGES][52] = {
 	"         SID-WIRE NOT DETECTED!         ",
 	"         DISK2EASYFLASH FAILED!         ",
 	"             FILE NOT FOUND             ",
+	"           CRT PROFILE SAVED            ",
 };
 
 #define MAX_SETTINGS 17
@@ -128,6 +133,7 @@ int extraMsg = 0;
 #define MENU_BROWSER 0x01
 #define MENU_ERROR	 0x02
 #define MENU_CONFIG  0x03
+#define MENU_CRTPROFILE 0x04
 u32 menuScreen = 0, 
 	previousMenuScreen = 0;
 u32 updateMenu = 1;
@@ -147,6 +153,80 @@ int subSID = 0;
 int subHasKernal = -1;
 int subHasLaunch = -1;
 
+// cartridge profile of a .crt edited in the browser (key P): handler, timing, DMA and one line per warm bank
+#define CRTPROFILE_EDIT_LINES	( 3 + CRTPROFILE_WARM_BANKS )
+CRTPROFILE crtProfileEdit;
+u32 crtProfileEditLine = 0;
+
+static s32 wrapValue( s32 v, s32 minV, s32 maxV )
+{
+	if ( v < minV ) return maxV;
+	if ( v > maxV ) return minV;
+	return v;
+}
+
+static void changeCRTProfileEdit( s32 d )
+{
+	CRTPROFILE *p = &crtProfileEdit;
+
+	switch ( crtProfileEditLine )
+	{
+	case 0:
+		p->handler = wrapValue( (s32)p->handler + d, 0, CRTPROFILE_HANDLER_MODES - 1 );
+		break;
+	case 1:
+		p->pollTimingOfs = wrapValue( (s32)p->pollTimingOfs + d, CRTPROFILE_TIMING_MIN, CRTPROFILE_TIMING_MAX );
+		break;
+	case 2:
+		p->dmaCycles = wrapValue( (s32)p->dmaCycles + d, 0, CRTPROFILE_DMA_MAX );
+		break;
+	default:
+		{
+			// -1 = unused (0xff)
+			u8 *b = &p->warmBanks[ crtProfileEditLine - 3 ];
+			s32 v = ( *b == 0xff ) ? -1 : *b;
+			v = wrapValue( v + d, -1, CRTPROFILE_BANKS - 1 );
+			*b = ( v < 0 ) ? 0xff : v;
+		}
+		break;
+	}
+}
+
+static void printCRTProfileScreen()
+{
+	char t[ 64 ];
+	const CRTPROFILE *p = &crtProfileEdit;
+	u8 c = skinValues.SKIN_ERROR_TEXT;
+
+	printC64( 0,  8, "\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9\xf9", skinValues.SKIN_ERROR_BAR, 0, 1 );
+	printC64( 0,  9, "              CRT PROFILE               ", c, 0, 3 );
+
+	for ( u32 i = 0; i < CRTPROFILE_EDIT_LINES; i++ )
+	{
+		if ( i == 0 )
+			sprintf( t, "  HANDLER          %s", crtProfileHandlerName( p->handler ) ); else
+		if ( i == 1 )
+			sprintf( t, "  TIMING OFFSET    %s%d", p->pollTimingOfs > 0 ? "+" : "", p->pollTimingOfs ); else
+		if ( i == 2 )
+		{
+			if ( p->dmaCycles )
+				sprintf( t, "  DMA CYCLES       %d", p->dmaCycles ); else
+				sprintf( t, "  DMA CYCLES       default" );
+		} else
+		{
+			u8 b = p->warmBanks[ i - 3 ];
+			if ( b == 0xff )
+				sprintf( t, "  WARM BANK %d      -", i - 2 ); else
+				sprintf( t, "  WARM BANK %d      %d", i - 2, b );
+		}
+		printC64( 0, 10 + i, "                                        ", c, 0 );
+		printC64( 0, 10 + i, t, c, ( i == crtProfileEditLine ) ? 0x80 : 0, 3 );
+	}
+
+	printC64( 0, 10 + CRTPROFILE_EDIT_LINES, "   CURSOR: CHANGE, RETURN: SAVE, ESC    ", c, 0, 3 );
+	printC64( 0, 11 + CRTPROFILE_EDIT_LINES, "\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8\xf8", skinValues.SKIN_ERROR_BAR, 0, 1 );
+}
+
 void clearC64()
 {
 	memset( c64screen, ' ', 1024 );
@@ -412,6 +492,38 @@ void printBrowserScreen()
 		printC64( 20, 24, "+SHIFT", skinValues.SKIN_BROWSER_TEXT_FOOTER, 128, 3 );
 	}
 
+	// song lengths and STIL availability from the HVSC index (in RAM, the STIL text is only read at launch)
+	if ( dir[ cursorPos ].f & DIR_SID_FILE )
+	{
+		char path[ 8192 ] = "SD:";
+		u32 nodes[ 256 ];
+		u32 n = 0, c = cursorPos;
+
+		nodes[ n ++ ] = c;
+		while ( dir[ c ].parent != 0xffffffff && n < 256 )
+			c = nodes[ n ++ ] = dir[ c ].parent;
+
+		for ( s32 i = n - 1; i >= 0; i -- )
+		{
+			if ( i != (s32)n - 1 )
+				strcat( path, "\\" );
+			strcat( path, (char*)dir[ nodes[ i ] ].name );
+		}
+
+		static u16 lengths[ 256 ];
+		u32 nSongs = 0, stilLength = 0;
+		if ( hvscDBInit( logger, DRIVE ) &&
+			 hvscDBLookup( logger, DRIVE, path, lengths, &nSongs, 256, NULL, &stilLength ) )
+		{
+			char temp[ 64 ];
+			if ( nSongs > 0 )
+				sprintf( temp, " HVSC: %3d song(s), #1 %2d:%02d %s", nSongs, lengths[ 0 ] / 60, lengths[ 0 ] % 60, stilLength ? "STIL" : "" ); else
+				sprintf( temp, " HVSC: no song lengths %s", stilLength ? "STIL" : "" );
+			printC64( 0, 24, "                                        ", skinValues.SKIN_BROWSER_TEXT_FOOTER, 0, 3 );
+			printC64( 0, 24, temp, skinValues.SKIN_BROWSER_TEXT_FOOTER, 0, 3 );
+		}
+	}
+
 	if ( modeC128 && ( dir[ cursorPos ].f & DIR_FILE_IN_D64 ) )
 		printC64( 0, 24, "SHIFT+RETURN to launch PRGs in C128-mode", skinValues.SKIN_BROWSER_TEXT_FOOTER, 0, 3 );
 
@@ -638,37 +750,24 @@ void snapJoy( int dir )
 
 int fileExists( CLogger *logger, const char *DRIVE, const char *FILENAME )
 {
-	FATFS m_FileSystem;
-
 	// mount file system
-	if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+	if ( fsMount( DRIVE ) != FR_OK )
 	{
 		//logger->Write( "fe", LogNotice, "Cannot mount drive: %s", DRIVE );
 		return -1;
 	}
 
-	// get filesize
-	FILINFO info;
-	u32 result = f_stat( FILENAME, &info );
-
-	// open file
-	FIL file;
-	result = f_open( &file, FILENAME, FA_READ | FA_OPEN_EXISTING );
-	if ( result != FR_OK )
+	// a cached handle answers without accessing the SD card, otherwise only the directory entry is looked up
+	u32 size;
+	if ( !getFileSize( logger, DRIVE, FILENAME, &size ) )
 	{
-		f_mount( 0, DRIVE, 0 );
+		fsUnmount( DRIVE );
 		//logger->Write( "fe", LogNotice, "Cannot open file: %s", FILENAME );
 		return -2;
 	}
 
-	if ( f_close( &file ) != FR_OK )
-	{
-		//logger->Write( "fe", LogNotice, "Cannot close file" );
-		return -5;
-	}
-
 	// unmount file system
-	if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
+	if ( fsUnmount( DRIVE ) != FR_OK )
 	{
 		//logger->Write( "fe", LogNotice, "Cannot unmount drive: %s", DRIVE );
 		return -6;
@@ -1301,7 +1400,7 @@ void handleC64( int k, u32 *launchKernel, char *FILENAME, char *filenameKernal,
 		if ( typeInName == 0 && ( k == VK_MOUNT || k == VK_MOUNT_START ) && dir[ cursorPos ].f & DIR_D64_FILE )
 		{
 			typeInName = 0;
-			extern int createD2EF( unsigned char *diskimage, int imageSize, unsigned char *cart, int build, int mode, int autostart );
+			extern int createD2EFStream( unsigned char *diskimage, int imageSize, unsigned char *cart, int build, int mode, int autostart );
 
 			unsigned char *cart = new unsigned char[ 1024 * 1025 ];
 			unsigned char *diskimage = new unsigned char[ 1024 * 1024 ];
@@ -1334,7 +1433,7 @@ void handleC64( int k, u32 *launchKernel, char *FILENAME, char *filenameKernal,
 			{
 				//logger->Write( "d2ef", LogNotice, "loaded %d bytes D64", diSize );
 
-				crtSize = createD2EF( diskimage, diSize, cart, 2, 0, autostart );
+				crtSize = createD2EFStream( diskimage, diSize, cart, 2, 0, autostart );
 
 				//logger->Write( "d2ef", LogNotice, "loaded %d bytes D64", diSize );
 
@@ -1363,6 +1462,51 @@ void handleC64( int k, u32 *launchKernel, char *FILENAME, char *filenameKernal,
 		}
 
 
+		// edit the settings stored in the cartridge profile database
+		if ( typeInName == 0 && k == VK_P && dir[ cursorPos ].f & DIR_CRT_FILE )
+		{
+			// build path
+			char path[ 8192 ] = {0};
+			s32 n = 0, c = cursorPos;
+			u32 nodes[ 256 ];
+			nodes[ n ++ ] = c;
+
+			while ( dir[ c ].parent != 0xffffffff )
+			{
+				c = nodes[ n ++ ] = dir[ c ].parent;
+			}
+
+			strcat( path, "SD:" );
+			for ( s32 i = n - 1; i >= 0; i -- )
+			{
+				if ( i != n-1 )
+					strcat( path, "\\" );
+				strcat( path, (char*)dir[ nodes[i] ].name );
+			}
+
+			u64 hash;
+			CRTPROFILE *profile;
+			crtProfileLoadDB( logger, DRIVE );
+			previousMenuScreen = menuScreen;
+			if ( getCRTContentHash( logger, DRIVE, path, &hash ) )
+			{
+				// unknown CRTs are only added to the database when the profile is saved
+				if ( ( profile = crtProfileLookup( hash ) ) != NULL )
+					crtProfileEdit = *profile; else
+				{
+					crtProfileSetDefaults( &crtProfileEdit );
+					crtProfileEdit.hash = hash;
+				}
+				crtProfileEditLine = 0;
+				menuScreen = MENU_CRTPROFILE;
+			} else
+			{
+				errorMsg = errorMessages[ 3 ];
+				menuScreen = MENU_ERROR;
+			}
+			return;
+		}
+
 		if ( typeInName == 1 )
 		{
 			int found = -1;
@@ -1641,8 +1785,7 @@ void handleC64( int k, u32 *launchKernel, char *FILENAME, char *filenameKernal,
 							u32 imgsize = 0;
 
 							// mount file system
-							FATFS m_FileSystem;
-							if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+							if ( fsMount( DRIVE ) != FR_OK )
 								logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: %s", DRIVE );
 
 							//logger->Write( "exec", LogNotice, "path '%s'", path );
@@ -1650,7 +1793,7 @@ void handleC64( int k, u32 *launchKernel, char *FILENAME, char *filenameKernal,
 								return;
 
 							// unmount file system
-							if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
+							if ( fsUnmount( DRIVE ) != FR_OK )
 								logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
 
 							if ( d64ParseExtract( d64buf, imgsize, D64_GET_FILE + fileIndex, prgDataLaunch, (s32*)&prgSizeLaunch ) == 0 )
@@ -1731,15 +1874,38 @@ void handleC64( int k, u32 *launchKernel, char *FILENAME, char *filenameKernal,
 
 						logger->Write( "exec", LogNotice, "bytes: '%d'", sidSize );
 
+						// re-launching a known tune only needs a copy of the cached conversion (the conversion
+						// contains the HVSC data, the index version is part of the key)
+						int hvscAvailable = hvscDBInit( logger, DRIVE );
+						u64 sidHash = psidCacheHash( sidData, sidSize, hvscDBVersion() );
+						if ( psidCacheLookup( logger, DRIVE, sidHash, prgDataLaunch, &prgSizeLaunch ) )
+						{
+							logger->Write( "exec", LogNotice, "psid conversion cached, prg size %d", prgSizeLaunch );
+							*launchKernel = 41; 
+							return;
+						}
+
 						Psid64 *psid64 = new Psid64();
 
 						psid64->setVerbose(false);
 						psid64->setUseGlobalComment(false);
 						psid64->setBlankScreen(false);
 						psid64->setNoDriver(false);
+
+						// song lengths and STIL entry from the HVSC database (the index is built on first use)
+						static u16 songLengths[ 256 ];
+						static char stilEntry[ HVSCDB_MAX_STIL ];
+						u32 nSongLengths = 0, stilLength = 0;
+						if ( hvscAvailable )
+							hvscDBLookup( logger, DRIVE, path, songLengths, &nSongLengths, 256, stilEntry, &stilLength );
+						psid64->setSongLengths( songLengths, nSongLengths );
+						psid64->setStilEntry( stilEntry, stilLength );
+
+						bool convertedOk = true;
 						if ( !psid64->load( sidData, sidSize ) )
 						{
 							//return false;
+							convertedOk = false;
 						}
 						logger->Write( "exec", LogNotice, "psid loaded" );
 
@@ -1747,12 +1913,16 @@ void handleC64( int k, u32 *launchKernel, char *FILENAME, char *filenameKernal,
 						if ( !psid64->convert() ) 
 						{
 							//return false;
+							convertedOk = false;
 						}
 						logger->Write( "exec", LogNotice, "psid converted, prg size %d", psid64->m_programSize );
 
 						memcpy( &prgDataLaunch[0], psid64->m_programData, psid64->m_programSize );
 						prgSizeLaunch = psid64->m_programSize;
 
+						if ( convertedOk && prgSizeLaunch > 0 )
+							psidCacheInsert( logger, DRIVE, sidHash, prgDataLaunch, prgSizeLaunch );
+
 						delete psid64;
 
 						*launchKernel = 41; 
@@ -1884,6 +2054,41 @@ void handleC64( int k, u32 *launchKernel, char *FILENAME, char *filenameKernal,
 
 		applySIDSettings();
 	} else
+	if ( menuScreen == MENU_CRTPROFILE )
+	{
+		if ( k == VK_UP )
+			crtProfileEditLine = ( crtProfileEditLine + CRTPROFILE_EDIT_LINES - 1 ) % CRTPROFILE_EDIT_LINES;
+		if ( k == VK_DOWN )
+			crtProfileEditLine = ( crtProfileEditLine + 1 ) % CRTPROFILE_EDIT_LINES;
+		if ( k == VK_LEFT )
+			changeCRTProfileEdit( -1 );
+		if ( k == VK_RIGHT )
+			changeCRTProfileEdit( +1 );
+
+		if ( k == VK_RETURN )
+		{
+			CRTPROFILE *profile = crtProfileInsert( crtProfileEdit.hash );
+			if ( profile != NULL )
+			{
+				profile->handler = crtProfileEdit.handler;
+				profile->pollTimingOfs = crtProfileEdit.pollTimingOfs;
+				profile->dmaCycles = crtProfileEdit.dmaCycles;
+				profile->flags |= CRTPROFILE_FLAG_USER;
+				memcpy( profile->warmBanks, crtProfileEdit.warmBanks, CRTPROFILE_WARM_BANKS );
+				if ( crtProfileSaveDB( logger, DRIVE ) )
+					errorMsg = errorMessages[ 9 ]; else
+					errorMsg = errorMessages[ 3 ];
+			} else
+				errorMsg = errorMessages[ 3 ];
+
+			// the message box only covers part of the profile box
+			printBrowserScreen();
+			menuScreen = MENU_ERROR;
+		}
+
+		if ( k == VK_ESC || k == VK_F7 )
+			menuScreen = previousMenuScreen;
+	} else
 	{
 		if ( k != 0 )
 			menuScreen = previousMenuScreen;
@@ -2320,6 +2525,13 @@ void renderC64()
 		if ( currentVDCMode == 2 )
 			printC64( 5, 22, "VDC output, (shift+)\x9e for VIC", 1, 0 ); 
 	} else
+	if ( menuScreen == MENU_CRTPROFILE )
+	{
+		printBrowserScreen();
+		printCRTProfileScreen();
+		showLogo = 0;
+		c64screenUppercase = 1;
+	} else
 	//if ( menuScreen == MENU_ERROR )
 	{
 		if ( errorMsg != NULL )
@@ -50,6 +50,7 @@ char skinFontFilename[ 1024 ];
 char skinAnimationFilename[ 1024 ];
 union T_SKIN_VALUES	skinValues;
 int screenType, screenRotation, vdcSupport;
+u16 cfgSID8_Addr[ 8 ];		// addresses of the SIDs of the 8-SID kernel, all 0 = default layout
 
 #define N_PROFILES 9
 static u32 currentProfile = 0;
@@ -274,6 +275,30 @@ int readConfig( CLogger *logger, char *DRIVE, char *FILENAME )
 				}
 				#endif
 
+				// e.g. "SID8_ADDRESSES D400 D420 D440 D460 DE00 DE20 DF00 DF20", at most 8 addresses (32 byte aligned)
+				// the FIQ handler only sees accesses to the SID socket ($D400-$D7FF) and to IO1/IO2 ($DE00-$DFFF), others are ignored
+				if ( strcmp( ptr, "SID8_ADDRESSES" ) == 0 )
+				{
+					for ( int i = 0; i < 8; i++ )
+					{
+						char *a = strtok_r( NULL, " \t", &rest );
+						u32 addr = 0;
+						for ( ; a && *a; a++ )
+						{
+							if ( *a >= '0' && *a <= '9' ) addr = addr * 16 + *a - '0'; else
+							if ( *a >= 'A' && *a <= 'F' ) addr = addr * 16 + *a - 'A' + 10; else
+							if ( *a >= 'a' && *a <= 'f' ) addr = addr * 16 + *a - 'a' + 10;
+						}
+						if ( ( addr >= 0xd400 && addr <= 0xd7ff ) || ( addr >= 0xde00 && addr <= 0xdfff ) )
+							cfgSID8_Addr[ i ] = addr & ~31; else
+						{
+							if ( addr )
+								logger->Write( "RaspiMenu", LogWarning, "  SID8_ADDRESSES: $%04X is not within $D400-$D7FF or $DE00-$DFFF, ignored", addr );
+							cfgSID8_Addr[ i ] = 0;
+						}
+					}
+				}
+
 				if ( strcmp( ptr, "SKIN_BACKGROUND_ANIMATION" ) == 0 )
 				{
 					ptr = strtok_r( NULL, " \t", &rest );
@@ -394,8 +419,7 @@ int readFavorites( CLogger *logger, char *DRIVE )
 	sprintf( path, "SD:/FAVORITES" );
 
 	// mount file system
-	FATFS m_FileSystem;
-	if ( f_mount( &m_FileSystem, "SD:", 1 ) != FR_OK )
+	if ( fsMount( "SD:" ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: SD:" );
 
 	DIR dir;
@@ -425,7 +449,7 @@ int readFavorites( CLogger *logger, char *DRIVE )
 
 
 	// unmount file system
-	if ( f_mount( 0, "SD:", 0 ) != FR_OK )
+	if ( fsUnmount( "SD:" ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: SD:" );
 
 
@@ -35,6 +35,7 @@ extern int menuX[ 5 ], menuY[ 5 ], menuItems[ 5 ];
 extern char menuText[ 5 ][ MAX_ITEMS ][ 32 ], menuFile[ 5 ][ MAX_ITEMS ][ 2048 ];
 extern int menuItemPos[ 5 ][ MAX_ITEMS ][ 2 ];
 extern int screenType, screenRotation, vdcSupport;
+extern u16 cfgSID8_Addr[ 8 ];
 
 #ifdef SIDEKICK20
 extern u8 cfgVIC_Emulation,
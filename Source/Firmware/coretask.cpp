@@ -0,0 +1,124 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ coretask.cpp
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - tasks on the secondary cores
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "coretask.h"
+#include "lowlevel_arm64.h"
+#ifdef ARM_ALLOW_MULTI_CORE
+#include <circle/multicore.h>
+#include <circle/memory.h>
+#endif
+
+typedef struct
+{
+	CORETASK_FUNC func;
+	void *param;
+	volatile u32 posted, done;
+	u32 pad[ 26 ];						// one cache line per core
+} CORETASK;
+
+static CORETASK coreTask[ CORETASK_CORES ] AAA;
+
+#ifdef ARM_ALLOW_MULTI_CORE
+class CCoreTasks : public CMultiCoreSupport
+{
+public:
+	CCoreTasks( CMemorySystem *pMemorySystem ) : CMultiCoreSupport( pMemorySystem ) {}
+
+	void Run( unsigned nCore )
+	{
+		if ( nCore == 0 || nCore >= CORETASK_CORES )
+			return;
+
+		CORETASK *t = &coreTask[ nCore ];
+		u32 task = 0;
+		while ( true )
+		{
+			while ( t->posted == task )
+				asm volatile( "wfe" );
+			task = t->posted;
+			asm volatile( "dmb ish" ::: "memory" );
+
+			t->func( t->param );
+
+			asm volatile( "dmb ish" ::: "memory" );
+			t->done = task;
+			asm volatile( "dsb ish\n sev" ::: "memory" );
+		}
+	}
+};
+
+static CCoreTasks *coreTasks = NULL;
+#endif
+
+void coreTaskInit()
+{
+	#ifdef ARM_ALLOW_MULTI_CORE
+	if ( coreTasks == NULL )
+	{
+		coreTasks = new CCoreTasks( CMemorySystem::Get() );
+		coreTasks->Initialize();
+	}
+	#endif
+}
+
+void coreTaskRun( u32 core, CORETASK_FUNC func, void *param )
+{
+	CORETASK *t = &coreTask[ core ];
+
+	#ifdef ARM_ALLOW_MULTI_CORE
+	if ( coreTasks != NULL && core > 0 && core < CORETASK_CORES )
+	{
+		coreTaskWait( core );
+		t->func = func;
+		t->param = param;
+		asm volatile( "dmb ish" ::: "memory" );
+		t->posted = t->posted + 1;
+		asm volatile( "dsb ish\n sev" ::: "memory" );
+		return;
+	}
+	#endif
+
+	// no secondary cores: run the task right away
+	t->posted = t->posted + 1;
+	func( param );
+	t->done = t->posted;
+}
+
+bool coreTaskDone( u32 core )
+{
+	bool done = coreTask[ core ].done == coreTask[ core ].posted;
+	asm volatile( "dmb ish" ::: "memory" );
+	return done;
+}
+
+void coreTaskWait( u32 core )
+{
+	while ( !coreTaskDone( core ) )
+		asm volatile( "wfe" );
+}
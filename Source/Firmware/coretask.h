@@ -0,0 +1,51 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ coretask.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - tasks on the secondary cores
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _coretask_h_
+#define _coretask_h_
+
+#include <circle/types.h>
+#include <circle/sysconfig.h>
+
+//
+// the secondary cores (1-3) are started once and then run functions posted by core 0: coreTaskRun starts a task,
+// coreTaskDone/coreTaskWait check for/wait until it finished. Kernels which use the cores (SID-8 rendering,
+// snapshot compression) share them this way, as CMultiCoreSupport can only be initialized once.
+// Without ARM_ALLOW_MULTI_CORE (only the menu kernel built with "multicore=1" defines it) tasks are executed immediately on core 0.
+//
+#define CORETASK_CORES		4
+
+typedef void (*CORETASK_FUNC)( void *param );
+
+extern void coreTaskInit();
+extern void coreTaskRun( u32 core, CORETASK_FUNC func, void *param );
+extern bool coreTaskDone( u32 core );
+extern void coreTaskWait( u32 core );
+
+#endif
@@ -28,6 +28,7 @@
  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "crt.h"
+#include "helpers.h"
 
 #define CONSOLE_DEBUG
 
@@ -47,7 +48,85 @@ u16 swapBytesU16( u8 *buf )
 	return buf[ 1 ] | ( buf[ 0 ] << 8 );
 }
 
-#define min( a, b ) ((a)<(b)?(a):(b))
+// content hash (64-bit FNV-1a on 32-bit words) of the last CRT read, computed while reading chunks from SD
+u64 crtContentHash = 0;
+
+#define CRT_HASH_INIT		0xcbf29ce484222325ULL
+#define CRT_HASH_PRIME		0x100000001b3ULL
+#define CRT_READ_CHUNK		( 64 * 1024 )
+
+static u64 crtHashUpdate( u64 h, const u8 *data, u32 size )
+{
+	const u32 *d32 = (const u32*)data;
+	for ( u32 i = 0; i < size / 4; i++ )
+	{
+		h ^= d32[ i ];
+		h *= CRT_HASH_PRIME;
+	}
+	for ( u32 i = size & ~3; i < size; i++ )
+	{
+		h ^= data[ i ];
+		h *= CRT_HASH_PRIME;
+	}
+	return h;
+}
+
+// reads 'filesize' bytes in chunks and hashes each chunk while it is still in the caches
+static u32 readAndHashCRT( FS_FILE *file, u8 *dst, u32 filesize, u64 *hash )
+{
+	u64 h = CRT_HASH_INIT;
+	u32 result = FR_OK;
+
+	for ( u32 ofs = 0; ofs < filesize; ofs += CRT_READ_CHUNK )
+	{
+		u32 bytes = min( CRT_READ_CHUNK, filesize - ofs );
+		u32 nBytesRead = fsRead( file, ofs, &dst[ ofs ], bytes );
+		if ( nBytesRead != bytes )
+			result = FR_DISK_ERR;
+		if ( nBytesRead == 0 )
+			break;
+		h = crtHashUpdate( h, &dst[ ofs ], nBytesRead );
+	}
+
+	*hash = h;
+	return result;
+}
+
+// hashes a CRT without touching the buffer which holds the current CRT, the result is the same as for readAndHashCRT
+static u8 crtHashChunk[ 16384 ];
+
+int getCRTContentHash( CLogger *logger, const char *DRIVE, const char *FILENAME, u64 *hash )
+{
+	if ( fsMount( DRIVE ) != FR_OK )
+		return 0;
+
+	FS_FILE *file = fsOpen( FILENAME );
+	if ( file == NULL )
+	{
+		fsUnmount( DRIVE );
+		return 0;
+	}
+
+	u32 filesize = min( fsFileSize( file ), 1032 * 1024 );
+	u32 result = FR_OK;
+	u64 h = CRT_HASH_INIT;
+
+	for ( u32 ofs = 0; ofs < filesize; ofs += sizeof( crtHashChunk ) )
+	{
+		u32 bytes = min( (u32)sizeof( crtHashChunk ), filesize - ofs );
+		u32 nBytesRead = fsRead( file, ofs, crtHashChunk, bytes );
+		if ( nBytesRead != bytes )
+			result = FR_DISK_ERR;
+		if ( nBytesRead == 0 )
+			break;
+		h = crtHashUpdate( h, crtHashChunk, nBytesRead );
+	}
+	*hash = h;
+
+	fsUnmount( DRIVE );
+
+	return result == FR_OK ? 1 : 0;
+}
 
 #define readCRT( dst, bytes ) memcpy( (dst), crt, bytes ); crt += bytes; 
 
@@ -56,52 +135,36 @@ int readCRTHeader( CLogger *logger, CRT_HEADER *crtHeader, const char *DRIVE, co
 {
 	CRT_HEADER header;
 
-	FATFS m_FileSystem;
-
 	// mount file system
-	if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+	if ( fsMount( DRIVE ) != FR_OK )
 	{
 		//logger->Write( "RPiFlash-CRTHeader", LogNotice, "Cannot mount drive: %s", DRIVE );
 		return -10;
 	}
 
-	// get filesize
-	FILINFO info;
-	u32 result = f_stat( FILENAME, &info );
-	u32 filesize = (u32)info.fsize;
-
-	// open file
-	FIL file;
-	result = f_open( &file, FILENAME, FA_READ | FA_OPEN_EXISTING );
-	if ( result != FR_OK )
+	// open file (the handle stays cached for reading the whole file later)
+	FS_FILE *file = fsOpen( FILENAME );
+	if ( file == NULL )
 	{
-		f_mount( 0, DRIVE, 0 );
+		fsUnmount( DRIVE );
 		//logger->Write( "RPiFlash-CRTHeader", LogNotice, "Cannot open file: %s", FILENAME );
 		return -12;
 	}
 
+	u32 filesize = fsFileSize( file );
 	if ( filesize < 64 )
 		return -2;
 
-	// read data in one big chunk
-	u32 nBytesRead;
-	memset( rawCRT, 0, filesize );
-	result = f_read( &file, rawCRT, 64, &nBytesRead );
-
-	if ( result != FR_OK )
+	// read header only
+	memset( rawCRT, 0, 64 );
+	if ( fsRead( file, 0, rawCRT, 64 ) != 64 )
 	{
 		//logger->Write( "RPiFlash-CRTHeader", LogNotice, "Read error" );
 		return -13;
 	}
 
-	if ( f_close( &file ) != FR_OK )
-	{
-		//logger->Write( "RPiFlash-CRTHeader", LogNotice, "Cannot close file" );
-		return -14;
-	}
-
 	// unmount file system
-	if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
+	if ( fsUnmount( DRIVE ) != FR_OK )
 	{
 		//logger->Write( "RPiFlash-CRTHeader", LogNotice, "Cannot unmount drive: %s", DRIVE );
 		return -15;
@@ -145,40 +208,32 @@ void readCRTFile( CLogger *logger, CRT_HEADER *crtHeader, const char *DRIVE, con
 {
 	CRT_HEADER header;
 
-	FATFS m_FileSystem;
-
 	// mount file system
-	if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+	if ( fsMount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiFlash", LogPanic, "Cannot mount drive: %s", DRIVE );
 
-	// get filesize
-	FILINFO info;
-	u32 result = f_stat( FILENAME, &info );
-	u32 filesize = (u32)info.fsize;
-
 	// open file
-	FIL file;
-	result = f_open( &file, FILENAME, FA_READ | FA_OPEN_EXISTING );
-	if ( result != FR_OK )
+	FS_FILE *file = fsOpen( FILENAME );
+	if ( file == NULL )
+	{
 		logger->Write( "RaspiFlash", LogPanic, "Cannot open file: %s", FILENAME );
+		return;
+	}
 
+	u32 filesize = fsFileSize( file );
 	if ( filesize > 1032 * 1024 )
 		filesize = 1032 * 1024;
 
-	// read data in one big chunk
-	u32 nBytesRead;
+	// read data in chunks and compute the content hash on the fly
 //	memset( rawCRT, 0, filesize );
 	memset( rawCRT, 0, 1032 * 1024 );
-	result = f_read( &file, rawCRT, filesize, &nBytesRead );
+	u32 result = readAndHashCRT( file, rawCRT, filesize, &crtContentHash );
 
 	if ( result != FR_OK )
 		logger->Write( "RaspiFlash", LogError, "Read error" );
 
-	if ( f_close( &file ) != FR_OK )
-		logger->Write( "RaspiFlash", LogPanic, "Cannot close file" );
-
 	// unmount file system
-	if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
+	if ( fsUnmount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiFlash", LogPanic, "Cannot unmount drive: %s", DRIVE );
 
 
@@ -546,40 +601,26 @@ int  getVIC20CRTFileStartEndAddr( CLogger *logger, const char *FILENAME, u32 *ad
 {
 	CRT_HEADER header;
 
-	// get filesize
-	FILINFO info;
-	u32 result = f_stat( FILENAME, &info );
-	u32 filesize = (u32)info.fsize;
-
 	// open file
-	FIL file;
-	result = f_open( &file, FILENAME, FA_READ | FA_OPEN_EXISTING );
-	if ( result != FR_OK )
+	FS_FILE *file = fsOpen( FILENAME );
+	if ( file == NULL )
 	{
 		logger->Write( "RaspiFlash", LogPanic, "Cannot open file: %s", FILENAME );
 		return 0;
 	}
 
+	u32 filesize = fsFileSize( file );
 	if ( filesize > 1032 * 1024 )
 		filesize = 1032 * 1024;
 
 	// read data in one big chunk
-	u32 nBytesRead;
 	memset( rawCRT, 0, filesize );
-	result = f_read( &file, rawCRT, filesize, &nBytesRead );
-
-	if ( result != FR_OK )
+	if ( fsRead( file, 0, rawCRT, filesize ) != filesize )
 	{
 		logger->Write( "RaspiFlash", LogError, "Read error" );
 		return 0;
 	}
 
-	if ( f_close( &file ) != FR_OK )
-	{
-		logger->Write( "RaspiFlash", LogPanic, "Cannot close file" );
-		return 0;
-	}
-
 	// now "parse" the file which we already have in memory
 	u8 *crt = rawCRT;
 	u8 *crtEnd = crt + filesize;
@@ -693,39 +734,32 @@ void writeChanges2CRTFile( CLogger *logger, const char *DRIVE, const char *FILEN
 	u32 nBanks;
 
 	CRT_HEADER header;
-	FATFS m_FileSystem;
 
 	logger->Write( "RaspiFlash", LogNotice, "saving modified CRT file", DRIVE );
 
 	// mount file system
-	if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+	if ( fsMount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiFlash", LogPanic, "Cannot mount drive: %s", DRIVE );
 
-	// get filesize
-	FILINFO info;
-	u32 result = f_stat( FILENAME, &info );
-	u32 filesize = (u32)info.fsize;
-
 	// open file
-	FIL file;
-	result = f_open( &file, FILENAME, FA_READ | FA_OPEN_EXISTING );
-	if ( result != FR_OK )
+	FS_FILE *rdFile = fsOpen( FILENAME );
+	if ( rdFile == NULL )
+	{
 		logger->Write( "RaspiFlash", LogPanic, "Cannot open file: %s", FILENAME );
+		return;
+	}
 
+	u32 filesize = fsFileSize( rdFile );
 	if ( filesize > 1025 * 1024 )
 		filesize = 1025 * 1024;
 
 	// read data in one big chunk
-	u32 nBytesRead;
 	memset( rawCRT, 0, filesize );
-	result = f_read( &file, rawCRT, filesize, &nBytesRead );
+	u32 nBytesRead = fsRead( rdFile, 0, rawCRT, filesize );
 
-	if ( result != FR_OK )
+	if ( nBytesRead != filesize )
 		logger->Write( "RaspiFlash", LogError, "Read error" );
 
-	if ( f_close( &file ) != FR_OK )
-		logger->Write( "RaspiFlash", LogPanic, "Cannot close file" );
-
 	// now "parse" the file which we already have in memory
 	u8 *crt = rawCRT;
 	u8 *crtEnd = crt + filesize;
@@ -754,7 +788,7 @@ void writeChanges2CRTFile( CLogger *logger, const char *DRIVE, const char *FILEN
 	{
 		//logger->Write( "RaspiFlash", LogNotice, "no EF CRT" );
 		// unmount file system
-		if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
+		if ( fsUnmount( DRIVE ) != FR_OK )
 			logger->Write( "RaspiFlash", LogPanic, "Cannot unmount drive: %s", DRIVE );
 		return;
 	}
@@ -847,8 +881,14 @@ void writeChanges2CRTFile( CLogger *logger, const char *DRIVE, const char *FILEN
 	}
 
 
-	// write file
-	result = f_open( &file, FILENAME, FA_CREATE_ALWAYS | FA_WRITE );
+	// the content hash changes with the modified flash (the cartridge profile is moved to the new one by the caller)
+	crtContentHash = crtHashUpdate( CRT_HASH_INIT, rawCRT, nBytesRead );
+
+	// write file (the cached handle for reading would be stale afterwards)
+	fsInvalidate( FILENAME );
+
+	FIL file;
+	u32 result = f_open( &file, FILENAME, FA_CREATE_ALWAYS | FA_WRITE );
 	if ( result != FR_OK )
 		logger->Write( "RaspiFlash", LogPanic, "Cannot open file: %s", FILENAME );
 
@@ -863,7 +903,7 @@ void writeChanges2CRTFile( CLogger *logger, const char *DRIVE, const char *FILEN
 		logger->Write( "RaspiFlash", LogPanic, "Cannot close file" );
 
 	// unmount file system
-	if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
+	if ( fsUnmount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiFlash", LogPanic, "Cannot unmount drive: %s", DRIVE );
 }
 
@@ -89,10 +89,13 @@ typedef struct  {
 int  readCRTHeader( CLogger *logger, CRT_HEADER *crtHeader, const char *DRIVE, const char *FILENAME );
 void readCRTFile( CLogger *logger, CRT_HEADER *crtHeader, const char *DRIVE, const char *FILENAME, u8 *flash, volatile u8 *bankswitchType, volatile u32 *ROM_LH, volatile u32 *nBanks, bool getRAW = false );
 void writeChanges2CRTFile( CLogger *logger, const char *DRIVE, const char *FILENAME, u8 *flash, bool isRAW );
+int  getCRTContentHash( CLogger *logger, const char *DRIVE, const char *FILENAME, u64 *hash );
 int  checkCRTFile( CLogger *logger, const char *DRIVE, const char *FILENAME, u32 *error, u32 *isFreezer = 0 );
 int checkCRTFileVIC20( CLogger *logger, const char *DRIVE, const char *FILENAME, u32 *error );
 extern int  getVIC20CRTFileStartEndAddr( CLogger *logger, const char *FILENAME, u32 *addr );
 
+extern u64 crtContentHash;
+
 extern u8 gmod2EEPROM[ 2048 ];
 extern u8 gmod2EEPROM_data;
 
@@ -0,0 +1,241 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ crtprofile.cpp
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - per-CRT profile database (handler mode, timing, prefetch and DMA settings)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "crtprofile.h"
+#include "helpers.h"
+
+static CRTPROFILEDB crtProfileDB;
+static u8 crtProfileDBLoaded = 0;
+
+static void crtProfileResetDB()
+{
+	memset( &crtProfileDB, 0, sizeof( CRTPROFILEDB ) );
+	crtProfileDB.magic = CRTPROFILE_MAGIC;
+	crtProfileDB.version = CRTPROFILE_VERSION;
+}
+
+// the database is read only once, later calls are no-ops
+void crtProfileLoadDB( CLogger *logger, const char *DRIVE )
+{
+	if ( crtProfileDBLoaded )
+		return;
+
+	u32 size = 0;
+	if ( !readFile( logger, DRIVE, CRTPROFILE_DB_FILENAME, (u8*)&crtProfileDB, &size, sizeof( CRTPROFILEDB ) ) ||
+		 size != sizeof( CRTPROFILEDB ) || crtProfileDB.magic != CRTPROFILE_MAGIC || crtProfileDB.version != CRTPROFILE_VERSION )
+		crtProfileResetDB();
+
+	crtProfileDBLoaded = 1;
+}
+
+int crtProfileSaveDB( CLogger *logger, const char *DRIVE )
+{
+	return writeFile( logger, DRIVE, CRTPROFILE_DB_FILENAME, (u8*)&crtProfileDB, sizeof( CRTPROFILEDB ) );
+}
+
+static inline u32 crtProfileSlot( u64 hash )
+{
+	return (u32)( hash ^ ( hash >> 32 ) ) & ( CRTPROFILE_ENTRIES - 1 );
+}
+
+CRTPROFILE *crtProfileLookup( u64 hash )
+{
+	if ( hash == 0 )
+		return NULL;
+
+	u32 slot = crtProfileSlot( hash );
+	for ( u32 i = 0; i < CRTPROFILE_ENTRIES; i++ )
+	{
+		CRTPROFILE *p = &crtProfileDB.entry[ ( slot + i ) & ( CRTPROFILE_ENTRIES - 1 ) ];
+		if ( p->hash == hash )
+		{
+			p->lastUse = ++ crtProfileDB.useCounter;
+			return p;
+		}
+		if ( p->hash == 0 )
+			return NULL;
+	}
+	return NULL;
+}
+
+// backward shift deletion: entries following in the probe sequence move up if their home slot allows it
+static void crtProfileRemove( CRTPROFILE *p )
+{
+	u32 hole = (u32)( p - crtProfileDB.entry );
+	u32 i = hole;
+
+	while ( true )
+	{
+		i = ( i + 1 ) & ( CRTPROFILE_ENTRIES - 1 );
+		CRTPROFILE *e = &crtProfileDB.entry[ i ];
+		if ( e->hash == 0 )
+			break;
+
+		u32 home = crtProfileSlot( e->hash );
+		if ( ( ( i - home ) & ( CRTPROFILE_ENTRIES - 1 ) ) >= ( ( i - hole ) & ( CRTPROFILE_ENTRIES - 1 ) ) )
+		{
+			crtProfileDB.entry[ hole ] = *e;
+			hole = i;
+		}
+	}
+
+	memset( &crtProfileDB.entry[ hole ], 0, sizeof( CRTPROFILE ) );
+	crtProfileDB.nEntries --;
+}
+
+// evicts the least recently used profile, profiles edited in the menu are kept as long as possible
+static void crtProfileEvict()
+{
+	CRTPROFILE *victim = NULL;
+
+	for ( u32 i = 0; i < CRTPROFILE_ENTRIES; i++ )
+	{
+		CRTPROFILE *p = &crtProfileDB.entry[ i ];
+		if ( p->hash == 0 )
+			continue;
+
+		if ( victim == NULL ||
+			 ( p->flags & CRTPROFILE_FLAG_USER ) < ( victim->flags & CRTPROFILE_FLAG_USER ) ||
+			 ( ( p->flags & CRTPROFILE_FLAG_USER ) == ( victim->flags & CRTPROFILE_FLAG_USER ) && p->lastUse < victim->lastUse ) )
+			victim = p;
+	}
+
+	if ( victim )
+		crtProfileRemove( victim );
+}
+
+void crtProfileSetDefaults( CRTPROFILE *profile )
+{
+	profile->handler = CRTPROFILE_HANDLER_AUTO;
+	profile->pollTimingOfs = 0;
+	profile->dmaCycles = 0;
+	profile->flags = 0;
+	memset( profile->warmBanks, 0xff, CRTPROFILE_WARM_BANKS );
+}
+
+CRTPROFILE *crtProfileInsert( u64 hash )
+{
+	if ( hash == 0 )
+		return NULL;
+
+	CRTPROFILE *p = crtProfileLookup( hash );
+	if ( p )
+		return p;
+
+	// keep the table at most 3/4 full to keep the probe sequences short
+	while ( crtProfileDB.nEntries >= CRTPROFILE_MAX_USED )
+		crtProfileEvict();
+
+	u32 slot = crtProfileSlot( hash );
+	while ( crtProfileDB.entry[ slot ].hash != 0 )
+		slot = ( slot + 1 ) & ( CRTPROFILE_ENTRIES - 1 );
+
+	p = &crtProfileDB.entry[ slot ];
+	crtProfileSetDefaults( p );
+	p->hash = hash;
+	p->lastUse = ++ crtProfileDB.useCounter;
+	crtProfileDB.nEntries ++;
+
+	return p;
+}
+
+static CRTPREDICTOR *crtProfileFindPredictor( u64 hash )
+{
+	for ( u32 i = 0; i < CRTPREDICTOR_ENTRIES; i++ )
+		if ( crtProfileDB.predictor[ i ].hash == hash )
+			return &crtProfileDB.predictor[ i ];
+	return NULL;
+}
+
+int crtProfileLoadPredictor( u64 hash, CRTPREDICTOR *pred )
+{
+	CRTPREDICTOR *p;
+	if ( hash == 0 || ( p = crtProfileFindPredictor( hash ) ) == NULL )
+		return 0;
+
+	p->lastUse = ++ crtProfileDB.useCounter;
+	memcpy( pred, p, sizeof( CRTPREDICTOR ) );
+	return 1;
+}
+
+void crtProfileStorePredictor( u64 hash, const CRTPREDICTOR *pred )
+{
+	if ( hash == 0 )
+		return;
+
+	// same title, else an empty or the least recently used table
+	CRTPREDICTOR *p = crtProfileFindPredictor( hash );
+	if ( p == NULL )
+	{
+		p = &crtProfileDB.predictor[ 0 ];
+		for ( u32 i = 1; i < CRTPREDICTOR_ENTRIES && p->hash != 0; i++ )
+			if ( crtProfileDB.predictor[ i ].hash == 0 || crtProfileDB.predictor[ i ].lastUse < p->lastUse )
+				p = &crtProfileDB.predictor[ i ];
+	}
+
+	memcpy( p, pred, sizeof( CRTPREDICTOR ) );
+	p->hash = hash;
+	p->lastUse = ++ crtProfileDB.useCounter;
+}
+
+void crtProfileRekey( u64 oldHash, u64 newHash )
+{
+	if ( oldHash == newHash || newHash == 0 )
+		return;
+
+	CRTPREDICTOR *pred;
+	if ( ( pred = crtProfileFindPredictor( newHash ) ) != NULL )
+		pred->hash = 0;
+	if ( oldHash != 0 && ( pred = crtProfileFindPredictor( oldHash ) ) != NULL )
+		pred->hash = newHash;
+
+	CRTPROFILE *p = crtProfileLookup( oldHash );
+	if ( p == NULL )
+		return;
+
+	CRTPROFILE profile = *p;
+	crtProfileRemove( p );
+
+	if ( ( p = crtProfileInsert( newHash ) ) != NULL )
+	{
+		profile.hash = newHash;
+		profile.lastUse = p->lastUse;
+		*p = profile;
+	}
+}
+
+const char *crtProfileHandlerName( u8 handler )
+{
+	switch ( handler )
+	{
+	case CRTPROFILE_HANDLER_FIQ:		return "FIQ";
+	case CRTPROFILE_HANDLER_POLLING:	return "polling";
+	default:							return "auto";
+	}
+}
@@ -0,0 +1,112 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ crtprofile.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - per-CRT profile database (handler mode, timing, prefetch and DMA settings)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _crtprofile_h
+#define _crtprofile_h
+
+#include <circle/types.h>
+#include <circle/util.h>
+#include <circle/logger.h>
+#include <fatfs/ff.h>
+
+// the database is a small open-addressing hash table (CRT content hash -> profile) stored on SD
+#define CRTPROFILE_DB_FILENAME	"SD:C64/crtprofiles.db"
+#define CRTPROFILE_ENTRIES		512		// must be a power of 2
+#define CRTPROFILE_MAX_USED		( CRTPROFILE_ENTRIES * 3 / 4 )	// beyond that the least recently used profile is evicted
+#define CRTPROFILE_MAGIC		0x50524b53	// "SKRP"
+#define CRTPROFILE_VERSION		3
+
+// which bus handler is used for EasyFlash cartridges
+#define CRTPROFILE_HANDLER_AUTO		0	// FIQ, or polling if the bank predictor learned that the title streams from flash
+#define CRTPROFILE_HANDLER_FIQ		1
+#define CRTPROFILE_HANDLER_POLLING	2
+#define CRTPROFILE_HANDLER_MODES	3
+
+#define CRTPROFILE_WARM_BANKS	4
+
+// ranges of the settings which can be edited in the menu
+#define CRTPROFILE_TIMING_MIN	-20
+#define CRTPROFILE_TIMING_MAX	20
+#define CRTPROFILE_DMA_MAX		40
+#define CRTPROFILE_BANKS		64
+
+#define CRTPROFILE_FLAG_USER	1		// edited in the menu, evicted only if there are no other profiles left
+
+typedef struct
+{
+	u64 hash;									// 0 = empty slot
+	u8  handler;								// CRTPROFILE_HANDLER_*
+	s8  pollTimingOfs;							// added to the polling handler's read/write timings
+	u8  dmaCycles;								// cycles the C64 is stalled while warming caches (0 = default)
+	u8  flags;									// CRTPROFILE_FLAG_*
+	u8  warmBanks[ CRTPROFILE_WARM_BANKS ];		// banks preloaded at start (0xff = unused)
+	u32 lastUse;								// value of the use counter when the profile was last used
+} __attribute__((packed)) CRTPROFILE;
+
+// bank transition tables of the EasyFlash bank predictor, kept for the most recently used titles only
+#define CRTPREDICTOR_ENTRIES	32
+#define CRTPREDICTOR_BANKS		64
+#define CRTPREDICTOR_SUCC		4		// successors tracked per bank (sorted by frequency)
+
+typedef struct
+{
+	u64 hash;									// 0 = empty slot
+	u32 lastUse;
+	u32 nTransitions;
+	u8  next[ CRTPREDICTOR_BANKS ][ CRTPREDICTOR_SUCC ];	// 0xff = unused
+	u8  count[ CRTPREDICTOR_BANKS ][ CRTPREDICTOR_SUCC ];
+} __attribute__((packed)) CRTPREDICTOR;
+
+typedef struct
+{
+	u32 magic, version;
+	u32 nEntries, useCounter;
+	CRTPROFILE entry[ CRTPROFILE_ENTRIES ];
+	CRTPREDICTOR predictor[ CRTPREDICTOR_ENTRIES ];
+} __attribute__((packed)) CRTPROFILEDB;
+
+extern void crtProfileLoadDB( CLogger *logger, const char *DRIVE );
+extern int  crtProfileSaveDB( CLogger *logger, const char *DRIVE );
+
+// both are O(1) (linear probing in a sparsely filled table), lookup returns NULL if unknown,
+// insert evicts the least recently used profile if the table is full
+extern CRTPROFILE *crtProfileLookup( u64 hash );
+extern CRTPROFILE *crtProfileInsert( u64 hash );
+
+// load returns 0 if no transitions are stored for the CRT, store replaces the least recently used table
+extern int  crtProfileLoadPredictor( u64 hash, CRTPREDICTOR *pred );
+extern void crtProfileStorePredictor( u64 hash, const CRTPREDICTOR *pred );
+
+// the content hash of a CRT changes when EAPI writes to flash are saved, its profile and predictor move along
+extern void crtProfileRekey( u64 oldHash, u64 newHash );
+
+extern void crtProfileSetDefaults( CRTPROFILE *profile );
+extern const char *crtProfileHandlerName( u8 handler );
+
+#endif
@@ -251,35 +251,24 @@ u8 d64buf[ 1024 * 1024 ];
 
 int readD64File( CLogger *logger, const char *DRIVE, const char *FILENAME, u8 *data, u32 *size )
 {
-	// get filesize
-	FILINFO info;
-	u32 res = f_stat( FILENAME, &info );
-	u32 filesize = (u32)info.fsize;
-
-	if ( filesize > 822400 )
-		return 0;
-
-	// open file
-	FIL file;
-	res = f_open( &file, FILENAME, FA_READ | FA_OPEN_EXISTING );
-	if ( res != FR_OK )
+	// open file (cached, browsing a .D64 reads it again and again)
+	FS_FILE *file = fsOpen( FILENAME );
+	if ( file == NULL )
 	{
 		//logger->Write( "RaspiMenu", LogNotice, "Cannot open file: %s", FILENAME );
 		return 0;
 	}
 
-	// read data in one big chunk
-	u32 nBytesRead;
-	res = f_read( &file, data, filesize, &nBytesRead );
+	u32 filesize = fsFileSize( file );
+	if ( filesize > 822400 )
+		return 0;
 
-	*size = nBytesRead;
+	// read data in one big chunk
+	*size = fsRead( file, 0, data, filesize );
 
-	if ( res != FR_OK )
+	if ( *size != filesize )
 		logger->Write( "RaspiMenu", LogError, "Read error" );
 
-	if ( f_close( &file ) != FR_OK )
-		logger->Write( "RaspiMenu", LogPanic, "Cannot close file" );
-
 	return 1;
 }
 
@@ -312,36 +301,24 @@ void quicksort( DIRENTRY *begin, DIRENTRY *end )
 // returns start and end address of .PRG
 int readStartEndAddressPRG( CLogger *logger, const char *FILENAME, u32 *addr )
 {
-	// get filesize
-	FILINFO info;
-	u32 res = f_stat( FILENAME, &info );
-	u32 filesize = (u32)info.fsize;
-
-	if ( filesize > 65535 )
-		return 0;
-
-	// open file
-	FIL file;
-	res = f_open( &file, FILENAME, FA_READ | FA_OPEN_EXISTING );
-	if ( res != FR_OK )
+	// open file (cached, the read-ahead also serves launching the .PRG afterwards)
+	FS_FILE *file = fsOpen( FILENAME );
+	if ( file == NULL )
 	{
 		//logger->Write( "RaspiMenu", LogNotice, "Cannot open file: %s", FILENAME );
 		return 0;
 	}
 
-	// read data in one big chunk
-	u32 nBytesRead;
-	u8 data[ 2 ];
-	res = f_read( &file, data, 2, &nBytesRead );
-
-	*addr = data[ 0 ] + data[ 1 ] * 256;
-	*addr |= ( (*addr + filesize-3) << 16 );
+	u32 filesize = fsFileSize( file );
+	if ( filesize > 65535 )
+		return 0;
 
-	if ( res != FR_OK )
+	u8 data[ 2 ] = { 0, 0 };
+	if ( fsRead( file, 0, data, 2 ) != 2 )
 		logger->Write( "RaspiMenu", LogError, "Read error" );
 
-	if ( f_close( &file ) != FR_OK )
-		logger->Write( "RaspiMenu", LogPanic, "Cannot close file" );
+	*addr = data[ 0 ] + data[ 1 ] * 256;
+	*addr |= ( (*addr + filesize-3) << 16 );
 
 	return 1;
 }
@@ -631,14 +608,13 @@ void insertDirectoryContents( int node, char *basePath, int listAll )
 	sprintf( path, "%s%s", basePath, dir[ node ].name );
 
 	// mount file system
-	FATFS m_FileSystem;
-	if ( f_mount( &m_FileSystem, "SD:", 1 ) != FR_OK )
+	if ( fsMount( "SD:" ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: SD:" );
 
 	readDirectory( 1, path, dir, &tempEntries, node, dir[ node ].level + 1, listAll, &nAdded );	
 
 	// unmount file system
-	if ( f_mount( 0, "SD:", 0 ) != FR_OK )
+	if ( fsUnmount( "SD:" ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: SD:" );
 
 	nDirEntries += tempEntries - dir[ node ].next;
@@ -647,10 +623,8 @@ void insertDirectoryContents( int node, char *basePath, int listAll )
 
 void scanDirectories( char *DRIVE )
 {
-	FATFS m_FileSystem;
-
 	// mount file system
-	if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+	if ( fsMount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: %s", DRIVE );
 
 	dir = (DIRENTRY*)getPoolMemory( sizeof( DIRENTRY ) * MAX_DIR_ENTRIES );
@@ -688,16 +662,14 @@ void scanDirectories( char *DRIVE )
 	//insertDirectoryContents( 0, "SD:" );
 
 	// unmount file system
-	if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
+	if ( fsUnmount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
 }
 
 void scanDirectoriesVIC20( char *DRIVE )
 {
-	FATFS m_FileSystem;
-
 	// mount file system
-	if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+	if ( fsMount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: %s", DRIVE );
 
 	dir = (DIRENTRY*)getPoolMemory( sizeof( DIRENTRY ) * MAX_DIR_ENTRIES );
@@ -730,16 +702,14 @@ void scanDirectoriesVIC20( char *DRIVE )
 	//insertDirectoryContents( 0, "SD:" );
 
 	// unmount file system
-	if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
+	if ( fsUnmount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
 }
 
 void scanDirectories264( char *DRIVE )
 {
-	FATFS m_FileSystem;
-
 	// mount file system
-	if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+	if ( fsMount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: %s", DRIVE );
 
 	dir = (DIRENTRY*)getPoolMemory( sizeof( DIRENTRY ) * MAX_DIR_ENTRIES );
@@ -752,7 +722,7 @@ void scanDirectories264( char *DRIVE )
 	APPEND_SUBTREE_UNSCANNED( "PRG264", "SD:PRG264", 0 )
 
 	// unmount file system
-	if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
+	if ( fsUnmount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
 }
 
@@ -578,15 +578,14 @@ static bool loadNewDirectory( char *vic20Filename, u8 *data, u32 *size )
 
 static bool readFileFromD64( CLogger *logger, const char *DRIVE, const char *FILENAME, u32 fileIndex, u8 *data, u32 *size )
 {
-	FATFS m_FileSystem;
-	if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+	if ( fsMount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: %s", DRIVE );
 
 	u32 imgsize = 0;
 	if ( !readD64File( logger, "", FILENAME, d64buf, &imgsize ) )
 		return false;
 
-	if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
+	if ( fsUnmount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
 
 	if ( d64ParseExtract( d64buf, imgsize, D64_GET_FILE + fileIndex, data, (s32*)size ) != 0 )
@@ -1488,6 +1488,10 @@ static void OPLResetChip(FM_OPL *OPL)
     OPL->mode = 0;      /* normal mode */
     OPL_STATUS_RESET(OPL, 0x7f);
 
+    /* LFO outputs are shared by all chips, do not keep those of a previous chip */
+    LFO_AM = 0;
+    LFO_PM = 0;
+
     /* reset with register write */
     OPLWriteReg(OPL, 0x01, 0); /* wavesel disable */
     OPLWriteReg(OPL, 0x02, 0); /* Timer1 */
@@ -1757,6 +1761,81 @@ void ym3812_update_one(FM_OPL *chip, OPLSAMPLE *buffer, int length)
     }
 }
 
+/*
+** Block rendering for the YM3812, bit-exact to ym3812_update_one.
+**
+** Register writes only happen between calls, thus a channel whose operators are both
+** switched off (and have no feedback left) stays silent for the entire block and is
+** skipped. The envelope/phase generators and the noise generator are advanced for all
+** channels as before, such that the chip state is identical afterwards.
+*/
+void ym3812_render_block(FM_OPL *chip, OPLSAMPLE *buffer, int length)
+{
+    FM_OPL *OPL = (FM_OPL *)chip;
+    UINT8 rhythm = OPL->rhythm & 0x20;
+    OPL_CH *active[9];
+    int nActive = 0;
+    int i, c;
+
+    if ((void *)OPL != cur_chip) {
+        cur_chip = (void *)OPL;
+        /* rhythm slots */
+        SLOT7_1 = &OPL->P_CH[7].SLOT[SLOT1];
+        SLOT7_2 = &OPL->P_CH[7].SLOT[SLOT2];
+        SLOT8_1 = &OPL->P_CH[8].SLOT[SLOT1];
+        SLOT8_2 = &OPL->P_CH[8].SLOT[SLOT2];
+    }
+
+    for (c = 0; c < (rhythm ? 6 : 9); c++) {
+        OPL_CH *CH = &OPL->P_CH[c];
+        if (CH->SLOT[SLOT1].state == EG_OFF && CH->SLOT[SLOT2].state == EG_OFF &&
+            CH->SLOT[SLOT1].op1_out[0] == 0 && CH->SLOT[SLOT1].op1_out[1] == 0) {
+            continue;
+        }
+        active[nActive++] = CH;
+    }
+
+    if (!nActive && !rhythm) {
+        /* chip is idle: output is silence, only the generators advance */
+        for (i = 0; i < length; i++) {
+            advance_lfo(OPL);
+            buffer[i] = 0;
+            advance(OPL);
+        }
+        return;
+    }
+
+    for (i = 0; i < length; i++) {
+        int lt;
+
+        output[0] = 0;
+
+        advance_lfo(OPL);
+
+        /* FM part */
+        for (c = 0; c < nActive; c++) {
+            OPL_CALC_CH(active[c]);
+        }
+
+        /* Rhythm part */
+        if (rhythm) {
+            OPL_CALC_RH(&OPL->P_CH[0], (OPL->noise_rng >> 0) & 1 );
+        }
+
+        lt = output[0];
+
+        lt >>= FINAL_SH;
+
+        /* limit check */
+        lt = limit(lt, MAXOUT, MINOUT);
+
+        /* store to sound buffer */
+        buffer[i] = lt;
+
+        advance(OPL);
+    }
+}
+
 FM_OPL *ym3526_init(UINT32 clock, UINT32 rate)
 {
     /* emulator create */
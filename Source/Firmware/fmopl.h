@@ -134,6 +134,12 @@ extern int ym3812_timer_over(FM_OPL *chip, int c);
  */
 extern void ym3812_update_one(FM_OPL *chip, OPLSAMPLE *buffer, int length);
 
+/*
+ * Same as ym3812_update_one (bit-exact), optimized for rendering blocks of samples
+ * between register writes: silent channels are skipped for the whole block
+ */
+extern void ym3812_render_block(FM_OPL *chip, OPLSAMPLE *buffer, int length);
+
 /*
  * Initialize YM3526 emulator.
  *
@@ -0,0 +1,137 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ hdmidma.cpp
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - HDMI sound via DMA with block-wise IEC958 framing
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <circle/util.h>
+#include "hdmidma.h"
+#include "helpers.h"
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+s32 hdmiDMARing[ HDMI_DMA_RING * 2 ] AAA;
+volatile u32 hdmiDMARead = 0, hdmiDMAWrite = 0;
+volatile u32 hdmiDMAChunkTime = 0;
+u32 hdmiDMARate = 48000;
+
+// samples of one chunk, copied out of the ring buffer
+static s32 hdmiDMAStage[ HDMI_DMA_CHUNK ] AAA;
+
+CHDMISoundDMADevice::CHDMISoundDMADevice( CInterruptSystem *pInterrupt, unsigned nSampleRate )
+	: CHDMISoundBaseDevice( pInterrupt, nSampleRate, HDMI_DMA_CHUNK )
+{
+	// framing a zero sample yields everything which does not depend on the sample value
+	for ( u32 i = 0; i < IEC958_SUBFRAMES_PER_BLOCK; i++ )
+		status[ i ] = ConvertIEC958Sample( 0, i / SOUND_HW_CHANNELS );
+	primed = 0;
+}
+
+//
+// IEC958 subframe: preamble (bits 0-3), 24-bit sample (bits 4-27), validity, user data, channel status (bits 28-30)
+// and even parity over bits 4-30 (bit 31). The status table already contains the parity of the channel status bit,
+// thus only the parity of the sample bits needs to be added.
+//
+static void frameIEC958( u32 *dst, const s32 *src, const u32 *status, u32 nSubframes )
+{
+#ifdef __ARM_NEON
+	const uint32x4_t mask = vdupq_n_u32( 0xffffff );
+	for ( u32 i = 0; i < nSubframes; i += 4 )
+	{
+		uint32x4_t d = vshlq_n_u32( vandq_u32( vreinterpretq_u32_s32( vld1q_s32( &src[ i ] ) ), mask ), 4 );
+		uint32x4_t p = vpaddlq_u16( vpaddlq_u8( vcntq_u8( vreinterpretq_u8_u32( d ) ) ) );
+		d = vorrq_u32( d, vld1q_u32( &status[ i ] ) );
+		d = veorq_u32( d, vshlq_n_u32( p, 31 ) );
+		vst1q_u32( &dst[ i ], d );
+	}
+#else
+	for ( u32 i = 0; i < nSubframes; i++ )
+	{
+		u32 d = ( (u32)src[ i ] & 0xffffff ) << 4;
+		dst[ i ] = ( d | status[ i ] ) ^ ( (u32)__builtin_parity( d ) << 31 );
+	}
+#endif
+}
+
+// called from the DMA interrupt when one of the two buffers has been played
+unsigned CHDMISoundDMADevice::GetChunk( u32 *pBuffer, unsigned nChunkSize )
+{
+	u32 nSamples = nChunkSize / SOUND_HW_CHANNELS;
+	u32 fill = hdmiDMAFill();
+	hdmiDMAChunkTime = CTimer::GetClockTicks();
+
+	// start (and restart after an underrun) only when a complete chunk is available, output silence meanwhile
+	if ( fill < nSamples )
+		primed = 0;
+	if ( !primed && fill >= nSamples )
+		primed = 1;
+
+	if ( primed )
+	{
+		u32 r = hdmiDMARead;
+		u32 n1 = min( nSamples, HDMI_DMA_RING - r );
+		memcpy( hdmiDMAStage, &hdmiDMARing[ r * 2 ], n1 * 2 * sizeof( s32 ) );
+		memcpy( &hdmiDMAStage[ n1 * 2 ], hdmiDMARing, ( nSamples - n1 ) * 2 * sizeof( s32 ) );
+		hdmiDMARead = ( r + nSamples ) & ( HDMI_DMA_RING - 1 );
+	} else
+		memset( hdmiDMAStage, 0, nChunkSize * sizeof( s32 ) );
+
+	for ( u32 i = 0; i < nChunkSize; i += IEC958_SUBFRAMES_PER_BLOCK )
+		frameIEC958( &pBuffer[ i ], &hdmiDMAStage[ i ], status, IEC958_SUBFRAMES_PER_BLOCK );
+
+	return nChunkSize;
+}
+
+CHDMISoundBaseDevice *hdmiDMAStart( CInterruptSystem *pInterrupt, unsigned nSampleRate )
+{
+	hdmiDMARead = hdmiDMAWrite = 0;
+	hdmiDMARate = nSampleRate;
+
+	CHDMISoundDMADevice *device = new CHDMISoundDMADevice( pInterrupt, nSampleRate );
+	if ( device == NULL )
+		return NULL;
+
+	if ( !device->Start() )
+	{
+		delete device;
+		return NULL;
+	}
+	return device;
+}
+
+void hdmiDMAStop( CHDMISoundBaseDevice *device )
+{
+	if ( device == NULL )
+		return;
+
+	device->Cancel();
+	while ( device->IsActive() ) {}
+
+	delete device;
+	hdmiDMARead = hdmiDMAWrite = 0;
+}
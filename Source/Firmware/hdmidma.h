@@ -0,0 +1,104 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ hdmidma.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - HDMI sound via DMA with block-wise IEC958 framing
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _hdmidma_h_
+#define _hdmidma_h_
+
+#include <circle/types.h>
+#include <circle/interrupt.h>
+#include <circle/timer.h>
+#include <circle/hdmisoundbasedevice.h>
+#include "lowlevel_arm64.h"
+
+//
+// HDMI sound output without per-sample register accesses: kernels put samples into a ring buffer (plain memory writes,
+// which is also fine within the FIQ handler), the DMA interrupt takes one chunk at a time, applies the IEC958 framing
+// to the whole chunk and hands it to the DMA control block chain of CHDMISoundBaseDevice (double buffered)
+//
+#define HDMI_DMA_CHUNK		384				// subframes per DMA transfer (multiple of 384), 4ms at 48kHz
+#define HDMI_DMA_RING		4096			// stereo samples, power of 2
+
+// level (see hdmiDMALevel) the producers aim at: the ring must hold a complete chunk whenever the DMA asks for one,
+// i.e. its fill oscillates between the margin and the margin plus a chunk
+#define HDMI_DMA_MARGIN		96
+#define HDMI_DMA_TARGET		( HDMI_DMA_CHUNK / 2 + HDMI_DMA_MARGIN )
+
+class CHDMISoundDMADevice : public CHDMISoundBaseDevice
+{
+public:
+	CHDMISoundDMADevice( CInterruptSystem *pInterrupt, unsigned nSampleRate );
+
+protected:
+	unsigned GetChunk( u32 *pBuffer, unsigned nChunkSize );
+
+private:
+	// IEC958 channel status, parity of the status bit, and preamble for each subframe position of a block
+	u32 status[ IEC958_SUBFRAMES_PER_BLOCK ] AAA;
+	u32 primed;
+};
+
+extern s32 hdmiDMARing[ HDMI_DMA_RING * 2 ];
+extern volatile u32 hdmiDMARead, hdmiDMAWrite;
+extern volatile u32 hdmiDMAChunkTime;		// clock ticks when the last chunk has been taken
+extern u32 hdmiDMARate;
+
+// creates and starts the DMA driven device, returns NULL on failure
+extern CHDMISoundBaseDevice *hdmiDMAStart( CInterruptSystem *pInterrupt, unsigned nSampleRate = 48000 );
+
+// cancels and deletes a device created by hdmiDMAStart (IRQs must be enabled, the cancel takes effect in the DMA interrupt)
+extern void hdmiDMAStop( CHDMISoundBaseDevice *device );
+
+// number of stereo samples waiting for output
+static __attribute__( ( always_inline ) ) inline u32 hdmiDMAFill()
+{
+	return ( hdmiDMAWrite - hdmiDMARead ) & ( HDMI_DMA_RING - 1 );
+}
+
+// number of stereo samples waiting, including the part of the current chunk which has not been played yet:
+// unlike hdmiDMAFill() this does not jump when a chunk is taken, thus it is the one to control the production rate with
+static __attribute__( ( always_inline ) ) inline u32 hdmiDMALevel()
+{
+	u32 played = (u32)( ( (u64)( CTimer::GetClockTicks() - hdmiDMAChunkTime ) * hdmiDMARate ) / 1000000 );
+	if ( played > HDMI_DMA_CHUNK / 2 )
+		played = HDMI_DMA_CHUNK / 2;
+	return hdmiDMAFill() + HDMI_DMA_CHUNK / 2 - played;
+}
+
+// 24-bit signed samples, dropped if the ring buffer is full
+static __attribute__( ( always_inline ) ) inline void hdmiDMAPutSample( s32 left, s32 right )
+{
+	u32 w = hdmiDMAWrite;
+	if ( ( ( w + 1 ) & ( HDMI_DMA_RING - 1 ) ) == hdmiDMARead )
+		return;
+	hdmiDMARing[ w * 2 + 0 ] = left;
+	hdmiDMARing[ w * 2 + 1 ] = right;
+	hdmiDMAWrite = ( w + 1 ) & ( HDMI_DMA_RING - 1 );
+}
+
+#endif
@@ -27,79 +27,259 @@
  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "helpers.h"
+#include <circle/util.h>
+
+//
+// file system session
+//
+// The volume is mounted once and stays mounted: all modules call fsMount/fsUnmount instead of f_mount, fsMount only
+// mounts again if the work area has been invalidated (fs_type == 0, e.g. someone else called f_mount), and then also
+// drops all cached handles as they refer to the old mount. Files which are written must be fsInvalidate'd first.
+//
+#if FF_FS_LOCK
+#define FS_CACHED_FILES		( FF_FS_LOCK / 2 )
+#else
+#define FS_CACHED_FILES		8
+#endif
+#define FS_MAX_PATH			256
+#define FS_LINKMAP_SIZE		64
+#define FS_READAHEAD_MIN	4096
+#define FS_READAHEAD_MAX	( 64 * 1024 )
+
+struct FS_FILE
+{
+	char	name[ FS_MAX_PATH ];
+	FIL		file;
+	u32		size;
+	u32		lastUse;
+	u32		readAhead;			// size of the last refill, doubled for sequential reads
+#if FF_USE_FASTSEEK
+	DWORD	linkMap[ FS_LINKMAP_SIZE ];	// cluster chain, seeking does not need to follow the FAT
+#endif
+};
+
+static FATFS	fsFileSystem;
+static u32		fsMounted = 0;
+static FS_FILE	fsFiles[ FS_CACHED_FILES ];
+static u32		fsFileValid[ FS_CACHED_FILES ];
+static u32		fsUseCounter = 0;
+
+// one read-ahead buffer shared by all files
+static u8		fsBuffer[ FS_READAHEAD_MAX ] __attribute__( ( aligned( 128 ) ) );
+static FS_FILE	*fsBufferFile = NULL;
+static u32		fsBufferOfs, fsBufferSize;
+
+static void fsClose( u32 i )
+{
+	if ( !fsFileValid[ i ] )
+		return;
+
+	f_close( &fsFiles[ i ].file );
+	fsFileValid[ i ] = 0;
+
+	if ( fsBufferFile == &fsFiles[ i ] )
+		fsBufferFile = NULL;
+}
+
+FRESULT fsMount( const char *DRIVE )
+{
+	if ( fsMounted && fsFileSystem.fs_type != 0 )
+		return FR_OK;
+
+	// the handles (if any) belong to a previous mount
+	memset( fsFileValid, 0, sizeof( fsFileValid ) );
+	fsBufferFile = NULL;
+
+	FRESULT result = f_mount( &fsFileSystem, ( DRIVE && DRIVE[ 0 ] ) ? DRIVE : "SD:", 1 );
+	fsMounted = ( result == FR_OK );
+
+	return result;
+}
+
+FRESULT fsUnmount( const char *DRIVE )
+{
+	// the session keeps the volume mounted
+	return FR_OK;
+}
+
+void fsInvalidate( const char *FILENAME )
+{
+	for ( u32 i = 0; i < FS_CACHED_FILES; i++ )
+		if ( fsFileValid[ i ] && strcmp( fsFiles[ i ].name, FILENAME ) == 0 )
+			fsClose( i );
+}
+
+FS_FILE *fsOpen( const char *FILENAME )
+{
+	if ( fsMount( "SD:" ) != FR_OK )
+		return NULL;
+
+	u32 lru = 0;
+	for ( u32 i = 0; i < FS_CACHED_FILES; i++ )
+	{
+		if ( fsFileValid[ i ] && strcmp( fsFiles[ i ].name, FILENAME ) == 0 )
+		{
+			fsFiles[ i ].lastUse = ++ fsUseCounter;
+			return &fsFiles[ i ];
+		}
+		if ( fsFileValid[ lru ] && ( !fsFileValid[ i ] || fsFiles[ i ].lastUse < fsFiles[ lru ].lastUse ) )
+			lru = i;
+	}
+
+	fsClose( lru );
+
+	FS_FILE *f = &fsFiles[ lru ];
+	if ( f_open( &f->file, FILENAME, FA_READ | FA_OPEN_EXISTING ) != FR_OK )
+		return NULL;
+
+	#if FF_USE_FASTSEEK
+	f->linkMap[ 0 ] = FS_LINKMAP_SIZE;
+	f->file.cltbl = f->linkMap;
+	if ( f_lseek( &f->file, CREATE_LINKMAP ) != FR_OK )
+		f->file.cltbl = NULL;	// too fragmented, seek through the FAT then
+	#endif
+
+	// overlong paths are never found again, the handle is simply reused
+	if ( strlen( FILENAME ) < FS_MAX_PATH )
+		strcpy( f->name, FILENAME ); else
+		f->name[ 0 ] = 0;
+
+	f->size = (u32)f_size( &f->file );
+	f->readAhead = FS_READAHEAD_MIN;
+	f->lastUse = ++ fsUseCounter;
+	fsFileValid[ lru ] = 1;
+
+	return f;
+}
+
+static u32 fsClusterBytes()
+{
+	#if FF_MAX_SS != FF_MIN_SS
+	return (u32)fsFileSystem.csize * fsFileSystem.ssize;
+	#else
+	return (u32)fsFileSystem.csize * FF_MAX_SS;
+	#endif
+}
+
+u32 fsFileSize( FS_FILE *f )
+{
+	return f->size;
+}
+
+// reads 'size' bytes at 'offset', returns the number of bytes read
+u32 fsRead( FS_FILE *f, u32 offset, void *data, u32 size )
+{
+	u8 *dst = (u8*)data;
+
+	if ( offset >= f->size )
+		return 0;
+
+	if ( size > f->size - offset )
+		size = f->size - offset;
+
+	u32 done = 0;
+	while ( done < size )
+	{
+		u32 pos = offset + done;
+
+		if ( fsBufferFile == f && pos >= fsBufferOfs && pos < fsBufferOfs + fsBufferSize )
+		{
+			u32 n = min( size - done, fsBufferOfs + fsBufferSize - pos );
+			memcpy( &dst[ done ], &fsBuffer[ pos - fsBufferOfs ], n );
+			done += n;
+			continue;
+		}
+
+		UINT nRead;
+
+		// large reads go directly to the destination, FatFs transfers all full sectors of a cluster at once
+		if ( size - done >= FS_READAHEAD_MAX )
+		{
+			if ( f_lseek( &f->file, pos ) == FR_OK && f_read( &f->file, &dst[ done ], size - done, &nRead ) == FR_OK )
+				done += nRead;
+			break;
+		}
+
+		// refill: sequential access continues at the end of the buffer with twice the read-ahead,
+		// otherwise we start over with a small, aligned block
+		u32 readAhead, start;
+		if ( fsBufferFile == f && pos == fsBufferOfs + fsBufferSize )
+		{
+			readAhead = min( f->readAhead * 2, (u32)FS_READAHEAD_MAX );
+			start = pos;
+		} else
+		{
+			readAhead = FS_READAHEAD_MIN;
+			start = pos & ~( FS_READAHEAD_MIN - 1 );
+		}
+		f->readAhead = readAhead;
+
+		// end the read at a cluster boundary (clusters are powers of two)
+		u32 align = min( readAhead, fsClusterBytes() );
+		u32 end = ( start + readAhead ) & ~( align - 1 );
+		if ( end <= pos )
+			end = start + readAhead;
+
+		if ( f_lseek( &f->file, start ) != FR_OK || f_read( &f->file, fsBuffer, end - start, &nRead ) != FR_OK || nRead <= pos - start )
+		{
+			fsBufferFile = NULL;
+			break;
+		}
+
+		fsBufferFile = f;
+		fsBufferOfs  = start;
+		fsBufferSize = nRead;
+	}
+
+	return done;
+}
 
 // file reading
 int readFile( CLogger *logger, const char *DRIVE, const char *FILENAME, u8 *data, u32 *size, u32 maxSize )
 {
-	FATFS m_FileSystem;
-
 	*size = 0;
 
-	// mount file system
-	if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+	if ( fsMount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: %s", DRIVE );
 
-	// get filesize
-	FILINFO info;
-	u32 result = f_stat( FILENAME, &info );
-	u32 filesize = (u32)info.fsize;
-
-	// open file
-	FIL file;
-	result = f_open( &file, FILENAME, FA_READ | FA_OPEN_EXISTING );
-	if ( result != FR_OK )
+	FS_FILE *file = fsOpen( FILENAME );
+	if ( file == NULL )
 	{
 		logger->Write( "RaspiMenu", LogNotice, "Cannot open file: %s", FILENAME );
-
-		if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
-			logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
-
 		return 0;
 	}
 
+	u32 filesize = fsFileSize( file );
 	if ( filesize > maxSize )
 		filesize = maxSize;
 
 	*size = filesize;
 
-	// read data in one big chunk
-	u32 nBytesRead;
-	result = f_read( &file, data, filesize, &nBytesRead );
-
-	if ( result != FR_OK )
+	if ( fsRead( file, 0, data, filesize ) != filesize )
 		logger->Write( "RaspiMenu", LogError, "Read error" );
 
-	if ( f_close( &file ) != FR_OK )
-		logger->Write( "RaspiMenu", LogPanic, "Cannot close file" );
-
-	// unmount file system
-	if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
-		logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
-	
 	return 1;
 }
 
 int getFileSize( CLogger *logger, const char *DRIVE, const char *FILENAME, u32 *size )
 {
-	FATFS m_FileSystem;
-
-	// mount file system
-	if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+	if ( fsMount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: %s", DRIVE );
 
-	// get filesize
-	FILINFO info;
-	u32 result = f_stat( FILENAME, &info );
+	// cached files already know their size
+	for ( u32 i = 0; i < FS_CACHED_FILES; i++ )
+		if ( fsFileValid[ i ] && strcmp( fsFiles[ i ].name, FILENAME ) == 0 )
+		{
+			*size = fsFiles[ i ].size;
+			return 1;
+		}
 
-	if ( result != FR_OK )
+	FILINFO info;
+	if ( f_stat( FILENAME, &info ) != FR_OK )
 		return 0;
 
 	*size = (u32)info.fsize;
 
-	// unmount file system
-	if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
-		logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
-	
 	return 1;
 }
 
@@ -107,12 +287,12 @@ int getFileSize( CLogger *logger, const char *DRIVE, const char *FILENAME, u32 *
 // file writing
 int writeFile( CLogger *logger, const char *DRIVE, const char *FILENAME, u8 *data, u32 size )
 {
-	FATFS m_FileSystem;
-
-	// mount file system
-	if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+	if ( fsMount( DRIVE ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: %s", DRIVE );
 
+	// a cached handle and read-ahead data would be stale afterwards
+	fsInvalidate( FILENAME );
+
 	// open file
 	FIL file;
 	u32 result = f_open( &file, FILENAME, FA_WRITE | FA_CREATE_ALWAYS );
@@ -132,10 +312,6 @@ int writeFile( CLogger *logger, const char *DRIVE, const char *FILENAME, u8 *dat
 	if ( f_close( &file ) != FR_OK )
 		logger->Write( "RaspiMenu", LogPanic, "Cannot close file" );
 
-	// unmount file system
-	if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
-		logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
-	
 	return 1;
 }
 
@@ -37,6 +37,17 @@ extern int readFile( CLogger *logger, const char *DRIVE, const char *FILENAME, u
 extern int getFileSize( CLogger *logger, const char *DRIVE, const char *FILENAME, u32 *size );
 extern int writeFile( CLogger *logger, const char *DRIVE, const char *FILENAME, u8 *data, u32 size );
 
+// file system session: the drive is mounted once (fsMount/fsUnmount replace f_mount everywhere),
+// recently used files keep their handles, and small reads are served from a cluster aligned read-ahead buffer
+typedef struct FS_FILE FS_FILE;
+
+extern FRESULT fsMount( const char *DRIVE );
+extern FRESULT fsUnmount( const char *DRIVE );
+extern void fsInvalidate( const char *FILENAME );
+extern FS_FILE *fsOpen( const char *FILENAME );
+extern u32 fsFileSize( FS_FILE *f );
+extern u32 fsRead( FS_FILE *f, u32 offset, void *data, u32 size );
+
 #define START_AND_READ_ADDR0to7_RW_RESET_CS	\
 	register u32 g2, g3;					\
 	BEGIN_CYCLE_COUNTER						\
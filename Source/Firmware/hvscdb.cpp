@@ -0,0 +1,170 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ hvscdb.cpp
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - song lengths and STIL entries of the HVSC collection in SD:SID (using the binary index in DOCUMENTS/HVSC.IDX)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "hvscdb.h"
+#include "helpers.h"
+#include "PSID/libpsid64/hvscindex.h"
+#include <fatfs/ff.h>
+#include <stdio.h>
+
+static u8 *hvscIndex = NULL;
+static char hvscRoot[ 64 ];
+static int hvscInitDone = 0;
+
+// reads a file into a buffer allocated with new[]
+static char *hvscDBLoad( CLogger *logger, const char *DRIVE, const char *filename, u32 *size )
+{
+	*size = 0;
+	if ( !getFileSize( logger, DRIVE, filename, size ) || *size == 0 )
+		return NULL;
+
+	char *data = new char[ *size ];
+	if ( !readFile( logger, DRIVE, filename, (u8*)data, size, *size ) )
+	{
+		delete [] data;
+		*size = 0;
+		return NULL;
+	}
+	return data;
+}
+
+int hvscDBInit( CLogger *logger, const char *DRIVE )
+{
+	static const char *roots[] = HVSCDB_ROOTS;
+	char filename[ 128 ];
+
+	if ( hvscInitDone )
+		return hvscIndex != NULL;
+	hvscInitDone = 1;
+
+	for ( u32 r = 0; r < sizeof( roots ) / sizeof( roots[ 0 ] ); r++ )
+	{
+		u32 songlengthsSize = 0, stilSize = 0, indexSize = 0;
+
+		sprintf( filename, "%s/DOCUMENTS/Songlengths.md5", roots[ r ] );
+		getFileSize( logger, DRIVE, filename, &songlengthsSize );
+		sprintf( filename, "%s/DOCUMENTS/STIL.txt", roots[ r ] );
+		getFileSize( logger, DRIVE, filename, &stilSize );
+
+		if ( songlengthsSize == 0 && stilSize == 0 )
+			continue;
+
+		strcpy( hvscRoot, roots[ r ] );
+
+		// use the existing index if it has been built from the current files
+		sprintf( filename, "%s/DOCUMENTS/%s", hvscRoot, HVSCINDEX_FILENAME );
+		u8 *index = (u8*)hvscDBLoad( logger, DRIVE, filename, &indexSize );
+		if ( hvscIndexValid( index, indexSize ) &&
+			 ((HVSCINDEXHEADER*)index)->songlengthsSize == songlengthsSize &&
+			 ((HVSCINDEXHEADER*)index)->stilSize == stilSize )
+		{
+			hvscIndex = index;
+			logger->Write( "RaspiMenu", LogNotice, "HVSC index loaded: %s (%d entries)", filename, ((HVSCINDEXHEADER*)index)->nEntries );
+			return 1;
+		}
+		if ( index )
+			delete [] index;
+
+		// one-time build
+		logger->Write( "RaspiMenu", LogNotice, "building HVSC index for %s", hvscRoot );
+
+		sprintf( filename, "%s/DOCUMENTS/Songlengths.md5", hvscRoot );
+		char *songlengths = hvscDBLoad( logger, DRIVE, filename, &songlengthsSize );
+		sprintf( filename, "%s/DOCUMENTS/STIL.txt", hvscRoot );
+		char *stil = hvscDBLoad( logger, DRIVE, filename, &stilSize );
+
+		indexSize = hvscIndexBuild( songlengths, songlengthsSize, stil, stilSize, &hvscIndex );
+
+		if ( songlengths ) delete [] songlengths;
+		if ( stil ) delete [] stil;
+
+		sprintf( filename, "%s/DOCUMENTS/%s", hvscRoot, HVSCINDEX_FILENAME );
+		writeFile( logger, DRIVE, filename, hvscIndex, indexSize );
+		logger->Write( "RaspiMenu", LogNotice, "HVSC index written: %s (%d entries)", filename, ((HVSCINDEXHEADER*)hvscIndex)->nEntries );
+		return 1;
+	}
+
+	return 0;
+}
+
+u64 hvscDBVersion()
+{
+	if ( hvscIndex == NULL )
+		return 0;
+
+	const HVSCINDEXHEADER *h = (const HVSCINDEXHEADER *)hvscIndex;
+	return ( (u64)h->songlengthsSize << 32 ) ^ ( (u64)h->version << 24 ) ^ h->stilSize;
+}
+
+// reads 'length' bytes at 'offset' of STIL.txt
+static int hvscDBReadSTIL( CLogger *logger, const char *DRIVE, u32 offset, u32 length, char *stil )
+{
+	char filename[ 128 ];
+	int ok = 0;
+
+	sprintf( filename, "%s/DOCUMENTS/STIL.txt", hvscRoot );
+
+	if ( fsMount( DRIVE ) != FR_OK )
+		logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: %s", DRIVE );
+
+	// the handle (and its cluster map) stays cached, seeking in the large STIL.txt is cheap then
+	FS_FILE *file = fsOpen( filename );
+	if ( file != NULL )
+		ok = fsRead( file, offset, stil, length ) == length;
+
+	if ( fsUnmount( DRIVE ) != FR_OK )
+		logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
+
+	return ok;
+}
+
+int hvscDBLookup( CLogger *logger, const char *DRIVE, const char *path, u16 *lengths, u32 *nSongs, u32 maxSongs, char *stil, u32 *stilLength )
+{
+	*nSongs = 0;
+	*stilLength = 0;
+
+	const HVSCINDEXENTRY *e = hvscIndexFind( hvscIndex, path );
+	if ( e == NULL )
+		return 0;
+
+	*nSongs = min( (u32)e->nSongs, maxSongs );
+	for ( u32 i = 0; i < *nSongs; i++ )
+		lengths[ i ] = hvscIndexSongLength( hvscIndex, e, i );
+
+	if ( stil == NULL )
+		*stilLength = e->stilLength; else
+	if ( e->stilLength )
+	{
+		u32 l = min( e->stilLength, (u32)HVSCDB_MAX_STIL );
+		if ( hvscDBReadSTIL( logger, DRIVE, e->stilOffset, l, stil ) )
+			*stilLength = l;
+	}
+
+	return 1;
+}
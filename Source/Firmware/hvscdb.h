@@ -0,0 +1,51 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ hvscdb.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - song lengths and STIL entries of the HVSC collection in SD:SID (using the binary index in DOCUMENTS/HVSC.IDX)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _hvscdb_h
+#define _hvscdb_h
+
+#include <circle/types.h>
+#include <circle/util.h>
+#include <circle/logger.h>
+
+// the HVSC is expected in one of these directories, the index is stored in (and built from) its DOCUMENTS subdirectory
+#define HVSCDB_ROOTS			{ "SD:SID/C64Music", "SD:SID/HVSC", "SD:SID" }
+#define HVSCDB_MAX_STIL			4096
+
+// loads the index (building it once if Songlengths.md5/STIL.txt are newer), returns 1 if a database is available
+extern int hvscDBInit( CLogger *logger, const char *DRIVE );
+
+// identifies the loaded index (0 = no database), changes whenever the collection is updated
+extern u64 hvscDBVersion();
+
+// song lengths (in seconds, 0 = unknown) and raw STIL text (not 0-terminated) of a .sid file, returns 1 if the tune is in the database;
+// with stil == NULL the STIL entry is not read and *stilLength is its length in STIL.txt
+extern int hvscDBLookup( CLogger *logger, const char *DRIVE, const char *path, u16 *lengths, u32 *nSongs, u32 maxSongs, char *stil, u32 *stilLength );
+
+#endif
@@ -35,6 +35,8 @@
 */
 
 #include "kernel_MODplay.h"
+#include "hdmidma.h"
+#include "asrc.h"
 #include <math.h>
 #include "config.h"
 
@@ -138,7 +140,8 @@ static u8 outputViaHDMI = 0;
 #define HDMI_SOUND_MODPLAY
 
 #ifdef HDMI_SOUND_MODPLAY
-static s32 lastWavPositionHDMI = 0x7fffffff;
+static s32 hdmiPosition = 0;		// next sample of ringbufHDMI to be output via HDMI
+static ASRC asrcHDMI;
 static u8 firstHDMIOut = 1, HDMIstarted = 0;
 extern CHDMISoundBaseDevice *hdmiSoundDevice;
 #endif
@@ -318,6 +321,51 @@ static u32 *ringbufHDMI;
 static u32 mod_size, rbRead, rbWrite;
 #define ringbufSize 16384
 
+#ifdef HDMI_SOUND_MODPLAY
+//
+// the FIQ handler advances wavPosition with the C64 clock, the main loop forwards the new samples in blocks
+// to the HDMI ring, resampled to the clock of the HDMI device (the main loop renders the music in large chunks,
+// thus it keeps more samples queued than the SID kernels)
+//
+#define MODPLAY_HDMI_BLOCK	32
+#define MODPLAY_HDMI_TARGET	( HDMI_DMA_TARGET + 512 )
+
+static void feedHDMI()
+{
+	static s32 left[ MODPLAY_HDMI_BLOCK ] AAA, right[ MODPLAY_HDMI_BLOCK ] AAA;
+	static s32 outLeft[ ASRC_MAX_OUTPUT( MODPLAY_HDMI_BLOCK ) ] AAA, outRight[ ASRC_MAX_OUTPUT( MODPLAY_HDMI_BLOCK ) ] AAA;
+
+	s32 pos = wavPosition;
+
+	// restart after a jump, or when too far behind
+	if ( pos < hdmiPosition || pos - hdmiPosition > ringbufSize / 8 )
+		hdmiPosition = pos;
+
+	while ( pos - hdmiPosition >= MODPLAY_HDMI_BLOCK )
+	{
+		if ( hdmiDMAFill() < MODPLAY_HDMI_BLOCK )
+		{
+			while ( hdmiDMAFill() < MODPLAY_HDMI_TARGET )
+				hdmiDMAPutSample( 0, 0 );
+			asrcResync( &asrcHDMI );
+		}
+
+		for ( u32 i = 0; i < MODPLAY_HDMI_BLOCK; i++ )
+		{
+			left[ i ]  = (s32)ringbufHDMI[ ( ( hdmiPosition + i ) * 2 + 0 ) & ( ringbufSize - 1 ) ];
+			right[ i ] = (s32)ringbufHDMI[ ( ( hdmiPosition + i ) * 2 + 1 ) & ( ringbufSize - 1 ) ];
+		}
+		hdmiPosition += MODPLAY_HDMI_BLOCK;
+
+		u32 n = asrcProcess( &asrcHDMI, left, right, MODPLAY_HDMI_BLOCK, hdmiDMALevel(), outLeft, outRight );
+		for ( u32 i = 0; i < n; i++ )
+			hdmiDMAPutSample( max( -0x7fffff, min( 0x7fffff, outLeft[ i ] ) ), max( -0x7fffff, min( 0x7fffff, outRight[ i ] ) ) );
+
+		firstHDMIOut = 0;
+	}
+}
+#endif
+
 pocketmod_context modJumpContext[ 128 ];
 
 static int dheight[ 48 ], firstRun = 1;
@@ -373,12 +421,12 @@ void computeSamplesAndScreenUpdate( u16 vol )
 				int o1 = ( v1 + v2 ) >> 9;
 
 				#ifdef HDMI_SOUND_MODPLAY
-				if ( outputViaHDMI ) ringbufHDMI[ ( rbWrite )&( ringbufSize - 1 ) ] = hdmiSoundDevice->ConvertSample( (v1-32768) << 7 ); 
+				if ( outputViaHDMI ) ringbufHDMI[ ( rbWrite )&( ringbufSize - 1 ) ] = ( (v1-32768) << 7 ); 
 				#endif
 				ringbuf[ ( rbWrite++ )&( ringbufSize - 1 ) ] = o1;
 
 				#ifdef HDMI_SOUND_MODPLAY
-				if ( outputViaHDMI ) ringbufHDMI[ ( rbWrite )&( ringbufSize - 1 ) ] = hdmiSoundDevice->ConvertSample( (v2-32768) << 7 ); 
+				if ( outputViaHDMI ) ringbufHDMI[ ( rbWrite )&( ringbufSize - 1 ) ] = ( (v2-32768) << 7 ); 
 				#endif
 				ringbuf[ ( rbWrite++ )&( ringbufSize - 1 ) ] = o1;
 			} else
@@ -404,11 +452,11 @@ void computeSamplesAndScreenUpdate( u16 vol )
 				//triangleState = ditherNoise;
 
 				#ifdef HDMI_SOUND_MODPLAY
-				if ( outputViaHDMI ) ringbufHDMI[ ( rbWrite )&( ringbufSize - 1 ) ] = hdmiSoundDevice->ConvertSample( (v1-32768) << 7 ); 
+				if ( outputViaHDMI ) ringbufHDMI[ ( rbWrite )&( ringbufSize - 1 ) ] = ( (v1-32768) << 7 ); 
 				#endif
 				ringbuf[ ( rbWrite++ )&( ringbufSize - 1 ) ] = o1;
 				#ifdef HDMI_SOUND_MODPLAY
-				if ( outputViaHDMI ) ringbufHDMI[ ( rbWrite )&( ringbufSize - 1 ) ] = hdmiSoundDevice->ConvertSample( (v2-32768) << 7 ); 
+				if ( outputViaHDMI ) ringbufHDMI[ ( rbWrite )&( ringbufSize - 1 ) ] = ( (v2-32768) << 7 ); 
 				#endif
 				ringbuf[ ( rbWrite++ )&( ringbufSize - 1 ) ] = o2;
 			}
@@ -438,11 +486,11 @@ void computeSamplesAndScreenUpdate( u16 vol )
 			int o2 = wavMemory[ p * 2 + 1 ];
 
 			#ifdef HDMI_SOUND_MODPLAY
-			if ( outputViaHDMI ) ringbufHDMI[ ( rbWrite )&( ringbufSize - 1 ) ] = hdmiSoundDevice->ConvertSample( (o1-128) << 16 ); 
+			if ( outputViaHDMI ) ringbufHDMI[ ( rbWrite )&( ringbufSize - 1 ) ] = ( (o1-128) << 16 ); 
 			#endif
 			ringbuf[ ( rbWrite++ )&( ringbufSize - 1 ) ] = o1;
 			#ifdef HDMI_SOUND_MODPLAY
-			if ( outputViaHDMI ) ringbufHDMI[ ( rbWrite )&( ringbufSize - 1 ) ] = hdmiSoundDevice->ConvertSample( (o2-128) << 16 ); 
+			if ( outputViaHDMI ) ringbufHDMI[ ( rbWrite )&( ringbufSize - 1 ) ] = ( (o2-128) << 16 ); 
 			#endif
 			ringbuf[ ( rbWrite++ )&( ringbufSize - 1 ) ] = o2;
 
@@ -469,7 +517,7 @@ void computeSamplesAndScreenUpdate( u16 vol )
 			o1 += 32768;
 			//int o1 = ( buffer[ i ] + 32768 );
 			#ifdef HDMI_SOUND_MODPLAY
-			u32 c1 = hdmiSoundDevice->ConvertSample( buffer[ i ] << 8 );
+			u32 c1 = buffer[ i ] << 8;
 			#endif
 
 			#ifdef HDMI_SOUND_MODPLAY
@@ -839,12 +887,13 @@ void CKernelMODplay::Run( void )
 	}
 
 	#ifdef HDMI_SOUND_MODPLAY
-	lastWavPositionHDMI = 0x7fffffff;
+	hdmiPosition = 0;
 	firstHDMIOut = 1;
 	HDMIstarted = 0;
 	if ( playHDMIinParallel )
 	{
 		outputViaHDMI = 1;
+		asrcInit( &asrcHDMI, MODPLAY_HDMI_TARGET, MOD_sampleRate );
 		//hdmiSoundDevice->Cancel();
 		//hdmiSoundDevice->Start();
 		/*while ( hdmiSoundDevice->IsWritable() )
@@ -1193,6 +1242,12 @@ void CKernelMODplay::Run( void )
 	// warm caches
 	prepareOnReset( true );
 
+	#ifdef HDMI_SOUND_MODPLAY
+	// the HDMI sound DMA takes its chunks in an IRQ (the FIQ still has priority)
+	if ( outputViaHDMI )
+		EnableIRQs();
+	#endif
+
 	nBytesRead = 0; stage = 1;
 	u32 cycleCountC64_Stage1 = 0;
 	c64CycleCount = resetCounter = 0;
@@ -1246,6 +1301,11 @@ void CKernelMODplay::Run( void )
 
 		if ( disableCart )
 		{
+			#ifdef HDMI_SOUND_MODPLAY
+			if ( outputViaHDMI )
+				feedHDMI();
+			#endif
+
 			if ( firstHDMIOut == 0 && HDMIstarted == 0 )
 			{
 				HDMIstarted = 1;
@@ -1649,28 +1709,11 @@ void CKernelMODplay::FIQHandler (void *pParam)
 		}
 
 		#ifdef HDMI_SOUND_MODPLAY
+		// the samples are forwarded to HDMI in the main loop, see feedHDMI()
 		if ( outputViaHDMI )
 		{
-			if ( lastWavPositionHDMI != wavPosition )
-			{
-				if ( firstHDMIOut )
-				{
-					firstHDMIOut = 0;
-				}
-
-				//if ( hdmiSoundDevice->IsWritable() )
-				if ( !( read32( RegMaiControl ) & BitMaiControlFull ) )
-				{
-					write32( RegMaiData, ringbufHDMI[ rbRead & ( ringbufSize - 1 ) ] );
-					write32( RegMaiData, ringbufHDMI[ (rbRead+1) & ( ringbufSize - 1 ) ] );
-				}
-
-				lastWavPositionHDMI = wavPosition;
-			}
-
 			wavPosition = (unsigned long long)c64CycleCount * (unsigned long long)MOD_sampleRate / c64ClockSpeed;
 			rbRead = wavPosition * 2;
-			CACHE_PRELOADL1STRM( &ringbufHDMI[ rbRead & ( ringbufSize - 1 ) ] );
 		}
 		#endif
 
@@ -30,6 +30,7 @@
 
 #include "kernel_ar.h"
 #include "crt.h"
+#include "snapshot.h"
 #ifdef COMPILE_MENU
 #include "kernel_menu.h"
 #endif
@@ -137,6 +138,7 @@ void initAR()
 __attribute__( ( always_inline ) ) inline void callbackReset()
 {
 	initAR();
+	snapshotReset();
 	latchSetClearImm( LATCH_LED0, 0 );
 }
 
@@ -242,6 +244,11 @@ void CKernel::Run( void )
 	}
 	#endif
 
+	// freezer snapshots: registers and RAM of the AR
+	snapshotInit( "ar" );
+	snapshotAddSection( (void*)&ar, offsetof( ARSTATE, resetCounter ) );
+	snapshotAddSection( ar.ramAR, 8192 );
+
 	// setup FIQ
 	DisableIRQs();
 	m_InputPin.ConnectInterrupt( FIQ_HANDLER, FIQ_PARENT );
@@ -280,6 +287,8 @@ void CKernel::Run( void )
 		if ( ar.resetCounter > 30 && ar.resetReleased )
 			callbackReset();
 
+		snapshotUpdate();
+
 		asm volatile ("wfi");
 	}
 
@@ -316,6 +325,8 @@ void CKernel::FIQHandler (void *pParam)
 
 	WAIT_AND_READ_ADDR8to12_ROMLH_IO12_BA
 
+	SNAPSHOT_FIQ( )
+
 	if ( ar.hasKernal && ROMH_ACCESS && KERNAL_ACCESS && !( ar.active & 256 ) )
 	{
 		WRITE_D0to7_TO_BUS( kernalROM[ GET_ADDRESS ] );
@@ -399,7 +410,7 @@ void CKernel::FIQHandler (void *pParam)
 
 freezer:
 	// initialize freezing
-	if ( BUTTON_PRESSED && ( ar.lastFreezeButton == 0 ) )
+	if ( SNAPSHOT_FREEZE_BUTTON && ( ar.lastFreezeButton == 0 ) )
 	{
 		ar.lastFreezeButton = 500000; // debouncing
 		ar.freezeNMICycles  = 10;
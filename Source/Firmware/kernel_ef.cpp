@@ -118,6 +118,11 @@ u8 *flash_cacheoptimized_pool;//[ 1024 * 1024 + 8 * 1024 ] AAA;
 
 static volatile EFSTATE ef AAA;
 
+// bank switches recorded by the FIQ handler, the main loop feeds them to the bank predictor
+static u8 bankLog[ 256 ] AAA;
+static volatile u8 bankLogWrite = 0;
+static u8 bankLogRead = 0;
+
 // table with EF memory configurations adapted from Vice
 #define M_EXROM	2
 #define M_GAME	1
@@ -294,6 +299,7 @@ __attribute__( ( always_inline ) ) inline void easyflash_IO1_Write( u32 addr, u8
 		ef.reg0old = ef.reg0;
 		ef.reg0 = (u8)( value & EASYFLASH_BANK_MASK );
 		ef.flashBank = &ef.flash_cacheoptimized[ ef.reg0 * 8192 * 2 ];
+		bankLog[ bankLogWrite ++ ] = ef.reg0;
 	} else
 	{
 		ef.reg2 = value & 0x87;
@@ -509,58 +515,213 @@ static void KernelEFFIQHandler_Comal80( void *pParam );
 static void KernelEFFIQHandler_EpyxFL( void *pParam );
 static void KernelMDOnlyFIQHandler( void *pParam );
 
-#define LRU_CACHE_ENTRIES	16
+//
+// bank transition predictor used by the polling handler: a small Markov table learns which 
+// bank usually follows which, the predicted successors of the current bank and the most 
+// recently used banks are kept warm in the caches (the table is stored in the CRT profile database)
+//
+#define BANKPRED_BANKS		CRTPREDICTOR_BANKS
+#define BANKPRED_SUCC		CRTPREDICTOR_SUCC
+#define BANKPRED_RECENT		11		// recently used banks kept warm in addition
+#define BANKPRED_SLOTS		( 1 + BANKPRED_SUCC + BANKPRED_RECENT )
+
+static CRTPREDICTOR bankPred AAA;
+static u32 bankPredLoadedTransitions = 0;
 
-u8 lruCache[ LRU_CACHE_ENTRIES ];
-u8 lruCurPreloadSlot = 0;
-u32 lruPreloadAddr = 0;
+u8  bankPredCur = 0xff;
+u8  bankRecent[ BANKPRED_RECENT ];
+u8  bankRecentPos = 0;
+u8  bankPredSlot = 0;
+u32 bankPredPreloadAddr = 0;
+u32 bankPredHits = 0, bankPredMisses = 0;
 
 static u8 usePollingEFHandler = 0;
 
+static void resetBankPredictor()
+{
+	memset( &bankPred, 0, sizeof( CRTPREDICTOR ) );
+	memset( bankPred.next, 0xff, sizeof( bankPred.next ) );
+}
 
-// looks for parts of "The dwarf gasps out" and "Prince Keirgar"
-const u32 eobString1[] = { 0x64206568, 0x66726177, 0x73616720 };
-const u32 eobString2[] = { 0x65636e69, 0x69654b20, 0x72616772 };
+static void loadBankPredictor()
+{
+	if ( !crtProfileLoadPredictor( crtContentHash, &bankPred ) )
+		resetBankPredictor();
 
-// checking for "Prince of Persia"
-const u32 popString1[] = { 0x4e495270, 0x4f204543, 0x45702046, 0x41495352 }; // pRINCE OF pERSIA
-const u32 popString2[] = { 0x124d202d, 0x4449532e };
+	bankPredLoadedTransitions = bankPred.nTransitions;
+}
 
-static void checkForEOTB_POP()
+static void saveBankPredictor()
 {
-	extern u8 tempRAWCRTBuffer[ 1032 * 1024 ];
+	logger->Write( "RaspiFlash", LogNotice, "bank prediction: %d hits, %d misses", bankPredHits, bankPredMisses );
 
-	usePollingEFHandler = 0;
+	// only write if something has been learned in this session
+	if ( bankPred.nTransitions == bankPredLoadedTransitions )
+		return;
+
+	crtProfileStorePredictor( crtContentHash, &bankPred );
+	crtProfileSaveDB( logger, DRIVE );
+	bankPredLoadedTransitions = bankPred.nTransitions;
+}
+
+// the FIQ handler's main loop writes what has been learned at most every ~10 seconds (and when the C64 is switched off)
+#define BANKPRED_SAVE_TRANSITIONS	1024
+#define BANKPRED_SAVE_CYCLES		10000000
+
+static void saveBankPredictorPeriodically( u64 c64CycleCount, u8 c64Off )
+{
+	static u64 lastSaveCycle = 0;
 
-	u32 *r = (u32*)&tempRAWCRTBuffer[ 0 ];
+	if ( c64CycleCount < lastSaveCycle )
+		lastSaveCycle = 0;
 
-	u8 s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+	if ( bankPred.nTransitions - bankPredLoadedTransitions < ( c64Off ? 1 : BANKPRED_SAVE_TRANSITIONS ) ||
+		 ( !c64Off && c64CycleCount - lastSaveCycle < BANKPRED_SAVE_CYCLES ) )
+		return;
+
+	saveBankPredictor();
+	lastSaveCycle = c64CycleCount;
+}
+
+// a title is considered to stream from flash if it keeps switching between many banks (instead of copying them once at startup)
+static u8 bankPredIsStreaming()
+{
+	u32 nBanksUsed = 0;
+	for ( u32 i = 0; i < BANKPRED_BANKS; i++ )
+		if ( bankPred.next[ i ][ 0 ] != 0xff )
+			nBanksUsed ++;
+
+	return ( nBanksUsed >= 8 && bankPred.nTransitions >= 32 * nBanksUsed ) ? 1 : 0;
+}
 
-	for ( int i = 0; i < 512 * 1024 / 4; i ++ )
+void initBankPredictorWarmSet()
+{
+	bankPredSlot = 0;
+	bankPredPreloadAddr = 0;
+	bankRecentPos = 0;
+	for ( int i = 0; i < BANKPRED_RECENT; i ++ )
+		bankRecent[ i ] = 0xff;
+}
+
+// slot 0 = current bank, then its predicted successors, then the most recently used banks
+__attribute__( ( always_inline ) ) inline u8 bankPredSlotBank( u8 slot )
+{
+	if ( slot == 0 )
+		return bankPredCur;
+	if ( bankPredCur == 0xff )
+		return 0xff;
+	if ( slot <= BANKPRED_SUCC )
+		return bankPred.next[ bankPredCur ][ slot - 1 ];
+
+	u8 r = bankRecentPos + slot - 1 - BANKPRED_SUCC;
+	if ( r >= BANKPRED_RECENT ) r -= BANKPRED_RECENT;
+	return bankRecent[ r ];
+}
+
+__attribute__( ( always_inline ) ) inline u8 isInBankPredWarmSet( u8 k )
+{
+	for ( int i = 0; i < BANKPRED_SLOTS; i ++ )
+		if ( bankPredSlotBank( i ) == k )
+			return 1;
+	return 0;
+}
+
+__attribute__( ( always_inline ) ) inline void bankPredLearn( u8 from, u8 to )
+{
+	u8 *n = bankPred.next[ from ];
+	u8 *c = bankPred.count[ from ];
+
+	// find successor, if unknown it replaces the least frequent one
+	int i = 0;
+	while ( i < BANKPRED_SUCC - 1 && n[ i ] != to ) i ++;
+	if ( n[ i ] != to )
 	{
-		if ( r[ i   ] == eobString1[ 0 ] &&
-			 r[ i+1 ] == eobString1[ 1 ] &&
-			 r[ i+2 ] == eobString1[ 2 ] )
-			s1 = 1;
-		if ( r[ i   ] == eobString2[ 0 ] &&
-			 r[ i+1 ] == eobString2[ 1 ] &&
-			 r[ i+2 ] == eobString2[ 2 ] )
-			s2 = 1;
+		n[ i ] = to;
+		c[ i ] = 0;
+	}
 
-		if ( r[ i   ] == popString1[ 0 ] &&
-			 r[ i+1 ] == popString1[ 1 ] &&
-			 r[ i+2 ] == popString1[ 2 ] &&
-			 r[ i+3 ] == popString1[ 3 ] )
-			s3 = 1;
-		if ( r[ i   ] == popString2[ 0 ] &&
-			 r[ i+1 ] == popString2[ 1 ] )
-			s4 = 1;
+	if ( c[ i ] == 255 )
+		for ( int j = 0; j < BANKPRED_SUCC; j ++ )
+			c[ j ] >>= 1;
+	c[ i ] ++;
 
-		if ( ( s1 && s2 ) || ( s3 && s4 ) )
-		{
-			usePollingEFHandler = 1;
-			return;
-		}
+	// keep successors sorted by frequency
+	while ( i > 0 && c[ i ] > c[ i - 1 ] )
+	{
+		u8 t = n[ i ]; n[ i ] = n[ i - 1 ]; n[ i - 1 ] = t;
+		t = c[ i ]; c[ i ] = c[ i - 1 ]; c[ i - 1 ] = t;
+		i --;
+	}
+
+	bankPred.nTransitions ++;
+}
+
+// returns 1 if the new bank was not warm, i.e. needs to be preloaded
+__attribute__( ( always_inline ) ) inline u8 bankPredSwitch( u8 bank )
+{
+	u8 hit = isInBankPredWarmSet( bank );
+
+	if ( bankPredCur != 0xff )
+	{
+		bankPredLearn( bankPredCur, bank );
+
+		// ring buffer of recently used banks, no shifting
+		bankRecentPos = bankRecentPos ? bankRecentPos - 1 : BANKPRED_RECENT - 1;
+		bankRecent[ bankRecentPos ] = bankPredCur;
+	}
+	bankPredCur = bank;
+
+	if ( hit ) bankPredHits ++; else bankPredMisses ++;
+
+	// continue warming with the most likely successor
+	bankPredSlot = 1;
+	bankPredPreloadAddr = 0;
+
+	return !hit;
+}
+
+// bank switches seen by the FIQ handler are only learned, the warm set is not used there
+static void bankPredObserve( u8 bank )
+{
+	if ( bankPredCur != 0xff )
+		bankPredLearn( bankPredCur, bank );
+	bankPredCur = bank;
+}
+
+// per-title settings from the profile database
+static s32 efPollTimingOfs = 0;
+static u32 efPollDMACycles = 4 + 6;
+static u8  efWarmBanks[ CRTPROFILE_WARM_BANKS ];
+
+static void applyCRTProfile( CRTPROFILE *profile )
+{
+	efPollTimingOfs = 0;
+	efPollDMACycles = 4 + 6;
+	memset( efWarmBanks, 0xff, CRTPROFILE_WARM_BANKS );
+
+	if ( profile == NULL )
+		return;
+
+	efPollTimingOfs = profile->pollTimingOfs;
+	if ( profile->dmaCycles )
+		efPollDMACycles = profile->dmaCycles;
+	memcpy( efWarmBanks, profile->warmBanks, CRTPROFILE_WARM_BANKS );
+
+	logger->Write( "RaspiFlash", LogNotice, "CRT profile %08x%08x: %s handler, timing %+d, DMA %d", 
+		(u32)( profile->hash >> 32 ), (u32)profile->hash, crtProfileHandlerName( profile->handler ), efPollTimingOfs, efPollDMACycles );
+}
+
+// writes EAPI changes back to the CRT, the title's profile moves to the content hash of the modified file
+static void saveEAPIChanges( const char *FILENAME )
+{
+	u64 oldHash = crtContentHash;
+
+	writeChanges2CRTFile( logger, (char*)DRIVE, (char*)FILENAME, (u8*)ef.flash_cacheoptimized, false );
+
+	if ( crtContentHash != oldHash )
+	{
+		crtProfileRekey( oldHash, crtContentHash );
+		crtProfileSaveDB( logger, DRIVE );
 	}
 }
 
@@ -580,8 +741,11 @@ void initEFGlobals()
 	curPixelRow = 0;
 	curCopyRow = 0;
 	pauseSlideShow = 0;
-	lruCurPreloadSlot = 0;
-	lruPreloadAddr = 0;
+	bankPredCur = 0xff;
+	bankPredSlot = 0;
+	bankPredPreloadAddr = 0;
+	bankPredHits = bankPredMisses = 0;
+	bankLogWrite = bankLogRead = 0;
 	irqFallingEdge = true;
 	epyxDisable = 0;
  	gmod2FF = 1;
@@ -640,9 +804,26 @@ void CKernelEF::Run( void )
 			ef.flash_cacheoptimized[ ADDR_LINEAR2CACHE(EAPI_OFFSET+i) * 2 + 1 ] = eapiC64Code[ i ];
 	}
 
-	checkForEOTB_POP();
+	// consult the cartridge profile database, unknown CRTs start with the automatic handler selection (and default settings),
+	// they get a profile only when edited in the menu; the lookup updates lastUse in memory only, which is written along with
+	// the next change of the database (e.g. learned bank transitions saved on return to the menu)
+	crtProfileLoadDB( logger, DRIVE );
+	CRTPROFILE *profile = crtProfileLookup( crtContentHash );
+	if ( profile != NULL )
+		usePollingEFHandler = ( profile->handler == CRTPROFILE_HANDLER_POLLING ) ? 1 : 0;
 	//usePollingEFHandler = 1;// only for testing
 
+	applyCRTProfile( profile );
+
+	// titles which have been observed to stream from many banks use the polling handler with bank prediction
+	loadBankPredictor();
+	if ( !usePollingEFHandler && ( profile == NULL || profile->handler == CRTPROFILE_HANDLER_AUTO ) &&
+		 ef.bankswitchType == BS_EASYFLASH && !ef.hasKernal && bankPredIsStreaming() )
+	{
+		logger->Write( "RaspiFlash", LogNotice, "streaming title (%d bank transitions learned)", bankPred.nTransitions );
+		usePollingEFHandler = 1;
+	}
+
 	showSlideShow = 0;
 	tftSlideShowNImages = 0;
 
@@ -891,6 +1072,7 @@ void CKernelEF::Run( void )
 
 	// additional first-time cache preloading
 	CACHE_PRELOAD_DATA_CACHE( (u8*)&ef, ( sizeof( EFSTATE ) + 63 ) / 64, CACHE_PRELOADL1KEEP )
+	CACHE_PRELOAD_DATA_CACHE( bankLog, sizeof( bankLog ), CACHE_PRELOADL1KEEP )
 	CACHE_PRELOAD_INSTRUCTION_CACHE( (void*)myHandler, 4096 )
 
 	FORCE_READ_LINEAR32a( &ef, sizeof( EFSTATE ), 65536 );
@@ -907,45 +1089,41 @@ void CKernelEF::Run( void )
 	if ( usePollingEFHandler )
 	{
 		void efPollingHandler();
-		void initLRUCache();
-
-		initLRUCache();
 
-		// this is actually unnecessary, but anyways...
-		#if 1
-		// const u8 nLRUInit = 6;
-		// const u8 lruInit[nLRUInit] = { 0x01, 0x00, 0x25, 0x12, 0x1f, 0x18 };
-		const u8 nLRUInit = 3;
-		const u8 lruInit[nLRUInit] = { 0x12, 0x18, 0x00 };
+		initBankPredictorWarmSet();
 
+		// warm up the start bank and the banks which are known to follow it
 		CACHE_PRELOAD_INSTRUCTION_CACHE( efPollingHandler, 4096 )
 
-		for ( int j = 0; j < nLRUInit; j++ )
+		bankPredCur = 0;
+		for ( int j = 0; j <= BANKPRED_SUCC; j++ )
 		{
-			//void addLRUCache( u8 k );
-			//addLRUCache( lruInit[ j ] );
-			lruCache[ nLRUInit - j - 1 ] = lruInit[ j ];
-			CACHE_PRELOAD_DATA_CACHE( &ef.flash_cacheoptimized[ lruInit[ j ] * 16384 ], 16384, CACHE_PRELOADL2KEEP )
-			FORCE_READ_LINEAR64( &ef.flash_cacheoptimized[ lruInit[ j ] * 16384 ], 16384 )
-			CACHE_PRELOAD_DATA_CACHE( &ef.flash_cacheoptimized[ lruInit[ j ] * 16384 ], 16384, CACHE_PRELOADL2KEEP )
-			FORCE_READ_LINEAR64( &ef.flash_cacheoptimized[ lruInit[ j ] * 16384 ], 16384 )
+			u8 bank = bankPredSlotBank( j );
+			if ( bank == 0xff ) continue;
+			CACHE_PRELOAD_DATA_CACHE( &ef.flash_cacheoptimized[ bank * 16384 ], 16384, CACHE_PRELOADL2KEEP )
+			FORCE_READ_LINEAR64( &ef.flash_cacheoptimized[ bank * 16384 ], 16384 )
 		}
 
-		lruCurPreloadSlot = 0;
-		lruPreloadAddr = 0;
-
-		//u8 lruCurPreloadBank = lruCache[ lruCurPreloadSlot ];
-		//CACHE_PRELOAD_DATA_CACHE( &ef.flash_cacheoptimized[ lruCurPreloadBank * 16384 ], 16384, CACHE_PRELOADL2KEEP )
+		for ( int j = 0; j < CRTPROFILE_WARM_BANKS; j++ )
+		{
+			u8 bank = efWarmBanks[ j ];
+			if ( bank >= ef.nBanks ) continue;
+			CACHE_PRELOAD_DATA_CACHE( &ef.flash_cacheoptimized[ bank * 16384 ], 16384, CACHE_PRELOADL2KEEP )
+			FORCE_READ_LINEAR64( &ef.flash_cacheoptimized[ bank * 16384 ], 16384 )
+		}
 
-		#endif
+		bankPredSlot = 0;
+		bankPredPreloadAddr = 0;
 
 		CACHE_PRELOAD_INSTRUCTION_CACHE( efPollingHandler, 4096 )
 		latchSetClear( LED_INIT2_HIGH, LED_INIT2_LOW );
 		efPollingHandler();
 
+		saveBankPredictor();
+
 		if ( ef.eapiCRTModified ) 
 		{
-			writeChanges2CRTFile( logger, (char*)DRIVE, (char*)FILENAME, (u8*)ef.flash_cacheoptimized, false );
+			saveEAPIChanges( FILENAME );
 		}
 
 		return;
@@ -960,8 +1138,52 @@ void CKernelEF::Run( void )
 		#ifdef COMPILE_MENU
 		TEST_FOR_JUMP_TO_MAINMENU2FIQs_CB( ef.c64CycleCount, ef.resetCounter2, 
 		{ if ( ef.eapiCRTModified ) {			/*logger->Write( "RaspiFlash", LogNotice, "EF-CRT saved!" );*/
-		writeChanges2CRTFile( logger, (char*)DRIVE, (char*)FILENAME, (u8*)ef.flash_cacheoptimized, false );}} 
-		{ if ( ef.bankswitchType == BS_GMOD2 ) { extern uint8_t m93c86_data[M93C86_SIZE]; char fn[ 4096 ]; sprintf( fn, "%s.eeprom", FILENAME ); writeFile( logger, DRIVE, fn, m93c86_data, 2048 ); } } )
+		saveEAPIChanges( FILENAME );}} 
+		{ if ( ef.bankswitchType == BS_GMOD2 ) { extern uint8_t m93c86_data[M93C86_SIZE]; char fn[ 4096 ]; sprintf( fn, "%s.eeprom", FILENAME ); writeFile( logger, DRIVE, fn, m93c86_data, 2048 ); } } 
+		{ if ( ef.bankswitchType == BS_EASYFLASH ) saveBankPredictor(); } )
+
+		// learn bank transitions (also with the FIQ handler) to detect titles streaming from flash,
+		// bank switches are lost only if the main loop falls behind by more than 256 of them
+		u32 nTransitions = bankPred.nTransitions;
+		while ( bankLogRead != bankLogWrite )
+		{
+			u8 bank = bankLog[ bankLogRead ++ ] & ( BANKPRED_BANKS - 1 );
+			if ( ef.bankswitchType == BS_EASYFLASH && bank != bankPredCur )
+				bankPredObserve( bank );
+		}
+
+		if ( bankPred.nTransitions != nTransitions )
+		{
+			// a title which turns out to stream from flash (already at its first launch) continues with the polling handler,
+			// the predictor is saved first such that later launches start with it
+			if ( ( profile == NULL || profile->handler == CRTPROFILE_HANDLER_AUTO ) && !ef.hasKernal && bankPredIsStreaming() )
+			{
+				logger->Write( "RaspiFlash", LogNotice, "streaming title detected (%d bank transitions learned)", bankPred.nTransitions );
+				saveBankPredictor();
+
+				// warm up the successors of the current bank
+				void efPollingHandler();
+				initBankPredictorWarmSet();
+				CACHE_PRELOAD_INSTRUCTION_CACHE( efPollingHandler, 4096 )
+				for ( int j = 1; j <= BANKPRED_SUCC; j++ )
+				{
+					u8 b = bankPredSlotBank( j );
+					if ( b == 0xff ) continue;
+					CACHE_PRELOAD_DATA_CACHE( &ef.flash_cacheoptimized[ b * 16384 ], 16384, CACHE_PRELOADL2KEEP )
+				}
+				CACHE_PRELOAD_INSTRUCTION_CACHE( efPollingHandler, 4096 )
+
+				// the switch happens between two bus cycles: the FIQ handler has returned and the polling handler syncs to the next one
+				if ( irqFallingEdge ) m_InputPin.DisableInterrupt2();
+				m_InputPin.DisableInterrupt();
+				m_InputPin.DisconnectInterrupt();
+				usePollingEFHandler = 1;
+				efPollingHandler();
+				break;
+			}
+
+			saveBankPredictorPeriodically( ef.c64CycleCount, 0 );
+		}
 		#endif
 
 
@@ -969,6 +1191,11 @@ void CKernelEF::Run( void )
 		// if the C64 is turned off and the CRT has been modified => write back to SD
 		// I omitted any notification as this is real quick
 
+		#ifdef COMPILE_MENU
+		if ( ef.mainloopCount > 10000 && ef.bankswitchType == BS_EASYFLASH )
+			saveBankPredictorPeriodically( ef.c64CycleCount, 1 );
+		#endif
+
 		if ( ef.mainloopCount > 10000 && ef.bankswitchType == BS_GMOD2 ) 
 		{
 			extern uint8_t m93c86_data[M93C86_SIZE];
@@ -979,7 +1206,7 @@ void CKernelEF::Run( void )
 
 		if ( ef.mainloopCount++ > 10000 && ef.eapiCRTModified ) 
 		{
-			writeChanges2CRTFile( logger, (char*)DRIVE, (char*)FILENAME, (u8*)ef.flash_cacheoptimized, false );
+			saveEAPIChanges( FILENAME );
 			/*logger->Write( "RaspiFlash", LogNotice, "EF-CRT saved, c64 switched off!" );*/
 			ef.eapiCRTModified = 0;
 			/*{
@@ -998,8 +1225,11 @@ void CKernelEF::Run( void )
 		asm volatile ("wfi");
 	}
 
-	// and we'll never reach this...
-	m_InputPin.DisableInterrupt();
+	// only reached after switching to the polling handler, which has returned to the menu
+	saveBankPredictor();
+
+	if ( ef.eapiCRTModified ) 
+		saveEAPIChanges( FILENAME );
 }
 
 
@@ -2025,53 +2255,6 @@ cleanup:
 static u32 lastEFAddr = 0;
 
 
-void initLRUCache()
-{
-	lruCurPreloadSlot = 0;
-	lruPreloadAddr = 0;
-	for ( int i = 0; i < LRU_CACHE_ENTRIES; i ++ )
-		lruCache[ i ] = 0xff;
-}
-
-__attribute__( ( always_inline ) ) inline u8 isInLRUCache( u8 k )
-{
-	for ( int i = 0; i < LRU_CACHE_ENTRIES; i ++ )
-		if ( lruCache[ i ] == k )
-		return i + 1;
-		
-	return 0;
-}
-
-__attribute__( ( always_inline ) ) inline void addLRUCache( u8 k )
-{
-	for ( int i = LRU_CACHE_ENTRIES - 1; i > 0; i -- )
-		lruCache[ i ] = lruCache[ i - 1 ];
-
-	lruCache[ 0 ] = k;
-}
-
-__attribute__( ( always_inline ) ) inline u8 addOrMoveFrontLRUCache( u8 k )
-{
-	u8 pos = isInLRUCache( k );
-	if ( pos == 0 )
-	{
-		addLRUCache( k );
-		return 1;
-	} else
-	if ( pos > 1 ) // = in cache, but not at front-most position
-	{
-		pos -= 1;
-		for ( int i = pos; i > 0; i -- )
-			lruCache[ i ] = lruCache[ i - 1 ];
-		lruCache[ 0 ] = k;
-
-		/*u8 t = lruCache[ 0 ];
-		lruCache[ 0 ] = lruCache[ pos ];
-		lruCache[ pos ] = t;*/
-	} 
-	return 0;
-}
-
 //#define FORCE_READ_LINEAR64_REG( p, size ) {				\
 //		for ( register u32 i = 0; i < size/8; i++ )			\
 //			forceRead = ((u64*)p)[ i ];						\
@@ -2118,9 +2301,9 @@ void efPollingHandler()
 	u32 _POLL_FOR_SIGNALS_CPU = POLL_FOR_SIGNALS_CPU;
 	u32 _POLL_CYCLE_MULTIPLEXER_VIC = POLL_CYCLE_MULTIPLEXER_VIC; 
 	u32 _POLL_CYCLE_MULTIPLEXER_CPU = POLL_CYCLE_MULTIPLEXER_CPU;
-	u32 _POLL_READ = POLL_READ;
-	u32 _POLL_READ_VIC2 = POLL_READ_VIC2;
-	u32 _POLL_WAIT_CYCLE_WRITEDATA = POLL_WAIT_CYCLE_WRITEDATA;
+	u32 _POLL_READ = POLL_READ + efPollTimingOfs;
+	u32 _POLL_READ_VIC2 = POLL_READ_VIC2 + efPollTimingOfs;
+	u32 _POLL_WAIT_CYCLE_WRITEDATA = POLL_WAIT_CYCLE_WRITEDATA + efPollTimingOfs;
 	u32 _POLL_TRIGGER_DMA = POLL_TRIGGER_DMA;
 	u32 _POLL_RELEASE_DMA = POLL_RELEASE_DMA;
 
@@ -2143,8 +2326,9 @@ const u32 _POLL_RELEASE_DMA = 475;*/
 
 	latchSetClearImm( LATCH_RESET | LED_INIT2_HIGH, LED_INIT2_LOW );
 
-	CACHE_PRELOADL1KEEP( (u64)&lruCache&~63 );
-	CACHE_PRELOADL1KEEP( ((u64)&lruCache&~63)+64 );
+	CACHE_PRELOADL1KEEP( (u64)&bankRecent&~63 );
+	for ( u32 i = 0; i < sizeof( bankPred ); i += 64 )
+		CACHE_PRELOADL1KEEP( (u64)&bankPred + i );
 
 	while ( 1 )
 	{
@@ -2154,7 +2338,7 @@ const u32 _POLL_RELEASE_DMA = 475;*/
 		#define WAIT_FOR_CPU_HALFCYCLE {do { g2 = read32( ARM_GPIO_GPLEV0 ); } while ( VIC_HALF_CYCLE );}
 		#define WAIT_FOR_VIC_HALFCYCLE {do { g2 = read32( ARM_GPIO_GPLEV0 ); } while ( !VIC_HALF_CYCLE ); }
 
-		u8 lruCurPreloadBank = lruCache[ lruCurPreloadSlot ];
+		u8 curPreloadBank = bankPredSlotBank( bankPredSlot );
 
 		/*static u16 preLoadIC = 0;
 		CACHE_PRELOAD_INSTRUCTION_CACHE( (u8*)efPollingHandler + preLoadIC, 64 )
@@ -2207,25 +2391,28 @@ const u32 _POLL_RELEASE_DMA = 475;*/
 		} else
 		{
 			write32( ARM_GPIO_GPCLR0, bCTRL257 );
-			if ( lruCurPreloadBank != 0xff )
+			if ( curPreloadBank != 0xff )
 			{
-				u8 *curPrefetchAddr = &ef.flash_cacheoptimized[ lruCurPreloadBank * 16384 + lruPreloadAddr ];
+				u8 *curPrefetchAddr = &ef.flash_cacheoptimized[ curPreloadBank * 16384 + bankPredPreloadAddr ];
 				FORCE_READ_LINEAR64_REG( curPrefetchAddr, PRELOAD_BUCKET_SIZE );
 
-				u8 nextPreloadSlot = ( lruCurPreloadSlot + 1 ) % LRU_CACHE_ENTRIES;
-				u8 lruNextPreloadBank = lruCache[ nextPreloadSlot ];
-				CACHE_PRELOAD_DATA_CACHE( &ef.flash_cacheoptimized[ lruNextPreloadBank * 16384 + lruPreloadAddr ], PRELOAD_BUCKET_SIZE, CACHE_PRELOADL2KEEP )
-
-				//CACHE_PRELOAD_DATA_CACHE( &flashBankR[ lruPreloadAddr ], PRELOAD_BUCKET_SIZE, CACHE_PRELOADL2KEEP )
+				u8 nextPreloadSlot = bankPredSlot + 1;
+				if ( nextPreloadSlot >= BANKPRED_SLOTS ) nextPreloadSlot = 0;
+				u8 nextPreloadBank = bankPredSlotBank( nextPreloadSlot );
+				if ( nextPreloadBank != 0xff )
+					CACHE_PRELOAD_DATA_CACHE( &ef.flash_cacheoptimized[ nextPreloadBank * 16384 + bankPredPreloadAddr ], PRELOAD_BUCKET_SIZE, CACHE_PRELOADL2KEEP )
 
-				lruPreloadAddr += PRELOAD_BUCKET_SIZE;
-				if ( lruPreloadAddr >= 16384 )
+				bankPredPreloadAddr += PRELOAD_BUCKET_SIZE;
+				if ( bankPredPreloadAddr >= 16384 )
 				{
-					lruPreloadAddr = 0;
-					lruCurPreloadSlot = nextPreloadSlot;
+					bankPredPreloadAddr = 0;
+					bankPredSlot = nextPreloadSlot;
 				}
 			} else
-				lruCurPreloadSlot = ( lruCurPreloadSlot + 1 ) % LRU_CACHE_ENTRIES;
+			{
+				bankPredSlot ++;
+				if ( bankPredSlot >= BANKPRED_SLOTS ) bankPredSlot = 0;
+			}
 		}
 		//
 		// CPU half-cycle
@@ -2308,14 +2495,13 @@ const u32 _POLL_RELEASE_DMA = 475;*/
 				if ( ( GET_IO12_ADDRESS & 2 ) == 0 && oldBank != ef.flashBank )
 				{
 					u8 newBank = ef.reg0 & 63;
-					//u32 evictBank = lruCache[ LRU_CACHE_ENTRIES - 1 ];
-					u8 requiresPreload = addOrMoveFrontLRUCache( newBank );
+					u8 requiresPreload = bankPredSwitch( newBank );
 
 					if ( requiresPreload )
 					{
 						WAIT_UP_TO_CYCLE( _POLL_OFFSET_CPU_HALFCYCLE+_POLL_TRIGGER_DMA );
 						CLR_GPIO( bDMA );
-						ef.releaseDMA = 4 + 6;
+						ef.releaseDMA = efPollDMACycles;
 
 						//#define CACHE_INVALIDATE( ptr )	{ asm volatile ("dc ivac, %0" :: "r" (ptr)); } // dc ivac oder dc isw
 						//if ( evictBank != 0xff )
@@ -2328,11 +2514,10 @@ const u32 _POLL_RELEASE_DMA = 475;*/
 						FORCE_READ_LINEAR64_REG( &ef.flashBank[ lastEFAddr & ~63 ], 512 * 8 );
 						FORCE_READ_LINEAR64_REG( &ef.flashBank[ 0 ], 16384 );
 
-						lruCurPreloadSlot = 1;
-						lruPreloadAddr = 0;
-
-						u8 lruCurPreloadBank = lruCache[ lruCurPreloadSlot ];
-						CACHE_PRELOAD_DATA_CACHE( &ef.flash_cacheoptimized[ lruCurPreloadBank * 16384 ], PRELOAD_TOTAL_SIZE, CACHE_PRELOADL2KEEP )
+						// bankPredSwitch already pointed the warming to the most likely successor
+						u8 nextBank = bankPredSlotBank( bankPredSlot );
+						if ( nextBank != 0xff )
+							CACHE_PRELOAD_DATA_CACHE( &ef.flash_cacheoptimized[ nextBank * 16384 ], PRELOAD_TOTAL_SIZE, CACHE_PRELOADL2KEEP )
 
 						//asm volatile ("dsb ish" ::);
 					}
@@ -2368,6 +2553,7 @@ const u32 _POLL_RELEASE_DMA = 475;*/
 		{
 			ef.resetCounter = 0x8000000;
 			initEF();
+			bankPredCur = 0;
 			if ( ef.resetEFRAM )
 				memset( (void*)ef.ram, 0, 256 );
 			ef.resetEFRAM = 0;
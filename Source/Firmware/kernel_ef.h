@@ -74,6 +74,7 @@
 #endif
 
 #include "crt.h"
+#include "crtprofile.h"
 #include "Vice/m93c86.h"
 
 #ifdef COMPILE_MENU
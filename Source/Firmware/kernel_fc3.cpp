@@ -29,6 +29,7 @@
 */
 
 #include "kernel_fc3.h"
+#include "snapshot.h"
 
 // this is an ugly hack: for some weird reasons the FC3 freezer occassionally
 // crashes on the first freeze (possibly due to caching behavior). This hack
@@ -100,6 +101,7 @@ static void initFC3()
 __attribute__( ( always_inline ) ) inline void callbackReset()
 {
 	initFC3();
+	snapshotReset();
 	latchSetClear( LATCH_LED0, 0 );
 }
 
@@ -212,6 +214,11 @@ void CKernelFC3::Run( void )
 	}
 	#endif
 
+	// freezer snapshots: state of the FC3 and the GAME/EXROM configuration
+	snapshotInit( "fc3" );
+	snapshotAddSection( (void*)&fc3, offsetof( FC3STATE, resetCounter ) );
+	snapshotAddSection( (void*)&fc3.statusGAMEEXROM, sizeof( u32 ) );
+
 	// setup FIQ
 	DisableIRQs();
 	m_InputPin.ConnectInterrupt( FIQ_HANDLER, FIQ_PARENT );
@@ -266,6 +273,8 @@ void CKernelFC3::Run( void )
 		if ( fc3.resetCounter > 30 && fc3.resetReleased )
 			callbackReset();
 
+		snapshotUpdate();
+
 		asm volatile ("wfi");
 
 		CACHE_PRELOAD_DATA_CACHE( &fc3.flash_cacheoptimized[ 8192 * 2 * 3 ], 8192 * 2, CACHE_PRELOADL1KEEP )
@@ -328,6 +337,8 @@ void CKernelFC3::FIQHandler (void *pParam)
 		return;
 	}
 
+	SNAPSHOT_FIQ( UPDATE_COUNTERS( fc3.c64CycleCount, fc3.resetCounter, fc3.resetPressed, fc3.resetReleased, fc3.cyclesSinceReset ) )
+
 	if ( fc3.hasKernal && ROMH_ACCESS && KERNAL_ACCESS && !(fc3.active & 256) )
 	{
 		WRITE_D0to7_TO_BUS( kernalROM[ GET_ADDRESS ] );
@@ -402,7 +413,7 @@ void CKernelFC3::FIQHandler (void *pParam)
 	}
 
 	// freeze
-	if ( BUTTON_PRESSED && ( fc3.lastFreezeButton == 0 ) )
+	if ( SNAPSHOT_FREEZE_BUTTON && ( fc3.lastFreezeButton == 0 ) )
 	{
 		fc3.lastFreezeButton = 500000; // debouncing
 		CLR_GPIO( bNMI | bCTRL257 ); 
@@ -29,6 +29,7 @@
 */
 
 #include "kernel_freezemachine.h"
+#include "snapshot.h"
 
 // we will read this .CRT file 
 static const char DRIVE[] = "SD:";
@@ -99,6 +100,7 @@ __attribute__( ( always_inline ) ) inline void initFM()
 __attribute__( ( always_inline ) ) inline void callbackReset()
 {
 	initFM();
+	snapshotReset();
 	latchSetClear( LATCH_LED0, 0 );
 }
 
@@ -195,6 +197,11 @@ void CKernelFM::Run( void )
 	}
 	#endif
 
+	// freezer snapshots: state of the cartridge and the GAME/EXROM configuration
+	snapshotInit( "fm" );
+	snapshotAddSection( (void*)&fm, offsetof( FMSTATE, resetCounter ) );
+	snapshotAddSection( (void*)&fm.statusGAMEEXROM, sizeof( u32 ) );
+
 	// setup FIQ
 	DisableIRQs();
 	m_InputPin.ConnectInterrupt( FIQ_HANDLER, FIQ_PARENT );
@@ -232,6 +239,8 @@ void CKernelFM::Run( void )
 		}
 		#endif
 
+		snapshotUpdate();
+
 		asm volatile ("wfi");
 
 		CACHE_PRELOAD_DATA_CACHE( &fm.cartridgeROM[ 8192 * 2 * 3 ], 8192 * 2, CACHE_PRELOADL1KEEP )
@@ -255,6 +264,8 @@ void CKernelFM::FIQHandler (void *pParam)
 	START_AND_READ_ADDR0to7_RW_RESET_CS
 	WAIT_AND_READ_ADDR8to12_ROMLH_IO12_BA
 
+	SNAPSHOT_FIQ( UPDATE_COUNTERS( fm.c64CycleCount, fm.resetCounter, fm.resetPressed, fm.resetReleased, fm.cyclesSinceReset ) )
+
 	if ( fm.hasKernal && ROMH_ACCESS && KERNAL_ACCESS && !(fm.active & 256) )
 	{
 		WRITE_D0to7_TO_BUS( kernalROM[ GET_ADDRESS ] );
@@ -297,7 +308,7 @@ void CKernelFM::FIQHandler (void *pParam)
 	}
 
 	// freeze
-	if ( BUTTON_PRESSED && ( fm.lastFreezeButton == 0 ) )
+	if ( SNAPSHOT_FREEZE_BUTTON && ( fm.lastFreezeButton == 0 ) )
 	{
 		fm.lastFreezeButton = 500000; // debouncing
 		CLR_GPIO( bNMI | bCTRL257 ); 
@@ -29,6 +29,7 @@
 */
 
 #include "kernel_kcs.h"
+#include "snapshot.h"
 
 // we will read this .CRT file 
 static const char DRIVE[] = "SD:";
@@ -113,6 +114,7 @@ static void initKCS()
 __attribute__( ( always_inline ) ) inline void callbackReset()
 {
 	initKCS();
+	snapshotReset();
 	latchSetClearImm( LATCH_LED0, 0 );
 }
 
@@ -209,6 +211,10 @@ void CKernelKCS::Run( void )
 	}
 	#endif
 
+	// freezer snapshots: register, RAM and state of the KCS
+	snapshotInit( "kcs" );
+	snapshotAddSection( (void*)&kcs, offsetof( KCSSTATE, resetCounter ) );
+
 	// setup FIQ
 	DisableIRQs();
 	m_InputPin.ConnectInterrupt( FIQ_HANDLER, FIQ_PARENT );
@@ -256,6 +262,8 @@ void CKernelKCS::Run( void )
 		if ( kcs.resetCounter > 30 && kcs.resetReleased )
 			callbackReset();
 
+		snapshotUpdate();
+
 		asm volatile ("wfi");
 	}
 
@@ -298,6 +306,8 @@ void CKernelKCS::FIQHandler (void *pParam)
 
 	UPDATE_COUNTERS( kcs.c64CycleCount, kcs.resetCounter, kcs.resetPressed, kcs.resetReleased, kcs.cyclesSinceReset )
 
+	SNAPSHOT_FIQ( )
+
 	if ( kcs.hasKernal && ROMH_ACCESS && KERNAL_ACCESS && !kcs.ultimax )
 	{
 		WRITE_D0to7_TO_BUS( kernalROM[ GET_ADDRESS ] );
@@ -369,7 +379,7 @@ void CKernelKCS::FIQHandler (void *pParam)
 	}
 
 	// freeze
-	if ( BUTTON_PRESSED && ( kcs.lastFreezeButton == 0 ) )
+	if ( SNAPSHOT_FREEZE_BUTTON && ( kcs.lastFreezeButton == 0 ) )
 	{
 		kcs.lastFreezeButton = 500000; // debouncing
 		kcs.freezeNMICycles  = 10;
@@ -33,6 +33,10 @@
 #include "config.h"
 #include "c64screen.h"
 #include "charlogo.h"
+#include "animation_delta.h"
+#include "screen_bitmap.h"
+#include "menusched.h"
+#include "hdmidma.h"
 
 #include <math.h>
 
@@ -62,6 +66,8 @@ unsigned char *animationRLE;
 unsigned char *bitflagsRLE;
 u32 *animationState;
 u32 *animationStateInitial;
+// delta-compressed animation (animation_delta.h): container in animationRLE, current frame in animationState
+bool animationDelta;
 
 
 static u32	disableCart     = 0;
@@ -484,6 +490,14 @@ boolean CKernelMenu::Initialize( void )
 			readFile( logger, (char*)DRIVE, (char*)"SD:C64/animation.zap", tempX, &size ); 
 		} 
 
+		animationDelta = false;
+		if ( showAnimation && skAnimValid( tempX, size, 128 * 1024 - 8 ) )
+		{
+			animationDelta = true;
+			memcpy( animationRLE, tempX, size );
+			skAnimInit();
+			skAnimSeek( animationRLE, (u8*)animationState, 0 );
+		} else
 		if ( showAnimation )
 		{
 			u8 *temp = &tempX[ 0 ];
@@ -535,17 +549,12 @@ boolean CKernelMenu::Initialize( void )
 
 #ifdef HDMI_SOUND
 	hdmiSoundAvailable = 1;
-	hdmiSoundDevice = new CHDMISoundBaseDevice( 48000 );
-	if ( hdmiSoundDevice )
+	hdmiSoundDevice = hdmiDMAStart( &m_Interrupt, 48000 );
+	if ( hdmiSoundDevice == NULL )
 	{
-		hdmiSoundDevice->SetWriteFormat( SoundFormatSigned24, 2 );
-		if (!hdmiSoundDevice->Start ())
-		{
-			m_Logger.Write ("SK64", LogPanic, "Cannot start sound device");
-			hdmiSoundAvailable = 0;
-		}
-	} else
+		m_Logger.Write ("SK64", LogPanic, "Cannot start sound device");
 		hdmiSoundAvailable = 0;
+	}
 #endif
 
 	applySIDSettings();
@@ -647,41 +656,8 @@ unsigned char framebuffer[ 320 * 200 / 8 ];
 
 void convertScreenToBitmap( unsigned char *framebuffer )
 {
-	u32 columns = 40; 
-	u32 rows = 25;
-
-	memset( framebuffer, 0, 320 * 200 / 8 );
-
-	for ( u32 j = 8; j < rows; j++ )
-	{
-		for ( u32 i = 1; i < columns-1; i++ )
-		{
-			unsigned char c = c64screen[ i + j * 40 ];
-			int x = i * 8;
-			int y = j * 8;
-
-			if ( c != 32 && c != ( 32 + 128 ) )
-			for ( int b = 0; b < 8; b++ )
-			{
-				extern u8 c64screenUppercase;
-				unsigned char v = charset[ 2048 - c64screenUppercase * 2048 + c * 8 + b ];
-
-				u32 *p = (u32*)&framebuffer[ ( x / 8 - 1 ) + ( b + y ) * 320 / 8 ];
-				u32 m2 = ( (u32)v ) << 8;
-				m2 &= 0xff00;
-				u32 m = m2;
-				u8 *d = (u8*)&m;
-				d[ 1 ] = v;
-				d[ 0 ] = v >> 7;
-				d[ 1 ] |= v << 1;
-				d[ 1 ] |= v >> 1;
-				d[ 2 ] = ( v << 7 ) & 128;
-				*p |= m;
-				*( p + 320 / 8 / 4 ) |= m;
-				*( p - 320 / 8 / 4 ) |= m;
-			}
-		}
-	}
+	extern u8 c64screenUppercase;
+	screenToBitmapDilated( framebuffer, c64screen, &charset[ 2048 - c64screenUppercase * 2048 ] );
 }
 
 // all this is used for rendering the menu
@@ -697,6 +673,77 @@ static int ctn = 0;
 static u32 menuSpeedCodeLength = 0;
 static u32 menuSpeedCodeMaxLength = 0x800;
 
+//
+// speedcode for the screen transfer: instead of emitting LDA/STA in screen order (reloading whenever the value changes),
+// the changed cells are grouped by value such that every value is loaded only once. Color RAM only uses the lower nibble,
+// so a color cell can also be written by any group with a matching lower nibble. The stores are scheduled against a
+// 6502 cycle budget (indexed stores/loops would save code bytes, but cost more cycles per cell than unrolled absolute stores)
+//
+#define SPEEDCODE_CYCLES_LDA	2		// LDA #imm
+#define SPEEDCODE_CYCLES_STA	4		// STA abs
+#define SPEEDCODE_MAX_STORES	2048	// screen + color RAM
+
+static u16 speedCodeGroupFirst[ 256 ], speedCodeGroupLast[ 256 ];
+static u16 speedCodeStoreAddr[ SPEEDCODE_MAX_STORES ], speedCodeStoreNext[ SPEEDCODE_MAX_STORES ];
+static u8  speedCodeGroupOrder[ 256 ];
+static u32 speedCodeNGroups, speedCodeNStores, speedCodeCycles;
+
+static void speedCodeReset()
+{
+	memset( speedCodeGroupFirst, 0xff, sizeof( speedCodeGroupFirst ) );
+	speedCodeNGroups = speedCodeNStores = speedCodeCycles = 0;
+}
+
+// returns the value (= group) which can be used to store 'v', or -1 if a new group is required
+static int speedCodeFindGroup( u8 v, bool colorRAM )
+{
+	if ( speedCodeGroupFirst[ v ] != 0xffff )
+		return v;
+
+	if ( colorRAM )
+		for ( u32 h = 0; h < 256; h += 16 )
+			if ( speedCodeGroupFirst[ h | ( v & 15 ) ] != 0xffff )
+				return h | ( v & 15 );
+
+	return -1;
+}
+
+static u32 speedCodeCost( u8 v, bool colorRAM )
+{
+	return SPEEDCODE_CYCLES_STA + ( speedCodeFindGroup( v, colorRAM ) < 0 ? SPEEDCODE_CYCLES_LDA : 0 );
+}
+
+static void speedCodeAddStore( u8 v, bool colorRAM, u16 addr )
+{
+	int g = speedCodeFindGroup( v, colorRAM );
+
+	speedCodeCycles += SPEEDCODE_CYCLES_STA;
+	if ( g < 0 )
+	{
+		g = v;
+		speedCodeGroupFirst[ g ] = speedCodeNStores;
+		speedCodeGroupOrder[ speedCodeNGroups ++ ] = g;
+		speedCodeCycles += SPEEDCODE_CYCLES_LDA;
+	} else
+		speedCodeStoreNext[ speedCodeGroupLast[ g ] ] = speedCodeNStores;
+
+	speedCodeGroupLast[ g ] = speedCodeNStores;
+	speedCodeStoreAddr[ speedCodeNStores ] = addr;
+	speedCodeStoreNext[ speedCodeNStores ] = 0xffff;
+	speedCodeNStores ++;
+}
+
+static void speedCodeEmit( u32 &curAddr )
+{
+	for ( u32 i = 0; i < speedCodeNGroups; i++ )
+	{
+		u8 v = speedCodeGroupOrder[ i ];
+		LDA( v );
+		for ( u32 s = speedCodeGroupFirst[ v ]; s != 0xffff; s = speedCodeStoreNext[ s ] )
+			STA( speedCodeStoreAddr[ s ] );
+	}
+}
+
 u32 freezeNMICycles = 0, countWrites = 0, readyForNMIs = 0;
 
 static unsigned char c64screenPrev[ 1024 ], c64colorPrev[ 1024 ];
@@ -832,6 +879,14 @@ void CKernelMenu::Run( void )
 	toggleVDCMode = true;
 	disableFIQ_Falling = 0;
 
+	// the work for one screen update (see menusched.h), key handling and speedcode generation are never deferred
+	const u32 taskInput     = menuSchedAddTask( "input", 0, 1000, 0 );
+	const u32 taskSpeedCode = menuSchedAddTask( "speedcode", 0, 1000, 0 );
+	const u32 taskAnimation = menuSchedAddTask( "animation", 1, 2000, 4 );
+	const u32 taskLogo      = menuSchedAddTask( "tft logo", 2, 20000, 10 );
+	if ( taskInput == MENUSCHED_NO_TASK || taskSpeedCode == MENUSCHED_NO_TASK || taskAnimation == MENUSCHED_NO_TASK || taskLogo == MENUSCHED_NO_TASK )
+		logger->Write( "RaspiMenu", LogError, "menu scheduler: too many tasks, some run unscheduled" );
+
 	// wait forever
 	while ( true )
 	{
@@ -867,6 +922,7 @@ void CKernelMenu::Run( void )
 			m_InputPin.DisableInterrupt2();
 			m_InputPin.DisconnectInterrupt();
 			EnableIRQs();
+			menuSchedLogStats( logger );
 			return;
 		}
 
@@ -896,6 +952,13 @@ void CKernelMenu::Run( void )
 			u32 tempTimeOut = menuUpdateTimeOut;
 			menuUpdateTimeOut = 1024 * 1024 * 1024;
 
+			bool wantLogo = updateLogo == 1 && screenType == 1 && modeC128;
+			bool wantAnimation = showAnimation && currentVDCMode < 2;
+			menuSchedBeginFrame( ( modePALNTSC == 1 || modePALNTSC == 2 ) ? MENUSCHED_BUDGET_NTSC : MENUSCHED_BUDGET_PAL,
+				MENUSCHED_TASK_BIT( taskInput ) | MENUSCHED_TASK_BIT( taskSpeedCode ) | ( wantAnimation ? MENUSCHED_TASK_BIT( taskAnimation ) : 0 ) | ( wantLogo ? MENUSCHED_TASK_BIT( taskLogo ) : 0 ) );
+
+			menuSchedBegin( taskInput );
+
 			static int swapColorProfile = 0;
 
 			//
@@ -1029,13 +1092,14 @@ void CKernelMenu::Run( void )
 			if ( wireSIDGotLow && wireSIDGotHigh )
 				wireSIDAvailable = 1;
 
-			if ( updateLogo == 1 && screenType == 1 && modeC128 )
+			if ( wantLogo && menuSchedBegin( taskLogo ) )
 			{
 				updateLogo = 2;
 				memcpy( tftBackground, tftC128Logo, 240 * 240 * 2 );
 				flush4BitBuffer( true );
 				tftCopyBackground2Framebuffer();
 				tftSendFramebuffer16BitImm( tftFrameBuffer );
+				menuSchedEnd( taskLogo );
 			}
 
 			startForC128 = 0;
@@ -1081,10 +1145,13 @@ void CKernelMenu::Run( void )
 				}
 			}
 
-			convertScreenToBitmap( framebuffer );
+			menuSchedEnd( taskInput );
 
-			if ( showAnimation && currentVDCMode < 2 )
+			// if deferred, the background animation pauses for one update
+			if ( wantAnimation && menuSchedBegin( taskAnimation ) )
 			{
+				convertScreenToBitmap( framebuffer );
+
 				ctn++;
 				if ( currentVDCMode == 1 )
 				{
@@ -1096,10 +1163,13 @@ void CKernelMenu::Run( void )
 						#include "render_sprite_animation.h"
 					}
 				}
+				menuSchedEnd( taskAnimation );
 			}
 
 			lastChar = 0;
 
+			menuSchedBegin( taskSpeedCode );
+
 			if ( modePALNTSC == 1 || modePALNTSC == 2 )
 				menuSpeedCodeMaxLength = 0x780; else
 				menuSpeedCodeMaxLength = 0x800;
@@ -1216,6 +1286,10 @@ void CKernelMenu::Run( void )
 
 			int nBytesToTransfer = 1000;
 
+			// the speedcode length limit corresponds to a budget of unrolled stores (3 bytes, 4 cycles each)
+			u32 speedCodeMaxCycles = ( menuSpeedCodeMaxLength - 10 ) / 3 * SPEEDCODE_CYCLES_STA;
+			speedCodeReset();
+
 			if ( currentVDCMode == 2 )
 			{
 				for ( int j = 0; j < 25; j++ )
@@ -1253,34 +1327,27 @@ void CKernelMenu::Run( void )
 				u8 byteA = c64screen[ curOfs ];
 				u8 byteX = c64color[ curOfs ];
 
+				u32 cost = 0;
+				if ( byteA != c64screenPrev[ curOfs ] ) cost += speedCodeCost( byteA, false );
+				if ( byteX != c64colorPrev[ curOfs ] ) cost += speedCodeCost( byteX, true );
+
+				if ( speedCodeCycles + cost > speedCodeMaxCycles )
+					goto cantCopyEverythingThisTimeText;
+
 				if ( byteA != c64screenPrev[ curOfs ] )
 				{
 					c64screenPrev[ curOfs ] = byteA;
-					if ( byteA != curValA )
-					{
-						curValA = byteA;
-						LDA( byteA );
-					}
-					STA( 0x400 + curOfs );
-
+					speedCodeAddStore( byteA, false, 0x400 + curOfs );
 					vdcDirtyFlags[ curOfs / 40 ] = 1;
 				}
 
 				if ( byteX != c64colorPrev[ curOfs ] )
 				{
 					c64colorPrev[ curOfs ] = byteX;
-					if ( byteX != curValX )
-					{
-						curValX = byteX;
-						LDX( byteX );
-					}
-					STX( 0xd800 + curOfs );
+					speedCodeAddStore( byteX, true, 0xd800 + curOfs );
 					vdcDirtyFlags[ 25 + curOfs / 40 ] = 1;
 				}
 
-				if ( curAddr >= 0x2000 + menuSpeedCodeMaxLength - 10 )
-					goto cantCopyEverythingThisTimeText;
-
 				curOfs += ofsIncr;
 				if ( curOfs >= 1000 )
 				{
@@ -1296,6 +1363,9 @@ void CKernelMenu::Run( void )
 		cantCopyEverythingThisTimeText:
 			lastCurOfsText = curOfs;
 
+			speedCodeEmit( curAddr );
+			curValA = curValX = 0xffff;
+
 			extern u32 showLogo;
 			static u32 showLogoPrev = 0xffffffff;
 
@@ -1584,6 +1654,8 @@ void CKernelMenu::Run( void )
 			RTS
 			endOfBankAddress = curAddr - 1; 
 
+			menuSchedEnd( taskSpeedCode );
+
 			sk64Command = 0xfe;
 
 			SyncDataAndInstructionCache();
@@ -29,6 +29,7 @@
 */
 
 #include "kernel_menu20.h"
+#include "hdmidma.h"
 #include "dirscan.h"
 #include "disk_emulation.h"
 #include "config.h"
@@ -741,9 +742,8 @@ boolean CKernelMenu::Initialize( void )
 #ifdef HDMI_SOUND
 	if ( cfgVIC_Emulation )
 	{
-		hdmiSoundDevice = new CHDMISoundBaseDevice( SAMPLERATE );
-		hdmiSoundDevice->SetWriteFormat( SoundFormatSigned24, 1 );
-		if ( !hdmiSoundDevice->Start() )
+		hdmiSoundDevice = hdmiDMAStart( &m_Interrupt, SAMPLERATE );
+		if ( hdmiSoundDevice == NULL )
 		{
 			cfgVIC_Emulation = 0;
 		}
@@ -812,7 +812,7 @@ static bool saveFileToSD( CLogger *logger, char *vic20Filename, u8 *data, u32 si
 
 static u8 ledActivityBrightness1 = 0;
 static u8 ledActivityBrightness2 = 0;
-static u32 hdmiSampleData;
+static s32 hdmiSampleData;
 
 static u8 visMode = 0;
 static u8 osciX = 0;			
@@ -925,7 +925,7 @@ void CKernelMenu::Run( void )
 			if ( vic656x.hasSampleOutput )
 			{
 				register s32 s = (s32)( vic656x.curSampleOutput ) << 7;
-				hdmiSampleData = hdmiSoundDevice->ConvertSample( s );
+				hdmiSampleData = s;
 			}
 		}
 
@@ -1422,12 +1422,7 @@ void CKernelMenu::FIQHandler (void *pParam)
 		if ( cfgVIC_Emulation && vic656x.hasSampleOutput )
 		{
 			// sound output
-			//if ( hdmiSoundDevice->IsWritable() )
-			if ( !( read32( RegMaiControl ) & BitMaiControlFull ) )
-			{
-				write32( RegMaiData, hdmiSampleData );
-				write32( RegMaiData, hdmiSampleData );
-			}
+			hdmiDMAPutSample( hdmiSampleData, hdmiSampleData );
 			vic656x.hasSampleOutput = 0;
 		}		
 	}
@@ -1770,11 +1765,7 @@ void CKernelMenu::FIQHandler (void *pParam)
 		// sound output
 		if ( cfgVIC_Emulation && vic656x.hasSampleOutput )
 		{
-			if ( !( read32( RegMaiControl ) & BitMaiControlFull ) )
-			{
-				write32( RegMaiData, hdmiSampleData );
-				write32( RegMaiData, hdmiSampleData );
-			}
+			hdmiDMAPutSample( hdmiSampleData, hdmiSampleData );
 
 			vic656x.hasSampleOutput = 0;
 		}		
@@ -33,6 +33,7 @@
 #include "config.h"
 #include "264screen.h"
 #include "charlogo.h"
+#include "hdmidma.h"
 
 // we will read these files
 static const char DRIVE[] = "SD:";
@@ -382,19 +383,14 @@ boolean CKernelMenu::Initialize( void )
 	readSettingsFile();
 
 #ifdef HDMI_SOUND
+	// DMA driven device, its buffers are refilled in an IRQ (which therefore needs to stay enabled while sound is on)
 	hdmiSoundAvailable = 1;
-	hdmiSoundDevice = new CHDMISoundBaseDevice( 48000 );
-	if ( hdmiSoundDevice )
+	hdmiSoundDevice = hdmiDMAStart( &m_Interrupt, 48000 );
+	if ( hdmiSoundDevice == NULL )
 	{
-		hdmiSoundDevice->SetWriteFormat( SoundFormatSigned24, 2 );
-		if (!hdmiSoundDevice->Start ())
-		{
-			//m_Logger.Write ("SK264", LogPanic, "Cannot start sound device");
-			hdmiSoundAvailable = 0;
-		} else
-			hdmiSoundDevice->Cancel();		
-	} else
+		//m_Logger.Write ("SK264", LogPanic, "Cannot start sound device");
 		hdmiSoundAvailable = 0;
+	}
 #endif
 
 	applySIDSettings();
@@ -461,8 +457,11 @@ void CKernelMenu::Run( void )
 		tftSendFramebuffer16BitImm( tftFrameBuffer );
 	}
 
-	if ( hdmiSoundDevice )
-		hdmiSoundDevice->Start();
+#ifdef HDMI_SOUND
+	// restart after returning from a kernel without sound output
+	if ( hdmiSoundAvailable && hdmiSoundDevice == NULL )
+		hdmiSoundDevice = hdmiDMAStart( &m_Interrupt, 48000 );
+#endif
 
 	if ( !disableCart )
 	{
@@ -479,6 +478,9 @@ void CKernelMenu::Run( void )
 		warmCache( (void*)this->FIQHandler );
 		warmCache( (void*)this->FIQHandler );
 
+		// the HDMI DMA takes its chunks in an IRQ (as in kernel_menu)
+		EnableIRQs();
+
 		// start c64 
 		DELAY(1<<10);
 		latchSetClearImm( LATCH_RESET, 0 );
@@ -718,6 +720,15 @@ int main( void )
 		{
 			reboot (); 	
 		} else*/
+#ifdef HDMI_SOUND
+		// only the SID kernel outputs sound (through the same device), stop the DMA for all others
+		if ( !( launchKernel == 8 || ( ( launchKernel == 4 || launchKernel == 40 ) && subSID ) ) )
+		{
+			hdmiDMAStop( hdmiSoundDevice );
+			hdmiSoundDevice = NULL;
+		}
+#endif
+
 		switch ( launchKernel )
 		{
 		case 3:
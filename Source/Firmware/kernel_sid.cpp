@@ -30,6 +30,7 @@
 */
 #include <math.h>
 #include "kernel_sid.h"
+#include "audiograph.h"
 #ifdef COMPILE_MENU
 #include "kernel_menu.h"
 #include "launch.h"
@@ -156,25 +157,10 @@ void setSIDConfiguration( u32 mode, u32 sid1, u32 sid2, u32 sid2addr, u32 rr, u3
 	SID_DigiBoost[ 1 ] = ( sid2 == 2 ) ? 1 : 0;
 
 	// panning = 0 .. 14, vol = 0 .. 15
-	// volumes -> 0 .. 255
-	cfgVolSID1_Left  = v1 * ( 14 - p1 );
-	cfgVolSID1_Right = v1 * ( p1 );
-	cfgVolSID2_Left  = v2 * ( 14 - p2 );
-	cfgVolSID2_Right = v2 * ( p2 );
-	cfgVolOPL_Left  = v3 * ( 14 - p3 );
-	cfgVolOPL_Right = v3 * ( p3 );
-
-	if ( outputPWMHDMI == 0 || outputPWMHDMI == 2 )
-	{
-		int maxVolFactor = max( cfgVolSID1_Left, max( cfgVolSID1_Right, max( cfgVolSID2_Left, max( cfgVolSID2_Right, max( cfgVolOPL_Left, cfgVolOPL_Right ) ) ) ) );
-
-		cfgVolSID1_Left  = cfgVolSID1_Left  * 256 / maxVolFactor;
-		cfgVolSID1_Right = cfgVolSID1_Right * 256 / maxVolFactor;
-		cfgVolSID2_Left  = cfgVolSID2_Left  * 256 / maxVolFactor;
-		cfgVolSID2_Right = cfgVolSID2_Right * 256 / maxVolFactor;
-		cfgVolOPL_Left   = cfgVolOPL_Left   * 256 / maxVolFactor;
-		cfgVolOPL_Right  = cfgVolOPL_Right  * 256 / maxVolFactor;
-	}
+	// volumes -> 0 .. 210 (normalized by the audio graph for PWM output)
+	audioGraphVolPan( v1, p1, 210, &cfgVolSID1_Left, &cfgVolSID1_Right );
+	audioGraphVolPan( v2, p2, 210, &cfgVolSID2_Left, &cfgVolSID2_Right );
+	audioGraphVolPan( v3, p3, 210, &cfgVolOPL_Left, &cfgVolOPL_Right );
 
 	if ( sid2 == 3 ) 
 	{ 
@@ -267,6 +253,7 @@ void initSID()
 	{
 		pOPL = ym3812_init( 3579545, SAMPLERATE );
 		ym3812_reset_chip( pOPL );
+		fmOutRegister = encodeGPIO( ym3812_read( pOPL, 0 ) );
 		hack_OPL_Sample_Value[ 0 ] = hack_OPL_Sample_Value[ 1 ] = 0;
 		hack_OPL_Sample_Enabled = 0;
 		fmFakeOutput = 0;
@@ -348,14 +335,21 @@ boolean CKernel::Initialize( void )
 }
 #endif
 
+#ifdef SUPPORT_MIDI
+static void midiReset();
+#endif
+
 void quitSID()
 {
+	pwmDMAStop();
+
 	for ( int i = 0; i < NUM_SIDS; i++ )
 		delete sid[ i ];
 
 #ifdef SUPPORT_MIDI
 	if ( TinySoundFont )
 		tsf_close( TinySoundFont );
+	TinySoundFont = NULL;
 #endif
 }
 
@@ -414,6 +408,7 @@ static void prepareOnReset( bool refresh = false )
 #ifdef SUPPORT_MIDI
 	if ( TinySoundFont )
 		tsf_reset( TinySoundFont );
+	midiReset();
 #endif
 
 	fmFakeOutput =
@@ -476,14 +471,290 @@ u32 fillSoundBuffer;
 
 #ifdef SUPPORT_MIDI
 
-#define MIDI_BUF_SIZE_BITS	5
-const int midiBufferSize = 1 << MIDI_BUF_SIZE_BITS;
-static float midiSampleBuffer[ 1 << (MIDI_BUF_SIZE_BITS) ] AAA;
-static u32 midiBufferOfs = midiBufferSize;
+//
+// tsf renders in larger blocks than the audio graph, such that the voice renderer works on long runs
+// and the SID emulation is interrupted less often. MIDI messages are queued with their sample time and
+// applied when the block containing them is rendered, i.e. the timing is exact, with a constant latency of one block
+//
+#define MIDI_RENDER_BLOCK	256			// samples, multiple of AUDIO_BLOCK_SIZE
+#define MIDI_MAX_VOICES		128
+#define MIDI_QUEUE_SIZE		1024		// power of 2
+
+static float midiSampleBuffer[ MIDI_RENDER_BLOCK ] AAA;
+static u32 midiSamplePos;				// next sample of midiSampleBuffer to output
+static u32 midiTime;					// sample time of the audio graph block which is currently filled
+static u32 midiRenderedTime;			// tsf has rendered everything before this sample time
+
+static u32 midiQueue[ MIDI_QUEUE_SIZE ];
+static u32 midiQueueTime[ MIDI_QUEUE_SIZE ];
+static u32 midiQueueRead, midiQueueWrite;
+static u32 midiQueuePrefetch;			// queued messages before this one have been looked at by midiServiceSampleCache
+
+static void midiReset()
+{
+	memset( midiSampleBuffer, 0, MIDI_RENDER_BLOCK * sizeof( float ) );
+	midiSamplePos = 0;
+	midiTime = midiRenderedTime = 0;
+	midiQueueRead = midiQueueWrite = midiQueuePrefetch = 0;
+}
+
+static void midiApplyMessage( u32 ev )
+{
+	register u8 MC = ev & 255;
+	register u8 MD1 = ( ev >> 8 ) & 255;
+	register u8 MD2 = ( ev >> 16 ) & 255;
+	register u16 pitch;
+
+	register u8 channel = MC & 0x0f;
+	MC &= 0xf0;
+
+	switch ( MC )
+	{
+	default:
+		break;
+	case 0x90: // note on
+		tsf_channel_note_on( TinySoundFont, channel, MD1, (float)MD2 / 127.0f ); 
+		break;
+	case 0x80: // note off
+		tsf_channel_note_off( TinySoundFont, channel, MD1 ); 
+		break;
+	case 0xc0: // program change
+		tsf_channel_set_presetnumber( TinySoundFont, channel, MD1, ( channel == 9 ) );
+		break;
+	/*case 0xd0: // pressure change
+		break;*/
+	case 0xe0: // pitch bend
+		pitch = MD1 | ( MD2 << 7 );
+		tsf_channel_set_pitchwheel( TinySoundFont, channel, pitch );
+		break;
+	case 0xb0: // control change
+		tsf_channel_midi_control( TinySoundFont, channel, MD1, MD2 );
+		break;
+	}		
+}
+
+static __attribute__( ( always_inline ) ) inline void midiQueueMessage( u32 ev )
+{
+	u32 next = ( midiQueueWrite + 1 ) & ( MIDI_QUEUE_SIZE - 1 );
+	if ( next == midiQueueRead )
+	{
+		// queue full, better slightly off than lost
+		midiApplyMessage( ev );
+		return;
+	}
+	midiQueue[ midiQueueWrite ] = ev;
+	midiQueueTime[ midiQueueWrite ] = midiTime + audioGraph.pos;
+	midiQueueWrite = next;
+}
+
+// renders the next MIDI_RENDER_BLOCK samples, split at the queued messages
+static void midiRenderBlock( tsf *t )
+{
+	u32 pos = 0;
+
+	while ( midiQueueRead != midiQueueWrite )
+	{
+		s32 ofs = (s32)( midiQueueTime[ midiQueueRead ] - midiRenderedTime );
+		if ( ofs >= MIDI_RENDER_BLOCK )
+			break;
+
+		if ( ofs > (s32)pos )
+		{
+			tsf_render_float( t, &midiSampleBuffer[ pos ], ofs - pos, 0 );
+			pos = ofs;
+		}
+
+		midiApplyMessage( midiQueue[ midiQueueRead ] );
+		midiQueueRead = ( midiQueueRead + 1 ) & ( MIDI_QUEUE_SIZE - 1 );
+	}
+
+	if ( pos < MIDI_RENDER_BLOCK )
+		tsf_render_float( t, &midiSampleBuffer[ pos ], MIDI_RENDER_BLOCK - pos, 0 );
+
+	midiRenderedTime += MIDI_RENDER_BLOCK;
+}
+
+// pull source for the audio graph: outputs the last rendered block, renders the next one when it has been used up
+static void renderMIDI( void *param, s32 *dst, u32 nSamples )
+{
+	for ( u32 i = 0; i < nSamples; i++ )
+	{
+		if ( midiSamplePos == MIDI_RENDER_BLOCK )
+		{
+			midiRenderBlock( (tsf*)param );
+			midiSamplePos = 0;
+		}
+
+		// tsf mixes into the buffer
+		s32 v = midiSampleBuffer[ midiSamplePos ] * 32767.0f;
+		midiSampleBuffer[ midiSamplePos ++ ] = 0.0f;
+		dst[ i ] = max( -31768+2, min( 31767-2, v ) );
+	}
+	midiTime += nSamples;
+}
+
+// called from the main loop, never while rendering: the sample pages of queued note-ons are requested (the messages
+// are applied one block later, usually the pages are there by then), then one page is read from the SD card
+static void midiServiceSampleCache( tsf *t )
+{
+	// messages which have been applied in the meantime need no prefetch anymore
+	if ( ( ( midiQueuePrefetch - midiQueueRead ) & ( MIDI_QUEUE_SIZE - 1 ) ) > ( ( midiQueueWrite - midiQueueRead ) & ( MIDI_QUEUE_SIZE - 1 ) ) )
+		midiQueuePrefetch = midiQueueRead;
+
+	while ( midiQueuePrefetch != midiQueueWrite )
+	{
+		u32 ev = midiQueue[ midiQueuePrefetch ];
+		if ( ( ev & 0xf0 ) == 0x90 )
+			tsf_channel_note_prefetch( t, ev & 0x0f, ( ev >> 8 ) & 255, (float)( ( ev >> 16 ) & 255 ) / 127.0f );
+		midiQueuePrefetch = ( midiQueuePrefetch + 1 ) & ( MIDI_QUEUE_SIZE - 1 );
+	}
+
+	tsf_cache_service( t, 1 );
+}
+
+//
+// the sound font stays on the SD card: tsf only loads presets and regions, sample data is paged into
+// an LRU cache from the main loop (see midiServiceSampleCache), the renderer plays silence for missing pages
+//
+#define MIDI_SAMPLE_CACHE_SIZE	( 24 * 1024 * 1024 )
+
+// the file is accessed through the file system session (see helpers.h): the handle is looked up by name on each access
+// (it survives as long as it is among the recently used ones, and is reopened transparently otherwise), seeking uses the
+// cluster link map instead of following the FAT, and the small reads when parsing the presets are served by the read-ahead
+static char midiSoundFontFilename[ 256 ];
+static u32 midiSoundFontPos;
+
+// random access for the sample cache
+static int midiSoundFontReadAt( void *data, unsigned int offset, void *ptr, unsigned int size )
+{
+	FS_FILE *f = fsOpen( midiSoundFontFilename );
+	if ( f == NULL )
+		return 0;
+	return fsRead( f, offset, ptr, size );
+}
+
+// sequential reading when parsing the presets
+static int midiSoundFontRead( void *data, void *ptr, unsigned int size )
+{
+	u32 n = midiSoundFontReadAt( data, midiSoundFontPos, ptr, size );
+	midiSoundFontPos += n;
+	return n;
+}
+
+static int midiSoundFontSkip( void *data, unsigned int count )
+{
+	FS_FILE *f = fsOpen( midiSoundFontFilename );
+	if ( f == NULL || midiSoundFontPos + count > fsFileSize( f ) )
+		return 0;
+	midiSoundFontPos += count;
+	return 1;
+}
+
+static tsf *midiLoadSoundFont( const char *filename )
+{
+	strcpy( midiSoundFontFilename, filename );
+	if ( fsMount( DRIVE ) != FR_OK || fsOpen( midiSoundFontFilename ) == NULL )
+		return NULL;
+
+	midiSoundFontPos = 0;
+	struct tsf_stream stream = { NULL, midiSoundFontRead, midiSoundFontSkip };
+	return tsf_load_streaming( &stream, midiSoundFontReadAt, NULL, MIDI_SAMPLE_CACHE_SIZE );
+}
+
+#endif
 
+#ifdef EMULATE_OPL2
+// pull source for the audio graph: FM is rendered block-wise up to the next register write
+static void renderOPL( void *param, s32 *dst, u32 nSamples )
+{
+	if ( cfgEmulateOPL2 )
+		ym3812_render_block( pOPL, dst, nSamples ); else
+		memset( dst, 0, nSamples * sizeof( s32 ) );
+
+	if ( hack_OPL_Sample_Enabled )
+		for ( u32 i = 0; i < nSamples; i++ )
+			dst[ i ] = ( hack_OPL_Sample_Value[ 0 ] << 5 ) + ( hack_OPL_Sample_Value[ 1 ] << 5 );
+}
+#endif
+
+// sources of the audio graph
+#define AUDIO_SRC_SID1		0
+#define AUDIO_SRC_SID2		1
+#define AUDIO_SRC_OPL		2
+#define AUDIO_SRC_MIDI		3
+
+//
+// register writes (and MIDI messages) are applied in the order of their timestamps:
+// writes to the SIDs need to be applied at their exact cycle, i.e. the SIDs are clocked precisely up to the next SID write,
+// whereas FM (rendered once per sample) and MIDI (queued with its sample time) only need to be sample-accurate
+// and thus do not split the SID emulation into shorter slices
+//
+static __attribute__( ( always_inline ) ) inline u32 isSIDRegisterWrite( u32 ev )
+{
+#ifdef SUPPORT_MIDI
+	if ( cfgMIDI && ( ev & (1<<31) ) ) return 0;
+#endif
+#ifdef EMULATE_OPL2
+	if ( cfgEmulateOPL2 && ( ev & bIO2 ) ) return 0;
 #endif
+	return 1;
+}
 
-static int first = 1;
+static void applyRegisterWrite( u32 ev )
+{
+#ifdef SUPPORT_MIDI
+	if ( cfgMIDI && (ev & (1<<31)) ) // MIDI
+	{
+		midiQueueMessage( ev );
+	} else
+#endif
+	{
+		unsigned char A, D;
+		decodeGPIO( ev, &A, &D );
+
+		#ifdef EMULATE_OPL2
+		if ( cfgEmulateOPL2 && (ev & bIO2) )
+		{
+			audioGraphRenderUpTo( AUDIO_SRC_OPL );
+
+			if ( ( ( A & ( 1 << 4 ) ) == 0 ) )
+			{
+				ym3812_write( pOPL, 0, D ); 
+			} else
+			{
+				ym3812_write( pOPL, 1, D );
+				if ( pOPL->address == 1 )
+				{
+					if ( D == 4 ) // enable digi hack
+						hack_OPL_Sample_Enabled = 1;  else
+						hack_OPL_Sample_Enabled = 0;
+				}
+				if ( hack_OPL_Sample_Enabled && ( pOPL->address == 0xa0 || pOPL->address == 0xa1 ) ) // digi hack
+					hack_OPL_Sample_Value[ pOPL->address - 0xa0 ] = D; else
+					hack_OPL_Sample_Value[ 0 ] = hack_OPL_Sample_Value[ 1 ] = 0;
+			}
+
+			// the timers are not emulated, i.e. the status only changes with register writes and is up to date right away
+			fmOutRegister = encodeGPIO( ym3812_read( pOPL, 0 ) );
+		} else
+		#endif
+		//#if !defined(SID2_DISABLED) && !defined(SID2_PLAY_SAME_AS_SID1)
+		// TODO: generic masks
+		if ( !cfgSID2_Disabled && !cfgSID2_PlaySameAsSID1 && (ev & SID2_MASK) )
+		{
+			sid[ 1 ]->write( A & 31, D );
+		} else
+		//#endif
+		{
+			sid[ 0 ]->write( A & 31, D );
+			//outRegisters[ A & 31 ] = D;
+			//#if !defined(SID2_DISABLED) && defined(SID2_PLAY_SAME_AS_SID1)
+			if ( !cfgSID2_Disabled && cfgSID2_PlaySameAsSID1 )
+				sid[ 1 ]->write( A & 31, D );
+			//#endif
+		}
+	}
+}
 
 
 #ifdef COMPILE_MENU
@@ -608,39 +879,55 @@ startHereAfterReset:
 #ifdef SUPPORT_MIDI
 	if ( cfgMIDI )
 	{
-		u32 size;
 		cfgMIDI = 0;
 		char filename[256];
 		sprintf( filename, "SD:MIDI/instrument%02d.sf2", cfgSoundFont );
-		if ( getFileSize( logger, DRIVE, filename, &size ) )
-		{
-			if ( size < 256 * 1024 * 1024 )
-			{
-				u8 *soundfont = new u8[ size ];
 
-				if ( readFile( logger, DRIVE, filename, soundfont, &size ) )
-				{
-					TinySoundFont = tsf_load_memory( soundfont, size );
-					tsf_set_output( TinySoundFont, TSF_MONO, SAMPLERATE, 0.0f );
-					//tsf_set_output( TinySoundFont, TSF_STEREO_INTERLEAVED, SAMPLERATE, 0.0f );
-					tsf_set_volume( TinySoundFont, 0.5f * (float)cfgMIDIVolume / 15.0f );
-					tsf_set_max_voices( TinySoundFont, 64 );
-					tsf_channel_set_bank_preset( TinySoundFont, 9, 128, 0 );
-					cfgMIDI = 1;
-				}
-				delete [] soundfont;
+		if ( ( TinySoundFont = midiLoadSoundFont( filename ) ) != NULL )
+		{
+			tsf_set_output( TinySoundFont, TSF_MONO, SAMPLERATE, 0.0f );
+			//tsf_set_output( TinySoundFont, TSF_STEREO_INTERLEAVED, SAMPLERATE, 0.0f );
+			tsf_set_volume( TinySoundFont, 0.5f * (float)cfgMIDIVolume / 15.0f );
+			tsf_set_max_voices( TinySoundFont, MIDI_MAX_VOICES );
+			tsf_channel_set_bank_preset( TinySoundFont, 9, 128, 0 );
+			cfgMIDI = 1;
+		} else
+			logger->Write( "", LogNotice, "cannot load sound font %s", filename );
 
-				memset( midiSampleBuffer, 0, midiBufferSize * sizeof( float ) );
-			}
-		}
+		midiReset();
 	}
 #endif
 
 	//
-	// initialize sound output (either PWM which is output in the FIQ handler, or via HDMI)
+	// initialize sound output (either PWM which is fed by DMA, or via HDMI)
 	//
 	logger->Write( "", LogNotice, "initialize sound output..." );
 	initSoundOutput( &m_pSound, NULL, outputPWM | outputHDMISound, outputHDMI );
+	if ( outputPWM )
+		pwmDMAStart();
+
+	//
+	// audio graph: SID #1, SID #2 and FM are fed per sample, MIDI is rendered block-wise
+	// (yes, left and right are 1 byte shifted in the buffer, need to fix)
+	//
+	audioGraphInit( ( outputPWM ? AUDIO_SINK_PWM : 0 ) | ( outputHDMISound ? AUDIO_SINK_HDMI : 0 ) );
+	if ( audioGraphAddSource( cfgVolSID1_Right, cfgVolSID1_Left ) != AUDIO_SRC_SID1 ||
+		 audioGraphAddSource( cfgVolSID2_Right, cfgVolSID2_Left ) != AUDIO_SRC_SID2 ||
+#ifdef EMULATE_OPL2
+		 audioGraphAddSource( cfgVolOPL_Right, cfgVolOPL_Left, renderOPL ) != AUDIO_SRC_OPL )
+#else
+		 audioGraphAddSource( cfgVolOPL_Right, cfgVolOPL_Left ) != AUDIO_SRC_OPL )
+#endif
+		logger->Write( "", LogError, "audio graph: cannot add sources" );
+	if ( outputPWM )
+		audioGraphNormalizeGains();
+#ifdef SUPPORT_MIDI
+	if ( cfgMIDI && audioGraphAddSource( 256, 256, renderMIDI, TinySoundFont ) != AUDIO_SRC_MIDI )
+	{
+		logger->Write( "", LogError, "audio graph: cannot add MIDI source" );
+		cfgMIDI = 0;
+	}
+#endif
 
 	#ifdef COMPILE_MENU
 	disableCart = 0;
@@ -706,7 +993,6 @@ startHereAfterReset:
 	nBytesRead = 0; stage = 1;
 	u32 cycleCountC64_Stage1 = 0;
 
-	first = 1;
 	#ifdef HDMI_SOUND
 	//extern CHDMISoundBaseDevice *hdmiSoundDevice;
 	//hdmiSoundDevice->Cancel();
@@ -851,138 +1137,53 @@ startHereAfterReset:
 			u32 cyclesToNextSample = cycleNextSampleReady - nCyclesEmulated;
 
 			do { // do SID emulation until time passed to create an additional sample (i.e. there may be several cycles until a sample value is created)
-				//u32 cyclesToEmulate = min( 256, cycleCount - nCyclesEmulated );
-				u32 cyclesToEmulate = min( 32, cycleCount - nCyclesEmulated );
+				u32 cyclesToEmulate = min( cyclesToNextSample, cycleCount - nCyclesEmulated );
 
-				if ( cyclesToEmulate > cyclesToNextSample )
-					cyclesToEmulate = cyclesToNextSample;
-
-				if ( ringRead != ringWrite )
+				// apply all writes which are due, the SIDs run until the next SID write at most
+				while ( ringRead != ringWrite )
 				{
-					int cyclesToNextWrite = (signed long long)ringTime[ ringRead ] - (signed long long)nCyclesEmulated;
+					u32 ev = ringBufGPIO[ ringRead ];
+					signed long long cyclesToNextWrite = (signed long long)ringTime[ ringRead ] - (signed long long)nCyclesEmulated;
 
-					if ( (int)cyclesToEmulate > cyclesToNextWrite && cyclesToNextWrite > 0 )
-						cyclesToEmulate = cyclesToNextWrite;
-				}
-				if ( cyclesToEmulate <= 0 )
-					cyclesToEmulate = 1;
-
-				//if ( cyclesToEmulate > 0 )
-				{
-					sid[ 0 ]->clock( cyclesToEmulate );
-					#ifndef SID2_DISABLED
-					if ( !cfgSID2_Disabled )
-						sid[ 1 ]->clock( cyclesToEmulate );
-					#endif
-
-					outRegisters[ 27 ] = sid[ 0 ]->read( 27 );
-					outRegisters[ 28 ] = sid[ 0 ]->read( 28 );
-					if ( !cfgSID2_Disabled )
+					if ( cyclesToNextWrite > 0 )
 					{
-						outRegisters_2[ 27 ] = 0;
-						outRegisters_2[ 28 ] = 0;
+						if ( isSIDRegisterWrite( ev ) )
+						{
+							if ( cyclesToNextWrite < (signed long long)cyclesToEmulate )
+								cyclesToEmulate = cyclesToNextWrite;
+							break;
+						}
+
+						// other chips: writes belonging to a later sample have to wait (a write at the cycle
+						// of the next sample belongs to it, as the SID writes which are applied after clocking up to it)
+						if ( cyclesToNextWrite >= (signed long long)cyclesToNextSample )
+							break;
 					}
 
-					nCyclesEmulated += cyclesToEmulate;
-					cyclesToNextSample -= cyclesToEmulate;
+					applyRegisterWrite( ev );
+					ringRead ++;
+					ringRead &= ( RING_SIZE - 1 );
 				}
 
+				if ( cyclesToEmulate == 0 )
+					cyclesToEmulate = 1;
 
-				// apply register updates (we do one-cycle emulation steps, but in case we need to catch up...)
-				unsigned int readUpTo = ringWrite;
+				sid[ 0 ]->clock( cyclesToEmulate );
+				#ifndef SID2_DISABLED
+				if ( !cfgSID2_Disabled )
+					sid[ 1 ]->clock( cyclesToEmulate );
+				#endif
 
-				if ( ringRead != readUpTo && nCyclesEmulated >= ringTime[ ringRead ] )
+				outRegisters[ 27 ] = sid[ 0 ]->read( 27 );
+				outRegisters[ 28 ] = sid[ 0 ]->read( 28 );
+				if ( !cfgSID2_Disabled )
 				{
-      quicklyGetAnotherRegisterWrite:
-#ifdef SUPPORT_MIDI
-					if ( cfgMIDI && (ringBufGPIO[ ringRead ] & (1<<31)) ) // MIDI
-					{
-						register u8 MC = ringBufGPIO[ ringRead ] & 255;
-						register u8 MD1 = ( ringBufGPIO[ ringRead ] >> 8 ) & 255;
-						register u8 MD2 = ( ringBufGPIO[ ringRead ] >> 16 ) & 255;
-						register u16 pitch;
-
-						register u8 channel = MC & 0x0f;
-						MC &= 0xf0;
-
-						switch ( MC )
-						{
-						default:
-							break;
-						case 0x90: // note on
-							tsf_channel_note_on( TinySoundFont, channel, MD1, (float)MD2 / 127.0f ); 
-							break;
-						case 0x80: // note off
-							tsf_channel_note_off( TinySoundFont, channel, MD1 ); 
-							break;
-						case 0xc0: // program change
-							tsf_channel_set_presetnumber( TinySoundFont, channel, MD1, ( channel == 9 ) );
-							break;
-						/*case 0xd0: // pressure change
-							break;*/
-						case 0xe0: // pitch bend
-							pitch = MD1 | ( MD2 << 7 );
-							tsf_channel_set_pitchwheel( TinySoundFont, channel, pitch );
-							break;
-						case 0xb0: // control change
-							tsf_channel_midi_control( TinySoundFont, channel, MD1, MD2 );
-							break;
-						}		
-					} else
-#endif
-					{
-
-						unsigned char A, D;
-						decodeGPIO( ringBufGPIO[ ringRead ], &A, &D );
-
-						#ifdef EMULATE_OPL2
-						if ( cfgEmulateOPL2 && (ringBufGPIO[ ringRead ] & bIO2) )
-						{
-							if ( ( ( A & ( 1 << 4 ) ) == 0 ) )
-							{
-								ym3812_write( pOPL, 0, D ); 
-							} else
-							{
-								ym3812_write( pOPL, 1, D );
-								if ( pOPL->address == 1 )
-								{
-									if ( D == 4 ) // enable digi hack
-										hack_OPL_Sample_Enabled = 1;  else
-										hack_OPL_Sample_Enabled = 0;
-								}
-								if ( hack_OPL_Sample_Enabled && ( pOPL->address == 0xa0 || pOPL->address == 0xa1 ) ) // digi hack
-									hack_OPL_Sample_Value[ pOPL->address - 0xa0 ] = D; else
-									hack_OPL_Sample_Value[ 0 ] = hack_OPL_Sample_Value[ 1 ] = 0;
-							}
-						} else
-						#endif
-						//#if !defined(SID2_DISABLED) && !defined(SID2_PLAY_SAME_AS_SID1)
-						// TODO: generic masks
-						if ( !cfgSID2_Disabled && !cfgSID2_PlaySameAsSID1 && (ringBufGPIO[ ringRead ] & SID2_MASK) )
-						{
-							sid[ 1 ]->write( A & 31, D );
-						} else
-						//#endif
-						{
-							sid[ 0 ]->write( A & 31, D );
-							//outRegisters[ A & 31 ] = D;
-							//#if !defined(SID2_DISABLED) && defined(SID2_PLAY_SAME_AS_SID1)
-							if ( !cfgSID2_Disabled && cfgSID2_PlaySameAsSID1 )
-								sid[ 1 ]->write( A & 31, D );
-							//#endif
-						}
-					}
-					ringRead++;
-					ringRead &= ( RING_SIZE - 1 );
-
-					if ( ringRead != ringWrite )
-					{
-					  s32 t = ringTime[ ringRead ] - nCyclesEmulated;
-					  if ( t <= 0 )
-						goto quicklyGetAnotherRegisterWrite;
-					} 
+					outRegisters_2[ 27 ] = 0;
+					outRegisters_2[ 28 ] = 0;
 				}
 
+				nCyclesEmulated += cyclesToEmulate;
+				cyclesToNextSample -= cyclesToEmulate;
 
 //				samplesElapsed = ( ( unsigned long long )nCyclesEmulated * ( unsigned long long )SAMPLERATE ) / ( unsigned long long )CLOCKFREQ;
 				samplesElapsed = ( ( unsigned long long )nCyclesEmulated * ( unsigned long long )SAMPLERATE_ADJUSTED ) / ( unsigned long long )CLOCKFREQ;
@@ -992,132 +1193,96 @@ startHereAfterReset:
 
 			} while ( samplesElapsed == samplesElapsedBefore );
 
-			CACHE_PRELOADL2STRMW( &sampleBuffer[ smpCur ] );
 			val1 = sid[ 0 ]->output();
 			val2 = 0;
-			valOPL = 0;
 
 		#ifndef SID2_DISABLED
 			if ( !cfgSID2_Disabled )
 				val2 = sid[ 1 ]->output();
 		#endif
 
-		#ifdef EMULATE_OPL2
-			if ( cfgEmulateOPL2 )
-			{
-				ym3812_update_one( pOPL, &valOPL, 1 );
-				// TODO asynchronous read back is an issue, needs to be fixed
-				fmOutRegister = encodeGPIO( ym3812_read( pOPL, 0 ) ); 
-			}
-
-			if ( hack_OPL_Sample_Enabled )
-		        valOPL = ( hack_OPL_Sample_Value[ 0 ] << 5 ) + ( hack_OPL_Sample_Value[ 1 ] << 5 );
-		#endif
+			if ( nCyclesEmulated < 400000 )
+				val1 = val2 = 0;
 
 			//
 			// mixer
 			//
-			register s32 left, right;
-
-#ifdef SUPPORT_MIDI
-			register s32 midiSampleLeft;
+			audioGraphPut( AUDIO_SRC_SID1, val1 );
+			audioGraphPut( AUDIO_SRC_SID2, val2 );
 
-			midiSampleLeft = 0;
-			if ( cfgMIDI )
-			{
-				if ( midiBufferOfs >= midiBufferSize )
-				{
-					tsf_render_float( TinySoundFont, &midiSampleBuffer[0], midiBufferSize, 0 );
-					midiBufferOfs = 0;
-				} 
-
-				midiSampleLeft = midiSampleBuffer[ midiBufferOfs ] * 32767.0f;
-				midiSampleBuffer[ midiBufferOfs ] = 0.0f;
-				midiBufferOfs ++;
-				midiSampleLeft = max( -31768+2, min( 31767-2, midiSampleLeft ) );
-			}
-#endif
-			if ( nCyclesEmulated < 400000 )
-				val1 = val2 = 0;
-			// yes, it's 1 byte shifted in the buffer, need to fix
-			right = ( val1 * cfgVolSID1_Left  + val2 * cfgVolSID2_Left  + valOPL * cfgVolOPL_Left ) >> 8;
-			left  = ( val1 * cfgVolSID1_Right + val2 * cfgVolSID2_Right + valOPL * cfgVolOPL_Right ) >> 8;
-
-#ifdef SUPPORT_MIDI
-			right += midiSampleLeft;
-			left  += midiSampleLeft;
-#endif
-
-/*			if ( fadeVolume < 65536 ) 
-			{
-				left = ( left * fadeVolume ) >> 16;
-				right = ( right * fadeVolume ) >> 16;
-				fadeVolume ++;
-			}*/
-
-			right = max( -32768+2, min( 32767-2, right ) );
-			left  = max( -32768+2, min( 32767-2, left ) );
-
-			if ( outputPWM ) 
-				putSample( left, right );
-
-			if ( outputHDMISound )
-				putSampleHDMI( left << 8, right << 8 );
+			if ( !audioGraphAdvance() )
+				goto NoSampleGeneratedYet;
 
 		#if 1
-			// vu meter
-			static u32 vu_nValues = 0;
-			static float vu_Sum[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
-			
-			//if ( vu_Mode != 2 )
+			// vu meter and visualization of the block which has just been output
+			for ( u32 smp = 0; smp < AUDIO_BLOCK_SIZE; smp++ )
 			{
-				float t = (left+right) / (float)32768.0f * 0.5f;
-				vu_Sum[ 0 ] += t * t * 1.0f;
+				register s32 left  = audioGraph.mixLeft[ smp ];
+				register s32 right = audioGraph.mixRight[ smp ];
+				val1   = audioGraph.src[ AUDIO_SRC_SID1 ].block[ smp ];
+				val2   = audioGraph.src[ AUDIO_SRC_SID2 ].block[ smp ];
+				valOPL = audioGraph.src[ AUDIO_SRC_OPL ].block[ smp ];
+
+				// vu meter
+				static u32 vu_nValues = 0;
+				static float vu_Sum[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			
+				//if ( vu_Mode != 2 )
+				{
+					float t = (left+right) / (float)32768.0f * 0.5f;
+					vu_Sum[ 0 ] += t * t * 1.0f;
 
-				vu_Sum[ 1 ] += val1 * val1 / (float)32768.0f / (float)32768.0f;
-				vu_Sum[ 2 ] += val2 * val2 / (float)32768.0f / (float)32768.0f;
-				vu_Sum[ 3 ] += valOPL * valOPL / (float)32768.0f / (float)32768.0f;
+					vu_Sum[ 1 ] += val1 * val1 / (float)32768.0f / (float)32768.0f;
+					vu_Sum[ 2 ] += val2 * val2 / (float)32768.0f / (float)32768.0f;
+					vu_Sum[ 3 ] += valOPL * valOPL / (float)32768.0f / (float)32768.0f;
 
-				if ( ++ vu_nValues == 256*2 )
-				{
-					for ( u32 i = 0; i < 4; i++ )
+					if ( ++ vu_nValues == 256*2 )
 					{
-						float vu_Volume = max( 0.0f, 2.0f * (log10( 0.1f + sqrt( (float)vu_Sum[ i ] / (float)vu_nValues ) ) + 1.0f) );
-						u32 v = vu_Volume * 1024.0f;
-						if ( i == 0 )
+						for ( u32 i = 0; i < 4; i++ )
 						{
-							// moving average
-							float v = min( 1.0f, (float)vuMeter[ 0 ] / 1024.0f );
-							static float led4Avg = 0.0f;
-							led4Avg = led4Avg * 0.8f + v * ( 1.0f - 0.8f );
+							float vu_Volume = max( 0.0f, 2.0f * (log10( 0.1f + sqrt( (float)vu_Sum[ i ] / (float)vu_nValues ) ) + 1.0f) );
+							u32 v = vu_Volume * 1024.0f;
+							if ( i == 0 )
+							{
+								// moving average
+								float v = min( 1.0f, (float)vuMeter[ 0 ] / 1024.0f );
+								static float led4Avg = 0.0f;
+								led4Avg = led4Avg * 0.8f + v * ( 1.0f - 0.8f );
 
-							vu_nLEDs = max( 0, min( 4, (led4Avg * 8.0f) ) );
-							if ( vu_nLEDs > 4 ) vu_nLEDs = 4;
+								vu_nLEDs = max( 0, min( 4, (led4Avg * 8.0f) ) );
+								if ( vu_nLEDs > 4 ) vu_nLEDs = 4;
+							}
+							vuMeter[ i ] = v;
+							vu_Sum[ i ] = 0;
 						}
-						vuMeter[ i ] = v;
-						vu_Sum[ i ] = 0;
-					}
 
-					vu_nValues = 0;
+						vu_nValues = 0;
+					}
 				}
-			}
 
-			#ifdef COMPILE_MENU
-			if ( screenType == 0 )
-			{
-				#include "oscilloscope_hack.h"
-			} else
-			if ( screenType == 1 )
-			{
-				const float scaleVis = 1.0f;
-				const u32 nLevelMeters = 3;
-				#include "tft_sid_vis.h"
-			} 
-			#endif
+				#ifdef COMPILE_MENU
+				if ( screenType == 0 )
+				{
+					#include "oscilloscope_hack.h"
+				} else
+				if ( screenType == 1 )
+				{
+					const float scaleVis = 1.0f;
+					const u32 nLevelMeters = 3;
+					#include "tft_sid_vis.h"
+				} 
+				#endif
+			}
 		#endif
 		NoSampleGeneratedYet:;
 		}
 	#endif
+
+	#ifdef SUPPORT_MIDI
+		// the emulation has caught up, time to read sample pages
+		if ( cfgMIDI && TinySoundFont )
+			midiServiceSampleCache( TinySoundFont );
+	#endif
 	}
 
 	m_InputPin.DisableInterrupt();
@@ -1238,7 +1403,6 @@ void CKernel::FIQHandler (void *pParam)
 	if ( !( launchPrg && !disableCart ) )
 	{
 		CACHE_PRELOADL1STRMW( &ringWrite );
-		CACHE_PRELOADL1STRM( &sampleBuffer[ smpLast ] );
 		CACHE_PRELOADL1STRM( &outRegisters[ 16 ] );
 	}
 	#endif
@@ -1332,6 +1496,7 @@ void CKernel::FIQHandler (void *pParam)
 				resetFromCodeState = 2;
 				cfgVolSID1_Left = cfgVolSID2_Left = cfgVolOPL_Left =
 				cfgVolSID1_Right = cfgVolSID2_Right = cfgVolOPL_Right = 0;
+				audioGraphMute();
 				latchSetClear( 0, LATCH_RESET );
 			}
 			OUTPUT_LATCH_AND_FINISH_BUS_HANDLING
@@ -1552,69 +1717,6 @@ void CKernel::FIQHandler (void *pParam)
 	#include "fragment_emulation_in_fiq.h"
 	#endif		
 
-	//  __                 __       ___  __       ___ 
-	// |__) |  |  |\/|    /  \ |  |  |  |__) |  |  |  
-	// |    |/\|  |  |    \__/ \__/  |  |    \__/  |  
-	// OPTIONAL
-	//											
-	#ifdef USE_PWM_DIRECT
-	if ( outputPWM )
-	{
-		static unsigned long long samplesElapsedBeforeFIQ = 0;
-
-		unsigned long long samplesElapsedFIQ = ( ( unsigned long long )cycleCountC64 * ( unsigned long long )SAMPLERATE ) / ( unsigned long long )CLOCKFREQ;
-		if ( samplesElapsedFIQ != samplesElapsedBeforeFIQ && !CPU_RESET )
-		{
-			write32( ARM_GPIO_GPCLR0, bCTRL257 ); 
-			samplesElapsedBeforeFIQ = samplesElapsedFIQ;
-
-			u32 s = getSample();
-			u16 s1 = s & 65535;
-			u16 s2 = s >> 16;
-
-			s32 d1 = (s32)( ( *(s16*)&s1 + 32768 ) * PWMRange ) >> 17;
-			s32 d2 = (s32)( ( *(s16*)&s2 + 32768 ) * PWMRange ) >> 17;
-			write32( ARM_PWM_DAT1, d1 );
-			write32( ARM_PWM_DAT2, d2 );
-			RESET_CPU_CYCLE_COUNTER
-			return;
-		} 
-	}
-	#endif
-	#ifdef HDMI_SOUND
-	if ( outputHDMISound )
-	{
-		static unsigned long long samplesElapsedBeforeFIQ = 0;
-
-		if ( first && nCyclesEmulated > 0 )
-		{
-			first = 0;
-			samplesElapsedBeforeFIQ = 0;
-		} 
-
-		if ( !first )
-		{
-		//	unsigned long long samplesElapsedFIQ = ( ( unsigned long long )cycleCountC64 * ( unsigned long long )SAMPLERATE ) / ( unsigned long long )CLOCKFREQ;
-			unsigned long long samplesElapsedFIQ = ( ( unsigned long long )cycleCountC64 * ( unsigned long long )48000 ) / ( unsigned long long )CLOCKFREQ;
-			if ( samplesElapsedFIQ != samplesElapsedBeforeFIQ && !CPU_RESET )
-			{
-				write32( ARM_GPIO_GPCLR0, bCTRL257 ); 
-				samplesElapsedBeforeFIQ = samplesElapsedFIQ;
-
-				u32 s1, s2;
-				getSampleHDMI( &s1, &s2 );
-				if ( !( read32( RegMaiControl ) & BitMaiControlFull ) )
-				{
-					write32( RegMaiData, s1 );
-					write32( RegMaiData, s2 );
-				}
-
-				RESET_CPU_CYCLE_COUNTER
-				return;
-			}
-		}
-	} 
-	#endif
 	//           ___  __       
 	// |     /\   |  /  ` |__| 
 	// |___ /~~\  |  \__, |  | 
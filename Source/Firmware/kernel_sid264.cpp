@@ -30,6 +30,7 @@
 */
 #include <math.h>
 #include "kernel_sid264.h"
+#include "audiograph.h"
 #ifdef COMPILE_MENU
 #include "kernel_menu.h"
 #include "launch264.h"
@@ -121,6 +122,13 @@ s32 cfgVolSID1_Left, cfgVolSID1_Right;
 s32 cfgVolSID2_Left, cfgVolSID2_Right;
 s32 cfgVolOPL_Left, cfgVolOPL_Right;
 
+// sources of the audio graph
+#define AUDIO_SRC_SID1			0
+#define AUDIO_SRC_SID2			1
+#define AUDIO_SRC_OPL			2
+#define AUDIO_SRC_DIGIBLASTER	3
+#define AUDIO_SRC_TED			4
+
 u8 outputHDMI = 0;
 
 void setSIDConfiguration( u32 mode, u32 sid1, u32 sid1addr, u32 sid2, u32 sid2addr, u32 rr, u32 addr, u32 exp, s32 v1, s32 p1, s32 v2, s32 p2, s32 v3, s32 p3, s32 digiblasterVol, s32 sidfreq, s32 tedVol, u8 output )
@@ -132,12 +140,9 @@ void setSIDConfiguration( u32 mode, u32 sid1, u32 sid1addr, u32 sid2, u32 sid2ad
 
 	// panning = 0 .. 14, vol = 0 .. 15
 	// volumes -> 0 .. 255
-	cfgVolSID1_Left  = v1 * ( 14 - p1 ) * 255 / 210;
-	cfgVolSID1_Right = v1 * ( p1 ) * 255 / 210;
-	cfgVolSID2_Left  = v2 * ( 14 - p2 ) * 255 / 210;
-	cfgVolSID2_Right = v2 * ( p2 ) * 255 / 210;
-	cfgVolOPL_Left  = v3 * ( 14 - p3 ) * 255 / 210;
-	cfgVolOPL_Right = v3 * ( p3 ) * 255 / 210;
+	audioGraphVolPan( v1, p1, 255, &cfgVolSID1_Left, &cfgVolSID1_Right );
+	audioGraphVolPan( v2, p2, 255, &cfgVolSID2_Left, &cfgVolSID2_Right );
+	audioGraphVolPan( v3, p3, 255, &cfgVolOPL_Left, &cfgVolOPL_Right );
 
 	if ( sid1addr )
 		cfgSID1_Addr = 0xd400; else
@@ -193,6 +198,14 @@ void setSIDConfiguration( u32 mode, u32 sid1, u32 sid1addr, u32 sid2, u32 sid2ad
 // taken directly from Yape, please see license in the header file                                                           
 #include "TEDsound.h"
 
+// TED sound is a pull source of the audio graph: rendered block-wise, and up to the current sample before each register write
+static void renderTED( void *param, s32 *dst, u32 nSamples )
+{
+	if ( tedVolume > 0 )
+		TEDrenderBlock( (int*)dst, nSamples ); else
+		memset( dst, 0, nSamples * sizeof( s32 ) );
+}
+
 
 //  __     __                __      ___                   ___ 
 // /__` | |  \     /\  |\ | |  \    |__   |\/|    | |\ | |  |  
@@ -514,9 +527,29 @@ void CKernel::Run( void )
 	}
 
 	//
-	// initialize sound output (either PWM which is output in the FIQ handler, or via HDMI)
+	// initialize sound output (either PWM which is fed by DMA, or via HDMI)
 	//
 	initSoundOutput( &m_pSound, pVCHIQ, 1, 0 );
+	#ifdef USE_PWM_DIRECT
+	if ( !outputHDMI )
+		pwmDMAStart();
+	#endif
+
+	//
+	// audio graph: SID #1, SID #2, FM, Digiblaster (fed per sample) and TED sound (rendered block-wise)
+	// (yes, left and right are 1 byte shifted in the buffer, need to fix)
+	//
+	#ifdef USE_PWM_DIRECT
+	audioGraphInit( outputHDMI ? AUDIO_SINK_HDMI : AUDIO_SINK_PWM );
+	#else
+	audioGraphInit( AUDIO_SINK_VCHIQ );
+	#endif
+	if ( audioGraphAddSource( cfgVolSID1_Right, cfgVolSID1_Left ) != AUDIO_SRC_SID1 ||
+		 audioGraphAddSource( cfgVolSID2_Right, cfgVolSID2_Left ) != AUDIO_SRC_SID2 ||
+		 audioGraphAddSource( cfgVolOPL_Right, cfgVolOPL_Left ) != AUDIO_SRC_OPL ||
+		 audioGraphAddSource( 2 * digiblasterVolume, 2 * digiblasterVolume ) != AUDIO_SRC_DIGIBLASTER ||
+		 audioGraphAddSource( tedVolume, tedVolume, renderTED ) != AUDIO_SRC_TED )
+		logger->Write( "", LogError, "audio graph: cannot add sources" );
 
 	for ( int i = 0; i < NUM_SIDS; i++ )
 		for ( int j = 0; j < 24; j++ )
@@ -613,7 +646,7 @@ void CKernel::Run( void )
 		#ifdef COMPILE_MENU
 		//TEST_FOR_JUMP_TO_MAINMENU( cycleCountC64, resetCounter )
 		if ( cycleCountC64 > 2000000 && resetCounter > 500000 ) {		
-			hdmiSoundDevice->Cancel();
+			pwmDMAStop();
 			EnableIRQs();												
 			m_InputPin.DisableInterrupt();								
 			m_InputPin.DisconnectInterrupt();							
@@ -720,6 +753,7 @@ void CKernel::Run( void )
 
 						if ( tedCommand )
 						{
+							audioGraphRenderUpTo( AUDIO_SRC_TED );
 							writeSoundReg( A, D );
 						} else
 						#ifdef EMULATE_OPL2
@@ -772,78 +806,72 @@ void CKernel::Run( void )
 			}
 		#endif
 
-			//
-			// mixer
-			//
-			s32 left, right;
-
-			short tedV = 0;
-
-			if ( tedVolume > 0 )
-				tedV = TEDcalcNextSample();
+			audioGraphPut( AUDIO_SRC_SID1, val1 );
+			audioGraphPut( AUDIO_SRC_SID2, val2 );
+			audioGraphPut( AUDIO_SRC_OPL, valOPL );
+			audioGraphPut( AUDIO_SRC_DIGIBLASTER, outputDigiblaster );
 
-			// yes, it's 1 byte shifted in the buffer, need to fix
-			right = ( val1 * cfgVolSID1_Left  + val2 * cfgVolSID2_Left  + valOPL * cfgVolOPL_Left + 2 * outputDigiblaster * digiblasterVolume + tedV * tedVolume ) >> 8;
-			left  = ( val1 * cfgVolSID1_Right + val2 * cfgVolSID2_Right + valOPL * cfgVolOPL_Right + 2 * outputDigiblaster * digiblasterVolume + tedV * tedVolume ) >> 8;
+			if ( !audioGraphAdvance() )
+				continue;
 
-			right = max( -32767, min( 32767, right ) );
-			left  = max( -32767, min( 32767, left ) );
-
-			#ifdef USE_PWM_DIRECT
-			putSample( left, right );
-			#else
-			putSample( left );
-			putSample( right );
-			#endif
-
-			// vu meter
-			static u32 vu_nValues = 0;
-			static float vu_Sum[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
-			
-			//if ( vu_Mode != 2 )
+			// vu meter and visualization of the block which has just been output
+			for ( u32 smp = 0; smp < AUDIO_BLOCK_SIZE; smp++ )
 			{
-				float t = (left+right) / (float)32768.0f * 0.5f;
-				vu_Sum[ 0 ] += t * t * 1.0f;
+				s32 left  = audioGraph.mixLeft[ smp ];
+				s32 right = audioGraph.mixRight[ smp ];
+				val1   = audioGraph.src[ AUDIO_SRC_SID1 ].block[ smp ];
+				val2   = audioGraph.src[ AUDIO_SRC_SID2 ].block[ smp ];
+				valOPL = audioGraph.src[ AUDIO_SRC_OPL ].block[ smp ];
+
+				// vu meter
+				static u32 vu_nValues = 0;
+				static float vu_Sum[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			
+				//if ( vu_Mode != 2 )
+				{
+					float t = (left+right) / (float)32768.0f * 0.5f;
+					vu_Sum[ 0 ] += t * t * 1.0f;
 
-				vu_Sum[ 1 ] += val1 * val1 / (float)32768.0f / (float)32768.0f;
-				vu_Sum[ 2 ] += val2 * val2 / (float)32768.0f / (float)32768.0f;
-				vu_Sum[ 3 ] += valOPL * valOPL / (float)32768.0f / (float)32768.0f;
+					vu_Sum[ 1 ] += val1 * val1 / (float)32768.0f / (float)32768.0f;
+					vu_Sum[ 2 ] += val2 * val2 / (float)32768.0f / (float)32768.0f;
+					vu_Sum[ 3 ] += valOPL * valOPL / (float)32768.0f / (float)32768.0f;
 
-				if ( ++ vu_nValues == 256*2 )
-				{
-					for ( u32 i = 0; i < 4; i++ )
+					if ( ++ vu_nValues == 256*2 )
 					{
-						float vu_Volume = max( 0.0f, 2.0f * (log10( 0.1f + sqrt( (float)vu_Sum[ i ] / (float)vu_nValues ) ) + 1.0f) );
-						u32 v = vu_Volume * 1024.0f;
-						if ( i == 0 )
+						for ( u32 i = 0; i < 4; i++ )
 						{
-							// moving average
-							float v = min( 1.0f, (float)vuMeter[ 0 ] / 1024.0f );
-							static float led4Avg = 0.0f;
-							led4Avg = led4Avg * 0.8f + v * ( 1.0f - 0.8f );
-
-							vu_nLEDs = max( 0, min( 4, (led4Avg * 8.0f) ) );
-							if ( vu_nLEDs > 4 ) vu_nLEDs = 4;
+							float vu_Volume = max( 0.0f, 2.0f * (log10( 0.1f + sqrt( (float)vu_Sum[ i ] / (float)vu_nValues ) ) + 1.0f) );
+							u32 v = vu_Volume * 1024.0f;
+							if ( i == 0 )
+							{
+								// moving average
+								float v = min( 1.0f, (float)vuMeter[ 0 ] / 1024.0f );
+								static float led4Avg = 0.0f;
+								led4Avg = led4Avg * 0.8f + v * ( 1.0f - 0.8f );
+
+								vu_nLEDs = max( 0, min( 4, (led4Avg * 8.0f) ) );
+								if ( vu_nLEDs > 4 ) vu_nLEDs = 4;
+							}
+							vuMeter[ i ] = v;
+							vu_Sum[ i ] = 0;
 						}
-						vuMeter[ i ] = v;
-						vu_Sum[ i ] = 0;
-					}
 
-					vu_nValues = 0;
+						vu_nValues = 0;
+					}
 				}
-			}
 
-			// ugly code which renders 3 oscilloscopes (SID1, SID2, FM) to HDMI and 1 for the OLED
-			if ( screenType == 0 )
-			{
-				#include "oscilloscope_hack.h"
-			} else
-			if ( screenType == 1 )
-			{
-				const float scaleVis = 1.0f;
-				const u32 nLevelMeters = 3;
-				#include "tft_sid_vis.h"
-			} 
+				// ugly code which renders 3 oscilloscopes (SID1, SID2, FM) to HDMI and 1 for the OLED
+				if ( screenType == 0 )
+				{
+					#include "oscilloscope_hack.h"
+				} else
+				if ( screenType == 1 )
+				{
+					const float scaleVis = 1.0f;
+					const u32 nLevelMeters = 3;
+					#include "tft_sid_vis.h"
+				} 
+			}
 		}
 	#endif
 	}
@@ -852,10 +880,6 @@ void CKernel::Run( void )
 }
 
 
-#ifdef USE_PWM_DIRECT
-static unsigned long long samplesElapsedBeforeFIQ = 0;
-#endif
-
 
 #ifdef COMPILE_MENU
 void KernelSIDFIQHandler( void *pParam )
@@ -863,7 +887,6 @@ void KernelSIDFIQHandler( void *pParam )
 void CKernel::FIQHandler (void *pParam)
 #endif
 {
-	unsigned long long samplesElapsedFIQ;
 	static s32 latchDelayOut = 10;
 	u32 swizzle = 0;
 
@@ -967,7 +990,6 @@ void CKernel::FIQHandler (void *pParam)
 		CACHE_PRELOADL1STRMW( &ringWrite );
 		//CACHE_PRELOADL1STRMW( &ringBufGPIO[ ringWrite ] );
 		//CACHE_PRELOADL1STRMW( &ringTime[ ringWrite ] );
-		CACHE_PRELOADL1STRM( &sampleBuffer[ smpLast ] );
 		CACHE_PRELOADL1STRM( &outRegisters[ 0 ] );
 		CACHE_PRELOADL1STRM( &outRegisters[ 16 ] );
 	}
@@ -1150,77 +1172,6 @@ void CKernel::FIQHandler (void *pParam)
 	#include "fragment_emulation_in_fiq.h"
 	#endif		
 
-	//  __                 __       ___  __       ___ 
-	// |__) |  |  |\/|    /  \ |  |  |  |__) |  |  |  
-	// |    |/\|  |  |    \__/ \__/  |  |    \__/  |  
-	// OPTIONAL
-	//											
-	#ifdef USE_PWM_DIRECT
-	samplesElapsedFIQ = ( ( unsigned long long )adjustedCycleCount( cycleCountC64 ) * ( unsigned long long )SAMPLERATE ) / ( unsigned long long )CLOCKFREQ_ADJ;
-
-	if ( samplesElapsedFIQ != samplesElapsedBeforeFIQ )
-	{
-		//write32( ARM_GPIO_GPCLR0, bCTRL257 ); 
-		samplesElapsedBeforeFIQ = samplesElapsedFIQ;
-
-#ifdef HDMI_SOUND
-		if ( outputHDMI )
-#else
-		if ( false )
-#endif
-		{
-			static int first = 1;
-
-			extern CHDMISoundBaseDevice *hdmiSoundDevice;
-
-			if ( first && nCyclesEmulated )
-			{
-				hdmiSoundDevice->Start();
-				first = 0;
-			} 
-
-			if ( !first )
-			{
-				u32 s = getSample();
-				u16 s1 = s & 65535;
-				u16 s2 = s >> 16;
-
-				if ( flushBuffer || nCyclesEmulated == 0 ) s1 = s2 = 0;
-
-				if ( hdmiSoundDevice->IsWritable() )
-				{
-					hdmiSoundDevice->WriteSample( (s32)(*(s16*)&s1) << 8 );
-					hdmiSoundDevice->WriteSample( (s32)(*(s16*)&s2) << 8 );
-					//hdmiSoundDevice->WriteSample( 0 );
-				}
-				/*extern CHDMISoundBaseDevice *hdmiSoundDevice;
-				if ( hdmiSoundDevice->IsWritable() && curChannel == 0 )
-				{
-					hdmiSoundDevice->WriteSample( (s32)(*(s16*)&s1) << 8 );
-					curChannel = 1;
-				}
-				if ( hdmiSoundDevice->IsWritable() && curChannel == 1 )
-				{
-					hdmiSoundDevice->WriteSample( (s32)(*(s16*)&s2) << 8 );
-					curChannel = 0;
-				}*/
-
-			}
-		} else
-		{
-			u32 s = getSample();
-			u16 s1 = s & 65535;
-			u16 s2 = s >> 16;
-		
-			s32 d1 = (s32)( ( *(s16*)&s1 + 32768 ) * PWMRange ) >> 17;
-			s32 d2 = (s32)( ( *(s16*)&s2 + 32768 ) * PWMRange ) >> 17;
-			write32( ARM_PWM_DAT1, d1 );
-			write32( ARM_PWM_DAT2, d2 );
-		}
-		goto get_out;
-	} 
-	#endif
-	
 	static u32 omitLatch = 0;
 
 	static u32 lastButtonPressed = 0;
@@ -30,6 +30,10 @@
 */
 #include <math.h>
 #include "kernel_sid8.h"
+#include "audiograph.h"
+#ifdef SID8_MULTICORE
+#include "coretask.h"
+#endif
 #ifdef COMPILE_MENU
 #include "kernel_menu.h"
 #include "launch.h"
@@ -77,9 +81,135 @@ static u32 *ringBufGPIO;// = (u32*)&flash_cacheoptimized_pool[ 0 ]; //[ RING_SIZ
 static unsigned long long *ringTime;// = (unsigned long long *)&flash_cacheoptimized_pool[ RING_SIZE * 4 ]; //[ RING_SIZE ];
 static u32 ringWrite;
 
+// address decoding: offset in the I/O page ($D000-$DFFF) -> register (bits 0-4) and SID (bits 5-7), or ignore
+// built from the configuration at start up, the FIQ handler needs only a single load per access
+// and the decoded value goes into the ring buffer as is
+#define SID8_DECODE_IGNORE	0x8000
+static u16 sidDecode[ 4096 ] AAA;
+extern u16 cfgSID8_Addr[ 8 ];
+
+// the parts of the table which can be hit: SID socket ($D400-$D7FF) and IO1/IO2 ($DE00-$DFFF), if any SID is mapped there
+static u8 sidDecodeUsesSocket, sidDecodeUsesIO;
+
+#define CACHE_PRELOAD_SID_DECODE( FUNC ) {									\
+	if ( sidDecodeUsesSocket ) CACHE_PRELOAD_DATA_CACHE( &sidDecode[ 0x400 ], 0x400 * 2, FUNC )	\
+	if ( sidDecodeUsesIO ) CACHE_PRELOAD_DATA_CACHE( &sidDecode[ 0xe00 ], 0x200 * 2, FUNC ) }
+
 // prepared GPIO output when SID-registers are read
 static u32 outRegisters[ 32 ];
 
+#ifdef SID8_MULTICORE
+//
+// multi-core rendering: render core k (1-3) owns the SIDs k-1, k+2, ... and gets its own queue of register writes per block,
+// core 0 distributes the writes from the ring buffer, starts the block as a task on all render cores (see coretask.h),
+// and mixes and outputs it when they are done
+//
+#define SID8_CORES			3
+#define SID8_QUEUE_SIZE		1024		// register writes per render core and block
+#define SID8_OSC3_CYCLES	32			// SID #1 is clocked in steps of at most this, to publish OSC3/ENV3 for register reads
+
+typedef struct
+{
+	u32 write[ SID8_QUEUE_SIZE ] AAA;	// entries as in ringBufGPIO
+	u32 time[ SID8_QUEUE_SIZE ];		// in cycles relative to the start of the block
+	u32 nWrites;
+	u32 cycles;							// cycles the block took
+} SID8_CORE;
+
+static SID8_CORE sid8Core[ SID8_CORES ] AAA;
+static u32 sid8BlockCycles;
+
+// renders one block of all SIDs owned by render core k, clocking each SID up to its next register write
+static void sid8RenderBlock( u32 k )
+{
+	SID8_CORE *c = &sid8Core[ k ];
+	short buf[ AUDIO_BLOCK_SIZE ];
+
+	for ( u32 s = k; s < NUM_SIDS; s += SID8_CORES )
+	{
+		u32 pos = 0, t = 0, w = 0;
+
+		while ( pos < AUDIO_BLOCK_SIZE )
+		{
+			while ( w < c->nWrites && ( ( c->write[ w ] >> 13 ) & 7 ) != s )
+				w ++;
+
+			cycle_count delta = ( s == 0 ) ? SID8_OSC3_CYCLES : 1 << 20;
+			if ( w < c->nWrites )
+			{
+				if ( c->time[ w ] <= t )
+				{
+					sid[ s ]->write( ( c->write[ w ] >> 8 ) & 31, c->write[ w ] & 255 );
+					w ++;
+					continue;
+				}
+				if ( c->time[ w ] - t < (u32)delta )
+					delta = c->time[ w ] - t;
+			}
+
+			cycle_count before = delta;
+			pos += sid[ s ]->clock( delta, &buf[ pos ], AUDIO_BLOCK_SIZE - pos );
+			t += before - delta;
+
+			if ( s == 0 )
+			{
+				outRegisters[ 27 ] = sid[ 0 ]->read( 27 );
+				outRegisters[ 28 ] = sid[ 0 ]->read( 28 );
+			}
+		}
+
+		// writes at the very end of the block (the block length is known only approximately when the writes are distributed)
+		for ( ; w < c->nWrites; w++ )
+			if ( ( ( c->write[ w ] >> 13 ) & 7 ) == s )
+				sid[ s ]->write( ( c->write[ w ] >> 8 ) & 31, c->write[ w ] & 255 );
+
+		for ( u32 i = 0; i < AUDIO_BLOCK_SIZE; i++ )
+			audioGraph.src[ s ].block[ i ] = buf[ i ];
+
+		c->cycles = t;
+	}
+}
+
+static void sid8RenderTask( void *param )
+{
+	sid8RenderBlock( (u32)(u64)param );
+}
+
+// distributes the register writes of the next block, renders it on the render cores, mixes and outputs it
+static u32 sid8RenderAndMixBlock( u32 ringRead, unsigned long long nCyclesEmulated )
+{
+	unsigned long long blockEnd = nCyclesEmulated + sid8BlockCycles;
+
+	for ( u32 k = 0; k < SID8_CORES; k++ )
+		sid8Core[ k ].nWrites = 0;
+
+	while ( ringRead != ringWrite && ringTime[ ringRead ] < blockEnd )
+	{
+		u32 rv = ringBufGPIO[ ringRead ];
+		SID8_CORE *c = &sid8Core[ ( ( rv >> 13 ) & 7 ) % SID8_CORES ];
+		if ( c->nWrites == SID8_QUEUE_SIZE )
+			break;
+
+		c->time[ c->nWrites ] = ringTime[ ringRead ] > nCyclesEmulated ? ringTime[ ringRead ] - nCyclesEmulated : 0;
+		c->write[ c->nWrites ++ ] = rv;
+
+		ringRead ++;
+		ringRead &= ( RING_SIZE - 1 );
+	}
+
+	for ( u32 k = 0; k < SID8_CORES; k++ )
+		coreTaskRun( k + 1, sid8RenderTask, (void*)(u64)k );
+
+	for ( u32 k = 0; k < SID8_CORES; k++ )
+		coreTaskWait( k + 1 );
+
+	audioGraphMix();
+	audioGraphOutput();
+
+	return ringRead;
+}
+#endif
+
 // counts the #cycles when the C64-reset line is pulled down (to detect a reset)
 static u32 resetCounter,
 		   resetPressed, resetReleased;
@@ -105,6 +235,32 @@ static int startVCHIQ = 0;
 // /__` | |  \     /\  |\ | |  \    |__   |\/|    | |\ | |  |  
 // .__/ | |__/    /~~\ | \| |__/    |     |  |    | | \| |  |  
 //                                                            
+static void buildSIDDecode()
+{
+	for ( u32 a = 0; a < 4096; a++ )
+		sidDecode[ a ] = SID8_DECODE_IGNORE;
+
+	u32 nConfigured = 0;
+	for ( u32 i = 0; i < NUM_SIDS; i++ )
+		if ( cfgSID8_Addr[ i ] )
+		{
+			for ( u32 r = 0; r < 32; r++ )
+				sidDecode[ ( cfgSID8_Addr[ i ] & 0xfe0 ) + r ] = r | ( i << 5 );
+			nConfigured ++;
+		}
+
+	// default layout: SIDs at $D400, $D420, $D480, $D4A0, $D500, $D520, $D580 and $D5A0 (mirrored within the chip select of the SID socket)
+	if ( nConfigured == 0 )
+		for ( u32 a = 0x400; a < 0x800; a++ )
+			sidDecode[ a ] = ( a & 31 ) | ( ( ( ( a >> 6 ) & 6 ) | ( ( a >> 5 ) & 1 ) ) << 5 );
+
+	sidDecodeUsesSocket = sidDecodeUsesIO = 0;
+	for ( u32 a = 0x400; a < 0x800; a++ )
+		if ( !( sidDecode[ a ] & SID8_DECODE_IGNORE ) ) sidDecodeUsesSocket = 1;
+	for ( u32 a = 0xe00; a < 0x1000; a++ )
+		if ( !( sidDecode[ a ] & SID8_DECODE_IGNORE ) ) sidDecodeUsesIO = 1;
+}
+
 void initSID8()
 {
 	resetCounter = 0;
@@ -135,6 +291,8 @@ void initSID8()
 		}
 	}
 
+	buildSIDDecode();
+
 	// ring buffer init
 	ringWrite = 0;
 	for ( int i = 0; i < RING_SIZE; i++ )
@@ -194,6 +352,8 @@ boolean CKernel::Initialize( void )
 
 void quitSID8()
 {
+	pwmDMAStop();
+
 	if ( outputHDMI && m_pSound != NULL )
 	{
 		#ifndef HDMI_SOUND
@@ -273,6 +433,7 @@ static void prepareOnReset( bool refresh = false )
 	// FIQ handler
 	CACHE_PRELOAD_INSTRUCTION_CACHE( (void*)&FIQ_HANDLER, 4*1024 );
 	FORCE_READ_LINEAR32a( (void*)&FIQ_HANDLER, 4*1024, 32768 );
+	CACHE_PRELOAD_SID_DECODE( CACHE_PRELOADL1KEEP );
 
 	resetCounter = cycleCountC64 = nCyclesEmulated = samplesElapsed = 0;
 	nBytesRead = 0; stage = 1;
@@ -290,8 +451,6 @@ static u32 targetSamplesAvail = 0, targetCount = 0;
 extern u32 fillSoundBuffer;
 extern bool CVCHIQ_CB_Manual;
 
-static int first = 1;
-
 #ifdef COMPILE_MENU
 void KernelSIDFIQHandler8( void *pParam );
 
@@ -378,12 +537,26 @@ startHereAfterReset:
 
 	//logger->Write( "", LogNotice, "initialize SIDs..." );
 	initSID8();
+	#ifdef SID8_MULTICORE
+	coreTaskInit();
+	#endif
 
 	//
-	// initialize sound output (either PWM which is output in the FIQ handler, or via HDMI)
+	// initialize sound output (either PWM which is fed by DMA, or via HDMI)
 	//
 	startVCHIQ = 0;
 	initSoundOutput( &m_pSound, NULL, outputPWM | outputHDMISound, outputHDMI );
+	if ( outputPWM )
+		pwmDMAStart();
+
+	//
+	// audio graph: one source per SID, odd SIDs go to the left, even SIDs to the right channel (at half volume)
+	// (yes, it's 1 byte shifted in the buffer, need to fix)
+	//
+	audioGraphInit( ( outputPWM ? AUDIO_SINK_PWM : 0 ) | ( outputHDMISound ? AUDIO_SINK_HDMI : 0 ) );
+	for ( u32 i = 0; i < 8; i++ )
+		if ( audioGraphAddSource( ( i & 1 ) ? 128 : 0, ( i & 1 ) ? 0 : 128 ) != i )
+			logger->Write( "", LogError, "audio graph: cannot add source for SID #%d", i + 1 );
 
 	#ifdef COMPILE_MENU
 	if ( FILENAME == NULL && !hasData )
@@ -439,8 +612,14 @@ startHereAfterReset:
 	logger->Write( "", LogNotice, "Measured C64 clock frequency: %u Hz", (u32)CLOCKFREQ );
 #endif
 
+	#ifdef SID8_MULTICORE
+	for ( int i = 0; i < NUM_SIDS; i++ )
+		sid[ i ]->set_sampling_parameters( CLOCKFREQ, SID8_SAMPLING, SAMPLERATE, SAMPLERATE * 0.4 );
+	sid8BlockCycles = (u64)AUDIO_BLOCK_SIZE * CLOCKFREQ / SAMPLERATE + 1;
+	#else
 	for ( int i = 0; i < NUM_SIDS; i++ )
 		sid[ i ]->set_sampling_parameters( CLOCKFREQ, SAMPLE_INTERPOLATE, SAMPLERATE );
+	#endif
 
 	//logger->Write( "", LogNotice, "start emulating..." );
 	cycleCountC64 = 0;
@@ -505,7 +684,6 @@ startHereAfterReset:
 
 	fillSoundBuffer = 0;
 
-	first = 1;
 	#ifdef HDMI_SOUND
 	extern CHDMISoundBaseDevice *hdmiSoundDevice;
 	/*hdmiSoundDevice->Cancel();
@@ -619,9 +797,20 @@ startHereAfterReset:
 	#ifndef EMULATION_IN_FIQ
 
 		unsigned long long cycleCount = cycleCountC64;
+	#ifdef SID8_MULTICORE
+		// a block is rendered once the C64 has passed its end, i.e. when all of its register writes are in the ring buffer
+		while ( cycleCount > nCyclesEmulated + sid8BlockCycles )
+		{
+			CACHE_PRELOAD_INSTRUCTION_CACHE( (void*)&FIQ_HANDLER, 6*1024 );
+			CACHE_PRELOAD_SID_DECODE( CACHE_PRELOADL2KEEP );
+
+			ringRead = sid8RenderAndMixBlock( ringRead, nCyclesEmulated );
+			nCyclesEmulated += sid8Core[ 0 ].cycles;
+	#else
 		while ( cycleCount > nCyclesEmulated )
 		{
 			CACHE_PRELOAD_INSTRUCTION_CACHE( (void*)&FIQ_HANDLER, 6*1024 );
+			CACHE_PRELOAD_SID_DECODE( CACHE_PRELOADL2KEEP );
 			CACHE_PRELOADL2STRMW( &smpCur );
 
 			static u32 carrySamples = 0;
@@ -651,7 +840,7 @@ startHereAfterReset:
 					u32 rv = ringBufGPIO[ ringRead ];
 					D = rv & 255;
 					A = (rv>>8)&31;
-					u32 whichSID = rv >> 16;
+					u32 whichSID = (rv>>13)&7;
 	
 					sid[ whichSID ]->write( A, D );
 
@@ -667,81 +856,69 @@ startHereAfterReset:
 			// mixer
 			//
 
-			CACHE_PRELOADL2STRMW( &sampleBuffer[ smpCur ] );
-			s32 left = 0, right = 0;
-			
-			// yes, it's 1 byte shifted in the buffer, need to fix
-			s32 l1, l2, l3, l4, r1, r2, r3, r4;
-			l1 = sid[1]->output();
-			l2 = sid[3]->output();
-			l3 = sid[5]->output();
-			l4 = sid[7]->output();
-			r1 = sid[0]->output();
-			r2 = sid[2]->output();
-			r3 = sid[4]->output();
-			r4 = sid[6]->output();
-
-			left = ( l1 + l2 + l3 + l4 ) >> 1;
-			right = ( r1 + r2 + r3 + r4 ) >> 1;
-
-			right = max( -32767, min( 32767, right ) );
-			left  = max( -32767, min( 32767, left ) );
-
-			if ( outputPWM )
-				putSample( left, right );
+			for ( u32 i = 0; i < 8; i++ )
+				audioGraphPut( i, sid[ i ]->output() );
 
-			if ( outputHDMISound )
-				putSampleHDMI( left << 8, right << 8 );
+			if ( !audioGraphAdvance() )
+				continue;
+	#endif
 
 		#if 1
-			// vu meter
-			static u32 vu_nValues = 0;
-			static float vu_Sum[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
-			
-			//if ( vu_Mode != 2 )
+			// vu meter and visualization of the block which has just been output
+			for ( u32 smp = 0; smp < AUDIO_BLOCK_SIZE; smp++ )
 			{
-				float t = (left+right) / (float)32768.0f * 0.5f;
-				vu_Sum[ 0 ] += t * t * 1.0f;
+				s32 left  = audioGraph.mixLeft[ smp ];
+				s32 right = audioGraph.mixRight[ smp ];
 
-				vu_Sum[ 1 ] += left * left/ (float)32768.0f / (float)32768.0f;
-				vu_Sum[ 2 ] += right * right / (float)32768.0f / (float)32768.0f;
-				//vu_Sum[ 3 ] += valOPL * valOPL / (float)32768.0f / (float)32768.0f;
-
-				if ( ++ vu_nValues == 256*2 )
+				// vu meter
+				static u32 vu_nValues = 0;
+				static float vu_Sum[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			
+				//if ( vu_Mode != 2 )
 				{
-					for ( u32 i = 0; i < 3; i++ )
+					float t = (left+right) / (float)32768.0f * 0.5f;
+					vu_Sum[ 0 ] += t * t * 1.0f;
+
+					vu_Sum[ 1 ] += left * left/ (float)32768.0f / (float)32768.0f;
+					vu_Sum[ 2 ] += right * right / (float)32768.0f / (float)32768.0f;
+					//vu_Sum[ 3 ] += valOPL * valOPL / (float)32768.0f / (float)32768.0f;
+
+					if ( ++ vu_nValues == 256*2 )
 					{
-						float vu_Volume = max( 0.0f, 2.0f * (log10( 0.1f + sqrt( (float)vu_Sum[ i ] / (float)vu_nValues ) ) + 1.0f) );
-						u32 v = vu_Volume * 1024.0f;
-						if ( i == 0 )
+						for ( u32 i = 0; i < 3; i++ )
 						{
-							// moving average
-							float v = min( 1.0f, (float)vuMeter[ 0 ] / 1024.0f );
-							static float led4Avg = 0.0f;
-							led4Avg = led4Avg * 0.8f + v * ( 1.0f - 0.8f );
-
-							vu_nLEDs = max( 0, min( 4, (led4Avg * 8.0f) ) );
-							if ( vu_nLEDs > 4 ) vu_nLEDs = 4;
+							float vu_Volume = max( 0.0f, 2.0f * (log10( 0.1f + sqrt( (float)vu_Sum[ i ] / (float)vu_nValues ) ) + 1.0f) );
+							u32 v = vu_Volume * 1024.0f;
+							if ( i == 0 )
+							{
+								// moving average
+								float v = min( 1.0f, (float)vuMeter[ 0 ] / 1024.0f );
+								static float led4Avg = 0.0f;
+								led4Avg = led4Avg * 0.8f + v * ( 1.0f - 0.8f );
+
+								vu_nLEDs = max( 0, min( 4, (led4Avg * 8.0f) ) );
+								if ( vu_nLEDs > 4 ) vu_nLEDs = 4;
+							}
+							vuMeter[ i ] = v;
+							vu_Sum[ i ] = 0;
 						}
-						vuMeter[ i ] = v;
-						vu_Sum[ i ] = 0;
-					}
 
-					vu_nValues = 0;
+						vu_nValues = 0;
+					}
 				}
-			}
 
-			// ugly code which renders 3 oscilloscopes (SID1, SID2, FM) to HDMI and 1 for the OLED
-			if ( screenType == 0 )
-			{
-				#include "oscilloscope_hack.h"
-			} else
-			if ( screenType == 1 )
-			{
-				const float scaleVis = 2.0f;
-				const u32 nLevelMeters = 2;
-				#include "tft_sid_vis.h"
-			} 
+				// ugly code which renders 3 oscilloscopes (SID1, SID2, FM) to HDMI and 1 for the OLED
+				if ( screenType == 0 )
+				{
+					#include "oscilloscope_hack.h"
+				} else
+				if ( screenType == 1 )
+				{
+					const float scaleVis = 2.0f;
+					const u32 nLevelMeters = 2;
+					#include "tft_sid_vis.h"
+				} 
+			}
 		#endif
 		}
 	#endif
@@ -840,7 +1017,6 @@ void CKernel::FIQHandler (void *pParam)
 	if ( !( launchPrg && !disableCart ) )
 	{
 		CACHE_PRELOADL1STRMW( &ringWrite );
-		CACHE_PRELOADL1STRM( &sampleBuffer[ smpLast ] );
 		CACHE_PRELOADL1STRM( &outRegisters[ 0 ] );
 		CACHE_PRELOADL1STRM( &outRegisters[ 16 ] );
 	}
@@ -856,10 +1032,13 @@ void CKernel::FIQHandler (void *pParam)
 	// |__) |__   /\  |  \    /__` | |  \ 
 	// |  \ |___ /~~\ |__/    .__/ | |__/ 
 	//
-	if ( cfgRegisterRead && CPU_READS_FROM_BUS && SID_ACCESS )
+	register u32 sidDec = SID8_DECODE_IGNORE;
+	if ( SID_ACCESS || IO1_OR_IO2_ACCESS )
+		sidDec = sidDecode[ GET_ADDRESS0to7 | ( ( GET_ADDRESS8to12 & 15 ) << 8 ) ];
+
+	if ( cfgRegisterRead && CPU_READS_FROM_BUS && !( sidDec & SID8_DECODE_IGNORE ) )
 	{
-		u32 A = ( g2 >> A0 ) & 31;
-		u32 D = outRegisters[ A ];
+		u32 D = outRegisters[ sidDec & 31 ];
 
 		WRITE_D0to7_TO_BUS( D )
 
@@ -870,15 +1049,11 @@ void CKernel::FIQHandler (void *pParam)
 	// |  | |__) |  |  |__     /__` | |  \ 
 	// |/\| |  \ |  |  |___    .__/ | |__/ 
 	//                                   
-	if ( CPU_WRITES_TO_BUS && SID_ACCESS ) 
+	if ( CPU_WRITES_TO_BUS && !( sidDec & SID8_DECODE_IGNORE ) ) 
 	{
 		//READ_D0to7_FROM_BUS( D )
 
-		register u32 A = GET_ADDRESS0to7 | ((GET_ADDRESS8to12&1)<<8);
-		register u32 whichSID = ((A>>6)&6) | ((A>>5)&1);
-		A &= 31;
-		
-		ringBufGPIO[ ringWrite ] = D | (A << 8) | (whichSID << 16);
+		ringBufGPIO[ ringWrite ] = D | ( sidDec << 8 );
 
 		//ringBufGPIO[ ringWrite ] = ( remapAddr | ( D << D0 ) ) & ~bIO2;
 		ringTime[ ringWrite ] = cycleCountC64;
@@ -894,70 +1069,6 @@ void CKernel::FIQHandler (void *pParam)
 		return;
 	}
 
-	//  __                 __       ___  __       ___ 
-	// |__) |  |  |\/|    /  \ |  |  |  |__) |  |  |  
-	// |    |/\|  |  |    \__/ \__/  |  |    \__/  |  
-	// OPTIONAL
-	//											
-	#ifdef USE_PWM_DIRECT
-	if ( outputPWM )
-	{
-		static unsigned long long samplesElapsedBeforeFIQ = 0;
-
-		unsigned long long samplesElapsedFIQ = ( ( unsigned long long )cycleCountC64 * ( unsigned long long )SAMPLERATE ) / ( unsigned long long )CLOCKFREQ;
-
-		if ( samplesElapsedFIQ != samplesElapsedBeforeFIQ )
-		{
-			write32( ARM_GPIO_GPCLR0, bCTRL257 ); 
-			samplesElapsedBeforeFIQ = samplesElapsedFIQ;
-
-			u32 s = getSample();
-			u16 s1 = s & 65535;
-			u16 s2 = s >> 16;
-			s32 d1 = (s32)( ( *(s16*)&s1 + 32768 ) * PWMRange ) >> 17;
-			s32 d2 = (s32)( ( *(s16*)&s2 + 32768 ) * PWMRange ) >> 17;
-			write32( ARM_PWM_DAT1, d1 );
-			write32( ARM_PWM_DAT2, d2 );
-			RESET_CPU_CYCLE_COUNTER
-			return;
-		} 
-	}
-	#endif
-	#ifdef HDMI_SOUND
-	if ( outputHDMISound )
-	{
-		static unsigned long long samplesElapsedBeforeFIQ = 0;
-		if ( first && nCyclesEmulated )
-		{
-			first = 0;
-			samplesElapsedBeforeFIQ = 0;
-		} 
-
-		if ( !first )
-		{
-			//unsigned long long samplesElapsedFIQ = ( ( unsigned long long )cycleCountC64 * ( unsigned long long )SAMPLERATE ) / ( unsigned long long )CLOCKFREQ;
-			unsigned long long samplesElapsedFIQ = ( ( unsigned long long )cycleCountC64 * ( unsigned long long )48000 ) / ( unsigned long long )CLOCKFREQ;
-			if ( samplesElapsedFIQ != samplesElapsedBeforeFIQ && !CPU_RESET )
-			{
-				write32( ARM_GPIO_GPCLR0, bCTRL257 ); 
-				samplesElapsedBeforeFIQ = samplesElapsedFIQ;
-
-				u32 s1, s2;
-				getSampleHDMI( &s1, &s2 );
-				if ( !( read32( RegMaiControl ) & BitMaiControlFull ) )
-				{
-					write32( RegMaiData, s1 );
-					write32( RegMaiData, s2 );
-				}
-
-				RESET_CPU_CYCLE_COUNTER
-				return;
-			}
-		}
-	} 
-	#endif
-	
-
 	//           ___  __       
 	// |     /\   |  /  ` |__| 
 	// |___ /~~\  |  \__, |  | 
@@ -98,6 +98,16 @@ extern CLogger	*logger;
 #endif
 
 
+//
+// render the SIDs on cores 1-3 while core 0 handles the bus, requires "multicore=1" (see Makefile);
+// SID8_SAMPLING is the reSID sampling method of the render cores, resampling costs about ten times as much as interpolation
+//
+#ifdef ARM_ALLOW_MULTI_CORE
+#define SID8_MULTICORE
+#define SID8_SAMPLING	SAMPLE_INTERPOLATE
+//#define SID8_SAMPLING	SAMPLE_RESAMPLE_FASTMEM
+#endif
+
 #ifndef min
 #define min( a, b ) ( ((a)<(b))?(a):(b) )
 #endif
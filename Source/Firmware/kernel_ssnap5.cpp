@@ -29,6 +29,7 @@
 */
 
 #include "kernel_ssnap5.h"
+#include "snapshot.h"
 
 // we will read this .CRT file 
 static const char DRIVE[] = "SD:";
@@ -114,6 +115,7 @@ static void initSS5()
 __attribute__( ( always_inline ) ) inline void callbackReset()
 {
 	initSS5();
+	snapshotReset();
 	latchSetClearImm( LATCH_LED0, 0 );
 }
 
@@ -206,6 +208,10 @@ void CKernelSS5::Run( void )
 	}
 	#endif
 
+	// freezer snapshots: register, RAM and state of the SS5
+	snapshotInit( "ss5" );
+	snapshotAddSection( (void*)&ss5, offsetof( SS5STATE, resetCounter ) );
+
 	// setup FIQ
 	DisableIRQs();
 	m_InputPin.ConnectInterrupt( FIQ_HANDLER, FIQ_PARENT );
@@ -258,6 +264,8 @@ void CKernelSS5::Run( void )
 		if ( ss5.resetCounter > 30 && ss5.resetReleased )
 			callbackReset();
 
+		snapshotUpdate();
+
 		asm volatile ("wfi");
 	}
 
@@ -283,6 +291,8 @@ void CKernelSS5::FIQHandler (void *pParam)
 	// starting from here we are in the CPU-half cycle
 	WAIT_AND_READ_ADDR8to12_ROMLH_IO12_BA
 
+	SNAPSHOT_FIQ( )
+
 	if ( ss5.hasKernal && ROMH_ACCESS && KERNAL_ACCESS && ( !ss5.ultimax || !ss5.active ) )
 	{
 		WRITE_D0to7_TO_BUS( kernalROM[ GET_ADDRESS ] );
@@ -372,7 +382,7 @@ void CKernelSS5::FIQHandler (void *pParam)
 	}
 
 	// freeze
-	if ( BUTTON_PRESSED && ( ss5.lastFreezeButton == 0 ) )
+	if ( SNAPSHOT_FREEZE_BUTTON && ( ss5.lastFreezeButton == 0 ) )
 	{
 		ss5.lastFreezeButton = 500000; // debouncing
 		ss5.freezeNMICycles  = 10;
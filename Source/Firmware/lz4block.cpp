@@ -0,0 +1,201 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ lz4block.cpp
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - fast LZ compression in the LZ4 block format
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "lz4block.h"
+#include <string.h>
+
+// positions + 1 of the last occurrence of each hashed 4-byte sequence (0 = none)
+static u32 lz4Hash[ 1 << LZ4_HASH_BITS ];
+
+static inline u32 lz4Read32( const u8 *p )
+{
+	u32 v;
+	memcpy( &v, p, 4 );
+	return v;
+}
+
+static inline u32 lz4HashOf( u32 v )
+{
+	return ( v * 2654435761u ) >> ( 32 - LZ4_HASH_BITS );
+}
+
+static inline u8 *lz4WriteLength( u8 *op, u32 len )
+{
+	for ( ; len >= 255; len -= 255 )
+		*( op ++ ) = 255;
+	*( op ++ ) = len;
+	return op;
+}
+
+// token and literals of a sequence, 0 if the output does not fit
+static inline u8 *lz4WriteLiterals( u8 *op, u8 *oend, const u8 *anchor, u32 nLiterals, u32 matchLength )
+{
+	if ( (u32)( oend - op ) < 1 + nLiterals / 255 + 1 + nLiterals + 2 + matchLength / 255 + 1 )
+		return 0;
+
+	u8 *token = op ++;
+	*token = ( nLiterals >= 15 ? 15 : nLiterals ) << 4;
+	if ( nLiterals >= 15 )
+		op = lz4WriteLength( op, nLiterals - 15 );
+
+	memcpy( op, anchor, nLiterals );
+	return op + nLiterals;
+}
+
+u32 lz4Compress( const u8 *src, u32 size, u8 *dst, u32 dstSize )
+{
+	const u8 *ip = src, *anchor = src, *iend = src + size;
+	u8 *op = dst, *oend = dst + dstSize;
+
+	memset( lz4Hash, 0, sizeof( lz4Hash ) );
+
+	if ( size > LZ4_MFLIMIT )
+	{
+		const u8 *mflimit = iend - LZ4_MFLIMIT, *matchlimit = iend - LZ4_LASTLITERALS;
+
+		while ( ip <= mflimit )
+		{
+			u32 seq = lz4Read32( ip ), h = lz4HashOf( seq );
+			u32 ref = lz4Hash[ h ];
+			lz4Hash[ h ] = ( ip - src ) + 1;
+
+			if ( ref == 0 || (u32)( ip - src ) + 1 - ref > LZ4_MAX_OFFSET || lz4Read32( src + ref - 1 ) != seq )
+			{
+				// skip faster through data which does not compress
+				ip += 1 + ( ( ip - anchor ) >> 7 );
+				continue;
+			}
+
+			const u8 *match = src + ref - 1;
+
+			// extend the match backwards into the literals and forwards
+			while ( ip > anchor && match > src && ip[ -1 ] == match[ -1 ] )
+				{ ip --; match --; }
+
+			u32 len = LZ4_MINMATCH;
+			while ( ip + len < matchlimit && ip[ len ] == match[ len ] )
+				len ++;
+
+			u8 *token = op;
+			if ( !( op = lz4WriteLiterals( op, oend, anchor, ip - anchor, len ) ) )
+				return 0;
+
+			u32 ofs = ip - match;
+			*( op ++ ) = ofs & 255;
+			*( op ++ ) = ofs >> 8;
+
+			len -= LZ4_MINMATCH;
+			*token |= len >= 15 ? 15 : len;
+			if ( len >= 15 )
+				op = lz4WriteLength( op, len - 15 );
+
+			ip += len + LZ4_MINMATCH;
+			anchor = ip;
+
+			// the position before the next one is likely to start a match later
+			if ( ip <= mflimit )
+				lz4Hash[ lz4HashOf( lz4Read32( ip - 2 ) ) ] = ( ip - 2 - src ) + 1;
+		}
+	}
+
+	// the last sequence contains only literals
+	if ( !( op = lz4WriteLiterals( op, oend, anchor, iend - anchor, 0 ) ) )
+		return 0;
+
+	return op - dst;
+}
+
+u32 lz4Decompress( const u8 *src, u32 size, u8 *dst, u32 dstSize )
+{
+	const u8 *ip = src, *iend = src + size;
+	u8 *op = dst, *oend = dst + dstSize;
+
+	while ( ip < iend )
+	{
+		u32 token = *( ip ++ );
+
+		u32 nLiterals = token >> 4;
+		if ( nLiterals == 15 )
+		{
+			u32 b;
+			do {
+				if ( ip >= iend ) return 0;
+				b = *( ip ++ );
+				nLiterals += b;
+			} while ( b == 255 );
+		}
+
+		if ( nLiterals > (u32)( iend - ip ) || nLiterals > (u32)( oend - op ) )
+			return 0;
+
+		memcpy( op, ip, nLiterals );
+		op += nLiterals;
+		ip += nLiterals;
+
+		// the last sequence has no match
+		if ( ip >= iend )
+			break;
+
+		if ( iend - ip < 2 )
+			return 0;
+
+		u32 ofs = ip[ 0 ] | ( ip[ 1 ] << 8 );
+		ip += 2;
+
+		if ( ofs == 0 || ofs > (u32)( op - dst ) )
+			return 0;
+
+		u32 len = token & 15;
+		if ( len == 15 )
+		{
+			u32 b;
+			do {
+				if ( ip >= iend ) return 0;
+				b = *( ip ++ );
+				len += b;
+			} while ( b == 255 );
+		}
+		len += LZ4_MINMATCH;
+
+		if ( len > (u32)( oend - op ) )
+			return 0;
+
+		// matches may overlap with their own output
+		const u8 *match = op - ofs;
+		if ( ofs >= 8 )
+		{
+			for ( ; len >= 8; len -= 8, op += 8, match += 8 )
+				memcpy( op, match, 8 );
+		}
+		while ( len -- )
+			*( op ++ ) = *( match ++ );
+	}
+
+	return op - dst;
+}
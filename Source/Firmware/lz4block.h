@@ -0,0 +1,53 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ lz4block.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - fast LZ compression in the LZ4 block format
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _lz4block_h_
+#define _lz4block_h_
+
+#include <circle/types.h>
+
+//
+// fast LZ compression in the LZ4 block format (greedy parsing, 4096-entry hash table):
+// sequences of a token (4 bits literal length, 4 bits match length - 4), the literals, a 16-bit offset
+// and length extensions in bytes of 255; the last 5 bytes are literals and no match starts in the last 12 bytes
+//
+#define LZ4_MINMATCH		4
+#define LZ4_LASTLITERALS	5
+#define LZ4_MFLIMIT			12
+#define LZ4_HASH_BITS		12
+#define LZ4_MAX_OFFSET		65535
+
+// worst case size of the compressed data (incompressible input)
+#define LZ4_COMPRESS_BOUND( size )	( (size) + (size) / 255 + 16 )
+
+// both return the size of the output, or 0 if it does not fit into dstSize or (decompression) the input is corrupt
+extern u32 lz4Compress( const u8 *src, u32 size, u8 *dst, u32 dstSize );
+extern u32 lz4Decompress( const u8 *src, u32 size, u8 *dst, u32 dstSize );
+
+#endif
@@ -0,0 +1,140 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ menusched.cpp
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - per-frame task scheduler for the menu (cost estimates, priorities, deferral, timing stats)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "menusched.h"
+#include "helpers.h"
+#include <circle/timer.h>
+
+static MENUSCHEDTASK menuSchedTask[ MENUSCHED_MAX_TASKS ];
+static u32 menuSchedNTasks = 0;
+static u32 menuSchedFrameStart, menuSchedBudget;
+static u32 menuSchedNFrames = 0, menuSchedNOverBudget = 0, menuSchedOverBudget;
+
+u32 menuSchedAddTask( const char *name, u32 priority, u32 costEstimate, u32 maxDefer )
+{
+	// tasks are registered once per kernel start, re-registering a name keeps the statistics
+	for ( u32 i = 0; i < menuSchedNTasks; i++ )
+		if ( strcmp( menuSchedTask[ i ].name, name ) == 0 )
+			return i;
+
+	if ( menuSchedNTasks >= MENUSCHED_MAX_TASKS )
+		return MENUSCHED_NO_TASK;
+
+	MENUSCHEDTASK *t = &menuSchedTask[ menuSchedNTasks ];
+	memset( t, 0, sizeof( MENUSCHEDTASK ) );
+	t->name = name;
+	t->priority = priority;
+	t->costEstimate = costEstimate;
+	t->maxDefer = maxDefer;
+
+	return menuSchedNTasks ++;
+}
+
+void menuSchedBeginFrame( u32 budget, u32 taskMask )
+{
+	menuSchedFrameStart = CTimer::GetClockTicks();
+	menuSchedBudget = budget;
+	menuSchedNFrames ++;
+	menuSchedOverBudget = 0;
+
+	for ( u32 i = 0; i < menuSchedNTasks; i++ )
+	{
+		menuSchedTask[ i ].pending = ( taskMask >> i ) & 1;
+		menuSchedTask[ i ].started = 0;
+	}
+}
+
+int menuSchedBegin( u32 task )
+{
+	if ( task >= menuSchedNTasks )
+		return 1;
+
+	MENUSCHEDTASK *t = &menuSchedTask[ task ];
+	u32 now = CTimer::GetClockTicks();
+	u32 elapsed = now - menuSchedFrameStart;
+	t->pending = 0;
+
+	int run = 1;
+	if ( t->priority > 0 && !( t->maxDefer && t->deferredInRow >= t->maxDefer ) )
+	{
+		// keep the time for pending tasks which are more important
+		u32 reserved = 0;
+		for ( u32 i = 0; i < menuSchedNTasks; i++ )
+			if ( menuSchedTask[ i ].pending && menuSchedTask[ i ].priority < t->priority )
+				reserved += menuSchedTask[ i ].costEstimate;
+
+		if ( elapsed + reserved + t->costEstimate > menuSchedBudget )
+			run = 0;
+	}
+
+	if ( !run )
+	{
+		t->nDeferred ++;
+		t->deferredInRow ++;
+		return 0;
+	}
+
+	t->deferredInRow = 0;
+	t->started = now;
+	return 1;
+}
+
+void menuSchedEnd( u32 task )
+{
+	if ( task >= menuSchedNTasks )
+		return;
+
+	MENUSCHEDTASK *t = &menuSchedTask[ task ];
+	u32 now = CTimer::GetClockTicks();
+	u32 d = now - t->started;
+
+	t->nRuns ++;
+	t->lastTime = d;
+	t->totalTime += d;
+	t->maxTime = max( t->maxTime, d );
+	// moving average, reacts within a few frames when skin effects change
+	t->costEstimate = ( t->costEstimate * 3 + d + 3 ) / 4;
+
+	if ( !menuSchedOverBudget && now - menuSchedFrameStart > menuSchedBudget )
+	{
+		menuSchedOverBudget = 1;
+		menuSchedNOverBudget ++;
+	}
+}
+
+void menuSchedLogStats( CLogger *logger )
+{
+	logger->Write( "RaspiMenu", LogNotice, "%d frames, %d over budget (%d us)", menuSchedNFrames, menuSchedNOverBudget, menuSchedBudget );
+	for ( u32 i = 0; i < menuSchedNTasks; i++ )
+	{
+		MENUSCHEDTASK *t = &menuSchedTask[ i ];
+		logger->Write( "RaspiMenu", LogNotice, "  %-10s prio %d: runs %d, deferred %d, est %d us, avg %d us, max %d us", t->name, t->priority, t->nRuns, t->nDeferred,
+			t->costEstimate, t->nRuns ? (u32)( t->totalTime / t->nRuns ) : 0, t->maxTime );
+	}
+}
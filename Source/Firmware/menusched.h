@@ -0,0 +1,76 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ menusched.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - per-frame task scheduler for the menu (cost estimates, priorities, deferral, timing stats)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _menusched_h
+#define _menusched_h
+
+#include <circle/types.h>
+#include <circle/util.h>
+#include <circle/logger.h>
+
+//
+// every screen update requested by the C64 (one per C64 frame at most) is a scheduler frame with a time budget.
+// Tasks declare a priority and an initial cost estimate (refined from measured run times). Priority 0 tasks
+// always run; any other task only runs if its estimate fits into the remaining budget after reserving time
+// for the pending tasks of higher priority, otherwise it is deferred to the next frame (at most 'maxDefer' times in a row)
+//
+#define MENUSCHED_MAX_TASKS		8
+#define MENUSCHED_NO_TASK		0xffffffff	// returned by menuSchedAddTask if the table is full, such a task always runs (untimed)
+#define MENUSCHED_TASK_BIT( t )	( (t) < MENUSCHED_MAX_TASKS ? 1 << (t) : 0 )
+#define MENUSCHED_BUDGET_PAL	( 19656 / 2 )	// in us, half a frame
+#define MENUSCHED_BUDGET_NTSC	( 17095 / 2 )
+
+typedef struct
+{
+	const char *name;
+	u32 priority;			// 0 = mandatory, higher values are deferred first
+	u32 maxDefer;			// 0 = can be deferred forever
+	u32 costEstimate;		// in us
+
+	// per frame
+	u32 pending, started;
+
+	// statistics
+	u32 nRuns, nDeferred, deferredInRow;
+	u32 lastTime, maxTime;
+	u64 totalTime;
+} MENUSCHEDTASK;
+
+extern u32  menuSchedAddTask( const char *name, u32 priority, u32 costEstimate, u32 maxDefer );
+
+// starts a frame, all tasks in 'taskMask' (bit = task index) are expected to be asked for with menuSchedBegin
+extern void menuSchedBeginFrame( u32 budget, u32 taskMask );
+
+// returns 1 if the task should run now (and starts timing it), 0 if it is deferred
+extern int  menuSchedBegin( u32 task );
+extern void menuSchedEnd( u32 task );
+
+extern void menuSchedLogStats( CLogger *logger );
+
+#endif
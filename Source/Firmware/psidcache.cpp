@@ -0,0 +1,177 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ psidcache.cpp
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - cache for PSID to PRG conversions (RAM and SD card)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "psidcache.h"
+#include "helpers.h"
+#include <fatfs/ff.h>
+#include <stdio.h>
+
+typedef struct
+{
+	u64 hash;
+	u32 size;
+	u32 lastUse;
+	u8  *data;
+} PSIDCACHEENTRY;
+
+static PSIDCACHEENTRY psidCacheRAM[ PSIDCACHE_RAM_ENTRIES ];
+static u32 psidCacheTime = 0;
+static int psidCacheDirChecked = 0;
+static u32 psidCacheSubdirChecked[ 256 / 32 ];
+
+// 64-bit FNV-1a, seeded with the cache version and the salt such that old conversions are not used anymore
+u64 psidCacheHash( const u8 *data, u32 size, u64 salt )
+{
+	u64 h = 0xcbf29ce484222325ULL ^ PSIDCACHE_VERSION;
+	for ( u32 i = 0; i < 8; i++ )
+	{
+		h ^= ( salt >> ( i * 8 ) ) & 255;
+		h *= 0x100000001b3ULL;
+	}
+	for ( u32 i = 0; i < size; i++ )
+	{
+		h ^= data[ i ];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static inline u32 psidCacheSubdir( u64 hash )
+{
+	return (u32)( hash >> 56 );
+}
+
+static void psidCacheFilename( char *filename, u64 hash )
+{
+	sprintf( filename, "%s/%02x/%x.prg", PSIDCACHE_PATH, psidCacheSubdir( hash ), (u32)( hash >> 32 ) % PSIDCACHE_SD_WAYS );
+}
+
+static PSIDCACHEENTRY *psidCacheFindRAM( u64 hash )
+{
+	for ( u32 i = 0; i < PSIDCACHE_RAM_ENTRIES; i++ )
+		if ( psidCacheRAM[ i ].data && psidCacheRAM[ i ].hash == hash )
+			return &psidCacheRAM[ i ];
+	return NULL;
+}
+
+static void psidCacheInsertRAM( u64 hash, const u8 *prg, u32 size )
+{
+	if ( psidCacheFindRAM( hash ) )
+		return;
+
+	// replace an empty or the least recently used entry
+	PSIDCACHEENTRY *e = &psidCacheRAM[ 0 ];
+	for ( u32 i = 0; i < PSIDCACHE_RAM_ENTRIES; i++ )
+	{
+		if ( !psidCacheRAM[ i ].data ) { e = &psidCacheRAM[ i ]; break; }
+		if ( psidCacheRAM[ i ].lastUse < e->lastUse ) e = &psidCacheRAM[ i ];
+	}
+
+	if ( e->data )
+		delete [] e->data;
+
+	e->data = new u8[ size ];
+	memcpy( e->data, prg, size );
+	e->hash = hash;
+	e->size = size;
+	e->lastUse = ++ psidCacheTime;
+}
+
+int psidCacheLookup( CLogger *logger, const char *DRIVE, u64 hash, u8 *prg, u32 *size )
+{
+	PSIDCACHEENTRY *e = psidCacheFindRAM( hash );
+	if ( e )
+	{
+		memcpy( prg, e->data, e->size );
+		*size = e->size;
+		e->lastUse = ++ psidCacheTime;
+		return 1;
+	}
+
+	char filename[ 64 ];
+	psidCacheFilename( filename, hash );
+
+	u32 fileSize;
+	if ( !getFileSize( logger, DRIVE, filename, &fileSize ) || fileSize <= sizeof( PSIDCACHEHEADER ) || fileSize > sizeof( PSIDCACHEHEADER ) + 65536 )
+		return 0;
+
+	u8 *buf = new u8[ fileSize ];
+	PSIDCACHEHEADER *hdr = (PSIDCACHEHEADER *)buf;
+
+	int ok = readFile( logger, DRIVE, filename, buf, &fileSize, fileSize ) &&
+			 hdr->magic == PSIDCACHE_MAGIC && hdr->version == PSIDCACHE_VERSION && hdr->hash == hash &&
+			 hdr->size == fileSize - sizeof( PSIDCACHEHEADER );
+
+	if ( ok )
+	{
+		*size = hdr->size;
+		memcpy( prg, buf + sizeof( PSIDCACHEHEADER ), hdr->size );
+		psidCacheInsertRAM( hash, prg, hdr->size );
+	}
+
+	delete [] buf;
+	return ok;
+}
+
+void psidCacheInsert( CLogger *logger, const char *DRIVE, u64 hash, const u8 *prg, u32 size )
+{
+	psidCacheInsertRAM( hash, prg, size );
+
+	// make sure the cache directory and the subdirectory exist (each once per boot)
+	u32 subdir = psidCacheSubdir( hash );
+	if ( !psidCacheDirChecked || !( psidCacheSubdirChecked[ subdir / 32 ] & ( 1 << ( subdir & 31 ) ) ) )
+	{
+		char path[ 32 ];
+		sprintf( path, "%s/%02x", PSIDCACHE_PATH, subdir );
+
+		if ( fsMount( DRIVE ) != FR_OK )
+			logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: %s", DRIVE );
+		if ( !psidCacheDirChecked )
+			f_mkdir( PSIDCACHE_PATH );
+		f_mkdir( path );
+		if ( fsUnmount( DRIVE ) != FR_OK )
+			logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
+		psidCacheDirChecked = 1;
+		psidCacheSubdirChecked[ subdir / 32 ] |= 1 << ( subdir & 31 );
+	}
+
+	u8 *buf = new u8[ sizeof( PSIDCACHEHEADER ) + size ];
+	PSIDCACHEHEADER *hdr = (PSIDCACHEHEADER *)buf;
+	hdr->magic = PSIDCACHE_MAGIC;
+	hdr->version = PSIDCACHE_VERSION;
+	hdr->hash = hash;
+	hdr->size = size;
+	memcpy( buf + sizeof( PSIDCACHEHEADER ), prg, size );
+
+	char filename[ 64 ];
+	psidCacheFilename( filename, hash );
+	writeFile( logger, DRIVE, filename, buf, sizeof( PSIDCACHEHEADER ) + size );
+
+	delete [] buf;
+}
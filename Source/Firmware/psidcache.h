@@ -0,0 +1,63 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ psidcache.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - cache for PSID to PRG conversions (RAM and SD card)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _psidcache_h
+#define _psidcache_h
+
+#include <circle/types.h>
+#include <circle/util.h>
+#include <circle/logger.h>
+
+// converted PRGs are kept in RAM (most recently used ones) and on SD, keyed by a hash of the .sid file contents
+// on SD the cache is direct mapped: the hash selects one of 256 subdirectories and one of PSIDCACHE_SD_WAYS files within,
+// a conversion replaces whatever was stored there before (the header tells which tune a file holds), this bounds the
+// number of files to 256 * PSIDCACHE_SD_WAYS and keeps each (linearly searched) directory short
+#define PSIDCACHE_PATH			"SD:PSIDCACHE"
+#define PSIDCACHE_SD_WAYS		16
+#define PSIDCACHE_RAM_ENTRIES	16
+#define PSIDCACHE_MAGIC			0x43445350		// "PSDC"
+#define PSIDCACHE_VERSION		2				// increase when the converter output changes
+
+typedef struct
+{
+	u32 magic;
+	u32 version;
+	u64 hash;
+	u32 size;
+} __attribute__((packed)) PSIDCACHEHEADER;
+
+// 'salt' identifies everything else the conversion depends on (e.g. the HVSC database version)
+extern u64  psidCacheHash( const u8 *data, u32 size, u64 salt );
+
+// returns 1 and copies the PRG to 'prg' if the conversion of the tune with this hash is cached
+extern int  psidCacheLookup( CLogger *logger, const char *DRIVE, u64 hash, u8 *prg, u32 *size );
+
+extern void psidCacheInsert( CLogger *logger, const char *DRIVE, u64 hash, const u8 *prg, u32 size );
+
+#endif
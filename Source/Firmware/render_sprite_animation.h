@@ -76,6 +76,32 @@ if ( firstD )
 	memset( bitmap, 0, 64 * 64 );
 firstD = 0;
 
+if ( animationDelta )
+{
+	// delta-compressed animation: animationState holds the current frame, one XOR block per step
+	const SKANIMHEADER *h = (const SKANIMHEADER *)animationRLE;
+	u8 *frame = (u8*)animationState;
+
+	for ( int y = 0; y < 147; y++ )
+	{
+		for ( int x = 0; x < 192 / 8; x++ )
+		{
+			int retVal = frame[ x + y * 192 / 8 ] & ~framebuffer[ x + 8 + min( 199, ( y + 6*8 + 1 )) * 320/8 ];
+
+			int bx = (x * 8) / 24;
+			int byteX = ( (x * 8) % 24 ) / 8;
+			bitmap[ (y / 21) * 8 * 64 + bx * 64 + (y % 21) * 3 + byteX ] = retVal & 255;
+		}
+	}
+
+	if ( skinValues.SKIN_BACKGROUND_GFX_LOOP == 1 || h->nFrames == 1 )
+		animDir = 1; else
+	if ( ( animDir > 0 && curFrame == h->nFrames - 1 ) || ( animDir < 0 && curFrame == 0 ) )
+		animDir = -animDir;
+
+	curFrame = skAnimStep( animationRLE, frame, curFrame, animDir );
+} else
+{
 for ( int y = 0; y < 147; y++ )
 {
 	for ( int x = 0; x < 192 / 8; x++ )
@@ -117,3 +143,4 @@ if ( skinValues.SKIN_BACKGROUND_GFX_LOOP == 1 )
 			animDir = -animDir;
 	} 
 }
+}
@@ -241,7 +241,7 @@ void EnvelopeGenerator::clock(cycle_count delta_t)
       if (unlikely(rate_counter & 0x8000)) {
         ++rate_counter &= 0x7fff;
       }
-      return;
+      break;
     }
 
     rate_counter = 0;
@@ -305,6 +305,10 @@ void EnvelopeGenerator::clock(cycle_count delta_t)
 
     rate_step = rate_period;
   }
+
+  // ENV3 is only sampled by single cycle clocking, keep it readable here
+  // (without the pipeline delay, like the counter itself).
+  env3 = envelope_counter;
 }
 
 /**
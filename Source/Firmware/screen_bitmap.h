@@ -0,0 +1,184 @@
+/*
+  _________.__    .___      __   .__        __            _____                       
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __       /     \   ____   ____  __ __ 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /      /  \ /  \_/ __ \ /    \|  |  \
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <      /    Y    \  ___/|   |  \  |  /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \____|__  /\___  >___|  /____/ 
+        \/         \/    \/     \/       \/     \/             \/     \/     \/       
+ 
+ screen_bitmap.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - text screen to bitmap conversion with dilation (mask for the background sprite layer)
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _screen_bitmap_h
+#define _screen_bitmap_h
+
+#include <circle/types.h>
+#include <circle/util.h>
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+//
+// the text screen (40x25, text rows SB_FIRST_ROW..24, columns 1..38) is converted into a 320x200 1-bit mask
+// where every set pixel is dilated by one pixel in all 8 directions. Instead of OR-ing every glyph row into
+// three framebuffer rows, this works in three passes over whole rows:
+//   1. glyph expansion: 8 characters at a time, their 8x8 glyphs transposed into 8 bitmap rows
+//   2. horizontal dilation of every bitmap row (shifts with carry from the neighboring bytes)
+//   3. vertical dilation: OR of three consecutive rows
+// text rows without any character are skipped in the first two passes (the menu screens have many of them)
+//
+#define SB_FIRST_ROW	8
+#define SB_ROWS			( ( 25 - SB_FIRST_ROW ) * 8 )
+#define SB_STRIDE		48		// 40 bytes + 1 byte padding left + padding to 16 bytes
+
+// glyph rows (1 byte padding on the left), then horizontally dilated rows (2 rows padding on top, 1 at the bottom)
+static u8 sbGlyph[ SB_ROWS * SB_STRIDE + 16 ] AAA;
+static u8 sbDilated[ ( SB_ROWS + 3 ) * SB_STRIDE ] AAA;
+static u8 sbRowUsed[ 25 ];
+
+static void screenToBitmapDilated( u8 *framebuffer, const u8 *screen, const u8 *font )
+{
+	memset( framebuffer, 0, SB_FIRST_ROW * 8 * 320 / 8 - 320 / 8 );
+
+	//
+	// 1. glyph expansion
+	//
+	for ( u32 j = SB_FIRST_ROW; j < 25; j++ )
+	{
+		u8 *dst = &sbGlyph[ ( j - SB_FIRST_ROW ) * 8 * SB_STRIDE + 1 ];
+
+		sbRowUsed[ j ] = 0;
+		for ( u32 i = 1; i < 39; i++ )
+			sbRowUsed[ j ] |= ( screen[ j * 40 + i ] & 127 ) != 32;
+		if ( !sbRowUsed[ j ] )
+			continue;
+
+		for ( u32 i = 0; i < 40; i += 8 )
+		{
+			u64 g[ 8 ];
+			for ( u32 k = 0; k < 8; k++ )
+			{
+				u32 c = screen[ j * 40 + i + k ];
+				if ( c == 32 || c == 32 + 128 || i + k == 0 || i + k == 39 )
+					g[ k ] = 0; else
+					memcpy( &g[ k ], &font[ c * 8 ], 8 );
+			}
+
+		#ifdef __ARM_NEON
+			// 8x8 byte transpose: glyph k, row b -> bitmap row b, byte k
+			uint8x8x2_t a0 = vtrn_u8( vcreate_u8( g[ 0 ] ), vcreate_u8( g[ 1 ] ) );
+			uint8x8x2_t a1 = vtrn_u8( vcreate_u8( g[ 2 ] ), vcreate_u8( g[ 3 ] ) );
+			uint8x8x2_t a2 = vtrn_u8( vcreate_u8( g[ 4 ] ), vcreate_u8( g[ 5 ] ) );
+			uint8x8x2_t a3 = vtrn_u8( vcreate_u8( g[ 6 ] ), vcreate_u8( g[ 7 ] ) );
+
+			uint16x4x2_t b0 = vtrn_u16( vreinterpret_u16_u8( a0.val[ 0 ] ), vreinterpret_u16_u8( a1.val[ 0 ] ) );
+			uint16x4x2_t b1 = vtrn_u16( vreinterpret_u16_u8( a0.val[ 1 ] ), vreinterpret_u16_u8( a1.val[ 1 ] ) );
+			uint16x4x2_t b2 = vtrn_u16( vreinterpret_u16_u8( a2.val[ 0 ] ), vreinterpret_u16_u8( a3.val[ 0 ] ) );
+			uint16x4x2_t b3 = vtrn_u16( vreinterpret_u16_u8( a2.val[ 1 ] ), vreinterpret_u16_u8( a3.val[ 1 ] ) );
+
+			uint32x2x2_t c0 = vtrn_u32( vreinterpret_u32_u16( b0.val[ 0 ] ), vreinterpret_u32_u16( b2.val[ 0 ] ) );
+			uint32x2x2_t c1 = vtrn_u32( vreinterpret_u32_u16( b1.val[ 0 ] ), vreinterpret_u32_u16( b3.val[ 0 ] ) );
+			uint32x2x2_t c2 = vtrn_u32( vreinterpret_u32_u16( b0.val[ 1 ] ), vreinterpret_u32_u16( b2.val[ 1 ] ) );
+			uint32x2x2_t c3 = vtrn_u32( vreinterpret_u32_u16( b1.val[ 1 ] ), vreinterpret_u32_u16( b3.val[ 1 ] ) );
+
+			vst1_u8( dst + i + 0 * SB_STRIDE, vreinterpret_u8_u32( c0.val[ 0 ] ) );
+			vst1_u8( dst + i + 1 * SB_STRIDE, vreinterpret_u8_u32( c1.val[ 0 ] ) );
+			vst1_u8( dst + i + 2 * SB_STRIDE, vreinterpret_u8_u32( c2.val[ 0 ] ) );
+			vst1_u8( dst + i + 3 * SB_STRIDE, vreinterpret_u8_u32( c3.val[ 0 ] ) );
+			vst1_u8( dst + i + 4 * SB_STRIDE, vreinterpret_u8_u32( c0.val[ 1 ] ) );
+			vst1_u8( dst + i + 5 * SB_STRIDE, vreinterpret_u8_u32( c1.val[ 1 ] ) );
+			vst1_u8( dst + i + 6 * SB_STRIDE, vreinterpret_u8_u32( c2.val[ 1 ] ) );
+			vst1_u8( dst + i + 7 * SB_STRIDE, vreinterpret_u8_u32( c3.val[ 1 ] ) );
+		#else
+			const u8 *gb = (const u8 *)g;
+			for ( u32 k = 0; k < 8; k++ )
+				for ( u32 b = 0; b < 8; b++ )
+					dst[ i + k + b * SB_STRIDE ] = gb[ k * 8 + b ];
+		#endif
+		}
+	}
+
+	//
+	// 2. horizontal dilation: byte k gets its own pixels shifted left/right, plus the boundary pixels of bytes k-1 and k+1
+	//
+	memset( sbDilated, 0, 2 * SB_STRIDE );
+	memset( sbDilated + ( SB_ROWS + 2 ) * SB_STRIDE, 0, SB_STRIDE );
+
+	for ( u32 y = 0; y < SB_ROWS; y++ )
+	{
+		const u8 *s = &sbGlyph[ y * SB_STRIDE ];
+		u8 *d = &sbDilated[ ( y + 2 ) * SB_STRIDE ];
+
+		if ( !sbRowUsed[ SB_FIRST_ROW + y / 8 ] )
+		{
+			memset( d, 0, 8 * SB_STRIDE );
+			y += 7;
+			continue;
+		}
+
+	#ifdef __ARM_NEON
+		for ( u32 k = 0; k < 48; k += 16 )
+		{
+			uint8x16_t l = vld1q_u8( s + k );
+			uint8x16_t c = vld1q_u8( s + k + 1 );
+			uint8x16_t r = vld1q_u8( s + k + 2 );
+			uint8x16_t v = vorrq_u8( vorrq_u8( c, vshlq_n_u8( c, 1 ) ), vshrq_n_u8( c, 1 ) );
+			v = vorrq_u8( v, vorrq_u8( vshlq_n_u8( l, 7 ), vshrq_n_u8( r, 7 ) ) );
+			vst1q_u8( d + k, v );
+		}
+	#else
+		// 8 bytes at a time, the masks remove the bits shifted across byte boundaries
+		for ( u32 k = 0; k < 40; k += 8 )
+		{
+			u64 l, c, r;
+			memcpy( &l, s + k, 8 );
+			memcpy( &c, s + k + 1, 8 );
+			memcpy( &r, s + k + 2, 8 );
+			u64 v = c | ( ( c << 1 ) & 0xfefefefefefefefeULL ) | ( ( c >> 1 ) & 0x7f7f7f7f7f7f7f7fULL ) |
+					( ( l << 7 ) & 0x8080808080808080ULL ) | ( ( r >> 7 ) & 0x0101010101010101ULL );
+			memcpy( d + k, &v, 8 );
+		}
+	#endif
+	}
+
+	//
+	// 3. vertical dilation, framebuffer rows SB_FIRST_ROW * 8 - 1 to 199
+	//
+	for ( u32 y = 0; y < SB_ROWS + 1; y++ )
+	{
+		const u8 *s = &sbDilated[ y * SB_STRIDE ];
+		u8 *d = &framebuffer[ ( SB_FIRST_ROW * 8 - 1 + y ) * 320 / 8 ];
+
+	#ifdef __ARM_NEON
+		for ( u32 k = 0; k < 32; k += 16 )
+			vst1q_u8( d + k, vorrq_u8( vorrq_u8( vld1q_u8( s + k ), vld1q_u8( s + k + SB_STRIDE ) ), vld1q_u8( s + k + 2 * SB_STRIDE ) ) );
+		vst1_u8( d + 32, vorr_u8( vorr_u8( vld1_u8( s + 32 ), vld1_u8( s + 32 + SB_STRIDE ) ), vld1_u8( s + 32 + 2 * SB_STRIDE ) ) );
+	#else
+		for ( u32 k = 0; k < 40; k += 8 )
+		{
+			u64 *dst = (u64 *)( d + k );
+			*dst = *(const u64 *)( s + k ) | *(const u64 *)( s + k + SB_STRIDE ) | *(const u64 *)( s + k + 2 * SB_STRIDE );
+		}
+	#endif
+	}
+}
+
+#endif
@@ -0,0 +1,319 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ snapshot.cpp
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - freezer snapshots: capture to and restore from SD card
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <circle/logger.h>
+#include <circle/util.h>
+#include "snapshot.h"
+#include "lz4block.h"
+#include "coretask.h"
+
+static const char DRIVE[] = "SD:";
+
+volatile SNAPSHOT_FIQSTATE snapshot AAA;
+
+// Ultimax code of C64Side/snapshot.a, the vectors are set in snapshotInit
+static const u8 snapshotCode[] = {
+#include "snapshot_ultimax.h"
+};
+
+static u8 snapshotROM[ 8192 ] AAA;
+static u8 snapshotCapture[ SNAPSHOT_C64_SIZE + 128 ] AAA;
+static u8 snapshotRestore[ SNAPSHOT_C64_SIZE + 128 ] AAA;
+static u8 snapshotCart[ SNAPSHOT_CART_SIZE ] AAA;
+static u8 snapshotFile[ sizeof( SNAPSHOT_HEADER ) + LZ4_COMPRESS_BOUND( SNAPSHOT_C64_SIZE ) + LZ4_COMPRESS_BOUND( SNAPSHOT_CART_SIZE ) ] AAA;
+
+// main loop side
+#define PHASE_IDLE			0
+#define PHASE_CAPTURE		1			// waiting for the transfer code to send everything
+#define PHASE_COMPRESS		2			// compressing on a spare core
+#define PHASE_RESTORE		3			// waiting for the transfer code to start
+
+#define SNAPSHOT_CORE		1
+
+static volatile u32 phase = PHASE_IDLE;
+static char kernelName[ 16 ];
+static char filename[ 64 ];
+static u32 nSections;
+static u8 *sectionData[ SNAPSHOT_MAX_SECTIONS ];
+static u32 sectionSize[ SNAPSHOT_MAX_SECTIONS ];
+static u32 fileSize;
+
+void snapshotInit( const char *kernel )
+{
+	memset( (void*)&snapshot, 0, sizeof( SNAPSHOT_FIQSTATE ) );
+	snapshot.rom = snapshotROM;
+	snapshot.capture = snapshotCapture;
+	snapshot.restore = snapshotRestore;
+
+	// NMI, RESET and IRQ vector point to the beginning of the code at $e000
+	memset( snapshotROM, 0, 8192 );
+	memcpy( snapshotROM, snapshotCode, sizeof( snapshotCode ) );
+	for ( u32 i = 0x1ffa; i < 0x2000; i += 2 )
+	{
+		snapshotROM[ i + 0 ] = 0x00;
+		snapshotROM[ i + 1 ] = 0xe0;
+	}
+
+	strncpy( kernelName, kernel, 15 );
+	kernelName[ 15 ] = 0;
+	strcpy( filename, "SD:Freezer/" );
+	strcat( filename, kernelName );
+	strcat( filename, ".snapshot" );
+
+	// the C64 memory is the first section, the kernel adds its cartridge state
+	nSections = 1;
+	sectionData[ 0 ] = snapshotCapture;
+	sectionSize[ 0 ] = SNAPSHOT_C64_SIZE;
+
+	phase = PHASE_IDLE;
+	coreTaskInit();
+}
+
+void snapshotAddSection( void *data, u32 size )
+{
+	if ( nSections >= SNAPSHOT_MAX_SECTIONS )
+		return;
+
+	sectionData[ nSections ] = (u8*)data;
+	sectionSize[ nSections ] = size;
+	nSections ++;
+}
+
+void snapshotReset()
+{
+	if ( snapshot.state == SNAPSHOT_TRIGGER || snapshot.state == SNAPSHOT_NMI )
+		SET_GPIO( bNMI );
+
+	snapshot.state = SNAPSHOT_OFF;
+	snapshot.request = SNAPSHOT_REQ_NONE;
+	snapshot.buttonCycles = snapshot.releaseCycles = 0;
+	snapshot.freezeRequest = 0;
+
+	// an ongoing compression and write will complete
+	if ( phase != PHASE_COMPRESS )
+		phase = PHASE_IDLE;
+}
+
+// the code and the stream need to be in the cache when the FIQ accesses them
+static void snapshotPrepareFIQ( u8 *stream, u32 size )
+{
+	snapshot.pos = 0;
+	snapshot.size = size;
+	snapshot.next = stream[ 0 ];
+
+	CACHE_PRELOAD_DATA_CACHE( snapshotROM, 1024, CACHE_PRELOADL2KEEP )
+	CACHE_PRELOAD_DATA_CACHE( &snapshotROM[ 8192 - 64 ], 64, CACHE_PRELOADL2KEEP )
+	CACHE_PRELOAD_DATA_CACHE( stream, 4096, CACHE_PRELOADL2KEEP )
+	CACHE_PRELOAD_DATA_CACHE( &snapshot, sizeof( SNAPSHOT_FIQSTATE ), CACHE_PRELOADL1KEEP )
+}
+
+// what the transfer code restores in any case: $0200-$03ff, $0100-$01ff, $0000-$00ff and the stack pointer
+static u32 snapshotBuildTail( u8 *dst, const u8 *c64 )
+{
+	memcpy( dst, &c64[ SNAPSHOT_C64_RAM + 0x200 ], 0x200 );
+	memcpy( dst + 0x200, &c64[ SNAPSHOT_C64_RAM + 0x100 ], 0x100 );
+	memcpy( dst + 0x300, &c64[ SNAPSHOT_C64_RAM ], 0x100 );
+	dst[ 0x400 ] = c64[ SNAPSHOT_C64_SP ];
+	return 0x401;
+}
+
+// everything in the order the transfer code expects it: $0400-$ffff, VIC, color RAM, CIAs, then the above
+static u32 snapshotBuildFull( u8 *dst, const u8 *c64 )
+{
+	u32 size = SNAPSHOT_C64_SIZE - SNAPSHOT_C64_RAM - 0x400;
+	memcpy( dst, &c64[ SNAPSHOT_C64_RAM + 0x400 ], size );
+	return size + snapshotBuildTail( dst + size, c64 );
+}
+
+static void snapshotCompressTask( void *param )
+{
+	SNAPSHOT_HEADER *h = (SNAPSHOT_HEADER *)snapshotFile;
+	u8 *out = snapshotFile + sizeof( SNAPSHOT_HEADER );
+	u8 *cart = snapshotCart;
+
+	for ( u32 i = 0; i < nSections; i++ )
+	{
+		u8 *src = i == 0 ? snapshotCapture : cart;
+		u32 size = sectionSize[ i ];
+
+		u32 packed = lz4Compress( src, size, out, size - 1 );
+		if ( packed == 0 )
+		{
+			memcpy( out, src, size );
+			packed = size;
+		}
+
+		h->rawSize[ i ] = size;
+		h->packedSize[ i ] = packed;
+		out += packed;
+		if ( i > 0 )
+			cart += size;
+	}
+
+	fileSize = out - snapshotFile;
+}
+
+static void snapshotSave()
+{
+	SNAPSHOT_HEADER *h = (SNAPSHOT_HEADER *)snapshotFile;
+
+	memset( h, 0, sizeof( SNAPSHOT_HEADER ) );
+	memcpy( h->magic, SNAPSHOT_MAGIC, 8 );
+	h->version = SNAPSHOT_VERSION;
+	strcpy( h->kernel, kernelName );
+	h->gameExrom = snapshot.gameExrom;
+	h->nSections = nSections;
+
+	// the cartridge state must be copied before the C64 continues
+	u8 *cart = snapshotCart;
+	for ( u32 i = 1; i < nSections; i++ )
+	{
+		memcpy( cart, sectionData[ i ], sectionSize[ i ] );
+		cart += sectionSize[ i ];
+	}
+
+	// let the transfer code continue the program
+	snapshotPrepareFIQ( snapshotRestore, snapshotBuildTail( snapshotRestore, snapshotCapture ) );
+	asm volatile( "dmb ish" ::: "memory" );
+	snapshot.status = 0;
+
+	coreTaskRun( SNAPSHOT_CORE, snapshotCompressTask, NULL );
+	phase = PHASE_COMPRESS;
+}
+
+static bool snapshotLoad()
+{
+	SNAPSHOT_HEADER *h = (SNAPSHOT_HEADER *)snapshotFile;
+	CLogger *logger = CLogger::Get();
+
+	u32 size;
+	if ( !readFile( logger, DRIVE, filename, snapshotFile, &size, sizeof( snapshotFile ) ) )
+		return false;
+
+	if ( size < sizeof( SNAPSHOT_HEADER ) || memcmp( h->magic, SNAPSHOT_MAGIC, 8 ) || h->version != SNAPSHOT_VERSION ||
+		 strncmp( h->kernel, kernelName, 16 ) || h->nSections != nSections )
+	{
+		logger->Write( "Snapshot", LogNotice, "%s does not match this freezer", filename );
+		return false;
+	}
+
+	u8 *in = snapshotFile + sizeof( SNAPSHOT_HEADER ), *cart = snapshotCart;
+	for ( u32 i = 0; i < nSections; i++ )
+	{
+		u8 *dst = i == 0 ? snapshotCapture : cart;
+
+		if ( h->rawSize[ i ] != sectionSize[ i ] || h->packedSize[ i ] > size - (u32)( in - snapshotFile ) )
+			return false;
+
+		if ( h->packedSize[ i ] == h->rawSize[ i ] )
+			memcpy( dst, in, h->rawSize[ i ] ); else
+		if ( lz4Decompress( in, h->packedSize[ i ], dst, h->rawSize[ i ] ) != h->rawSize[ i ] )
+		{
+			logger->Write( "Snapshot", LogNotice, "%s is corrupt", filename );
+			return false;
+		}
+
+		in += h->packedSize[ i ];
+		if ( i > 0 )
+			cart += h->rawSize[ i ];
+	}
+
+	snapshotPrepareFIQ( snapshotRestore, snapshotBuildFull( snapshotRestore, snapshotCapture ) );
+	return true;
+}
+
+void snapshotUpdate()
+{
+	switch ( phase )
+	{
+	case PHASE_IDLE:
+		if ( snapshot.request == SNAPSHOT_REQ_NONE || snapshot.state != SNAPSHOT_OFF )
+			break;
+
+		if ( snapshot.request == SNAPSHOT_REQ_SAVE )
+		{
+			snapshot.captured = 0;
+			snapshot.status = 0;
+			snapshotPrepareFIQ( snapshotCapture, SNAPSHOT_C64_SIZE );
+			phase = PHASE_CAPTURE;
+			snapshot.request = SNAPSHOT_REQ_NONE;
+			snapshot.state = SNAPSHOT_TRIGGER;
+		} else
+		{
+			snapshot.request = SNAPSHOT_REQ_NONE;
+			if ( snapshotLoad() )
+			{
+				// the cartridge state is restored once the C64 runs the transfer code
+				snapshot.status = SNAPSHOT_STATUS_BUSY | SNAPSHOT_STATUS_FULL;
+				phase = PHASE_RESTORE;
+				snapshot.state = SNAPSHOT_TRIGGER;
+			}
+		}
+		break;
+
+	case PHASE_CAPTURE:
+		if ( snapshot.captured )
+		{
+			if ( snapshot.pos != SNAPSHOT_C64_SIZE )
+				CLogger::Get()->Write( "Snapshot", LogWarning, "received %d of %d bytes", snapshot.pos, SNAPSHOT_C64_SIZE );
+			snapshotSave();
+		}
+		break;
+
+	case PHASE_COMPRESS:
+		if ( coreTaskDone( SNAPSHOT_CORE ) )
+		{
+			phase = PHASE_IDLE;
+			if ( writeFile( CLogger::Get(), DRIVE, filename, snapshotFile, fileSize ) )
+				CLogger::Get()->Write( "Snapshot", LogNotice, "saved %s (%d bytes)", filename, fileSize );
+		}
+		break;
+
+	case PHASE_RESTORE:
+		if ( snapshot.state == SNAPSHOT_ACTIVE )
+		{
+			SNAPSHOT_HEADER *h = (SNAPSHOT_HEADER *)snapshotFile;
+
+			u8 *cart = snapshotCart;
+			for ( u32 i = 1; i < nSections; i++ )
+			{
+				memcpy( sectionData[ i ], cart, sectionSize[ i ] );
+				cart += sectionSize[ i ];
+			}
+			snapshot.gameExrom = h->gameExrom;
+
+			asm volatile( "dmb ish" ::: "memory" );
+			snapshot.status = SNAPSHOT_STATUS_FULL;
+			phase = PHASE_IDLE;
+		} else
+		if ( snapshot.state == SNAPSHOT_OFF )
+			phase = PHASE_IDLE;
+		break;
+	}
+}
@@ -0,0 +1,225 @@
+/*
+  _________.__    .___      __   .__        __        _________   ________   _____  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __    \_   ___ \ /  _____/  /  |  | 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /    /    \  \//   __  \  /   |  |_
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <     \     \___\  |__\  \/    ^   /
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \     \______  /\_____  /\____   | 
+        \/         \/    \/     \/       \/     \/            \/       \/      |__| 
+ 
+ snapshot.h
+
+ Sidekick64 - A framework for interfacing 8-Bit Commodore computers (C64/C128,C16/Plus4,VC20) and a Raspberry Pi Zero 2 or 3A+/3B+
+            - freezer snapshots: capture to and restore from SD card
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef _snapshot_h_
+#define _snapshot_h_
+
+#include <circle/types.h>
+#include <stddef.h>
+#include "lowlevel_arm64.h"
+#include "gpio_defs.h"
+#include "helpers.h"
+
+//
+// freezer snapshots: a short press of the button freezes, keeping it pressed for more than a second and releasing it saves a
+// snapshot of the C64 (RAM, VIC registers, color RAM, CIA ports, CPU registers) and the cartridge state, 3 seconds restore
+// the last one.
+//
+// The C64 side is the Ultimax code in C64Side/snapshot.a which is entered via NMI (as the freezers do it) and transfers the
+// memory through IO1. The freezer kernels use it by
+// - registering their cartridge state (RAM, registers) with snapshotInit/snapshotAddSection,
+// - inserting SNAPSHOT_FIQ after reading the address, ROML/ROMH, IO1/2 and BA, which runs the transfer and returns from the FIQ
+//   while the transfer code is executed (otherwise the kernel continues as usual), the parameter is executed after the bus
+//   handling when returning (e.g. kernels updating their counters at the end of the FIQ),
+// - triggering freezes with SNAPSHOT_FREEZE_BUTTON instead of BUTTON_PRESSED (a freeze happens once, when a press shorter
+//   than SNAPSHOT_HOLD_SAVE has been released, so that saving or restoring does not freeze first), calling snapshotReset
+//   upon a reset and snapshotUpdate in their main loop.
+// snapshotUpdate compresses the data on a spare core (LZ4 block format, see lz4block.h) and writes it to SD card while the
+// C64 continues, and it loads, decompresses and prepares the data which the FIQ then streams back to the C64.
+// SID registers, CIA timers and interrupt masks cannot be read by the C64 and are not part of a snapshot.
+//
+
+// button hold times in C64 cycles
+#define SNAPSHOT_HOLD_SAVE		1000000		// ~1 second: save when the button is released
+#define SNAPSHOT_HOLD_RESTORE	3000000		// ~3 seconds: restore the last snapshot
+#define SNAPSHOT_DEBOUNCE		10000		// a press ends after the button has been released for this long
+
+// true once for each short press (set by SNAPSHOT_FIQ, consumed here)
+#define SNAPSHOT_FREEZE_BUTTON	( snapshot.freezeRequest && snapshot.state == SNAPSHOT_OFF && ( snapshot.freezeRequest = 0, 1 ) )
+
+// states of the transfer
+#define SNAPSHOT_OFF			0
+#define SNAPSHOT_TRIGGER		1			// pull NMI
+#define SNAPSHOT_NMI			2			// wait until the CPU has pushed PC and P
+#define SNAPSHOT_ACTIVE			3			// the transfer code runs
+#define SNAPSHOT_LEAVE			4			// switch back to the cartridge's configuration at the opcode fetch of RTI ...
+#define SNAPSHOT_LEAVE_NEXT		5			// ... i.e. in the following cycle
+
+// requests from the FIQ to the main loop
+#define SNAPSHOT_REQ_NONE		0
+#define SNAPSHOT_REQ_SAVE		1
+#define SNAPSHOT_REQ_RESTORE	2
+
+// IO1 registers and commands of the transfer code
+#define SNAPSHOT_REG_DATA		0
+#define SNAPSHOT_REG_CTRL		1
+#define SNAPSHOT_REG_LEAVE		2
+
+#define SNAPSHOT_CMD_NORMAL		0
+#define SNAPSHOT_CMD_ULTIMAX	1
+#define SNAPSHOT_CMD_CAPTURED	2
+
+#define SNAPSHOT_STATUS_BUSY	0x80
+#define SNAPSHOT_STATUS_FULL	0x40		// restore everything, not only what the transfer code used
+
+// the data sent by the transfer code: stack pointer, RAM, VIC registers, color RAM, CIA ports/data direction registers
+#define SNAPSHOT_C64_SP			0
+#define SNAPSHOT_C64_RAM		1
+#define SNAPSHOT_C64_VIC		( SNAPSHOT_C64_RAM + 65536 )
+#define SNAPSHOT_C64_COLOR		( SNAPSHOT_C64_VIC + 47 )
+#define SNAPSHOT_C64_CIA		( SNAPSHOT_C64_COLOR + 1024 )
+#define SNAPSHOT_C64_SIZE		( SNAPSHOT_C64_CIA + 8 )
+
+#define SNAPSHOT_MAX_SECTIONS	4			// C64 + cartridge state
+#define SNAPSHOT_CART_SIZE		65536		// cartridge state (all sections)
+
+typedef struct
+{
+	u32 state, request;
+	u32 status;
+	u32 pos, size;							// position in/size of the stream which is captured or restored
+	u32 captured;
+	u32 writes;								// consecutive write cycles after pulling NMI
+	u32 gameExrom;							// GAME/EXROM levels before the snapshot
+
+	u32 buttonCycles, releaseCycles;
+	u32 freezeRequest;						// a short press has been released
+
+	u8 *rom, *capture, *restore;
+	u8 next;								// next byte to restore (read ahead)
+} SNAPSHOT_FIQSTATE;
+
+extern volatile SNAPSHOT_FIQSTATE snapshot AAA;
+
+// snapshot file: header followed by the sections (LZ4 compressed, or stored if packedSize == rawSize)
+#define SNAPSHOT_MAGIC			"SK64SNAP"
+#define SNAPSHOT_VERSION		1
+
+typedef struct
+{
+	char magic[ 8 ];
+	u32 version;
+	char kernel[ 16 ];
+	u32 gameExrom;
+	u32 nSections;
+	u32 rawSize[ SNAPSHOT_MAX_SECTIONS ];
+	u32 packedSize[ SNAPSHOT_MAX_SECTIONS ];
+} __attribute__((packed)) SNAPSHOT_HEADER;
+
+extern void snapshotInit( const char *kernel );
+extern void snapshotAddSection( void *data, u32 size );
+extern void snapshotReset();
+extern void snapshotUpdate();
+
+#define SNAPSHOT_FIQ( afterBusHandling )																\
+	if ( BUTTON_PRESSED ) {																			\
+		snapshot.releaseCycles = 0;																	\
+		if ( ++ snapshot.buttonCycles == SNAPSHOT_HOLD_RESTORE && snapshot.state == SNAPSHOT_OFF )	\
+			snapshot.request = SNAPSHOT_REQ_RESTORE;												\
+	} else																							\
+	if ( snapshot.buttonCycles && ++ snapshot.releaseCycles == SNAPSHOT_DEBOUNCE ) {				\
+		if ( snapshot.buttonCycles < SNAPSHOT_HOLD_SAVE && snapshot.state == SNAPSHOT_OFF )			\
+			snapshot.freezeRequest = 1; else														\
+		if ( snapshot.buttonCycles < SNAPSHOT_HOLD_RESTORE && snapshot.state == SNAPSHOT_OFF )		\
+			snapshot.request = SNAPSHOT_REQ_SAVE;													\
+		snapshot.buttonCycles = 0;																	\
+	}																								\
+																									\
+	if ( snapshot.state == SNAPSHOT_TRIGGER ) {														\
+		CLR_GPIO( bNMI );																			\
+		snapshot.writes = 0;																		\
+		snapshot.state = SNAPSHOT_NMI;																\
+	} else																							\
+	if ( snapshot.state == SNAPSHOT_NMI ) {															\
+		if ( !CPU_WRITES_TO_BUS )																	\
+			snapshot.writes = 0; else																\
+		if ( ++ snapshot.writes == 3 ) {															\
+			/* the CPU has pushed PC and P: Ultimax mode for the vector fetch */					\
+			snapshot.gameExrom = g2 & ( bGAME | bEXROM );											\
+			SET_GPIO( bEXROM | bNMI );																\
+			CLR_GPIO( bGAME );																		\
+			snapshot.state = SNAPSHOT_ACTIVE;														\
+			FINISH_BUS_HANDLING afterBusHandling													\
+			return;																					\
+		}																							\
+	} else																							\
+	if ( snapshot.state == SNAPSHOT_LEAVE_NEXT ) {													\
+		SET_GPIO( snapshot.gameExrom );																\
+		CLR_GPIO( ( bGAME | bEXROM ) & ~snapshot.gameExrom );										\
+		snapshot.state = SNAPSHOT_OFF;																\
+	} else																							\
+	if ( snapshot.state >= SNAPSHOT_ACTIVE ) {														\
+		if ( CPU_READS_FROM_BUS && ROMH_ACCESS ) {													\
+			WRITE_D0to7_TO_BUS( snapshot.rom[ GET_ADDRESS ] )										\
+			/* BA high: not the VIC, the CPU fetches the RTI opcode */								\
+			if ( snapshot.state == SNAPSHOT_LEAVE && ( g3 & bBA ) )									\
+				snapshot.state = SNAPSHOT_LEAVE_NEXT;												\
+		} else																						\
+		if ( IO1_ACCESS && CPU_WRITES_TO_BUS ) {													\
+			register u32 D;																			\
+			READ_D0to7_FROM_BUS( D )																\
+			if ( ( GET_IO12_ADDRESS & 3 ) == SNAPSHOT_REG_DATA ) {									\
+				if ( snapshot.pos < snapshot.size )													\
+					snapshot.capture[ snapshot.pos ++ ] = D;										\
+			} else																					\
+			if ( ( GET_IO12_ADDRESS & 3 ) == SNAPSHOT_REG_CTRL ) {									\
+				if ( D == SNAPSHOT_CMD_NORMAL )														\
+					SET_GPIO( bGAME | bEXROM ) else													\
+				if ( D == SNAPSHOT_CMD_ULTIMAX )													\
+					SETCLR_GPIO( bEXROM, bGAME ) else												\
+				if ( D == SNAPSHOT_CMD_CAPTURED ) {													\
+					snapshot.status = SNAPSHOT_STATUS_BUSY;											\
+					snapshot.captured = 1;															\
+				}																					\
+			}																						\
+		} else																						\
+		if ( IO1_ACCESS ) {																			\
+			if ( ( GET_IO12_ADDRESS & 3 ) == SNAPSHOT_REG_DATA ) {									\
+				WRITE_D0to7_TO_BUS( snapshot.next )													\
+				/* BA low: the CPU is halted and will repeat the read */							\
+				if ( ( g3 & bBA ) && snapshot.pos < snapshot.size ) {								\
+					FINISH_BUS_HANDLING afterBusHandling											\
+					snapshot.next = snapshot.restore[ ++ snapshot.pos ];							\
+					CACHE_PRELOADL2STRM( &snapshot.restore[ snapshot.pos + 64 ] );					\
+					return;																			\
+				}																					\
+			} else																					\
+			if ( ( GET_IO12_ADDRESS & 3 ) == SNAPSHOT_REG_CTRL ) {									\
+				WRITE_D0to7_TO_BUS( snapshot.status )												\
+			} else {																				\
+				WRITE_D0to7_TO_BUS( 0 )																\
+				if ( ( GET_IO12_ADDRESS & 3 ) == SNAPSHOT_REG_LEAVE )								\
+					snapshot.state = SNAPSHOT_LEAVE;												\
+			}																						\
+		}																							\
+		FINISH_BUS_HANDLING afterBusHandling														\
+		return;																						\
+	}
+
+#endif
@@ -0,0 +1,75 @@
+ 0x48, 0x8a, 0x48, 0x98, 0x48, 0xd8, 0x2c, 0x01,
+ 0xde, 0x30, 0xfb, 0x70, 0x3d, 0xba, 0x8e, 0x00,
+ 0xde, 0xa2, 0x00, 0xb5, 0x00, 0x8d, 0x00, 0xde,
+ 0xe8, 0xd0, 0xf8, 0xbd, 0x00, 0x01, 0x8d, 0x00,
+ 0xde, 0xe8, 0xd0, 0xf7, 0xa9, 0x00, 0x85, 0x02,
+ 0xa9, 0x02, 0x85, 0x03, 0xa0, 0x00, 0xb1, 0x02,
+ 0x8d, 0x00, 0xde, 0xc8, 0xd0, 0xf8, 0xe6, 0x03,
+ 0xa5, 0x03, 0xc9, 0x10, 0xd0, 0xf0, 0xbd, 0x8f,
+ 0xe0, 0x9d, 0x00, 0x02, 0xe8, 0xd0, 0xf7, 0x4c,
+ 0x00, 0x02, 0xa2, 0x00, 0xbd, 0x73, 0xe1, 0x9d,
+ 0x00, 0x02, 0xe8, 0xd0, 0xf7, 0x4c, 0x00, 0x02,
+ 0x2c, 0x01, 0xde, 0x30, 0xfb, 0xa2, 0x00, 0xad,
+ 0x00, 0xde, 0x9d, 0x00, 0x02, 0xe8, 0xd0, 0xf7,
+ 0xad, 0x00, 0xde, 0x9d, 0x00, 0x03, 0xe8, 0xd0,
+ 0xf7, 0xad, 0x00, 0xde, 0x9d, 0x00, 0x01, 0xe8,
+ 0xd0, 0xf7, 0xad, 0x00, 0xde, 0x95, 0x00, 0xe8,
+ 0xd0, 0xf8, 0xae, 0x00, 0xde, 0x9a, 0x68, 0xa8,
+ 0x68, 0xaa, 0x68, 0x2c, 0x02, 0xde, 0x40, 0xa9,
+ 0x00, 0x8d, 0x01, 0xde, 0xa9, 0x2f, 0x85, 0x00,
+ 0xa9, 0x35, 0x85, 0x01, 0xa2, 0x10, 0xe0, 0xd0,
+ 0x90, 0x25, 0xe0, 0xe0, 0xb0, 0x21, 0x8e, 0x22,
+ 0x02, 0xa9, 0x34, 0x85, 0x01, 0xa0, 0x00, 0xb9,
+ 0x00, 0xd0, 0x99, 0x00, 0x03, 0xc8, 0xd0, 0xf7,
+ 0xa9, 0x35, 0x85, 0x01, 0xb9, 0x00, 0x03, 0x8d,
+ 0x00, 0xde, 0xc8, 0xd0, 0xf7, 0xf0, 0x51, 0x8e,
+ 0x54, 0x02, 0x8e, 0x5a, 0x02, 0x8e, 0x60, 0x02,
+ 0x8e, 0x66, 0x02, 0x8e, 0x6c, 0x02, 0x8e, 0x72,
+ 0x02, 0x8e, 0x78, 0x02, 0x8e, 0x7e, 0x02, 0xa0,
+ 0x00, 0xb9, 0x00, 0x10, 0x8d, 0x00, 0xde, 0xb9,
+ 0x01, 0x10, 0x8d, 0x00, 0xde, 0xb9, 0x02, 0x10,
+ 0x8d, 0x00, 0xde, 0xb9, 0x03, 0x10, 0x8d, 0x00,
+ 0xde, 0xb9, 0x04, 0x10, 0x8d, 0x00, 0xde, 0xb9,
+ 0x05, 0x10, 0x8d, 0x00, 0xde, 0xb9, 0x06, 0x10,
+ 0x8d, 0x00, 0xde, 0xb9, 0x07, 0x10, 0x8d, 0x00,
+ 0xde, 0x98, 0x18, 0x69, 0x08, 0xa8, 0xd0, 0xc9,
+ 0xe8, 0xd0, 0x83, 0xa2, 0x00, 0xbd, 0x00, 0xd0,
+ 0x8d, 0x00, 0xde, 0xe8, 0xe0, 0x2f, 0xd0, 0xf5,
+ 0xa2, 0x00, 0xbd, 0x00, 0xd8, 0x8d, 0x00, 0xde,
+ 0xe8, 0xd0, 0xf7, 0xbd, 0x00, 0xd9, 0x8d, 0x00,
+ 0xde, 0xe8, 0xd0, 0xf7, 0xbd, 0x00, 0xda, 0x8d,
+ 0x00, 0xde, 0xe8, 0xd0, 0xf7, 0xbd, 0x00, 0xdb,
+ 0x8d, 0x00, 0xde, 0xe8, 0xd0, 0xf7, 0xbd, 0x00,
+ 0xdc, 0x8d, 0x00, 0xde, 0xe8, 0xe0, 0x04, 0xd0,
+ 0xf5, 0xa2, 0x00, 0xbd, 0x00, 0xdd, 0x8d, 0x00,
+ 0xde, 0xe8, 0xe0, 0x04, 0xd0, 0xf5, 0xa9, 0x01,
+ 0x8d, 0x01, 0xde, 0xa9, 0x02, 0x8d, 0x01, 0xde,
+ 0x4c, 0x58, 0xe0, 0xa9, 0x00, 0x8d, 0x01, 0xde,
+ 0xa9, 0x2f, 0x85, 0x00, 0xa9, 0x35, 0x85, 0x01,
+ 0xa2, 0x04, 0xe0, 0xd0, 0x90, 0x25, 0xe0, 0xe0,
+ 0xb0, 0x21, 0xa0, 0x00, 0xad, 0x00, 0xde, 0x99,
+ 0x00, 0x03, 0xc8, 0xd0, 0xf7, 0x8e, 0x2e, 0x02,
+ 0xa9, 0x34, 0x85, 0x01, 0xb9, 0x00, 0x03, 0x99,
+ 0x00, 0xd0, 0xc8, 0xd0, 0xf7, 0xa9, 0x35, 0x85,
+ 0x01, 0xd0, 0x51, 0x8e, 0x57, 0x02, 0x8e, 0x5d,
+ 0x02, 0x8e, 0x63, 0x02, 0x8e, 0x69, 0x02, 0x8e,
+ 0x6f, 0x02, 0x8e, 0x75, 0x02, 0x8e, 0x7b, 0x02,
+ 0x8e, 0x81, 0x02, 0xa0, 0x00, 0xad, 0x00, 0xde,
+ 0x99, 0x00, 0x04, 0xad, 0x00, 0xde, 0x99, 0x01,
+ 0x04, 0xad, 0x00, 0xde, 0x99, 0x02, 0x04, 0xad,
+ 0x00, 0xde, 0x99, 0x03, 0x04, 0xad, 0x00, 0xde,
+ 0x99, 0x04, 0x04, 0xad, 0x00, 0xde, 0x99, 0x05,
+ 0x04, 0xad, 0x00, 0xde, 0x99, 0x06, 0x04, 0xad,
+ 0x00, 0xde, 0x99, 0x07, 0x04, 0x98, 0x18, 0x69,
+ 0x08, 0xa8, 0xd0, 0xc9, 0xe8, 0xd0, 0x83, 0xa2,
+ 0x00, 0xad, 0x00, 0xde, 0x9d, 0x00, 0xd0, 0xe8,
+ 0xe0, 0x2f, 0xd0, 0xf5, 0xa2, 0x00, 0xad, 0x00,
+ 0xde, 0x9d, 0x00, 0xd8, 0xe8, 0xd0, 0xf7, 0xad,
+ 0x00, 0xde, 0x9d, 0x00, 0xd9, 0xe8, 0xd0, 0xf7,
+ 0xad, 0x00, 0xde, 0x9d, 0x00, 0xda, 0xe8, 0xd0,
+ 0xf7, 0xad, 0x00, 0xde, 0x9d, 0x00, 0xdb, 0xe8,
+ 0xd0, 0xf7, 0xad, 0x00, 0xde, 0x9d, 0x00, 0xdc,
+ 0xe8, 0xe0, 0x04, 0xd0, 0xf5, 0xa2, 0x00, 0xad,
+ 0x00, 0xde, 0x9d, 0x00, 0xdd, 0xe8, 0xe0, 0x04,
+ 0xd0, 0xf5, 0xa9, 0x01, 0x8d, 0x01, 0xde, 0x4c,
+ 0x58, 0xe0,
@@ -27,8 +27,15 @@
  You should have received a copy of the GNU General Public License
  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <math.h>
+#include <circle/machineinfo.h>
+#include <circle/synchronize.h>
 #include "kernel_sid.h"
 
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
 #define WRITE_CHANNELS		2		// 1: Mono, 2: Stereo
 #define CHUNK_SIZE			2000	// number of samples, written to sound device at once
 
@@ -124,7 +131,6 @@ void initSoundOutputVCHIQ( CSoundBaseDevice **m_pSound, CVCHIQDevice *m_VCHIQ )
 // for PWM Output
 //
 u32 sampleBuffer[ 128 ];
-u32 sampleBufferHDMI[ HDMI_BUF_SIZE ];
 u32 smpLast, smpCur;
 
 #ifdef USE_PWM_DIRECT
@@ -192,6 +198,219 @@ void initPWMOutput()
 
 	smpLast = smpCur = 0;
 }
+
+//
+// DMA paced PWM output: the PWM FIFO is fed by a DMA channel which loops over a ring of control blocks,
+// no interrupts involved. The main loop requantizes the blocks of the audio graph with 2nd order noise shaping
+// and writes them ahead of the DMA read position, which is read once per block (instead of a write per sample in the FIQ).
+// The distance to the read position is kept at PWM_DMA_TARGET by the resampler of the audio graph (asrc.h).
+//
+#define ARM_PWM_DMAC_ENAB		(1 << 31)
+#define ARM_PWM_DMAC_PANIC(x)	((x) << 8)
+#define ARM_PWM_DMAC_DREQ(x)	((x) << 0)
+
+#define PWM_DMA_CS(c)			( ARM_DMA_BASE + (c) * 0x100 + 0x00 )
+#define PWM_DMA_CONBLK_AD(c)	( ARM_DMA_BASE + (c) * 0x100 + 0x04 )
+#define PWM_DMA_SOURCE_AD(c)	( ARM_DMA_BASE + (c) * 0x100 + 0x0c )
+#define PWM_DMA_ENABLE			( ARM_DMA_BASE + 0xff0 )
+
+#define PWM_DMA_CS_ACTIVE		(1 << 0)
+#define PWM_DMA_CS_END			(1 << 1)
+#define PWM_DMA_CS_INT			(1 << 2)
+#define PWM_DMA_CS_PRIORITY		(1 << 16)
+#define PWM_DMA_CS_PANIC		(15 << 20)
+#define PWM_DMA_CS_WAIT_WRITES	(1 << 28)
+#define PWM_DMA_CS_RESET		(1 << 31)
+
+#define PWM_DMA_TI_WAIT_RESP	(1 << 3)
+#define PWM_DMA_TI_DEST_DREQ	(1 << 6)
+#define PWM_DMA_TI_SRC_INC		(1 << 8)
+#define PWM_DMA_TI_PERMAP_PWM	(5 << 16)
+
+#define PWM_DMA_CB_FRAMES		( PWM_DMA_FRAMES / PWM_DMA_BLOCKS )
+#define PWM_DMA_MASK			( PWM_DMA_FRAMES - 1 )
+
+typedef struct
+{
+	u32 ti, source, dest, length, stride, next, reserved[ 2 ];
+} PWM_DMA_CB;
+
+static PWM_DMA_CB pwmDMACB[ PWM_DMA_BLOCKS ] AAA;
+static u32 pwmDMARing[ PWM_DMA_FRAMES * 2 ] AAA;		// interleaved duty cycles, channel 1 and 2
+static float pwmDMAStage[ PWM_DMA_MAX_BLOCK * 2 ] AAA;
+static float pwmDMAError[ 4 ];							// last and second to last quantization error, left and right
+static u32 pwmDMAChannel = ~0u;
+static u32 pwmDMAPos;									// write position in frames
+
+void pwmDMAStop()
+{
+	if ( pwmDMAChannel == ~0u )
+		return;
+
+	PeripheralEntry();
+	write32( PWM_DMA_CS( pwmDMAChannel ), PWM_DMA_CS_RESET );
+	write32( ARM_PWM_DMAC, 0 );
+	write32( ARM_PWM_CTL, ARM_PWM_CTL_PWEN1 | ARM_PWM_CTL_PWEN2 );
+	PeripheralExit();
+
+	CMachineInfo::Get()->FreeDMAChannel( pwmDMAChannel );
+	pwmDMAChannel = ~0u;
+}
+
+void pwmDMAStart()
+{
+	pwmDMAStop();
+
+	pwmDMAChannel = CMachineInfo::Get()->AllocateDMAChannel( DMA_CHANNEL_NORMAL );
+
+	// start with silence, i.e. the duty cycle of a zero sample
+	u32 silence = ( 32768 * PWMRange ) >> 17;
+	for ( u32 i = 0; i < PWM_DMA_FRAMES * 2; i++ )
+		pwmDMARing[ i ] = silence;
+
+	for ( u32 i = 0; i < PWM_DMA_BLOCKS; i++ )
+	{
+		PWM_DMA_CB *cb = &pwmDMACB[ i ];
+		cb->ti     = PWM_DMA_TI_PERMAP_PWM | PWM_DMA_TI_DEST_DREQ | PWM_DMA_TI_SRC_INC | PWM_DMA_TI_WAIT_RESP;
+		cb->source = BUS_ADDRESS( (uintptr)&pwmDMARing[ i * PWM_DMA_CB_FRAMES * 2 ] );
+		cb->dest   = ( ARM_PWM_FIF1 & 0xffffff ) + GPU_IO_BASE;
+		cb->length = PWM_DMA_CB_FRAMES * 2 * sizeof( u32 );
+		cb->stride = 0;
+		cb->next   = BUS_ADDRESS( (uintptr)&pwmDMACB[ ( i + 1 ) % PWM_DMA_BLOCKS ] );
+		cb->reserved[ 0 ] = cb->reserved[ 1 ] = 0;
+	}
+
+	CleanAndInvalidateDataCacheRange( (uintptr)pwmDMARing, sizeof( pwmDMARing ) );
+	CleanAndInvalidateDataCacheRange( (uintptr)pwmDMACB, sizeof( pwmDMACB ) );
+
+	PeripheralEntry();
+
+	write32( ARM_PWM_CTL, 0 );
+	CTimer::SimpleusDelay( 100 );
+	write32( ARM_PWM_STA, ARM_PWM_STA_WERR1 | ARM_PWM_STA_RERR1 | ARM_PWM_STA_BERR );
+	write32( ARM_PWM_DMAC, ARM_PWM_DMAC_ENAB | ARM_PWM_DMAC_PANIC( 7 ) | ARM_PWM_DMAC_DREQ( 3 ) );
+	write32( ARM_PWM_CTL, ARM_PWM_CTL_CLRF1 );
+	CTimer::SimpleusDelay( 100 );
+	write32( ARM_PWM_CTL, ARM_PWM_CTL_PWEN1 | ARM_PWM_CTL_USEF1 | ARM_PWM_CTL_PWEN2 | ARM_PWM_CTL_USEF2 );
+
+	write32( PWM_DMA_ENABLE, read32( PWM_DMA_ENABLE ) | ( 1 << pwmDMAChannel ) );
+	write32( PWM_DMA_CS( pwmDMAChannel ), PWM_DMA_CS_RESET );
+	CTimer::SimpleusDelay( 10 );
+	write32( PWM_DMA_CS( pwmDMAChannel ), PWM_DMA_CS_INT | PWM_DMA_CS_END );
+	write32( PWM_DMA_CONBLK_AD( pwmDMAChannel ), BUS_ADDRESS( (uintptr)&pwmDMACB[ 0 ] ) );
+	write32( PWM_DMA_CS( pwmDMAChannel ), PWM_DMA_CS_WAIT_WRITES | PWM_DMA_CS_PANIC | PWM_DMA_CS_PRIORITY | PWM_DMA_CS_ACTIVE );
+
+	PeripheralExit();
+
+	pwmDMAPos = PWM_DMA_TARGET;
+	memset( pwmDMAError, 0, sizeof( pwmDMAError ) );
+}
+
+//
+// requantization to the PWM range with error feedback: v = x - 2e[n-1] + e[n-2], q = round(v), e = q - v,
+// i.e. the quantization error is shaped by (1-z^-1)^2 and pushed towards Nyquist, out of the audible band
+// (the error uses the unclamped q, such that clipping at the range limits cannot make the loop run away)
+//
+static void pwmRequantize( const s32 *left, const s32 *right, u32 n )
+{
+	const float scale = (float)PWMRange / 131072.0f;
+	const float offset = 32768.0f * scale;
+	const s32 qMax = PWMRange >> 1;
+
+#ifdef __ARM_NEON
+	u32 j = 0;
+	for ( ; j + 4 <= n; j += 4 )
+	{
+		float32x4_t l = vmlaq_n_f32( vdupq_n_f32( offset ), vcvtq_f32_s32( vld1q_s32( &left[ j ] ) ), scale );
+		float32x4_t r = vmlaq_n_f32( vdupq_n_f32( offset ), vcvtq_f32_s32( vld1q_s32( &right[ j ] ) ), scale );
+		float32x4x2_t lr = vzipq_f32( l, r );
+		vst1q_f32( &pwmDMAStage[ j * 2 ], lr.val[ 0 ] );
+		vst1q_f32( &pwmDMAStage[ j * 2 + 4 ], lr.val[ 1 ] );
+	}
+	for ( ; j < n; j++ )
+	{
+		pwmDMAStage[ j * 2 + 0 ] = offset + (float)left[ j ] * scale;
+		pwmDMAStage[ j * 2 + 1 ] = offset + (float)right[ j ] * scale;
+	}
+
+	float32x2_t e1 = vld1_f32( &pwmDMAError[ 0 ] );
+	float32x2_t e2 = vld1_f32( &pwmDMAError[ 2 ] );
+	int32x2_t qMin = vdup_n_s32( 0 ), qLimit = vdup_n_s32( qMax );
+
+	for ( u32 i = 0; i < n; i++ )
+	{
+		float32x2_t v = vsub_f32( vadd_f32( vld1_f32( &pwmDMAStage[ i * 2 ] ), e2 ), vadd_f32( e1, e1 ) );
+		int32x2_t q = vcvtn_s32_f32( v );
+		e2 = e1;
+		e1 = vsub_f32( vcvt_f32_s32( q ), v );
+		q = vmax_s32( qMin, vmin_s32( qLimit, q ) );
+		vst1_u32( &pwmDMARing[ pwmDMAPos * 2 ], vreinterpret_u32_s32( q ) );
+		pwmDMAPos = ( pwmDMAPos + 1 ) & PWM_DMA_MASK;
+	}
+
+	vst1_f32( &pwmDMAError[ 0 ], e1 );
+	vst1_f32( &pwmDMAError[ 2 ], e2 );
+#else
+	for ( u32 j = 0; j < n; j++ )
+	{
+		pwmDMAStage[ j * 2 + 0 ] = offset + (float)left[ j ] * scale;
+		pwmDMAStage[ j * 2 + 1 ] = offset + (float)right[ j ] * scale;
+	}
+
+	for ( u32 i = 0; i < n; i++ )
+	{
+		for ( u32 c = 0; c < 2; c++ )
+		{
+			float v = pwmDMAStage[ i * 2 + c ] - 2.0f * pwmDMAError[ c ] + pwmDMAError[ c + 2 ];
+			s32 q = (s32)floorf( v + 0.5f );
+			pwmDMAError[ c + 2 ] = pwmDMAError[ c ];
+			pwmDMAError[ c ] = (float)q - v;
+			pwmDMARing[ pwmDMAPos * 2 + c ] = max( 0, min( qMax, q ) );
+		}
+		pwmDMAPos = ( pwmDMAPos + 1 ) & PWM_DMA_MASK;
+	}
+#endif
+}
+
+static u32 pwmDMAReadPos()
+{
+	return ( ( read32( PWM_DMA_SOURCE_AD( pwmDMAChannel ) ) - BUS_ADDRESS( (uintptr)pwmDMARing ) ) / ( 2 * sizeof( u32 ) ) ) & PWM_DMA_MASK;
+}
+
+u32 pwmDMAFill()
+{
+	if ( pwmDMAChannel == ~0u )
+		return PWM_DMA_TARGET;
+
+	return ( pwmDMAPos - pwmDMAReadPos() ) & PWM_DMA_MASK;
+}
+
+void pwmDMAResync()
+{
+	if ( pwmDMAChannel != ~0u )
+		pwmDMAPos = ( pwmDMAReadPos() + PWM_DMA_TARGET ) & PWM_DMA_MASK;
+}
+
+void pwmDMAOutput( const s32 *left, const s32 *right, u32 n )
+{
+	if ( pwmDMAChannel == ~0u )
+		return;
+
+	while ( n > 0 )
+	{
+		u32 nFrames = min( n, (u32)PWM_DMA_MAX_BLOCK );
+		u32 first = pwmDMAPos;
+		pwmRequantize( left, right, nFrames );
+
+		// write back the new frames such that the DMA engine sees them
+		u32 nFirst = min( nFrames, PWM_DMA_FRAMES - first );
+		CleanAndInvalidateDataCacheRange( (uintptr)&pwmDMARing[ first * 2 ], nFirst * 2 * sizeof( u32 ) );
+		if ( nFirst < nFrames )
+			CleanAndInvalidateDataCacheRange( (uintptr)pwmDMARing, ( nFrames - nFirst ) * 2 * sizeof( u32 ) );
+
+		left += nFrames; right += nFrames; n -= nFrames;
+	}
+}
 #endif
 
 //   ___ ___________      _____  .___       _________                        .___
@@ -38,6 +38,18 @@ extern u32 nSamplesPrecompute;
 
 extern u32 PWMRange;
 
+// DMA paced PWM output, see sound.cpp
+#define PWM_DMA_FRAMES		512		// stereo frames in the DMA ring (power of 2)
+#define PWM_DMA_BLOCKS		4		// DMA control blocks looping over the ring
+#define PWM_DMA_MAX_BLOCK	64		// frames requantized at once
+#define PWM_DMA_TARGET		128		// frames ahead of the DMA read position (2.7ms)
+
+extern void pwmDMAStart();
+extern void pwmDMAStop();
+extern void pwmDMAOutput( const s32 *left, const s32 *right, u32 n );
+extern u32  pwmDMAFill();		// frames written ahead of the DMA read position
+extern void pwmDMAResync();		// moves the write position to PWM_DMA_TARGET ahead of the DMA, e.g. after an underrun
+
 extern void initSoundOutput( CSoundBaseDevice **m_pSound = NULL, CVCHIQDevice *m_VCHIQ = NULL, u32 outputPWM = 0, u32 outputHDMI = 0 );
 extern void initSoundOutputVCHIQ( CSoundBaseDevice **m_pSound, CVCHIQDevice *m_VCHIQ );
 extern void clearSoundBuffer();
@@ -45,9 +57,6 @@ extern void clearSoundBuffer();
 extern u32 sampleBuffer[ 128 ];
 extern u32 smpLast, smpCur;
 
-#define HDMI_BUF_SIZE 4096
-extern u32 sampleBufferHDMI[ HDMI_BUF_SIZE ];
-
 static __attribute__( ( always_inline ) ) inline void putSample( s16 a, s16 b )
 {
 	u16 *a_ = (u16*)&a, *b_ = (u16*)&b;
@@ -63,34 +72,6 @@ static __attribute__( ( always_inline ) ) inline s32 getSample()
 	return ret;
 }
 
-static __attribute__( ( always_inline ) ) inline void putSampleHDMI( s32 a, s32 b )
-{
-	extern CHDMISoundBaseDevice *hdmiSoundDevice;
-	sampleBufferHDMI[ smpCur ++ ] = hdmiSoundDevice->ConvertSample( a );
-	sampleBufferHDMI[ smpCur ++ ] = hdmiSoundDevice->ConvertSample( b );
-	smpCur &= HDMI_BUF_SIZE - 1;
-}
-
-static __attribute__( ( always_inline ) ) inline u8 getSampleHDMI( u32 *a, u32 *b )
-{
-	if ( smpLast == smpCur ) { *a = sampleBufferHDMI[ ( smpLast - 2 + 2048 ) & 2047 ]; *b = sampleBufferHDMI[ ( smpLast - 1 + 2048 ) & 2047 ]; return 0; }
-	*a = sampleBufferHDMI[ smpLast ++ ];
-	*b = sampleBufferHDMI[ smpLast ++ ];
-	smpLast &= HDMI_BUF_SIZE - 1;
-	return 1;
-}
-
-static __attribute__( ( always_inline ) ) inline u32 getNSamplesHDMI()
-{
-	return ( smpCur + HDMI_BUF_SIZE - smpLast ) & ( HDMI_BUF_SIZE - 1 );
-}
-
-static __attribute__( ( always_inline ) ) inline void skipSamplesHDMI( u32 n )
-{
-	smpLast += n;
-	smpLast &= HDMI_BUF_SIZE - 1;
-}
-
 extern short PCMBuffer[ PCMBufferSize ];
 extern u32 PCMCountLast, PCMCountCur;
 
@@ -45,7 +45,7 @@
 // this version has been slightly modified for use with Sidekick:
 // - uses fast (approximations) for log10, pow2, pow10
 // - tsf_render_float removed memset
-// - tsf_voice_render only handles mono mixing
+// - voices are rendered four at a time (NEON) and only mono mixing is supported
 
 #ifndef TSF_INCLUDE_TSF_INL
 #define TSF_INCLUDE_TSF_INL
@@ -94,6 +94,19 @@ struct tsf_stream
 // Generic SoundFont loading method using the stream structure above
 TSFDEF tsf* tsf_load(struct tsf_stream* stream);
 
+// Streaming SoundFont loading: only presets/regions are loaded from the stream, the sample data stays in
+// the file and is paged into a sample cache of 'cacheBytes' bytes (least recently used pages are replaced).
+// readAt is called to read 'size' bytes at the absolute file position 'offset' (returns number of read bytes)
+TSFDEF tsf* tsf_load_streaming(struct tsf_stream* stream, int (*readAt)(void* data, unsigned int offset, void* ptr, unsigned int size), void* readAtData, unsigned int cacheBytes);
+
+// Streaming only: rendering never reads from the stream, pages which are not in the cache play as silence and are
+// requested instead. tsf_cache_service loads the requested pages and the ones the playing voices need next
+// (at most maxPages, all if < 0) and returns the number of loaded pages; call it outside of the render path.
+TSFDEF int tsf_cache_service(tsf* f, int maxPages);
+
+// Streaming only: requests the pages a note-on would start playing, such that they can be loaded before the note is applied
+TSFDEF void tsf_channel_note_prefetch(tsf* f, int channel, int key, float vel);
+
 // Free the memory related to this tsf instance
 TSFDEF void tsf_close(tsf* f);
 
@@ -248,6 +261,16 @@ TSFDEF float tsf_channel_get_tuning(tsf* f, int channel);
 // Grace release time for quick voice off (avoid clicking noise)
 #define TSF_FASTRELEASETIME 0.01f
 
+// Number of samples per page of the sample cache (tsf_load_streaming)
+#ifndef TSF_CACHE_PAGESAMPLES
+#define TSF_CACHE_PAGESAMPLES 4096
+#endif
+
+// Number of outstanding page requests of the sample cache (power of 2)
+#ifndef TSF_CACHE_REQUESTS
+#define TSF_CACHE_REQUESTS 256
+#endif
+
 #if !defined(TSF_MALLOC) || !defined(TSF_FREE) || !defined(TSF_REALLOC)
 #  include <stdlib.h>
 #  define TSF_MALLOC  malloc
@@ -281,6 +304,10 @@ TSFDEF float tsf_channel_get_tuning(tsf* f, int channel);
 #  include <stdio.h>
 #endif
 
+#ifdef __ARM_NEON
+#  include <arm_neon.h>
+#endif
+
 #define TSF_TRUE 1
 #define TSF_FALSE 0
 #define TSF_BOOL char
@@ -301,10 +328,13 @@ typedef char tsf_char20[20];
 
 #define TSF_FourCCEquals(value1, value2) (value1[0] == value2[0] && value1[1] == value2[1] && value1[2] == value2[2] && value1[3] == value2[3])
 
+struct tsf_sample_cache;
+
 struct tsf
 {
 	struct tsf_preset* presets;
 	float* fontSamples;
+	struct tsf_sample_cache* cache; // instead of fontSamples when streaming
 	struct tsf_voice* voices;
 	struct tsf_channels* channels;
 	float* outputSamples;
@@ -859,7 +889,9 @@ static void tsf_load_samples(float** fontSamples, unsigned int* fontSampleCount,
 	// Read sample data into float format buffer.
 	float* out; unsigned int samplesLeft, samplesToRead, samplesToConvert;
 	samplesLeft = *fontSampleCount = chunkSmpl->size / sizeof(short);
-	out = *fontSamples = (float*)TSF_MALLOC(samplesLeft * sizeof(float));
+	// One sample beyond the end, the voice renderer always reads the pair for the interpolation.
+	out = *fontSamples = (float*)TSF_MALLOC((samplesLeft + 1) * sizeof(float));
+	out[samplesLeft] = 0;
 	for (; samplesLeft; samplesLeft -= samplesToRead)
 	{
 		short sampleBuffer[1024], *in = sampleBuffer;;
@@ -1038,6 +1070,123 @@ static void tsf_voice_lfo_process(struct tsf_voice_lfo* e, int blockSamples)
 	else if (e->level < -1.0f) { e->delta = -e->delta; e->level = -2.0f - e->level; }
 }
 
+// Sample cache: page p holds the samples p*TSF_CACHE_PAGESAMPLES ... (p+1)*TSF_CACHE_PAGESAMPLES (one sample overlap for the interpolation)
+struct tsf_sample_cache
+{
+	int (*readAt)(void* data, unsigned int offset, void* ptr, unsigned int size);
+	void* readAtData;
+	unsigned int smplOffset, sampleCount;
+	int pageNum, slotNum;
+	int *pageSlot, *slotPage;
+	unsigned int *slotUse, useCounter;
+	float* slots;
+	short* readBuffer;
+	unsigned char* pageWanted;
+	int want[TSF_CACHE_REQUESTS];
+	unsigned int wantRead, wantWrite;
+	unsigned int hits, misses;
+};
+
+static void tsf_cache_free(struct tsf_sample_cache* c)
+{
+	if (!c) return;
+	TSF_FREE(c->pageSlot); TSF_FREE(c->slotPage); TSF_FREE(c->slotUse);
+	TSF_FREE(c->slots); TSF_FREE(c->readBuffer); TSF_FREE(c->pageWanted); TSF_FREE(c);
+}
+
+static struct tsf_sample_cache* tsf_cache_create(unsigned int smplOffset, unsigned int sampleCount, int (*readAt)(void*, unsigned int, void*, unsigned int), void* readAtData, unsigned int cacheBytes)
+{
+	int i;
+	struct tsf_sample_cache* c = (struct tsf_sample_cache*)TSF_MALLOC(sizeof(struct tsf_sample_cache));
+	if (!c) return TSF_NULL;
+	TSF_MEMSET(c, 0, sizeof(struct tsf_sample_cache));
+	c->readAt = readAt;
+	c->readAtData = readAtData;
+	c->smplOffset = smplOffset;
+	c->sampleCount = sampleCount;
+	c->pageNum = (sampleCount + TSF_CACHE_PAGESAMPLES - 1) / TSF_CACHE_PAGESAMPLES;
+	c->slotNum = cacheBytes / ((TSF_CACHE_PAGESAMPLES + 1) * sizeof(float));
+	if (c->slotNum > c->pageNum) c->slotNum = c->pageNum;
+	if (c->slotNum < 1) c->slotNum = 1;
+	c->pageSlot = (int*)TSF_MALLOC(c->pageNum * sizeof(int));
+	c->slotPage = (int*)TSF_MALLOC(c->slotNum * sizeof(int));
+	c->slotUse = (unsigned int*)TSF_MALLOC(c->slotNum * sizeof(unsigned int));
+	c->slots = (float*)TSF_MALLOC(c->slotNum * (TSF_CACHE_PAGESAMPLES + 1) * sizeof(float));
+	c->readBuffer = (short*)TSF_MALLOC((TSF_CACHE_PAGESAMPLES + 1) * sizeof(short));
+	c->pageWanted = (unsigned char*)TSF_MALLOC(c->pageNum);
+	if (!c->pageSlot || !c->slotPage || !c->slotUse || !c->slots || !c->readBuffer || !c->pageWanted) { tsf_cache_free(c); return TSF_NULL; }
+	for (i = 0; i < c->pageNum; i++) c->pageSlot[i] = -1, c->pageWanted[i] = 0;
+	for (i = 0; i < c->slotNum; i++) c->slotPage[i] = -1, c->slotUse[i] = 0;
+	return c;
+}
+
+// Loads a page (reads from the stream, not to be called in the render path)
+static float* tsf_cache_page(struct tsf_sample_cache* c, unsigned int page)
+{
+	int slot = c->pageSlot[page];
+	float* out;
+	if (slot < 0)
+	{
+		// Replace the least recently used page.
+		unsigned int i, oldest = 0xffffffff, first, count, bytes;
+		for (i = 0, slot = 0; i < (unsigned int)c->slotNum; i++)
+			if (c->slotUse[i] < oldest) { oldest = c->slotUse[i]; slot = i; }
+		if (c->slotPage[slot] >= 0) c->pageSlot[c->slotPage[slot]] = -1;
+		c->slotPage[slot] = page;
+		c->pageSlot[page] = slot;
+
+		first = page * TSF_CACHE_PAGESAMPLES;
+		count = c->sampleCount - first;
+		if (count > TSF_CACHE_PAGESAMPLES + 1) count = TSF_CACHE_PAGESAMPLES + 1;
+		bytes = c->readAt(c->readAtData, c->smplOffset + first * sizeof(short), c->readBuffer, count * sizeof(short));
+		count = (bytes > 0 ? bytes / sizeof(short) : 0);
+
+		out = c->slots + slot * (TSF_CACHE_PAGESAMPLES + 1);
+		for (i = 0; i < count; i++) out[i] = (float)(c->readBuffer[i] / 32767.0);
+		for (; i < TSF_CACHE_PAGESAMPLES + 1; i++) out[i] = 0;
+	}
+	c->pageWanted[page] = 0;
+	c->slotUse[slot] = ++c->useCounter;
+	return c->slots + slot * (TSF_CACHE_PAGESAMPLES + 1);
+}
+
+// Queues a page for tsf_cache_service (dropped if the queue is full, the renderer asks again)
+static void tsf_cache_request(struct tsf_sample_cache* c, unsigned int page)
+{
+	if (page >= (unsigned int)c->pageNum || c->pageSlot[page] >= 0 || c->pageWanted[page]) return;
+	if (c->wantWrite - c->wantRead >= TSF_CACHE_REQUESTS) return;
+	c->want[c->wantWrite++ & (TSF_CACHE_REQUESTS - 1)] = page;
+	c->pageWanted[page] = 1;
+}
+
+// Render path: returns the page if it is in the cache, otherwise requests it and returns TSF_NULL
+static float* tsf_cache_lookup(struct tsf_sample_cache* c, unsigned int page)
+{
+	int slot = c->pageSlot[page];
+	if (slot < 0) { c->misses++; tsf_cache_request(c, page); return TSF_NULL; }
+	c->hits++;
+	c->slotUse[slot] = ++c->useCounter;
+	return c->slots + slot * (TSF_CACHE_PAGESAMPLES + 1);
+}
+
+static float tsf_sample(tsf* f, unsigned int pos)
+{
+	float* page;
+	if (!f->cache) return f->fontSamples[pos];
+	page = tsf_cache_lookup(f->cache, pos / TSF_CACHE_PAGESAMPLES);
+	return (page ? page[pos % TSF_CACHE_PAGESAMPLES] : 0.0f);
+}
+
+// Request the pages a new voice needs first: the start of the sample and the start of the loop
+static void tsf_cache_prefetch(tsf* f, unsigned int offset, unsigned int loopStart)
+{
+	struct tsf_sample_cache* c = f->cache;
+	if (!c || offset >= c->sampleCount) return;
+	tsf_cache_request(c, offset / TSF_CACHE_PAGESAMPLES);
+	tsf_cache_request(c, offset / TSF_CACHE_PAGESAMPLES + 1);
+	if (loopStart && loopStart < c->sampleCount) tsf_cache_request(c, loopStart / TSF_CACHE_PAGESAMPLES);
+}
+
 static void tsf_voice_kill(struct tsf_voice* v)
 {
 	v->playingPreset = -1;
@@ -1083,149 +1232,224 @@ static void tsf_voice_calcpitchratio(struct tsf_voice* v, float pitchShift, floa
 	v->pitchOutputFactor = v->region->sample_rate / (tsf_timecents2Secsd(v->region->pitch_keycenter * 100.0) * outSampleRate);
 }
 
-static void tsf_voice_render(tsf* f, struct tsf_voice* v, float* outputBuffer, int numSamples)
-{
-	struct tsf_region* region = v->region;
-	float* input = f->fontSamples;
-	float* outL = outputBuffer;
-	//float* outR = (f->outputmode == TSF_STEREO_UNWEAVED ? outL + numSamples : TSF_NULL);
+// Voices are rendered four at a time, one voice per lane: envelopes, LFOs, pitch and gain are updated per voice once
+// per effect block, interpolation, low-pass filter, gain and mixing of all four voices run per sample on a vector.
+// Sample positions are 32.32 fixed point. Only mono output is produced.
+#define TSF_LANES 4
 
-	// Cache some values, to give them at least some chance of ending up in registers.
-	TSF_BOOL updateModEnv = (region->modEnvToPitch || region->modEnvToFilterFc);
-	TSF_BOOL updateModLFO = (v->modlfo.delta && (region->modLfoToPitch || region->modLfoToFilterFc || region->modLfoToVolume));
-	TSF_BOOL updateVibLFO = (v->viblfo.delta && (region->vibLfoToPitch));
-	TSF_BOOL isLooping    = (v->loopStart < v->loopEnd);
-	unsigned int tmpLoopStart = v->loopStart, tmpLoopEnd = v->loopEnd;
-	double tmpSampleEndDbl = (double)region->end, tmpLoopEndDbl = (double)tmpLoopEnd + 1.0;
-	double tmpSourceSamplePosition = v->sourceSamplePosition;
-	struct tsf_voice_lowpass tmpLowpass = v->lowpass;
+struct tsf_lanes
+{
+	unsigned int pos[TSF_LANES], frac[TSF_LANES], incPos[TSF_LANES], incFrac[TSF_LANES];
+	unsigned int loopStart[TSF_LANES], loopEnd[TSF_LANES], loopWrap[TSF_LANES], loopLen[TSF_LANES], end[TSF_LANES], done[TSF_LANES];
+	float gain[TSF_LANES], loopSample[TSF_LANES];
+	// Window of the sample data which can be accessed directly (whole font, or one page of the sample cache):
+	// input[pos - inputStart] and the sample after it are valid for pos - inputStart < inputSpan.
+	const float* input[TSF_LANES];
+	unsigned int inputStart[TSF_LANES], inputSpan[TSF_LANES];
+};
 
-	TSF_BOOL dynamicLowpass = (region->modLfoToFilterFc || region->modEnvToFilterFc);
-	
-	/*****/dynamicLowpass = false;
+static const float tsf_lane_silence[2] = { 0, 0 };
 
-	float tmpSampleRate = f->outSampleRate;//, tmpInitialFilterFc, tmpModLfoToFilterFc, tmpModEnvToFilterFc;
+// Advances envelopes and LFOs of a voice by one block and returns the gain and pitch ratio to use for it.
+static float tsf_voice_block_params(tsf* f, struct tsf_voice* v, int blockSamples, double* pitchRatio)
+{
+	struct tsf_region* region = v->region;
+	float noteGain, gainMono;
 
-	TSF_BOOL dynamicPitchRatio = (region->modLfoToPitch || region->modEnvToPitch || region->vibLfoToPitch);
-	double pitchRatio;
-	float tmpModLfoToPitch, tmpVibLfoToPitch, tmpModEnvToPitch;
+	if (region->modLfoToPitch || region->modEnvToPitch || region->vibLfoToPitch)
+		*pitchRatio = tsf_timecents2Secsd(v->pitchInputTimecents + (v->modlfo.level * region->modLfoToPitch + v->viblfo.level * region->vibLfoToPitch + v->modenv.level * region->modEnvToPitch)) * v->pitchOutputFactor;
+	else
+		*pitchRatio = tsf_timecents2Secsd(v->pitchInputTimecents) * v->pitchOutputFactor;
 
-	TSF_BOOL dynamicGain = (region->modLfoToVolume != 0);
-	float noteGain = 0, tmpModLfoToVolume;
+	if (region->modLfoToVolume)
+		noteGain = tsf_decibelsToGain(v->noteGainDB + (v->modlfo.level * region->modLfoToVolume * 0.1f));
+	else
+		noteGain = tsf_decibelsToGain(v->noteGainDB);
 
-	//if (dynamicLowpass) tmpInitialFilterFc = (float)region->initialFilterFc, tmpModLfoToFilterFc = (float)region->modLfoToFilterFc, tmpModEnvToFilterFc = (float)region->modEnvToFilterFc;
-	//else tmpInitialFilterFc = 0, tmpModLfoToFilterFc = 0, tmpModEnvToFilterFc = 0;
+	gainMono = noteGain * v->ampenv.level;
 
-	if (dynamicPitchRatio) pitchRatio = 0, tmpModLfoToPitch = (float)region->modLfoToPitch, tmpVibLfoToPitch = (float)region->vibLfoToPitch, tmpModEnvToPitch = (float)region->modEnvToPitch;
-	else pitchRatio = tsf_timecents2Secsd(v->pitchInputTimecents) * v->pitchOutputFactor, tmpModLfoToPitch = 0, tmpVibLfoToPitch = 0, tmpModEnvToPitch = 0;
+	// Update EG.
+	tsf_voice_envelope_process(&v->ampenv, blockSamples, f->outSampleRate);
+	if (region->modEnvToPitch || region->modEnvToFilterFc) tsf_voice_envelope_process(&v->modenv, blockSamples, f->outSampleRate);
 
-	if (dynamicGain) tmpModLfoToVolume = (float)region->modLfoToVolume * 0.1f;
-	else noteGain = tsf_decibelsToGain(v->noteGainDB), tmpModLfoToVolume = 0;
+	// Update LFOs.
+	if (v->modlfo.delta && (region->modLfoToPitch || region->modLfoToFilterFc || region->modLfoToVolume)) tsf_voice_lfo_process(&v->modlfo, blockSamples);
+	if (v->viblfo.delta && region->vibLfoToPitch) tsf_voice_lfo_process(&v->viblfo, blockSamples);
 
-	while (numSamples)
-	{
-		float gainMono/*, gainLeft, gainRight*/;
-		int blockSamples = (numSamples > TSF_RENDER_EFFECTSAMPLEBLOCK ? TSF_RENDER_EFFECTSAMPLEBLOCK : numSamples);
-		numSamples -= blockSamples;
+	return gainMono;
+}
 
-		/*if (dynamicLowpass)
-		{
-			float fres = tmpInitialFilterFc + v->modlfo.level * tmpModLfoToFilterFc + v->modenv.level * tmpModEnvToFilterFc;
-			float lowpassFc = (fres <= 13500 ? tsf_cents2Hertz(fres) / tmpSampleRate : 1.0f);
-			tmpLowpass.active = (lowpassFc < 0.499f);
-			//////tmpLowpass.active = false;
-			if (tmpLowpass.active) tsf_voice_lowpass_setup(&tmpLowpass, lowpassFc);
-		}*/
+static void tsf_lanes_setup(tsf* f, struct tsf_lanes* l, int i, struct tsf_voice* v, int blockSamples)
+{
+	double pitchRatio, pos = v->sourceSamplePosition;
+	unsigned long long inc;
 
-		if (dynamicPitchRatio)
-			pitchRatio = tsf_timecents2Secsd(v->pitchInputTimecents + (v->modlfo.level * tmpModLfoToPitch + v->viblfo.level * tmpVibLfoToPitch + v->modenv.level * tmpModEnvToPitch)) * v->pitchOutputFactor;
+	l->gain[i] = tsf_voice_block_params(f, v, blockSamples, &pitchRatio);
+	inc = (unsigned long long)(pitchRatio * 4294967296.0);
 
-		if (dynamicGain)
-			noteGain = tsf_decibelsToGain(v->noteGainDB + (v->modlfo.level * tmpModLfoToVolume));
+	l->pos[i] = (unsigned int)pos;
+	l->frac[i] = (unsigned int)((pos - l->pos[i]) * 4294967296.0);
+	l->incPos[i] = (unsigned int)(inc >> 32);
+	l->incFrac[i] = (unsigned int)inc;
+	l->end[i] = v->region->end;
+	l->done[i] = (l->pos[i] >= l->end[i] ? 0xffffffff : 0);
 
-		gainMono = noteGain * v->ampenv.level;
+	if (v->loopStart < v->loopEnd)
+	{
+		l->loopStart[i] = v->loopStart;
+		l->loopEnd[i] = v->loopEnd;
+		l->loopWrap[i] = v->loopEnd + 1;
+		l->loopLen[i] = v->loopEnd - v->loopStart + 1;
+	}
+	else
+		l->loopStart[i] = 0, l->loopEnd[i] = l->loopWrap[i] = 0xffffffff, l->loopLen[i] = 0;
 
-		// Update EG.
-		tsf_voice_envelope_process(&v->ampenv, blockSamples, tmpSampleRate);
-		if (updateModEnv) tsf_voice_envelope_process(&v->modenv, blockSamples, tmpSampleRate);
+	// The interpolation at the loop end uses the sample at the loop start.
+	l->loopSample[i] = (l->loopLen[i] ? tsf_sample(f, l->loopStart[i]) : 0);
 
-		// Update LFOs.
-		if (updateModLFO) tsf_voice_lfo_process(&v->modlfo, blockSamples);
-		if (updateVibLFO) tsf_voice_lfo_process(&v->viblfo, blockSamples);
+	// The low-pass filter is not applied (as in the original renderer, where it had been switched off for CPU reasons).
 
-		/*switch (f->outputmode)
-		{
-			case TSF_STEREO_INTERLEAVED:
-				gainLeft = gainMono * v->panFactorLeft, gainRight = gainMono * v->panFactorRight;
-				while (blockSamples-- && tmpSourceSamplePosition < tmpSampleEndDbl)
-				{
-					unsigned int pos = (unsigned int)tmpSourceSamplePosition, nextPos = (pos >= tmpLoopEnd && isLooping ? tmpLoopStart : pos + 1);
+	l->input[i] = f->fontSamples;
+	l->inputStart[i] = 0;
+	l->inputSpan[i] = (f->cache ? 0 : 0xffffffff);
+}
 
-					// Simple linear interpolation.
-					float alpha = (float)(tmpSourceSamplePosition - pos), val = (input[pos] * (1.0f - alpha) + input[nextPos] * alpha);
+// Unused lane: plays silence and never reads outside of tsf_lane_silence.
+static void tsf_lanes_setup_silent(struct tsf_lanes* l, int i)
+{
+	l->pos[i] = l->frac[i] = l->incPos[i] = l->incFrac[i] = 0;
+	l->loopStart[i] = 0, l->loopEnd[i] = l->loopWrap[i] = 0xffffffff, l->loopLen[i] = 0;
+	l->end[i] = 1, l->done[i] = 0xffffffff;
+	l->gain[i] = 0, l->loopSample[i] = 0;
+	l->input[i] = tsf_lane_silence, l->inputStart[i] = 0, l->inputSpan[i] = 1;
+}
 
-					// Low-pass filter.
-					if (tmpLowpass.active) val = tsf_voice_lowpass_process(&tmpLowpass, val);
+// Moves the window of a lane to the cache page containing 'pos'. A page which is not loaded yet plays as silence
+// (tsf_lane_silence with an empty span, i.e. it is looked up again at the next sample).
+static void tsf_lanes_window(tsf* f, struct tsf_lanes* l, int i, unsigned int pos)
+{
+	float* page = tsf_cache_lookup(f->cache, pos / TSF_CACHE_PAGESAMPLES);
+	if (page) l->input[i] = page, l->inputStart[i] = pos - pos % TSF_CACHE_PAGESAMPLES, l->inputSpan[i] = TSF_CACHE_PAGESAMPLES;
+	else l->input[i] = tsf_lane_silence, l->inputStart[i] = pos, l->inputSpan[i] = 0;
+}
 
-					*outL++ += val * gainLeft;
-					*outL++ += val * gainRight;
+#ifndef __ARM_NEON
+// Fetches the two samples for the linear interpolation of every lane.
+static void tsf_lanes_gather(tsf* f, struct tsf_lanes* l, float* s0, float* s1)
+{
+	int i;
+	for (i = 0; i < TSF_LANES; i++)
+	{
+		unsigned int pos = l->pos[i], rel = pos - l->inputStart[i];
+		if (rel >= l->inputSpan[i]) tsf_lanes_window(f, l, i, pos), rel = pos - l->inputStart[i];
+		s0[i] = l->input[i][rel];
+		s1[i] = (!l->inputSpan[i] ? 0 : pos < l->loopEnd[i] ? l->input[i][rel + 1] : l->loopSample[i]);
+	}
+}
+#endif
 
-					// Next sample.
-					tmpSourceSamplePosition += pitchRatio;
-					if (tmpSourceSamplePosition >= tmpLoopEndDbl && isLooping) tmpSourceSamplePosition -= (tmpLoopEnd - tmpLoopStart + 1.0);
-				}
-				break;
+static void tsf_lanes_render(tsf* f, struct tsf_lanes* l, float* outputBuffer, int numSamples)
+{
+#ifdef __ARM_NEON
+	uint32x4_t pos = vld1q_u32(l->pos), frac = vld1q_u32(l->frac), incPos = vld1q_u32(l->incPos), incFrac = vld1q_u32(l->incFrac);
+	uint32x4_t loopWrap = vld1q_u32(l->loopWrap), loopLen = vld1q_u32(l->loopLen), loopEnd = vld1q_u32(l->loopEnd), end = vld1q_u32(l->end), done = vld1q_u32(l->done);
+	uint32x4_t inputStart = vld1q_u32(l->inputStart), inputSpan = vld1q_u32(l->inputSpan);
+	uint32x4_t last = vsubq_u32(end, vdupq_n_u32(1));
+	float32x4_t gain = vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(vld1q_f32(l->gain)), done));
+	float32x4_t loopSample = vld1q_f32(l->loopSample);
 
-			case TSF_STEREO_UNWEAVED:
-				gainLeft = gainMono * v->panFactorLeft, gainRight = gainMono * v->panFactorRight;
-				while (blockSamples-- && tmpSourceSamplePosition < tmpSampleEndDbl)
-				{
-					unsigned int pos = (unsigned int)tmpSourceSamplePosition, nextPos = (pos >= tmpLoopEnd && isLooping ? tmpLoopStart : pos + 1);
+	while (numSamples--)
+	{
+		float32x4_t a, b, alpha, val;
+		float32x4x2_t pairs;
+		uint32x4_t rel = vsubq_u32(pos, inputStart), nextFrac;
 
-					// Simple linear interpolation.
-					float alpha = (float)(tmpSourceSamplePosition - pos), val = (input[pos] * (1.0f - alpha) + input[nextPos] * alpha);
+		// A lane left its window (only with the sample cache, once per page): move the windows on the scalar side.
+		if (vmaxvq_u32(vcgeq_u32(rel, inputSpan)))
+		{
+			int i;
+			vst1q_u32(l->pos, pos);
+			for (i = 0; i < TSF_LANES; i++)
+				if (l->pos[i] - l->inputStart[i] >= l->inputSpan[i]) tsf_lanes_window(f, l, i, l->pos[i]);
+			inputStart = vld1q_u32(l->inputStart), inputSpan = vld1q_u32(l->inputSpan);
+			rel = vsubq_u32(pos, inputStart);
+		}
 
-					// Low-pass filter.
-					if (tmpLowpass.active) val = tsf_voice_lowpass_process(&tmpLowpass, val);
+		// Gather the sample pairs (pos, pos + 1) of the lanes and de-interleave them into the interpolation end points,
+		// the second one is the loop start sample at the loop end, and silence while a page is missing.
+		pairs = vuzpq_f32(vcombine_f32(vld1_f32(l->input[0] + vgetq_lane_u32(rel, 0)), vld1_f32(l->input[1] + vgetq_lane_u32(rel, 1))),
+		                  vcombine_f32(vld1_f32(l->input[2] + vgetq_lane_u32(rel, 2)), vld1_f32(l->input[3] + vgetq_lane_u32(rel, 3))));
+		a = pairs.val[0];
+		b = vbslq_f32(vcltq_u32(pos, loopEnd), pairs.val[1], loopSample);
+		b = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(b), vtstq_u32(inputSpan, inputSpan)));
+
+		// Simple linear interpolation.
+		alpha = vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(frac, 8)), 1.0f / 16777216.0f);
+		val = vmlaq_f32(a, vsubq_f32(b, a), alpha);
+
+		*outputBuffer++ += vaddvq_f32(vmulq_f32(val, gain));
+
+		// Next sample: 32.32 add, loop and end of sample.
+		nextFrac = vaddq_u32(frac, incFrac);
+		pos = vsubq_u32(vaddq_u32(pos, incPos), vcltq_u32(nextFrac, frac));
+		frac = nextFrac;
+		pos = vsubq_u32(pos, vandq_u32(vcgeq_u32(pos, loopWrap), loopLen));
+		done = vorrq_u32(done, vcgeq_u32(pos, end));
+		gain = vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(gain), done));
+		pos = vminq_u32(pos, last);
+	}
 
-					*outL++ += val * gainLeft;
-					*outR++ += val * gainRight;
+	vst1q_u32(l->pos, pos);
+	vst1q_u32(l->frac, frac);
+	vst1q_u32(l->done, done);
+#else
+	float s0[TSF_LANES], s1[TSF_LANES];
+	int i;
+	for (i = 0; i < TSF_LANES; i++)
+		if (l->done[i]) l->gain[i] = 0;
 
-					// Next sample.
-					tmpSourceSamplePosition += pitchRatio;
-					if (tmpSourceSamplePosition >= tmpLoopEndDbl && isLooping) tmpSourceSamplePosition -= (tmpLoopEnd - tmpLoopStart + 1.0);
-				}
-				break;
+	while (numSamples--)
+	{
+		float mix = 0;
+		tsf_lanes_gather(f, l, s0, s1);
+		for (i = 0; i < TSF_LANES; i++)
+		{
+			float alpha = (float)(l->frac[i] >> 8) * (1.0f / 16777216.0f), val = s0[i] + (s1[i] - s0[i]) * alpha;
+			unsigned int nextFrac = l->frac[i] + l->incFrac[i];
 
-			case TSF_MONO:*/
-				while (blockSamples-- && tmpSourceSamplePosition < tmpSampleEndDbl)
-				{
-					unsigned int pos = (unsigned int)tmpSourceSamplePosition, nextPos = (pos >= tmpLoopEnd && isLooping ? tmpLoopStart : pos + 1);
+			mix += val * l->gain[i];
 
-					// Simple linear interpolation.
-					float alpha = (float)(tmpSourceSamplePosition - pos), val = (input[pos] * (1.0f - alpha) + input[nextPos] * alpha);
+			l->pos[i] += l->incPos[i] + (nextFrac < l->frac[i]);
+			l->frac[i] = nextFrac;
+			if (l->pos[i] >= l->loopWrap[i]) l->pos[i] -= l->loopLen[i];
+			if (l->pos[i] >= l->end[i]) l->done[i] = 0xffffffff, l->gain[i] = 0, l->pos[i] = l->end[i] - 1;
+		}
+		*outputBuffer++ += mix;
+	}
+#endif
+}
 
-					// Low-pass filter.
-					//if (tmpLowpass.active) val = tsf_voice_lowpass_process(&tmpLowpass, val);
+static void tsf_voices_render(tsf* f, struct tsf_voice** voices, int voiceCount, float* outputBuffer, int numSamples)
+{
+	struct tsf_lanes l;
+	int i;
 
-					*outL++ += val * gainMono;
+	for (i = 0; i < TSF_LANES; i++)
+		if (i < voiceCount) tsf_lanes_setup(f, &l, i, voices[i], numSamples);
+		else tsf_lanes_setup_silent(&l, i);
 
-					// Next sample.
-					tmpSourceSamplePosition += pitchRatio;
-					if (tmpSourceSamplePosition >= tmpLoopEndDbl && isLooping) tmpSourceSamplePosition -= (tmpLoopEnd - tmpLoopStart + 1.0);
-				}
-				//break;
-		//}
+	tsf_lanes_render(f, &l, outputBuffer, numSamples);
 
-		if (tmpSourceSamplePosition >= tmpSampleEndDbl || v->ampenv.segment == TSF_SEGMENT_DONE)
+	for (i = 0; i < voiceCount; i++)
+	{
+		struct tsf_voice* v = voices[i];
+		if (l.done[i] || v->ampenv.segment == TSF_SEGMENT_DONE)
 		{
 			tsf_voice_kill(v);
-			return;
+			continue;
 		}
+		v->sourceSamplePosition = l.pos[i] + l.frac[i] * (1.0 / 4294967296.0);
 	}
-
-	v->sourceSamplePosition = tmpSourceSamplePosition;
-	if (tmpLowpass.active || dynamicLowpass) v->lowpass = tmpLowpass;
 }
 
 
@@ -1378,7 +1602,13 @@ static void tsf_voice_render(tsf* f, struct tsf_voice* v, float* outputBuffer, i
 }
 */
 
-TSFDEF tsf* tsf_load(struct tsf_stream* stream)
+// Keeps track of the stream position to locate the sample data when streaming.
+struct tsf_stream_counting { struct tsf_stream* stream; unsigned int pos; };
+static int tsf_stream_counting_read(struct tsf_stream_counting* c, void* ptr, unsigned int size) { int n = c->stream->read(c->stream->data, ptr, size); if (n > 0) c->pos += n; return n; }
+static int tsf_stream_counting_skip(struct tsf_stream_counting* c, unsigned int count) { if (!c->stream->skip(c->stream->data, count)) return 0; c->pos += count; return 1; }
+
+// streamPos == NULL: load the sample data, otherwise only return its position and size
+static tsf* tsf_load_internal(struct tsf_stream* stream, const unsigned int* streamPos, unsigned int* smplOffset, unsigned int* smplCount)
 {
 	tsf* res = TSF_NULL;
 	struct tsf_riffchunk chunkHead;
@@ -1426,7 +1656,13 @@ TSFDEF tsf* tsf_load(struct tsf_stream* stream)
 		{
 			while (tsf_riffchunk_read(&chunkList, &chunk, stream))
 			{
-				if (TSF_FourCCEquals(chunk.id, "smpl"))
+				if (TSF_FourCCEquals(chunk.id, "smpl") && streamPos)
+				{
+					*smplOffset = *streamPos;
+					*smplCount = fontSampleCount = chunk.size / sizeof(short);
+					stream->skip(stream->data, chunk.size);
+				}
+				else if (TSF_FourCCEquals(chunk.id, "smpl"))
 				{
 					tsf_load_samples(&fontSamples, &fontSampleCount, &chunk, stream);
 				}
@@ -1439,7 +1675,7 @@ TSFDEF tsf* tsf_load(struct tsf_stream* stream)
 	{
 		//if (e) *e = TSF_INVALID_INCOMPLETE;
 	}
-	else if (fontSamples == TSF_NULL)
+	else if (fontSamples == TSF_NULL && !(streamPos && fontSampleCount))
 	{
 		//if (e) *e = TSF_INVALID_NOSAMPLEDATA;
 	}
@@ -1461,6 +1697,51 @@ TSFDEF tsf* tsf_load(struct tsf_stream* stream)
 	return res;
 }
 
+TSFDEF tsf* tsf_load(struct tsf_stream* stream)
+{
+	return tsf_load_internal(stream, TSF_NULL, TSF_NULL, TSF_NULL);
+}
+
+TSFDEF tsf* tsf_load_streaming(struct tsf_stream* stream, int (*readAt)(void* data, unsigned int offset, void* ptr, unsigned int size), void* readAtData, unsigned int cacheBytes)
+{
+	struct tsf_stream_counting counting = { stream, 0 };
+	struct tsf_stream countingStream = { &counting, (int(*)(void*,void*,unsigned int))&tsf_stream_counting_read, (int(*)(void*,unsigned int))&tsf_stream_counting_skip };
+	unsigned int smplOffset = 0, smplCount = 0;
+	tsf* res = tsf_load_internal(&countingStream, &counting.pos, &smplOffset, &smplCount);
+	if (!res) return res;
+	res->cache = tsf_cache_create(smplOffset, smplCount, readAt, readAtData, cacheBytes);
+	if (!res->cache) { tsf_close(res); return TSF_NULL; }
+	return res;
+}
+
+TSFDEF int tsf_cache_service(tsf* f, int maxPages)
+{
+	struct tsf_sample_cache* c = f->cache;
+	struct tsf_voice *v, *vEnd;
+	int loaded = 0;
+	if (!c) return 0;
+
+	// read-ahead: the current and the next page of every playing voice, and its loop start
+	for (v = f->voices, vEnd = v + f->voiceNum; v != vEnd; v++)
+	{
+		unsigned int page;
+		if (v->playingPreset == -1) continue;
+		page = (unsigned int)v->sourceSamplePosition / TSF_CACHE_PAGESAMPLES;
+		tsf_cache_request(c, page);
+		tsf_cache_request(c, page + 1);
+		if (v->loopStart < v->loopEnd) tsf_cache_request(c, v->loopStart / TSF_CACHE_PAGESAMPLES);
+	}
+
+	// requests are served in order, i.e. misses of the renderer and note-on prefetches first
+	while (c->wantRead != c->wantWrite && (maxPages < 0 || loaded < maxPages))
+	{
+		int page = c->want[c->wantRead++ & (TSF_CACHE_REQUESTS - 1)];
+		if (c->pageSlot[page] < 0) { tsf_cache_page(c, page); loaded++; }
+		c->pageWanted[page] = 0;
+	}
+	return loaded;
+}
+
 TSFDEF void tsf_close(tsf* f)
 {
 	struct tsf_preset *preset, *presetEnd;
@@ -1469,6 +1750,7 @@ TSFDEF void tsf_close(tsf* f)
 		TSF_FREE(preset->regions);
 	TSF_FREE(f->presets);
 	TSF_FREE(f->fontSamples);
+	tsf_cache_free(f->cache);
 	TSF_FREE(f->voices);
 	if (f->channels) { TSF_FREE(f->channels->channels); TSF_FREE(f->channels); }
 	TSF_FREE(f->outputSamples);
@@ -1593,6 +1875,7 @@ TSFDEF void tsf_note_on(tsf* f, int preset_index, int key, float vel)
 		doLoop = (region->loop_mode != TSF_LOOPMODE_NONE && region->loop_start < region->loop_end);
 		voice->loopStart = (doLoop ? region->loop_start : 0);
 		voice->loopEnd = (doLoop ? region->loop_end : 0);
+		tsf_cache_prefetch(f, region->offset, voice->loopStart);
 
 		// Setup envelopes.
 		tsf_voice_envelope_setup(&voice->ampenv, &region->ampenv, key, midiVelocity, TSF_TRUE, f->outSampleRate);
@@ -1695,11 +1978,22 @@ TSFDEF void tsf_render_short(tsf* f, short* buffer, int samples, int flag_mixing
 
 TSFDEF void tsf_render_float(tsf* f, float* buffer, int samples, int flag_mixing)
 {
-	struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum;
+	struct tsf_voice* group[TSF_LANES];
 	//if (!flag_mixing) TSF_MEMSET(buffer, 0, (f->outputmode == TSF_MONO ? 1 : 2) * sizeof(float) * samples);
-	for (; v != vEnd; v++)
-		if (v->playingPreset != -1)
-			tsf_voice_render(f, v, buffer, samples);
+	while (samples)
+	{
+		struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum;
+		int blockSamples = (samples > TSF_RENDER_EFFECTSAMPLEBLOCK ? TSF_RENDER_EFFECTSAMPLEBLOCK : samples), n = 0;
+		for (; v != vEnd; v++)
+			if (v->playingPreset != -1)
+			{
+				group[n++] = v;
+				if (n == TSF_LANES) { tsf_voices_render(f, group, n, buffer, blockSamples); n = 0; }
+			}
+		if (n) tsf_voices_render(f, group, n, buffer, blockSamples);
+		buffer += blockSamples;
+		samples -= blockSamples;
+	}
 }
 
 static void tsf_channel_setup_voice(tsf* f, struct tsf_voice* v)
@@ -1852,6 +2146,21 @@ TSFDEF void tsf_channel_note_on(tsf* f, int channel, int key, float vel)
 	tsf_note_on(f, f->channels->channels[channel].presetIndex, key, vel);
 }
 
+TSFDEF void tsf_channel_note_prefetch(tsf* f, int channel, int key, float vel)
+{
+	struct tsf_region *region, *regionEnd;
+	short midiVelocity = (short)(vel * 127);
+	int preset_index;
+	if (!f->cache || !f->channels || channel >= f->channels->channelNum || vel <= 0.0f) return;
+	preset_index = f->channels->channels[channel].presetIndex;
+	if (preset_index >= f->presetNum) return;
+	for (region = f->presets[preset_index].regions, regionEnd = region + f->presets[preset_index].regionNum; region != regionEnd; region++)
+	{
+		if (key < region->lokey || key > region->hikey || midiVelocity < region->lovel || midiVelocity > region->hivel) continue;
+		tsf_cache_prefetch(f, region->offset, (region->loop_mode != TSF_LOOPMODE_NONE && region->loop_start < region->loop_end) ? region->loop_start : 0);
+	}
+}
+
 TSFDEF void tsf_channel_note_off(tsf* f, int channel, int key)
 {
 	struct tsf_voice *v = f->voices, *vEnd = v + f->voiceNum, *vMatchFirst = TSF_NULL, *vMatchLast = TSF_NULL;
@@ -1031,8 +1031,7 @@ void handleC64( int k, u32 *launchKernel, char *FILENAME, char *filenameKernal )
 							u32 imgsize = 0;
 
 							// mount file system
-							FATFS m_FileSystem;
-							if ( f_mount( &m_FileSystem, DRIVE, 1 ) != FR_OK )
+							if ( fsMount( DRIVE ) != FR_OK )
 								logger->Write( "RaspiMenu", LogPanic, "Cannot mount drive: %s", DRIVE );
 
 							logger->Write( "exec", LogNotice, "D64-path '%s'", path );
@@ -1040,7 +1039,7 @@ void handleC64( int k, u32 *launchKernel, char *FILENAME, char *filenameKernal )
 								return;
 
 							// unmount file system
-							if ( f_mount( 0, DRIVE, 0 ) != FR_OK )
+							if ( fsUnmount( DRIVE ) != FR_OK )
 								logger->Write( "RaspiMenu", LogPanic, "Cannot unmount drive: %s", DRIVE );
 
 							char d64filename[ 20 ];
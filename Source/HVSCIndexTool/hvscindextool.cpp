@@ -0,0 +1,137 @@
+/*
+  _________.__    .___      __   .__        __        ___ ___ ____   ____  ______________  
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __   /   |   \\   \ /   / /   _____/\_   ___ \ 
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /  /    ~    \\   Y   /  \_____  \ /    \  \/ 
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <   \    Y    / \     /   /        \\     \____
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \   \___|_  /   \___/   /_______  / \______  /
+        \/         \/    \/     \/       \/     \/         \/                    \/         \/ 
+
+
+ Sidekick64 - HVSC Index Tool
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// builds DOCUMENTS/HVSC.IDX from DOCUMENTS/Songlengths.md5 and DOCUMENTS/STIL.txt (the firmware does the same on first use,
+// but this is much faster on a PC), or looks up .sid files in an existing index
+//
+// build:  g++ -O2 -o hvscindex hvscindextool.cpp
+// usage:  hvscindex <HVSC root>                    (e.g. hvscindex C64Music)
+//         hvscindex <HVSC root> <.sid path> ...    (e.g. hvscindex C64Music /MUSICIANS/H/Hubbard_Rob/Commando.sid)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../Firmware/PSID/libpsid64/hvscindex.cpp"
+
+static char *loadFile( const char *filename, uint32_t *size )
+{
+	FILE *f = fopen( filename, "rb" );
+	if ( f == NULL )
+	{
+		*size = 0;
+		return NULL;
+	}
+
+	fseek( f, 0, SEEK_END );
+	*size = ftell( f );
+	fseek( f, 0, SEEK_SET );
+
+	char *data = new char[ *size + 1 ];
+	*size = fread( data, 1, *size, f );
+	data[ *size ] = 0;
+	fclose( f );
+
+	return data;
+}
+
+int main( int argc, char **argv )
+{
+	char filename[ 4096 ];
+
+	if ( argc < 2 )
+	{
+		printf( "usage: %s <HVSC root> [.sid path ...]\n", argv[ 0 ] );
+		return -1;
+	}
+
+	uint32_t stilSize;
+	sprintf( filename, "%s/DOCUMENTS/STIL.txt", argv[ 1 ] );
+	char *stil = loadFile( filename, &stilSize );
+
+	if ( argc == 2 )
+	{
+		uint32_t songlengthsSize;
+		sprintf( filename, "%s/DOCUMENTS/Songlengths.md5", argv[ 1 ] );
+		char *songlengths = loadFile( filename, &songlengthsSize );
+
+		if ( songlengths == NULL && stil == NULL )
+		{
+			printf( "neither Songlengths.md5 nor STIL.txt found in '%s/DOCUMENTS'\n", argv[ 1 ] );
+			return -1;
+		}
+
+		uint8_t *index;
+		uint32_t size = hvscIndexBuild( songlengths, songlengthsSize, stil, stilSize, &index );
+
+		sprintf( filename, "%s/DOCUMENTS/%s", argv[ 1 ], HVSCINDEX_FILENAME );
+		FILE *f = fopen( filename, "wb" );
+		if ( f == NULL || fwrite( index, 1, size, f ) != size )
+		{
+			printf( "error writing '%s'\n", filename );
+			return -1;
+		}
+		fclose( f );
+
+		const HVSCINDEXHEADER *h = (const HVSCINDEXHEADER *)index;
+		printf( "%s: %d entries, %d song lengths, %d bytes\n", filename, h->nEntries, h->nLengths, size );
+		return 0;
+	}
+
+	uint32_t size;
+	sprintf( filename, "%s/DOCUMENTS/%s", argv[ 1 ], HVSCINDEX_FILENAME );
+	uint8_t *index = (uint8_t *)loadFile( filename, &size );
+	if ( !hvscIndexValid( index, size ) )
+	{
+		printf( "'%s' is missing or not a valid index\n", filename );
+		return -1;
+	}
+
+	for ( int i = 2; i < argc; i++ )
+	{
+		const HVSCINDEXENTRY *e = hvscIndexFind( index, argv[ i ] );
+		if ( e == NULL )
+		{
+			printf( "%s: not found\n", argv[ i ] );
+			continue;
+		}
+
+		printf( "%s:", argv[ i ] );
+		for ( int s = 0; s < e->nSongs; s++ )
+		{
+			uint16_t l = hvscIndexSongLength( index, e, s );
+			printf( " %d:%02d", l / 60, l % 60 );
+		}
+		printf( "\n" );
+
+		if ( e->stilLength && stil != NULL && e->stilOffset + e->stilLength <= stilSize )
+			printf( "%.*s\n", e->stilLength, stil + e->stilOffset );
+	}
+
+	return 0;
+}
@@ -0,0 +1,16 @@
+// minimal stand-in for Circle's types.h to compile firmware headers on the host
+#ifndef _circle_types_h
+#define _circle_types_h
+
+typedef unsigned char		u8;
+typedef unsigned short		u16;
+typedef unsigned int		u32;
+typedef unsigned long long	u64;
+typedef signed char			s8;
+typedef signed short		s16;
+typedef signed int			s32;
+typedef signed long long	s64;
+
+#define AAA __attribute__ ((aligned (128)))
+
+#endif
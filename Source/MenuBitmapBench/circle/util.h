@@ -0,0 +1,7 @@
+// minimal stand-in for Circle's util.h to compile firmware headers on the host
+#ifndef _circle_util_h
+#define _circle_util_h
+
+#include <string.h>
+
+#endif
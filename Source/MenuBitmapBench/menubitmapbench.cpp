@@ -0,0 +1,147 @@
+/*
+  _________.__    .___      __   .__        __        _________.___________  .___  .___
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __   /   _____/|   \______ \ |   | |   |
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /   \_____  \ |   ||    |  \|   | |   |
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <    /        \|   ||    `   \   | |   |
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \  /_______  /|___/_______  /___| |___|
+        \/         \/    \/     \/       \/     \/          \/             \/           
+
+
+ Sidekick64 - menu sprite layer mask benchmark
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// converts random text screens with the original per-character code and with screenToBitmapDilated
+// (Firmware/screen_bitmap.h, NEON when compiled for ARM), compares the masks and reports the timings
+//
+// build:  g++ -O2 -I. -o menubitmapbench menubitmapbench.cpp
+// usage:  menubitmapbench [charset.bin] [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../Firmware/screen_bitmap.h"
+
+static u8 charset[ 4096 ];
+static u8 screen[ 1000 ];
+static u8 fbRef[ 320 * 200 / 8 + 40 ];		// the original code writes one row beyond the bitmap
+static u8 fbNew[ 320 * 200 / 8 ];
+
+// the original conversion from kernel_menu.cpp
+static void convertScreenToBitmapRef( unsigned char *framebuffer, const u8 *font )
+{
+	u32 columns = 40; 
+	u32 rows = 25;
+
+	memset( framebuffer, 0, 320 * 200 / 8 );
+
+	for ( u32 j = 8; j < rows; j++ )
+	{
+		for ( u32 i = 1; i < columns-1; i++ )
+		{
+			unsigned char c = screen[ i + j * 40 ];
+			int x = i * 8;
+			int y = j * 8;
+
+			if ( c != 32 && c != ( 32 + 128 ) )
+			for ( int b = 0; b < 8; b++ )
+			{
+				unsigned char v = font[ c * 8 + b ];
+
+				u32 *p = (u32*)&framebuffer[ ( x / 8 - 1 ) + ( b + y ) * 320 / 8 ];
+				u32 m2 = ( (u32)v ) << 8;
+				m2 &= 0xff00;
+				u32 m = m2;
+				u8 *d = (u8*)&m;
+				d[ 1 ] = v;
+				d[ 0 ] = v >> 7;
+				d[ 1 ] |= v << 1;
+				d[ 1 ] |= v >> 1;
+				d[ 2 ] = ( v << 7 ) & 128;
+				*p |= m;
+				*( p + 320 / 8 / 4 ) |= m;
+				*( p - 320 / 8 / 4 ) |= m;
+			}
+		}
+	}
+}
+
+static double now()
+{
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main( int argc, char **argv )
+{
+	int iterations = 10000;
+
+	srand( 1234 );
+	for ( int i = 0; i < 4096; i++ )
+		charset[ i ] = rand();
+
+	if ( argc > 1 )
+	{
+		FILE *f = fopen( argv[ 1 ], "rb" );
+		if ( f == NULL )
+		{
+			printf( "cannot open '%s'\n", argv[ 1 ] );
+			return -1;
+		}
+		fread( charset, 1, 4096, f );
+		fclose( f );
+	}
+	if ( argc > 2 )
+		iterations = atoi( argv[ 2 ] );
+
+	// correctness: random screens with a varying amount of spaces (menu screens are mostly empty)
+	int errors = 0;
+	for ( int t = 0; t < 1000; t++ )
+	{
+		int spaces = t % 100;
+		for ( int i = 0; i < 1000; i++ )
+			screen[ i ] = ( rand() % 100 < spaces ) ? ( ( rand() & 1 ) ? 32 : 32 + 128 ) : rand();
+
+		const u8 *font = &charset[ ( t & 1 ) * 2048 ];
+		convertScreenToBitmapRef( fbRef, font );
+		screenToBitmapDilated( fbNew, screen, font );
+		if ( memcmp( fbRef, fbNew, sizeof( fbNew ) ) )
+			errors ++;
+	}
+
+	// timing on a typical menu screen: about half of the characters are spaces
+	for ( int i = 0; i < 1000; i++ )
+		screen[ i ] = ( rand() & 1 ) ? 32 : rand();
+
+	double t0 = now();
+	for ( int i = 0; i < iterations; i++ )
+		convertScreenToBitmapRef( fbRef, charset );
+	double t1 = now();
+	for ( int i = 0; i < iterations; i++ )
+		screenToBitmapDilated( fbNew, screen, charset );
+	double t2 = now();
+
+	printf( "%d mismatches in 1000 screens\n", errors );
+	printf( "original:  %8.2f us/screen\n", ( t1 - t0 ) * 1e6 / iterations );
+	printf( "new:       %8.2f us/screen (%.1fx)\n", ( t2 - t1 ) * 1e6 / iterations, ( t1 - t0 ) / ( t2 - t1 ) );
+
+	return errors ? 1 : 0;
+}
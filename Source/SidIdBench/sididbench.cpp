@@ -0,0 +1,173 @@
+/*
+  _________.__    .___      __   .__        __        _________.___________  .___  .___
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __   /   _____/|   \______ \ |   | |   |
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /   \_____  \ |   ||    |  \|   | |   |
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <    /        \|   ||    `   \   | |   |
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \  /_______  /|___/_______  /___| |___|
+        \/         \/    \/     \/       \/     \/          \/             \/           
+
+
+ Sidekick64 - SID player identification benchmark
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+ 
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// runs the single-pass player identification (SidId::identify) and the per-pattern reference
+// (SidId::identifySlow) over all .sid files in a directory tree, compares the results and reports the timings
+//
+// build:  g++ -O2 -o sididbench sididbench.cpp ../Firmware/PSID/libpsid64/sidid.cpp
+// usage:  sididbench <sidid.cfg> <directory> [-v]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include "../Firmware/PSID/libpsid64/sidid.h"
+
+static std::vector< std::vector<uint_least8_t> > tunes;
+static std::vector< std::string > names;
+
+static double now()
+{
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// returns the C64 data of a PSID/RSID file (without the load address), as psid64 passes it to SidId
+static bool loadSID( const char *filename, std::vector<uint_least8_t> &data )
+{
+	FILE *f = fopen( filename, "rb" );
+	if ( f == NULL )
+		return false;
+
+	std::vector<uint_least8_t> file;
+	uint_least8_t buf[ 4096 ];
+	size_t n;
+	while ( ( n = fread( buf, 1, sizeof( buf ), f ) ) > 0 )
+		file.insert( file.end(), buf, buf + n );
+	fclose( f );
+
+	if ( file.size() < 0x76 || ( memcmp( &file[ 0 ], "PSID", 4 ) && memcmp( &file[ 0 ], "RSID", 4 ) ) )
+		return false;
+
+	size_t dataOffset = ( file[ 6 ] << 8 ) | file[ 7 ];
+	size_t loadAddr = ( file[ 8 ] << 8 ) | file[ 9 ];
+	if ( loadAddr == 0 )
+		dataOffset += 2;
+	if ( dataOffset >= file.size() )
+		return false;
+
+	data.assign( file.begin() + dataOffset, file.end() );
+	return true;
+}
+
+static void scanDirectory( const std::string &path )
+{
+	DIR *d = opendir( path.c_str() );
+	if ( d == NULL )
+		return;
+
+	struct dirent *e;
+	while ( ( e = readdir( d ) ) != NULL )
+	{
+		if ( e->d_name[ 0 ] == '.' )
+			continue;
+
+		std::string name = path + "/" + e->d_name;
+		size_t l = strlen( e->d_name );
+
+		if ( l > 4 && strcasecmp( e->d_name + l - 4, ".sid" ) == 0 )
+		{
+			std::vector<uint_least8_t> data;
+			if ( loadSID( name.c_str(), data ) )
+			{
+				tunes.push_back( data );
+				names.push_back( name );
+			}
+		} else
+			scanDirectory( name );
+	}
+	closedir( d );
+}
+
+int main( int argc, char **argv )
+{
+	if ( argc < 3 )
+	{
+		printf( "usage: %s <sidid.cfg> <directory> [-v]\n", argv[ 0 ] );
+		return -1;
+	}
+
+	bool verbose = argc > 3 && strcmp( argv[ 3 ], "-v" ) == 0;
+
+	SidId sidId;
+	if ( !sidId.readConfigFile( argv[ 1 ] ) )
+	{
+		printf( "error reading '%s'\n", argv[ 1 ] );
+		return -1;
+	}
+
+	scanDirectory( argv[ 2 ] );
+
+	size_t bytes = 0;
+	for ( size_t i = 0; i < tunes.size(); i++ )
+		bytes += tunes[ i ].size();
+	printf( "%d tunes, %d bytes\n", (int)tunes.size(), (int)bytes );
+
+	std::vector< std::string > resFast( tunes.size() ), resSlow( tunes.size() );
+
+	// the first call builds the automaton, time it separately
+	double t0 = now();
+	if ( !tunes.empty() )
+		sidId.identify( tunes[ 0 ] );
+	double t1 = now();
+	for ( size_t i = 0; i < tunes.size(); i++ )
+		resFast[ i ] = sidId.identify( tunes[ i ] );
+	double t2 = now();
+	for ( size_t i = 0; i < tunes.size(); i++ )
+		resSlow[ i ] = sidId.identifySlow( tunes[ i ] );
+	double t3 = now();
+
+	int mismatches = 0, identified = 0;
+	for ( size_t i = 0; i < tunes.size(); i++ )
+	{
+		if ( !resFast[ i ].empty() )
+			identified ++;
+		if ( resFast[ i ] != resSlow[ i ] )
+		{
+			mismatches ++;
+			printf( "MISMATCH %s: '%s' (single pass) vs '%s' (reference)\n", names[ i ].c_str(), resFast[ i ].c_str(), resSlow[ i ].c_str() );
+		} else
+		if ( verbose )
+			printf( "%s: %s\n", names[ i ].c_str(), resFast[ i ].empty() ? "<?>" : resFast[ i ].c_str() );
+	}
+
+	double n = tunes.empty() ? 1 : (double)tunes.size();
+	printf( "identified:  %d of %d\n", identified, (int)tunes.size() );
+	printf( "compile:     %8.3f ms (first identify call)\n", ( t1 - t0 ) * 1e3 );
+	printf( "single pass: %8.3f ms total, %8.3f us per tune\n", ( t2 - t1 ) * 1e3, ( t2 - t1 ) * 1e6 / n );
+	printf( "reference:   %8.3f ms total, %8.3f us per tune\n", ( t3 - t2 ) * 1e3, ( t3 - t2 ) * 1e6 / n );
+	printf( "mismatches:  %d\n", mismatches );
+
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,2 @@
+// YmMusic.h includes "YmLoad.h", the file is Ymload.h: forward for case-sensitive host file systems
+#include "../Firmware/STSoundLib/Ymload.h"
@@ -0,0 +1,5 @@
+// minimal stand-in for Circle's memory.h to compile firmware sources on the host
+#ifndef _circle_memory_h
+#define _circle_memory_h
+
+#endif
@@ -0,0 +1,291 @@
+/*
+  _________.__    .___      __   .__        __        _________.___________  .___  .___
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __   /   _____/|   \______ \ |   | |   |
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /   \_____  \ |   ||    |  \|   | |   |
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <    /        \|   ||    `   \   | |   |
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \  /_______  /|___/_______  /___| |___|
+        \/         \/    \/     \/       \/     \/          \/             \/
+
+
+ Sidekick64 - golden audio regression test for the sound engines
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// renders canonical inputs through the sound engines (see soundengines.h) into reference WAVs, and compares
+// later builds against them: bit-exact by default, or within a per-sample tolerance; the first divergent
+// sample, the largest difference and the SNR of the difference are reported
+//
+// build:  make goldenaudio
+// usage:  goldenaudio -write <dir> [-e engine] [-s seconds] [-load dir] [-mod file] [-sf2 file] [-ym file]
+//         goldenaudio -compare <dir> [-e engine] [-tolerance n]
+//         make check      (compares against the references in golden/)
+//
+// -write stores the inputs next to the references (<engine>.evt, pocketmod.mod, tsf.sf2, ymfile.ym) and
+// -compare replays exactly these, so changes to the stream generators do not invalidate the references.
+// Engines which reimplement another one (e.g. "tedblock" for "ted") have no references of their own,
+// they are compared against those of the original engine.
+// The references are mono 32 bit PCM WAVs of the raw engine output. Every engine which is available has to
+// have a reference, a missing one counts as a failure. The exit code is the number of failures.
+// The references in golden/ (2 seconds each) were rendered on x86-64; engines using floats (pocketmod, tsf)
+// may need a small tolerance on other architectures.
+
+#include "soundengines.h"
+
+static std::vector<s32> rendered;
+
+static void render( const ENGINE *e, u32 nSamples )
+{
+	s32 block[ AUDIO_BLOCK_SIZE ];
+
+	eventPos = 0;
+	e->init();
+
+	rendered.clear();
+	for ( u32 pos = 0; pos < nSamples; pos += AUDIO_BLOCK_SIZE )
+	{
+		e->render( block, AUDIO_BLOCK_SIZE );
+		rendered.insert( rendered.end(), block, block + AUDIO_BLOCK_SIZE );
+	}
+	rendered.resize( nSamples );
+}
+
+static bool saveBinary( const char *filename, const std::vector<u8> &data )
+{
+	FILE *f = fopen( filename, "wb" );
+	if ( f == NULL )
+		return false;
+	bool ok = data.empty() || fwrite( &data[ 0 ], 1, data.size(), f ) == data.size();
+	fclose( f );
+	return ok;
+}
+
+static void put32( u8 *p, u32 v ) { p[ 0 ] = v; p[ 1 ] = v >> 8; p[ 2 ] = v >> 16; p[ 3 ] = v >> 24; }
+static void put16( u8 *p, u32 v ) { p[ 0 ] = v; p[ 1 ] = v >> 8; }
+static u32 get32( const u8 *p ) { return p[ 0 ] | ( p[ 1 ] << 8 ) | ( p[ 2 ] << 16 ) | ( (u32)p[ 3 ] << 24 ); }
+static u32 get16( const u8 *p ) { return p[ 0 ] | ( p[ 1 ] << 8 ); }
+
+static bool writeWAV( const char *filename, u32 sampleRate, const std::vector<s32> &samples )
+{
+	u32 dataBytes = (u32)samples.size() * 4;
+	std::vector<u8> wav( 44 + dataBytes );
+	u8 *h = &wav[ 0 ];
+
+	memcpy( &h[ 0 ], "RIFF", 4 );	put32( &h[ 4 ], 36 + dataBytes );
+	memcpy( &h[ 8 ], "WAVEfmt ", 8 );
+	put32( &h[ 16 ], 16 );
+	put16( &h[ 20 ], 1 );				// PCM
+	put16( &h[ 22 ], 1 );				// mono
+	put32( &h[ 24 ], sampleRate );
+	put32( &h[ 28 ], sampleRate * 4 );
+	put16( &h[ 32 ], 4 );
+	put16( &h[ 34 ], 32 );
+	memcpy( &h[ 36 ], "data", 4 );	put32( &h[ 40 ], dataBytes );
+
+	for ( u32 i = 0; i < samples.size(); i++ )
+		put32( &h[ 44 + i * 4 ], (u32)samples[ i ] );
+
+	return saveBinary( filename, wav );
+}
+
+static bool readWAV( const char *filename, u32 *sampleRate, std::vector<s32> &samples )
+{
+	std::vector<u8> wav;
+	if ( !loadBinary( filename, wav ) || wav.size() < 12 || memcmp( &wav[ 0 ], "RIFF", 4 ) || memcmp( &wav[ 8 ], "WAVE", 4 ) )
+		return false;
+
+	bool fmtOk = false;
+	for ( u32 ofs = 12; ofs + 8 <= wav.size(); )
+	{
+		const u8 *c = &wav[ ofs ];
+		u32 size = get32( &c[ 4 ] );
+		if ( ofs + 8 + size > wav.size() )
+			break;
+
+		if ( !memcmp( c, "fmt ", 4 ) && size >= 16 )
+		{
+			*sampleRate = get32( &c[ 12 ] );
+			fmtOk = get16( &c[ 8 ] ) == 1 && get16( &c[ 10 ] ) == 1 && get16( &c[ 22 ] ) == 32;
+		} else
+		if ( !memcmp( c, "data", 4 ) && fmtOk )
+		{
+			samples.resize( size / 4 );
+			for ( u32 i = 0; i < samples.size(); i++ )
+				samples[ i ] = (s32)get32( &c[ 8 + i * 4 ] );
+			return true;
+		}
+		ofs += 8 + size + ( size & 1 );
+	}
+	return false;
+}
+
+static void inputFilename( char *filename, const char *dir, const char *name, const char *ext )
+{
+	snprintf( filename, 1024, "%s/%s.%s", dir, name, ext );
+}
+
+// returns false if the engine failed the comparison
+static bool compare( const ENGINE *e, const std::vector<s32> &ref, u32 tolerance )
+{
+	u32 nDiffer = 0, firstDiff = ~0u;
+	double maxDiff = 0.0, sigEnergy = 0.0, diffEnergy = 0.0;
+
+	for ( u32 i = 0; i < ref.size(); i++ )
+	{
+		double d = fabs( (double)rendered[ i ] - (double)ref[ i ] );
+		sigEnergy += (double)ref[ i ] * ref[ i ];
+		diffEnergy += d * d;
+		if ( d > 0.0 )
+		{
+			if ( nDiffer ++ == 0 )
+				firstDiff = i;
+			maxDiff = max( maxDiff, d );
+		}
+	}
+
+	if ( nDiffer == 0 )
+	{
+		printf( "%-10s bit-exact (%u samples)\n", e->name, (u32)ref.size() );
+		return true;
+	}
+
+	bool pass = maxDiff <= tolerance;
+	double snr = diffEnergy > 0.0 && sigEnergy > 0.0 ? 10.0 * log10( sigEnergy / diffEnergy ) : 0.0;
+
+	printf( "%-10s %s: %u of %u samples differ, first at %u (%.4f s, reference %d, now %d), max |diff| %.0f, SNR %.1f dB\n",
+		e->name, pass ? "within tolerance" : "FAILED", nDiffer, (u32)ref.size(), firstDiff, firstDiff / (double)e->sampleRate,
+		ref[ firstDiff ], rendered[ firstDiff ], maxDiff, snr );
+
+	return pass;
+}
+
+int main( int argc, char **argv )
+{
+	const char *engineName = NULL, *writeDir = NULL, *compareDir = NULL, *loadDir = NULL;
+	u32 seconds = 10, tolerance = 0;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( !strcmp( argv[ i ], "-write" ) && i + 1 < argc ) writeDir = argv[ ++i ]; else
+		if ( !strcmp( argv[ i ], "-compare" ) && i + 1 < argc ) compareDir = argv[ ++i ]; else
+		if ( !strcmp( argv[ i ], "-e" ) && i + 1 < argc ) engineName = argv[ ++i ]; else
+		if ( !strcmp( argv[ i ], "-s" ) && i + 1 < argc ) { seconds = atoi( argv[ ++i ] ); seconds = max( seconds, 1 ); } else
+		if ( !strcmp( argv[ i ], "-tolerance" ) && i + 1 < argc ) tolerance = atoi( argv[ ++i ] ); else
+		if ( !strcmp( argv[ i ], "-load" ) && i + 1 < argc ) loadDir = argv[ ++i ]; else
+		if ( !strcmp( argv[ i ], "-mod" ) && i + 1 < argc ) { if ( !loadBinary( argv[ ++i ], modData ) ) { printf( "cannot read %s\n", argv[ i ] ); return 1; } } else
+		if ( !strcmp( argv[ i ], "-sf2" ) && i + 1 < argc ) { if ( !loadBinary( argv[ ++i ], sf2Data ) ) { printf( "cannot read %s\n", argv[ i ] ); return 1; } } else
+		if ( !strcmp( argv[ i ], "-ym" ) && i + 1 < argc ) { if ( !loadBinary( argv[ ++i ], ymFileData ) ) { printf( "cannot read %s\n", argv[ i ] ); return 1; } } else
+		{
+			writeDir = compareDir = NULL;
+			break;
+		}
+	}
+
+	if ( ( writeDir == NULL ) == ( compareDir == NULL ) )
+	{
+		printf( "usage: %s -write <dir> [-e engine] [-s seconds] [-load dir] [-mod file] [-sf2 file] [-ym file]\n", argv[ 0 ] );
+		printf( "       %s -compare <dir> [-e engine] [-tolerance n]\n", argv[ 0 ] );
+		return 1;
+	}
+
+	const char *dir = writeDir ? writeDir : compareDir;
+	char filename[ 1024 ];
+
+	// the inputs stored with the references
+	if ( compareDir )
+	{
+		inputFilename( filename, dir, "pocketmod", "mod" );	loadBinary( filename, modData );
+		inputFilename( filename, dir, "tsf", "sf2" );			loadBinary( filename, sf2Data );
+		inputFilename( filename, dir, "ymfile", "ym" );		loadBinary( filename, ymFileData );
+	}
+
+	int failures = 0, tested = 0;
+
+	for ( u32 k = 0; k < sizeof( engines ) / sizeof( ENGINE ); k++ )
+	{
+		const ENGINE *e = &engines[ k ];
+		if ( ( engineName && strcmp( engineName, e->name ) ) || ( e->available && !e->available() ) )
+			continue;
+
+		inputFilename( filename, dir, engineStreams( e ), "wav" );
+
+		if ( writeDir )
+		{
+			if ( e->reference )
+				continue;
+
+			rndState = engineSeed( e );
+			if ( !loadDir || !loadEvents( loadDir, e->name, events ) )
+			{
+				events.clear();
+				e->generate( events, seconds );
+			}
+
+			render( e, seconds * e->sampleRate );
+
+			if ( !writeWAV( filename, e->sampleRate, rendered ) )
+			{
+				printf( "cannot write %s\n", filename );
+				return 1;
+			}
+			if ( !events.empty() )
+				saveEvents( dir, e->name, events );
+			printf( "%-10s %u samples -> %s\n", e->name, (u32)rendered.size(), filename );
+		} else
+		{
+			std::vector<s32> ref;
+			u32 sampleRate = 0;
+
+			if ( !readWAV( filename, &sampleRate, ref ) )
+			{
+				printf( "%-10s FAILED: no reference %s\n", e->name, filename );
+				failures ++;
+				continue;
+			}
+
+			if ( sampleRate != e->sampleRate )
+			{
+				printf( "%-10s FAILED: reference has %u Hz, engine renders %u Hz\n", e->name, sampleRate, e->sampleRate );
+				failures ++;
+				continue;
+			}
+
+			events.clear();
+			loadEvents( dir, engineStreams( e ), events );
+
+			render( e, (u32)ref.size() );
+			tested ++;
+			if ( !compare( e, ref, tolerance ) )
+				failures ++;
+		}
+	}
+
+	// generated module and SoundFont are inputs as well
+	if ( writeDir )
+	{
+		inputFilename( filename, dir, "pocketmod", "mod" );	if ( !modData.empty() ) saveBinary( filename, modData );
+		inputFilename( filename, dir, "tsf", "sf2" );			if ( !sf2Data.empty() ) saveBinary( filename, sf2Data );
+		inputFilename( filename, dir, "ymfile", "ym" );		if ( !ymFileData.empty() ) saveBinary( filename, ymFileData );
+	} else
+	if ( tested == 0 && failures == 0 )
+	{
+		printf( "no engine to compare\n" );
+		return 1;
+	}
+
+	return failures;
+}
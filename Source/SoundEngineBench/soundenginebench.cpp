@@ -0,0 +1,240 @@
+/*
+  _________.__    .___      __   .__        __        _________.___________  .___  .___
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __   /   _____/|   \______ \ |   | |   |
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /   \_____  \ |   ||    |  \|   | |   |
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <    /        \|   ||    `   \   | |   |
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \  /_______  /|___/_______  /___| |___|
+        \/         \/    \/     \/       \/     \/          \/             \/
+
+
+ Sidekick64 - sound engine benchmark
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// drives the sound engines of the firmware (reSID, FM_OPL, TED sound, YM2149, pocketmod, TinySoundFont) with
+// register/event streams at the firmware's clocks and sample rates (see soundengines.h) and reports
+// samples/second, cycles/sample and how much the engines suffer from cold caches
+//
+// build:  make soundenginebench            (host)
+//         make CROSS=aarch64-linux-gnu-     (64-bit Linux on a Raspberry Pi, NEON code paths enabled)
+// usage:  soundenginebench [-e engine] [-s seconds] [-mhz clock] [-save dir] [-load dir] [-mod file] [-sf2 file] [-ym file]
+//
+// The streams are generated deterministically, -load replays recorded ones instead (<dir>/<engine>.evt, an
+// array of EVENTs), -save writes the generated ones in the same format. Each engine runs once with warm caches
+// and once with the caches flushed before every block of AUDIO_BLOCK_SIZE samples, as it happens on the Pi
+// when the bus handling runs in between: the difference is the cost of the engine's cache footprint.
+// Cycles and L1D misses are read from the perf counters if available, otherwise cycles are derived from
+// the time stamp counter (x86) or from the clock given with -mhz.
+
+#include <time.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+
+#include "soundengines.h"
+
+#define FLUSH_SIZE			( 2 * 1024 * 1024 )
+
+//
+// measurement
+//
+static double now()
+{
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int perfCycles = -1, perfL1DMisses = -1;
+
+#ifdef __linux__
+static int perfOpen( u32 type, u64 config )
+{
+	struct perf_event_attr pe;
+	memset( &pe, 0, sizeof( pe ) );
+	pe.type = type;
+	pe.size = sizeof( pe );
+	pe.config = config;
+	pe.exclude_kernel = 1;
+	pe.exclude_hv = 1;
+	return (int)syscall( __NR_perf_event_open, &pe, 0, -1, -1, 0 );
+}
+#endif
+
+static u64 perfRead( int fd )
+{
+	u64 v = 0;
+	#ifdef __linux__
+	if ( fd >= 0 && read( fd, &v, sizeof( v ) ) != sizeof( v ) )
+		v = 0;
+	#endif
+	return v;
+}
+
+static double cpuMHz = 1400.0;	// Raspberry Pi 3B+, used if neither perf counters nor a time stamp counter exist
+
+static u64 cycleCounter()
+{
+	if ( perfCycles >= 0 )
+		return perfRead( perfCycles );
+	#if defined( __x86_64__ ) || defined( __i386__ )
+	return __rdtsc();
+	#else
+	return (u64)( now() * cpuMHz * 1e6 );
+	#endif
+}
+
+typedef struct
+{
+	double seconds;
+	u64 cycles, misses;
+	u64 checksum;
+} RESULT;
+
+static u8 flushBuffer[ FLUSH_SIZE ];
+static s32 output[ AUDIO_BLOCK_SIZE ];
+
+static void flushCaches()
+{
+	for ( u32 i = 0; i < FLUSH_SIZE; i += 64 )
+		flushBuffer[ i ] ++;
+}
+
+static RESULT run( const ENGINE *e, u32 nSamples, bool cold )
+{
+	RESULT r = { 0.0, 0, 0, 0 };
+
+	eventPos = 0;
+	e->init();
+
+	u64 h = 0xcbf29ce484222325ULL;
+	for ( u32 pos = 0; pos < nSamples; pos += AUDIO_BLOCK_SIZE )
+	{
+		if ( cold )
+			flushCaches();
+
+		double t0 = now();
+		u64 c0 = cycleCounter(), m0 = perfRead( perfL1DMisses );
+
+		e->render( output, AUDIO_BLOCK_SIZE );
+
+		r.misses += perfRead( perfL1DMisses ) - m0;
+		r.cycles += cycleCounter() - c0;
+		r.seconds += now() - t0;
+
+		for ( u32 i = 0; i < AUDIO_BLOCK_SIZE; i++ )
+			h = ( h ^ (u32)output[ i ] ) * 0x100000001b3ULL;
+	}
+	r.checksum = h;
+
+	return r;
+}
+
+// the same instrumentation around an empty block, subtracted from the results
+static RESULT overhead( u32 nBlocks )
+{
+	RESULT r = { 0.0, 0, 0, 0 };
+	for ( u32 i = 0; i < nBlocks; i++ )
+	{
+		double t0 = now();
+		u64 c0 = cycleCounter(), m0 = perfRead( perfL1DMisses );
+		r.misses += perfRead( perfL1DMisses ) - m0;
+		r.cycles += cycleCounter() - c0;
+		r.seconds += now() - t0;
+	}
+	return r;
+}
+
+int main( int argc, char **argv )
+{
+	const char *engineName = NULL, *loadDir = NULL, *saveDir = NULL;
+	u32 seconds = 10;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( !strcmp( argv[ i ], "-e" ) && i + 1 < argc ) engineName = argv[ ++i ]; else
+		if ( !strcmp( argv[ i ], "-s" ) && i + 1 < argc ) { seconds = atoi( argv[ ++i ] ); seconds = max( seconds, 1 ); } else
+		if ( !strcmp( argv[ i ], "-mhz" ) && i + 1 < argc ) cpuMHz = atof( argv[ ++i ] ); else
+		if ( !strcmp( argv[ i ], "-load" ) && i + 1 < argc ) loadDir = argv[ ++i ]; else
+		if ( !strcmp( argv[ i ], "-save" ) && i + 1 < argc ) saveDir = argv[ ++i ]; else
+		if ( !strcmp( argv[ i ], "-mod" ) && i + 1 < argc ) { if ( !loadBinary( argv[ ++i ], modData ) ) { printf( "cannot read %s\n", argv[ i ] ); return 1; } } else
+		if ( !strcmp( argv[ i ], "-sf2" ) && i + 1 < argc ) { if ( !loadBinary( argv[ ++i ], sf2Data ) ) { printf( "cannot read %s\n", argv[ i ] ); return 1; } } else
+		if ( !strcmp( argv[ i ], "-ym" ) && i + 1 < argc ) { if ( !loadBinary( argv[ ++i ], ymFileData ) ) { printf( "cannot read %s\n", argv[ i ] ); return 1; } } else
+		{
+			printf( "usage: %s [-e engine] [-s seconds] [-mhz clock] [-save dir] [-load dir] [-mod file] [-sf2 file] [-ym file]\n", argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	#ifdef __linux__
+	perfCycles = perfOpen( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES );
+	perfL1DMisses = perfOpen( PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ) );
+	#endif
+
+	printf( "cycles: %s, L1D misses: %s\n\n",
+		perfCycles >= 0 ? "perf counter" :
+		#if defined( __x86_64__ ) || defined( __i386__ )
+		"time stamp counter",
+		#else
+		"derived from -mhz",
+		#endif
+		perfL1DMisses >= 0 ? "perf counter" : "n/a" );
+
+	printf( "engine       rate   Msamples/s  realtime  cycles/sample  cold caches  L1D miss/sample  state [KB]  checksum\n" );
+
+	for ( u32 k = 0; k < sizeof( engines ) / sizeof( ENGINE ); k++ )
+	{
+		const ENGINE *e = &engines[ k ];
+		if ( ( engineName && strcmp( engineName, e->name ) ) || ( e->available && !e->available() ) )
+			continue;
+
+		rndState = engineSeed( e );
+		if ( !loadDir || !loadEvents( loadDir, e->name, events ) )
+		{
+			events.clear();
+			e->generate( events, seconds );
+		}
+		if ( saveDir )
+			saveEvents( saveDir, e->name, events );
+
+		u32 nSamples = seconds * e->sampleRate / AUDIO_BLOCK_SIZE * AUDIO_BLOCK_SIZE;
+		u32 nBlocks = nSamples / AUDIO_BLOCK_SIZE;
+
+		RESULT ovh  = overhead( nBlocks );
+		RESULT warm = run( e, nSamples, false );
+		RESULT cold = run( e, nSamples, true );
+
+		double t = max( warm.seconds - ovh.seconds, 1e-9 );
+		double cyclesWarm = (double)( warm.cycles - min( ovh.cycles, warm.cycles ) ) / nSamples;
+		double cyclesCold = (double)( cold.cycles - min( ovh.cycles, cold.cycles ) ) / nSamples;
+
+		printf( "%-10s %6u %12.2f %9.1f %14.1f %12.1f ", e->name, e->sampleRate, nSamples / t * 1e-6, nSamples / (double)e->sampleRate / t, cyclesWarm, cyclesCold );
+		if ( perfL1DMisses >= 0 )
+			printf( "%16.2f ", (double)( warm.misses - min( ovh.misses, warm.misses ) ) / nSamples ); else
+			printf( "%16s ", "n/a" );
+		printf( "%11.1f  %016llx%s\n", e->stateBytes() / 1024.0, (unsigned long long)warm.checksum, warm.checksum != cold.checksum ? " (mismatch)" : "" );
+	}
+
+	return 0;
+}
@@ -0,0 +1,1063 @@
+/*
+  _________.__    .___      __   .__        __        _________.___________  .___  .___
+ /   _____/|__| __| _/____ |  | _|__| ____ |  | __   /   _____/|   \______ \ |   | |   |
+ \_____  \ |  |/ __ |/ __ \|  |/ /  |/ ___\|  |/ /   \_____  \ |   ||    |  \|   | |   |
+ /        \|  / /_/ \  ___/|    <|  \  \___|    <    /        \|   ||    `   \   | |   |
+/_______  /|__\____ |\___  >__|_ \__|\___  >__|_ \  /_______  /|___/_______  /___| |___|
+        \/         \/    \/     \/       \/     \/          \/             \/
+
+
+ Sidekick64 - sound engine drivers for the host tools
+ Copyright (c) 2023 Carsten Dachsbacher <frenetic@dachsbacher.de>
+
+ Logo created with http://patorjk.com/software/taag/
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// drives the sound engines of the firmware with register/event streams, the same way the kernels do:
+// reSID is clocked up to each register write and sample, FM_OPL, YM2149 and TinySoundFont render blocks between
+// events, TED sound renders one sample at a time; used by soundenginebench and goldenaudio
+
+#ifndef _soundengines_h
+#define _soundengines_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <vector>
+#include <algorithm>
+
+#include <circle/types.h>
+
+#include "../Firmware/resid/sid.h"
+#include "../Firmware/fmopl.h"
+#include "../Firmware/TEDsound.h"
+#include "../Firmware/STSoundLib/YmTypes.h"
+#include "../Firmware/STSoundLib/Ym2149Ex.h"
+#include "../Firmware/STSoundLib/YmMusic.h"
+#define POCKETMOD_IMPLEMENTATION
+#include "../Firmware/pocketmod.h"
+#define TSF_IMPLEMENTATION
+#include "../Firmware/tsf.h"
+
+using namespace reSID;
+
+#define min( a, b ) ( ( (a) < (b) ) ? (a) : (b) )
+#define max( a, b ) ( ( (a) > (b) ) ? (a) : (b) )
+
+// as in the firmware (kernel_sid.h, audiograph.h, kernel_sid.cpp)
+#define SAMPLERATE			48000
+#define AUDIO_BLOCK_SIZE	32
+#define SID_CLOCK			985248
+#define OPL_CLOCK			3579545
+#define MIDI_MAX_VOICES		128
+#define MIDI_RENDER_BLOCK	256
+#define MIDI_CACHE_SIZE		( 24 * 1024 * 1024 )
+
+#define FRAMES_PER_SECOND	50
+
+typedef struct
+{
+	u32 time;				// in chip cycles (SID) or samples (all others)
+	u8  a, b, c, d;			// register/value, port/value (OPL), or MIDI status/data 1/data 2
+} EVENT;
+
+typedef struct
+{
+	const char *name;
+	u32  sampleRate;
+	void (*generate)( std::vector<EVENT> &ev, u32 seconds );
+	void (*init)();
+	void (*render)( s32 *dst, u32 n );
+	u32  (*stateBytes)();
+	bool (*available)();	// NULL if always available
+	const char *reference;	// engine whose streams and output this one has to reproduce bit-exactly, NULL if none
+} ENGINE;
+
+static std::vector<EVENT> events;
+static u32 eventPos;
+
+static u32 rndState;
+
+static u32 rnd()
+{
+	rndState = rndState * 1664525 + 1013904223;
+	return rndState >> 8;
+}
+
+static void put( std::vector<EVENT> &ev, u32 time, u32 a, u32 b, u32 c = 0 )
+{
+	EVENT e = { time, (u8)a, (u8)b, (u8)c, 0 };
+	ev.push_back( e );
+}
+
+static double noteHz( u32 note )
+{
+	return 440.0 * pow( 2.0, ( (double)note - 69.0 ) / 12.0 );
+}
+
+//
+// reSID, as used in kernel_sid (SAMPLE_FAST) and kernel_sid8 (SAMPLE_INTERPOLATE, or SAMPLE_RESAMPLE on the render cores)
+//
+static SID *sid = NULL;
+static u64 sidCycle, sidSample;
+
+static void sidGenerate( std::vector<EVENT> &ev, u32 seconds )
+{
+	const u32 frameCycles = SID_CLOCK / FRAMES_PER_SECOND;
+	const u8 waves[ 3 ] = { 0x41, 0x21, 0x11 };
+
+	put( ev, 0, 0x18, 0x1f );
+	put( ev, 10, 0x17, 0xf7 );
+	for ( u32 v = 0; v < 3; v++ )
+	{
+		put( ev, 20 + v * 30, v * 7 + 5, 0x09 + v * 0x10 );
+		put( ev, 30 + v * 30, v * 7 + 6, 0x8a );
+	}
+
+	for ( u32 frame = 1; frame < seconds * FRAMES_PER_SECOND; frame++ )
+	{
+		// the player runs at the start of the frame, one write every few cycles
+		u32 c = frame * frameCycles;
+
+		for ( u32 v = 0; v < 3; v++ )
+		{
+			u32 base = v * 7;
+			if ( ( frame % 6 ) == v * 2 )
+			{
+				u8 wave = ( v == 2 && ( frame % 24 ) == 4 ) ? 0x81 : waves[ v ];
+				u32 freq = (u32)( noteHz( 36 + v * 12 + rnd() % 12 ) * 16777216.0 / SID_CLOCK );
+				put( ev, c, base + 4, wave & 0xfe );	c += 12;
+				put( ev, c, base + 0, freq & 255 );		c += 8;
+				put( ev, c, base + 1, freq >> 8 );		c += 8;
+				put( ev, c, base + 4, wave );			c += 12;
+			}
+			u32 pw = 0x400 + ( ( frame * ( 37 + v * 11 ) ) & 0x7ff );
+			put( ev, c, base + 2, pw & 255 );			c += 8;
+			put( ev, c, base + 3, pw >> 8 );			c += 8;
+		}
+
+		u32 cutoff = 0x200 + ( ( frame * 23 ) % 0x600 );
+		put( ev, c, 0x15, cutoff & 7 );					c += 8;
+		put( ev, c, 0x16, cutoff >> 3 );
+	}
+}
+
+static void sidInit( chip_model model, sampling_method method )
+{
+	delete sid;
+	sid = new SID;
+	sid->set_chip_model( model );
+	sid->adjust_filter_bias( 1.0 );
+	sid->set_sampling_parameters( SID_CLOCK, method, SAMPLERATE, SAMPLERATE * 90 / 200.0f, 0.97f );
+	sid->reset();
+	sidCycle = sidSample = 0;
+}
+
+static void sidInit6581() { sidInit( MOS6581, SAMPLE_FAST ); }
+static void sidInit8580() { sidInit( MOS8580, SAMPLE_INTERPOLATE ); }
+static void sidInit8580Resample() { sidInit( MOS8580, SAMPLE_RESAMPLE ); }
+
+static void sidRender( s32 *dst, u32 n )
+{
+	for ( u32 i = 0; i < n; i++ )
+	{
+		u64 next = ( sidSample + 1 ) * SID_CLOCK / SAMPLERATE;
+
+		while ( eventPos < events.size() && events[ eventPos ].time < next )
+		{
+			EVENT &e = events[ eventPos ++ ];
+			if ( e.time > sidCycle )
+			{
+				sid->clock( e.time - sidCycle );
+				sidCycle = e.time;
+			}
+			sid->write( e.a, e.b );
+		}
+
+		if ( next > sidCycle )
+		{
+			sid->clock( next - sidCycle );
+			sidCycle = next;
+		}
+
+		dst[ i ] = sid->output();
+		sidSample ++;
+	}
+}
+
+// buffered clocking up to the next write, as on the render cores of kernel_sid8
+static void sidRenderResample( s32 *dst, u32 n )
+{
+	static std::vector<short> buf;
+	buf.resize( n );
+
+	u32 pos = 0;
+	while ( pos < n )
+	{
+		cycle_count delta = 1 << 20;
+		if ( eventPos < events.size() )
+		{
+			EVENT &e = events[ eventPos ];
+			if ( e.time <= sidCycle )
+			{
+				sid->write( e.a, e.b );
+				eventPos ++;
+				continue;
+			}
+			delta = min( (u64)delta, e.time - sidCycle );
+		}
+		cycle_count before = delta;
+		pos += sid->clock( delta, &buf[ pos ], n - pos );
+		sidCycle += before - delta;
+	}
+
+	for ( u32 i = 0; i < n; i++ )
+		dst[ i ] = buf[ i ];
+}
+
+static u32 sidStateBytes()
+{
+	return sizeof( SID );
+}
+
+//
+// FM_OPL (YM3812), one ym3812_update_one call per sample ("fmopl", the reference) or block-wise rendering
+// between register writes as in the audio graph of kernel_sid ("fmoplblock")
+//
+static FM_OPL *opl = NULL;
+static u32 oplSample, oplSplit;
+
+static void oplWrite( std::vector<EVENT> &ev, u32 time, u32 reg, u32 value )
+{
+	put( ev, time, 0, reg );
+	put( ev, time, 1, value );
+}
+
+static void oplGenerate( std::vector<EVENT> &ev, u32 seconds )
+{
+	const u32 frameSamples = SAMPLERATE / FRAMES_PER_SECOND;
+	const u32 block = 4;
+
+	oplWrite( ev, 0, 0x01, 0x20 );
+	for ( u32 ch = 0; ch < 9; ch++ )
+	{
+		u32 op = ( ch % 3 ) + ( ch / 3 ) * 8;
+		oplWrite( ev, 0, 0x20 + op, 0x21 );
+		oplWrite( ev, 0, 0x23 + op, 0x21 + ( ch & 1 ) );
+		oplWrite( ev, 0, 0x40 + op, 0x10 + ch );
+		oplWrite( ev, 0, 0x43 + op, 0x00 );
+		oplWrite( ev, 0, 0x60 + op, 0xf4 );
+		oplWrite( ev, 0, 0x63 + op, 0xf2 );
+		oplWrite( ev, 0, 0x80 + op, 0x55 );
+		oplWrite( ev, 0, 0x83 + op, 0x46 );
+		oplWrite( ev, 0, 0xe0 + op, ch & 3 );
+		oplWrite( ev, 0, 0xe3 + op, 0 );
+		oplWrite( ev, 0, 0xc0 + ch, 0x0a | ( ch & 1 ) );
+	}
+
+	for ( u32 frame = 1; frame < seconds * FRAMES_PER_SECOND; frame++ )
+	{
+		u32 t = frame * frameSamples;
+		for ( u32 ch = 0; ch < 6; ch++ )
+		{
+			if ( ( frame % 12 ) != ch * 2 )
+				continue;
+			u32 fnum = (u32)( noteHz( 48 + rnd() % 24 ) * (double)( 1 << ( 20 - block ) ) / ( OPL_CLOCK / 72.0 ) );
+			oplWrite( ev, t, 0xb0 + ch, ( block << 2 ) | ( fnum >> 8 ) );
+			oplWrite( ev, t, 0xa0 + ch, fnum & 255 );
+			oplWrite( ev, t, 0xb0 + ch, 0x20 | ( block << 2 ) | ( fnum >> 8 ) );
+		}
+	}
+}
+
+static void oplInit()
+{
+	if ( opl )
+		ym3812_shutdown( opl );
+	opl = ym3812_init( OPL_CLOCK, SAMPLERATE );
+	ym3812_reset_chip( opl );
+	oplSample = oplSplit = 0;
+}
+
+static void oplRender( s32 *dst, u32 n )
+{
+	for ( u32 i = 0; i < n; i++ )
+	{
+		while ( eventPos < events.size() && events[ eventPos ].time <= oplSample )
+		{
+			EVENT &e = events[ eventPos ++ ];
+			ym3812_write( opl, e.a, e.b );
+		}
+		ym3812_update_one( opl, &dst[ i ], 1 );
+		oplSample ++;
+	}
+}
+
+// the blocks are additionally split into varying lengths, as audioGraphRenderUpTo renders up to arbitrary samples
+static void oplBlockRender( s32 *dst, u32 n )
+{
+	u32 pos = 0;
+	while ( pos < n )
+	{
+		while ( eventPos < events.size() && events[ eventPos ].time <= oplSample + pos )
+		{
+			EVENT &e = events[ eventPos ++ ];
+			ym3812_write( opl, e.a, e.b );
+		}
+
+		u32 end = n;
+		if ( eventPos < events.size() && events[ eventPos ].time < oplSample + n )
+			end = events[ eventPos ].time - oplSample;
+		oplSplit = ( oplSplit * 7 + 3 ) % AUDIO_BLOCK_SIZE;
+		end = min( end, pos + 1 + oplSplit );
+
+		ym3812_render_block( opl, &dst[ pos ], end - pos );
+		pos = end;
+	}
+	oplSample += n;
+}
+
+static u32 oplStateBytes()
+{
+	return sizeof( FM_OPL );
+}
+
+//
+// SID and FM together with all writes timestamped in SID cycles (EVENT.d = 0 for the SID, 1 for FM): "sidfm" applies
+// them with the per-chip scheduling of kernel_sid, "sidfmcycle" is the reference which clocks the SID one cycle at a
+// time and applies every SID write at its exact cycle and every FM write in the sample it falls into (sample k covers
+// the cycles [t_k, t_k+1) with t_k = k * SID_CLOCK / SAMPLERATE); the SID is compared by its OSC3 readback, which is
+// exact for any clocking, whereas reSID's analog parts (filter, external filter) and the envelope pipeline depend on
+// the step size
+//
+#define EVENT_SID	0
+#define EVENT_FM	1
+
+static s32 sidfmSID[ AUDIO_BLOCK_SIZE ], sidfmFM[ AUDIO_BLOCK_SIZE ];
+static u32 sidfmFMRendered;
+static u32 sidfmSIDPos, sidfmFMPos;
+
+static void sidfmGenerate( std::vector<EVENT> &ev, u32 seconds )
+{
+	std::vector<EVENT> sidEv, fmEv;
+	sidGenerate( sidEv, seconds );
+	oplGenerate( fmEv, seconds );
+
+	// dense writes as for digis, every 128 cycles during every other second (to voice 3, such that they show in OSC3)
+	for ( u32 c = 0; c < seconds * SID_CLOCK; c += 128 )
+		if ( ( c / SID_CLOCK ) & 1 )
+			put( sidEv, c, 14, ( c >> 7 ) & 255 );
+
+	// FM writes at arbitrary cycles within their sample (and at the sample boundaries), in their original order
+	u32 t = 0;
+	for ( u32 i = 0; i < fmEv.size(); i++ )
+	{
+		t = max( t, (u32)( (u64)fmEv[ i ].time * SID_CLOCK / SAMPLERATE ) + rnd() % ( SID_CLOCK / SAMPLERATE ) );
+		fmEv[ i ].time = t;
+		fmEv[ i ].d = EVENT_FM;
+	}
+
+	ev.clear();
+	ev.insert( ev.end(), sidEv.begin(), sidEv.end() );
+	ev.insert( ev.end(), fmEv.begin(), fmEv.end() );
+	std::stable_sort( ev.begin(), ev.end(), []( const EVENT &a, const EVENT &b ) { return a.time < b.time; } );
+}
+
+static void sidfmInit()
+{
+	sidInit6581();
+	oplInit();
+	sidfmSIDPos = sidfmFMPos = 0;
+}
+
+static void sidfmApply( const EVENT &e )
+{
+	if ( e.d == EVENT_FM )
+		ym3812_write( opl, e.a, e.b ); else
+		sid->write( e.a, e.b );
+}
+
+// as the scheduling loop in kernel_sid: the SID is clocked up to the next SID write or the next sample, FM writes
+// are applied (after rendering FM up to the current sample, as audioGraphRenderUpTo) when they are due for this sample
+static void sidfmRender( s32 *dst, u32 n )
+{
+	sidfmFMRendered = 0;
+
+	for ( u32 i = 0; i < n; i++ )
+	{
+		u64 next = ( sidSample + 1 ) * SID_CLOCK / SAMPLERATE;
+		u32 cyclesToNextSample = (u32)( next - sidCycle );
+
+		do {
+			u32 cyclesToEmulate = cyclesToNextSample;
+
+			while ( eventPos < events.size() )
+			{
+				EVENT &e = events[ eventPos ];
+				s64 cyclesToNextWrite = (s64)e.time - (s64)sidCycle;
+
+				if ( cyclesToNextWrite > 0 )
+				{
+					if ( e.d == EVENT_SID )
+					{
+						if ( cyclesToNextWrite < (s64)cyclesToEmulate )
+							cyclesToEmulate = (u32)cyclesToNextWrite;
+						break;
+					}
+					if ( cyclesToNextWrite >= (s64)cyclesToNextSample )
+						break;
+				}
+
+				if ( e.d == EVENT_FM && i > sidfmFMRendered )
+				{
+					ym3812_render_block( opl, &sidfmFM[ sidfmFMRendered ], i - sidfmFMRendered );
+					sidfmFMRendered = i;
+				}
+				sidfmApply( e );
+				eventPos ++;
+			}
+
+			if ( cyclesToEmulate == 0 )
+				cyclesToEmulate = 1;
+
+			sid->clock( cyclesToEmulate );
+			sidCycle += cyclesToEmulate;
+			cyclesToNextSample -= cyclesToEmulate;
+		} while ( cyclesToNextSample > 0 );
+
+		sidfmSID[ i ] = sid->read( 27 ) << 8;
+		sidSample ++;
+	}
+
+	ym3812_render_block( opl, &sidfmFM[ sidfmFMRendered ], n - sidfmFMRendered );
+
+	for ( u32 i = 0; i < n; i++ )
+		dst[ i ] = sidfmSID[ i ] + sidfmFM[ i ];
+}
+
+// the next event of one chip, each chip has its own position in the stream
+static EVENT *sidfmNext( u32 *pos, u8 chip )
+{
+	while ( *pos < events.size() && events[ *pos ].d != chip )
+		( *pos ) ++;
+	return *pos < events.size() ? &events[ *pos ] : NULL;
+}
+
+static void sidfmCycleRender( s32 *dst, u32 n )
+{
+	EVENT *e;
+
+	for ( u32 i = 0; i < n; i++ )
+	{
+		u64 next = ( sidSample + 1 ) * SID_CLOCK / SAMPLERATE;
+
+		for ( ; sidCycle < next; sidCycle ++ )
+		{
+			while ( ( e = sidfmNext( &sidfmSIDPos, EVENT_SID ) ) != NULL && e->time <= sidCycle )
+			{
+				sidfmApply( *e );
+				sidfmSIDPos ++;
+			}
+			sid->clock( 1 );
+		}
+
+		while ( ( e = sidfmNext( &sidfmFMPos, EVENT_FM ) ) != NULL && e->time < next )
+		{
+			sidfmApply( *e );
+			sidfmFMPos ++;
+		}
+
+		s32 fm;
+		ym3812_update_one( opl, &fm, 1 );
+		dst[ i ] = ( sid->read( 27 ) << 8 ) + fm;
+		sidSample ++;
+	}
+}
+
+static u32 sidfmStateBytes()
+{
+	return sizeof( SID ) + sizeof( FM_OPL );
+}
+
+//
+// TED sound, one sample at a time ("ted") or block-wise between register writes as in kernel_sid264 ("tedblock")
+//
+static u32 tedSample;
+
+static void tedGenerate( std::vector<EVENT> &ev, u32 seconds )
+{
+	const u32 frameSamples = SAMPLERATE / FRAMES_PER_SECOND;
+
+	put( ev, 0, 3, 0x38 );
+	for ( u32 frame = 1; frame < seconds * FRAMES_PER_SECOND; frame++ )
+	{
+		u32 t = frame * frameSamples;
+		if ( ( frame % 4 ) == 0 )
+		{
+			u32 f0 = 0x200 + rnd() % 0x1e0, f1 = 0x200 + rnd() % 0x1e0;
+			put( ev, t, 0, f0 & 255 );
+			put( ev, t, 4, f0 >> 8 );
+			put( ev, t, 1, f1 & 255 );
+			put( ev, t, 2, f1 >> 8 );
+		}
+		if ( ( frame % 16 ) == 0 )
+			put( ev, t, 3, ( frame & 16 ) ? 0x58 : 0x38 );
+	}
+}
+
+static void tedInit()
+{
+	tedSoundInit( SAMPLERATE );
+	for ( u32 r = 0; r < 5; r++ )
+		writeSoundReg( r, 0 );
+	tedSample = 0;
+}
+
+static void tedRender( s32 *dst, u32 n )
+{
+	for ( u32 i = 0; i < n; i++ )
+	{
+		while ( eventPos < events.size() && events[ eventPos ].time <= tedSample )
+		{
+			EVENT &e = events[ eventPos ++ ];
+			writeSoundReg( e.a, e.b );
+		}
+		dst[ i ] = TEDcalcNextSample();
+		tedSample ++;
+	}
+}
+
+static void tedBlockRender( s32 *dst, u32 n )
+{
+	u32 end = tedSample + n;
+	while ( tedSample < end )
+	{
+		while ( eventPos < events.size() && events[ eventPos ].time <= tedSample )
+		{
+			EVENT &e = events[ eventPos ++ ];
+			writeSoundReg( e.a, e.b );
+		}
+		u32 next = end;
+		if ( eventPos < events.size() && events[ eventPos ].time < end )
+			next = events[ eventPos ].time;
+		TEDrenderBlock( (int*)dst, next - tedSample );
+		dst += next - tedSample;
+		tedSample = next;
+	}
+}
+
+static u32 tedStateBytes()
+{
+	return sizeof( volumeTable ) + sizeof( noise ) + sizeof( oscCount ) + sizeof( OscReload ) + 16 * sizeof( int );
+}
+
+//
+// YM2149 (STSoundLib)
+//
+static CYm2149Ex *ym = NULL;
+static u32 ymSample;
+static ymsample ymBuffer[ MIDI_RENDER_BLOCK ];
+
+static void ymGenerate( std::vector<EVENT> &ev, u32 seconds )
+{
+	const u32 frameSamples = SAMPLERATE / FRAMES_PER_SECOND;
+	u32 period[ 3 ] = { 0x1dd, 0x17c, 0x11d };
+
+	// a register dump as in .YM files: all registers every frame, the envelope shape only when it changes
+	for ( u32 frame = 0; frame < seconds * FRAMES_PER_SECOND; frame++ )
+	{
+		u32 t = frame * frameSamples;
+		if ( ( frame % 8 ) == 0 )
+			for ( u32 v = 0; v < 3; v++ )
+				period[ v ] = (u32)( ATARI_CLOCK / 16 / noteHz( 48 + v * 7 + rnd() % 12 ) );
+
+		for ( u32 v = 0; v < 3; v++ )
+		{
+			put( ev, t, v * 2 + 0, period[ v ] & 255 );
+			put( ev, t, v * 2 + 1, period[ v ] >> 8 );
+		}
+		put( ev, t, 6, frame & 31 );
+		put( ev, t, 7, ( frame & 32 ) ? 0x18 : 0x38 );
+		put( ev, t, 8, 15 - ( frame & 7 ) );
+		put( ev, t, 9, 12 );
+		put( ev, t, 10, ( frame & 64 ) ? 0x10 : 10 );
+		put( ev, t, 11, 0x80 );
+		put( ev, t, 12, 0x02 );
+		if ( ( frame % 64 ) == 0 )
+			put( ev, t, 13, 0x0e );
+	}
+}
+
+static void ymInit()
+{
+	delete ym;
+	ym = new CYm2149Ex( ATARI_CLOCK, 1, SAMPLERATE );
+	ym->reset();
+	ymSample = 0;
+}
+
+static void ymRender( s32 *dst, u32 n )
+{
+	u32 pos = 0;
+	while ( pos < n )
+	{
+		while ( eventPos < events.size() && events[ eventPos ].time <= ymSample + pos )
+		{
+			EVENT &e = events[ eventPos ++ ];
+			ym->writeRegister( e.a, e.b );
+		}
+
+		u32 end = n;
+		if ( eventPos < events.size() && events[ eventPos ].time < ymSample + n )
+			end = events[ eventPos ].time - ymSample;
+
+		ym->update( ymBuffer, end - pos );
+		for ( u32 i = pos; i < end; i++ )
+			dst[ i ] = ymBuffer[ i - pos ];
+		pos = end;
+	}
+	ymSample += n;
+}
+
+static u32 ymStateBytes()
+{
+	return sizeof( CYm2149Ex );
+}
+
+//
+// pocketmod, the "stream" is the module itself (generated or given with -mod)
+//
+static std::vector<u8> modData;
+static pocketmod_context modContext;
+static float modBuffer[ MIDI_RENDER_BLOCK ][ 2 ];
+static u32 modStats[ MIDI_RENDER_BLOCK ];
+
+static void modWriteBE16( u8 *p, u32 v )
+{
+	p[ 0 ] = v >> 8;
+	p[ 1 ] = v & 255;
+}
+
+// 4 channel M.K. module with two looped samples and four patterns of arpeggios, bass and volume slides
+static void modGenerate( std::vector<EVENT> &ev, u32 seconds )
+{
+	const u32 nPatterns = 4, sampleWords = 512;
+	const u16 periods[ 12 ] = { 856, 808, 762, 720, 678, 640, 604, 570, 538, 508, 480, 453 };
+
+	if ( !modData.empty() )
+		return;
+
+	// pocketmod interpolates with the byte after a sample, keep a few more bytes after the last one
+	modData.assign( 1084 + nPatterns * 1024 + 2 * sampleWords * 2 + 16, 0 );
+	u8 *m = &modData[ 0 ];
+
+	memcpy( m, "soundenginebench", 16 );
+	for ( u32 s = 0; s < 2; s++ )
+	{
+		u8 *h = &m[ 20 + s * 30 ];
+		modWriteBE16( &h[ 22 ], sampleWords );
+		h[ 25 ] = 64;
+		modWriteBE16( &h[ 26 ], 0 );
+		modWriteBE16( &h[ 28 ], sampleWords );
+	}
+	m[ 950 ] = nPatterns;
+	m[ 951 ] = 127;
+	for ( u32 i = 0; i < nPatterns; i++ )
+		m[ 952 + i ] = i;
+	memcpy( &m[ 1080 ], "M.K.", 4 );
+
+	for ( u32 p = 0; p < nPatterns; p++ )
+		for ( u32 row = 0; row < 64; row++ )
+			for ( u32 ch = 0; ch < 4; ch++ )
+			{
+				u8 *cell = &m[ 1084 + p * 1024 + row * 16 + ch * 4 ];
+				u32 smp = 0, period = 0, effect = 0, param = 0;
+
+				if ( ch == 0 && ( row & 3 ) == 0 )	{ smp = 2; period = periods[ rnd() % 12 ] * 2; }
+				if ( ch == 1 && ( row & 1 ) == 0 )	{ smp = 1; period = periods[ rnd() % 12 ]; effect = 0; param = 0x37; }
+				if ( ch == 2 && ( row & 7 ) == 4 )	{ smp = 1; period = periods[ rnd() % 12 ] / 2; }
+				if ( ch == 3 && ( row & 7 ) == 0 )	{ smp = 2; period = periods[ rnd() % 12 ]; }
+				if ( ch == 3 && ( row & 7 ) != 0 )	{ effect = 0xa; param = 0x02; }
+
+				cell[ 0 ] = ( smp & 0xf0 ) | ( period >> 8 );
+				cell[ 1 ] = period & 255;
+				cell[ 2 ] = ( ( smp & 15 ) << 4 ) | effect;
+				cell[ 3 ] = param;
+			}
+
+	s8 *smp = (s8*)&m[ 1084 + nPatterns * 1024 ];
+	for ( u32 i = 0; i < sampleWords * 2; i++ )
+	{
+		smp[ i ] = ( i & 32 ) ? 100 : -100;							// square
+		smp[ i + sampleWords * 2 ] = (s8)( ( i * 4 ) & 255 ) / 2;		// saw
+	}
+}
+
+static void modInit()
+{
+	if ( !pocketmod_init( &modContext, &modData[ 0 ], (int)modData.size(), SAMPLERATE ) )
+	{
+		printf( "pocketmod: invalid module\n" );
+		exit( 1 );
+	}
+}
+
+static void modRender( s32 *dst, u32 n )
+{
+	while ( n > 0 )
+	{
+		u32 bytes = min( n, (u32)MIDI_RENDER_BLOCK ) * sizeof( float[ 2 ] );
+		u32 rendered = pocketmod_render( &modContext, modBuffer, modStats, bytes ) / sizeof( float[ 2 ] );
+		for ( u32 i = 0; i < rendered; i++ )
+			*dst++ = (s32)( ( modBuffer[ i ][ 0 ] + modBuffer[ i ][ 1 ] ) * 16384.0f );
+		n -= rendered;
+	}
+}
+
+static u32 modStateBytes()
+{
+	return sizeof( pocketmod_context ) + (u32)modData.size();
+}
+
+//
+// TinySoundFont, streaming sample cache as in kernel_sid (generated SoundFont or given with -sf2)
+//
+static std::vector<u8> sf2Data;
+static tsf *soundFont = NULL;
+static u32 midiSample;
+static float midiBuffer[ MIDI_RENDER_BLOCK ];
+
+static void sf2Chunk( std::vector<u8> &f, const char *id, const void *data, u32 size )
+{
+	const u8 *d = (const u8*)data;
+	f.insert( f.end(), id, id + 4 );
+	for ( u32 i = 0; i < 4; i++ )
+		f.push_back( ( size >> ( i * 8 ) ) & 255 );
+	f.insert( f.end(), d, d + size );
+}
+
+static void sf2Put16( std::vector<u8> &f, u32 v ) { f.push_back( v & 255 ); f.push_back( ( v >> 8 ) & 255 ); }
+static void sf2Put32( std::vector<u8> &f, u32 v ) { sf2Put16( f, v & 0xffff ); sf2Put16( f, v >> 16 ); }
+static void sf2PutName( std::vector<u8> &f, const char *name ) { char n[ 20 ] = { 0 }; strncpy( n, name, 19 ); f.insert( f.end(), n, n + 20 ); }
+
+// minimal SoundFont: one preset -> one instrument -> one looped sample
+static void sf2Generate()
+{
+	const u32 nSamples = 4096;
+	std::vector<u8> smpl, phdr, pbag, pmod( 10, 0 ), pgen, inst, ibag, imod( 10, 0 ), igen, shdr, sdta, pdta, body;
+
+	for ( u32 i = 0; i < nSamples + 46; i++ )
+	{
+		s32 v = i < nSamples ? (s32)( 12000.0 * sin( i * 2.0 * M_PI * 8 / nSamples ) + 4000.0 * sin( i * 2.0 * M_PI * 24 / nSamples ) ) : 0;
+		sf2Put16( smpl, (u32)v );
+	}
+
+	sf2PutName( phdr, "Bench" );	sf2Put16( phdr, 0 ); sf2Put16( phdr, 0 ); sf2Put16( phdr, 0 ); sf2Put32( phdr, 0 ); sf2Put32( phdr, 0 ); sf2Put32( phdr, 0 );
+	sf2PutName( phdr, "EOP" );		sf2Put16( phdr, 0 ); sf2Put16( phdr, 0 ); sf2Put16( phdr, 1 ); sf2Put32( phdr, 0 ); sf2Put32( phdr, 0 ); sf2Put32( phdr, 0 );
+	sf2Put16( pbag, 0 ); sf2Put16( pbag, 0 );
+	sf2Put16( pbag, 1 ); sf2Put16( pbag, 0 );
+	sf2Put16( pgen, 41 ); sf2Put16( pgen, 0 );		// instrument 0
+	sf2Put16( pgen, 0 ); sf2Put16( pgen, 0 );
+	sf2PutName( inst, "Bench" );	sf2Put16( inst, 0 );
+	sf2PutName( inst, "EOI" );		sf2Put16( inst, 1 );
+	sf2Put16( ibag, 0 ); sf2Put16( ibag, 0 );
+	sf2Put16( ibag, 3 ); sf2Put16( ibag, 0 );
+	sf2Put16( igen, 54 ); sf2Put16( igen, 1 );		// sample modes: loop
+	sf2Put16( igen, 38 ); sf2Put16( igen, 0 );		// release: 1s
+	sf2Put16( igen, 53 ); sf2Put16( igen, 0 );		// sample 0
+	sf2Put16( igen, 0 ); sf2Put16( igen, 0 );
+	sf2PutName( shdr, "Bench" );	sf2Put32( shdr, 0 ); sf2Put32( shdr, nSamples ); sf2Put32( shdr, 0 ); sf2Put32( shdr, nSamples );
+	sf2Put32( shdr, 32000 ); shdr.push_back( 60 ); shdr.push_back( 0 ); sf2Put16( shdr, 0 ); sf2Put16( shdr, 1 );
+	sf2PutName( shdr, "EOS" );		sf2Put32( shdr, 0 ); sf2Put32( shdr, 0 ); sf2Put32( shdr, 0 ); sf2Put32( shdr, 0 );
+	sf2Put32( shdr, 0 ); shdr.push_back( 0 ); shdr.push_back( 0 ); sf2Put16( shdr, 0 ); sf2Put16( shdr, 0 );
+
+	sdta.insert( sdta.end(), "sdta", "sdta" + 4 );
+	sf2Chunk( sdta, "smpl", &smpl[ 0 ], (u32)smpl.size() );
+
+	pdta.insert( pdta.end(), "pdta", "pdta" + 4 );
+	sf2Chunk( pdta, "phdr", &phdr[ 0 ], (u32)phdr.size() );
+	sf2Chunk( pdta, "pbag", &pbag[ 0 ], (u32)pbag.size() );
+	sf2Chunk( pdta, "pmod", &pmod[ 0 ], (u32)pmod.size() );
+	sf2Chunk( pdta, "pgen", &pgen[ 0 ], (u32)pgen.size() );
+	sf2Chunk( pdta, "inst", &inst[ 0 ], (u32)inst.size() );
+	sf2Chunk( pdta, "ibag", &ibag[ 0 ], (u32)ibag.size() );
+	sf2Chunk( pdta, "imod", &imod[ 0 ], (u32)imod.size() );
+	sf2Chunk( pdta, "igen", &igen[ 0 ], (u32)igen.size() );
+	sf2Chunk( pdta, "shdr", &shdr[ 0 ], (u32)shdr.size() );
+
+	body.insert( body.end(), "sfbk", "sfbk" + 4 );
+	sf2Chunk( body, "LIST", &sdta[ 0 ], (u32)sdta.size() );
+	sf2Chunk( body, "LIST", &pdta[ 0 ], (u32)pdta.size() );
+
+	sf2Data.clear();
+	sf2Chunk( sf2Data, "RIFF", &body[ 0 ], (u32)body.size() );
+}
+
+// chords on three channels with long notes (many overlapping voices) and a melody on a fourth
+static void midiGenerate( std::vector<EVENT> &ev, u32 seconds )
+{
+	const u32 beat = SAMPLERATE / 4;
+
+	for ( u32 ch = 0; ch < 4; ch++ )
+		put( ev, 0, 0xc0 | ch, 0 );
+
+	std::vector<EVENT> offs;
+	for ( u32 b = 0; b < seconds * 4; b++ )
+	{
+		u32 t = b * beat;
+
+		if ( ( b % 2 ) == 0 )
+		{
+			u32 ch = ( b / 2 ) % 3, root = 48 + rnd() % 12;
+			for ( u32 k = 0; k < 3; k++ )
+			{
+				u32 key = root + k * 4 - ( k == 2 );
+				put( ev, t, 0x90 | ch, key, 90 );
+				put( offs, t + 6 * beat, 0x80 | ch, key );
+			}
+		}
+		u32 key = 72 + rnd() % 12;
+		put( ev, t, 0x93, key, 100 );
+		put( offs, t + beat / 2, 0x83, key );
+	}
+
+	// merge the note offs into the (sorted) stream
+	for ( size_t i = 0; i < offs.size(); i++ )
+	{
+		size_t j = ev.size();
+		while ( j > 0 && ev[ j - 1 ].time > offs[ i ].time ) j--;
+		ev.insert( ev.begin() + j, offs[ i ] );
+	}
+}
+
+static int midiReadAt( void *data, unsigned int offset, void *ptr, unsigned int size )
+{
+	if ( offset >= sf2Data.size() )
+		return 0;
+	if ( size > sf2Data.size() - offset )
+		size = (unsigned int)sf2Data.size() - offset;
+	memcpy( ptr, &sf2Data[ offset ], size );
+	return (int)size;
+}
+
+static void midiInitFont( bool streaming )
+{
+	if ( sf2Data.empty() )
+		sf2Generate();
+
+	if ( soundFont )
+		tsf_close( soundFont );
+
+	struct tsf_stream_memory mem = { (const char*)&sf2Data[ 0 ], (unsigned int)sf2Data.size(), 0 };
+	struct tsf_stream stream = { &mem, (int(*)(void*,void*,unsigned int))&tsf_stream_memory_read, (int(*)(void*,unsigned int))&tsf_stream_memory_skip };
+	if ( streaming )
+		soundFont = tsf_load_streaming( &stream, midiReadAt, NULL, MIDI_CACHE_SIZE ); else
+		soundFont = tsf_load( &stream );
+	if ( soundFont == NULL )
+	{
+		printf( "tsf: invalid SoundFont\n" );
+		exit( 1 );
+	}
+
+	tsf_set_output( soundFont, TSF_MONO, SAMPLERATE, 0.0f );
+	tsf_set_max_voices( soundFont, MIDI_MAX_VOICES );
+	midiSample = 0;
+}
+
+static void midiInit()
+{
+	midiInitFont( true );
+}
+
+// all samples in memory: the voices read the font directly instead of windows into the sample cache
+static void midiInitMemory()
+{
+	midiInitFont( false );
+}
+
+static void midiEvent( const EVENT &e )
+{
+	u32 ch = e.a & 15;
+	switch ( e.a & 0xf0 )
+	{
+	case 0x90: tsf_channel_note_on( soundFont, ch, e.b, e.c / 127.0f ); break;
+	case 0x80: tsf_channel_note_off( soundFont, ch, e.b ); break;
+	case 0xc0: tsf_channel_set_presetnumber( soundFont, ch, e.b, ch == 9 ); break;
+	case 0xb0: tsf_channel_midi_control( soundFont, ch, e.b, e.c ); break;
+	}
+}
+
+static void midiRender( s32 *dst, u32 n )
+{
+	u32 pos = 0;
+	while ( pos < n )
+	{
+		while ( eventPos < events.size() && events[ eventPos ].time <= midiSample + pos )
+			midiEvent( events[ eventPos ++ ] );
+
+		u32 end = n;
+		if ( eventPos < events.size() && events[ eventPos ].time < midiSample + n )
+			end = events[ eventPos ].time - midiSample;
+		end = min( end, pos + MIDI_RENDER_BLOCK );
+
+		// kernel_sid loads the pages between render blocks as well, here it always has the time to load all of them
+		tsf_cache_service( soundFont, -1 );
+
+		// tsf mixes into the buffer, kernel_sid clears it before rendering as well
+		memset( midiBuffer, 0, ( end - pos ) * sizeof( float ) );
+		tsf_render_float( soundFont, midiBuffer, end - pos, 0 );
+		for ( u32 i = pos; i < end; i++ )
+			dst[ i ] = (s32)( midiBuffer[ i - pos ] * 32767.0f );
+		pos = end;
+	}
+	midiSample += n;
+}
+
+static u32 midiStateBytes()
+{
+	return sizeof( tsf ) + soundFont->presetNum * sizeof( struct tsf_preset ) + soundFont->voiceNum * sizeof( struct tsf_voice );
+}
+
+//
+// YM files played by STSoundLib's CYmMusic as in kernel_MODplay (only with -ym)
+//
+static std::vector<u8> ymFileData;
+static CYmMusic *ymMusic = NULL;
+
+static void ymFileGenerate( std::vector<EVENT> &ev, u32 seconds )
+{
+}
+
+static void ymFileInit()
+{
+	// CYmMusic depacks and keeps its own copy
+	std::vector<u8> data( ymFileData );
+
+	delete ymMusic;
+	ymMusic = new CYmMusic( SAMPLERATE );
+	if ( !ymMusic->loadMemory( &data[ 0 ], (ymu32)data.size() ) )
+	{
+		printf( "CYmMusic: %s\n", ymMusic->getLastError() );
+		exit( 1 );
+	}
+	ymMusic->setLoopMode( YMTRUE );
+	ymMusic->play();
+}
+
+static void ymFileRender( s32 *dst, u32 n )
+{
+	while ( n > 0 )
+	{
+		u32 block = min( n, (u32)MIDI_RENDER_BLOCK );
+		ymMusic->update( ymBuffer, block );
+		for ( u32 i = 0; i < block; i++ )
+			*dst++ = ymBuffer[ i ];
+		n -= block;
+	}
+}
+
+static u32 ymFileStateBytes()
+{
+	return sizeof( CYmMusic ) + (u32)ymFileData.size();
+}
+
+static bool ymFileAvailable()
+{
+	return !ymFileData.empty();
+}
+
+static const ENGINE engines[] =
+{
+	{ "resid6581",	SAMPLERATE, sidGenerate,	sidInit6581,	sidRender,	sidStateBytes,	NULL, NULL },
+	{ "resid8580",	SAMPLERATE, sidGenerate,	sidInit8580,	sidRender,	sidStateBytes,	NULL, NULL },
+	{ "resid8580rs", SAMPLERATE, sidGenerate,	sidInit8580Resample, sidRenderResample, sidStateBytes, NULL, NULL },
+	{ "fmopl",		SAMPLERATE, oplGenerate,	oplInit,		oplRender,	oplStateBytes,	NULL, NULL },
+	{ "fmoplblock",	SAMPLERATE, oplGenerate,	oplInit,		oplBlockRender, oplStateBytes, NULL, "fmopl" },
+	{ "sidfmcycle",	SAMPLERATE, sidfmGenerate,	sidfmInit,		sidfmCycleRender, sidfmStateBytes, NULL, NULL },
+	{ "sidfm",		SAMPLERATE, sidfmGenerate,	sidfmInit,		sidfmRender, sidfmStateBytes, NULL, "sidfmcycle" },
+	{ "ted",		SAMPLERATE, tedGenerate,	tedInit,		tedRender,	tedStateBytes,	NULL, NULL },
+	{ "tedblock",	SAMPLERATE, tedGenerate,	tedInit,		tedBlockRender, tedStateBytes, NULL, "ted" },
+	{ "ym2149",		SAMPLERATE, ymGenerate,		ymInit,			ymRender,	ymStateBytes,	NULL, NULL },
+	{ "pocketmod",	SAMPLERATE, modGenerate,	modInit,		modRender,	modStateBytes,	NULL, NULL },
+	{ "tsf",		SAMPLERATE, midiGenerate,	midiInit,		midiRender,	midiStateBytes,	NULL, NULL },
+	{ "tsfmemory",	SAMPLERATE, midiGenerate,	midiInitMemory,	midiRender,	midiStateBytes,	NULL, "tsf" },
+	{ "ymfile",		SAMPLERATE, ymFileGenerate,	ymFileInit,		ymFileRender, ymFileStateBytes, ymFileAvailable, NULL },
+};
+
+// name of the streams and reference output of an engine
+static const char *engineStreams( const ENGINE *e )
+{
+	return e->reference ? e->reference : e->name;
+}
+
+// seed of the stream generator, engines reproducing another one get the same streams
+static u32 engineSeed( const ENGINE *e )
+{
+	u32 k = 0;
+	while ( strcmp( engines[ k ].name, engineStreams( e ) ) )
+		k ++;
+	return 0x5eed + k;
+}
+
+static bool loadEvents( const char *dir, const char *name, std::vector<EVENT> &ev )
+{
+	char filename[ 1024 ];
+	snprintf( filename, sizeof( filename ), "%s/%s.evt", dir, name );
+
+	FILE *f = fopen( filename, "rb" );
+	if ( f == NULL )
+		return false;
+
+	EVENT e;
+	ev.clear();
+	while ( fread( &e, sizeof( EVENT ), 1, f ) == 1 )
+		ev.push_back( e );
+	fclose( f );
+	return true;
+}
+
+static void saveEvents( const char *dir, const char *name, const std::vector<EVENT> &ev )
+{
+	char filename[ 1024 ];
+	snprintf( filename, sizeof( filename ), "%s/%s.evt", dir, name );
+
+	FILE *f = fopen( filename, "wb" );
+	if ( f == NULL )
+	{
+		printf( "cannot write %s\n", filename );
+		return;
+	}
+	if ( !ev.empty() )
+		fwrite( &ev[ 0 ], sizeof( EVENT ), ev.size(), f );
+	fclose( f );
+}
+
+static bool loadBinary( const char *filename, std::vector<u8> &data )
+{
+	FILE *f = fopen( filename, "rb" );
+	if ( f == NULL )
+		return false;
+	fseek( f, 0, SEEK_END );
+	data.resize( ftell( f ) );
+	fseek( f, 0, SEEK_SET );
+	bool ok = fread( &data[ 0 ], 1, data.size(), f ) == data.size();
+	fclose( f );
+	return ok;
+}
+
+#endif